@@ -2,6 +2,8 @@
 #include "Log/SimpleNetChannelLog.h"
 #include "Global/SimpleNetGlobalInfo.h"
 #include "Connetion/Core/SimpleConnetion.h"
+#include "SimpleNetManage.h"
+#include "Timer/SimpleNetTimerWheel.h"
 #include "Misc/ScopeLock.h"
 
 FSimpleNetBatchManage::FSimpleNetBatchManage()
@@ -10,6 +12,8 @@ FSimpleNetBatchManage::FSimpleNetBatchManage()
 
 FSimpleNetBatchManage::~FSimpleNetBatchManage()
 {
+	//定时器绑定的是this
+	Reset();
 }
 
 void FSimpleNetBatchManage::SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionPtr)
@@ -17,92 +21,239 @@ void FSimpleNetBatchManage::SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionP
 	ConnetionPtr = InConnetionPtr;
 }
 
-void FSimpleNetBatchManage::Tick(float DeltaSeconds)
+FSimpleNetTimerWheel* FSimpleNetBatchManage::GetTimerWheel() const
+{
+	if (TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin())
+	{
+		if (FSimpleNetManage* Manage = Connetion->GetManage())
+		{
+			return &Manage->GetTimerWheel();
+		}
+	}
+
+	return nullptr;
+}
+
+double FSimpleNetBatchManage::GetTime() const
+{
+	if (FSimpleNetTimerWheel* TimerWheel = GetTimerWheel())
+	{
+		return TimerWheel->GetTime();
+	}
+
+	return 0.0;
+}
+
+void FSimpleNetBatchManage::ScheduleRepackaging(FSimpleNetBatchManage::FBatch& InBatch, const FGuid& InGuid, float InDelay)
+{
+	if (FSimpleNetTimerWheel* TimerWheel = GetTimerWheel())
+	{
+		InBatch.RepackagingTimer = TimerWheel->Schedule(InDelay, FSimpleDelegate::CreateRaw(this, &FSimpleNetBatchManage::Repackaging, InGuid));
+	}
+}
+
+void FSimpleNetBatchManage::Repackaging(FGuid InGuid)
 {
 	FScopeLock ScopeLock(&BatchsReadWrite);
 
-	if (ConnetionPtr.IsValid())
+	FBatch* Batch = Batchs.Find(InGuid);
+	if (!Batch)
+	{
+		//通道关闭时已经清理
+		return;
+	}
+
+	//已经到期 不需要再取消
+	Batch->RepackagingTimer = 0;
+
+	TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin();
+	if (Batch->bAck || !Connetion.IsValid())
 	{
-		TArray<FGuid> RemoveBatchID;
-		
-		for (auto& Tmp : Batchs)
+		Discard(*Batch);
+		Batchs.Remove(InGuid);
+		return;
+	}
+
+	const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+
+	//拥塞控制打开时 重传超时跟着往返时间走
+	FSimpleNetCongestion& Congestion = Connetion->GetCongestion();
+	float RepackagingTime = ConfigInfo.bCongestionControl ? (float)Congestion.GetRTO() : ConfigInfo.RepackagingTime;
+
+	float NextDelay = RepackagingTime;
+	if (ConfigInfo.bRepackaging)
+	{
+		double CurrentTime = GetTime();
+		bool bTimeout = false;
+
+		//对方还没有回应握手 重发握手
+		if (Batch->NextSend == 0 && Batch->Handshake.Num() > 0)
 		{
-			if (Tmp.Value.bAck)
+			double ElapsedTime = CurrentTime - Batch->HandshakeTime;
+			if (ElapsedTime >= RepackagingTime)
 			{
-				RemoveBatchID.Add(Tmp.Key);
+				Batch->HandshakeTime = CurrentTime;
+				Batch->HandshakeRepeatCount++;
+				bTimeout = true;
+
+				Connetion->Send(Batch->Handshake);
+
+				if (Batch->HandshakeRepeatCount >= ConfigInfo.RepackagingFrequency)
+				{
+					UE_LOG(LogSimpleNetChannel, Error, TEXT("Unable to get handshake confirmation, whether the other party is offline."));
+
+					Discard(*Batch);
+					Batchs.Remove(InGuid);
+					return;
+				}
 			}
 			else
 			{
-				if (FSimpleNetGlobalInfo::Get()->GetInfo().bRepackaging)
+				NextDelay = RepackagingTime - ElapsedTime;
+			}
+		}
+		else
+		{
+			for (auto& TmpSequence : Batch->Sequence)
+			{
+				FBatch::FElement& Element = TmpSequence.Value;
+
+				//Do you want to start the packet replenishment test
+				if (Element.bStartUpRepackaging && !Element.bAck)
 				{
-					for (auto& TmpSequence : Tmp.Value.Sequence)
+					double ElapsedTime = CurrentTime - Element.SendTime;
+					if (ElapsedTime >= RepackagingTime)
 					{
-						//Do you want to start the packet replenishment test
-						if (TmpSequence.Value.bStartUpRepackaging)
+						Element.SendTime = CurrentTime;
+						Element.RepeatCount++;
+						bTimeout = true;
+
+						//Repackaging
+						Connetion->Send(Element.Package, Element.Body);
+
+						if (ConfigInfo.bCongestionControl)
+						{
+							Congestion.ForceConsumeTokens(Element.Package.Num() + Element.Body.Size, CurrentTime);
+							Congestion.OnSend(true);
+						}
+
+						if (Element.RepeatCount >= ConfigInfo.RepackagingFrequency)
 						{
-							//Do you complete the repackaging
-							if (!TmpSequence.Value.bAck)
-							{
-								TmpSequence.Value.CurrentTime += DeltaSeconds;
-								if (TmpSequence.Value.CurrentTime >= FSimpleNetGlobalInfo::Get()->GetInfo().RepackagingTime)
-								{
-									TmpSequence.Value.CurrentTime = 0.f;
-									TmpSequence.Value.RepeatCount++;
-
-									//Repackaging
-									ConnetionPtr.Pin()->Send(TmpSequence.Value.Package);
-
-									if (TmpSequence.Value.RepeatCount >= FSimpleNetGlobalInfo::Get()->GetInfo().RepackagingFrequency)
-									{
-										//Start cleaning to prevent protocol attacks
-										Tmp.Value.bAck = true;
-
-										UE_LOG(LogSimpleNetChannel, Error, TEXT("Unable to get client acceptance confirmation,Please check whether the local sending buffer is too large, or the opposite receiving buffer is too small, or whether the other party is offline."));
-										break;
-									}
-								}
-							}
+							//Start cleaning to prevent protocol attacks
+							UE_LOG(LogSimpleNetChannel, Error, TEXT("Unable to get client acceptance confirmation,Please check whether the local sending buffer is too large, or the opposite receiving buffer is too small, or whether the other party is offline."));
+
+							Discard(*Batch);
+							Batchs.Remove(InGuid);
+							return;
 						}
 					}
+					else
+					{
+						NextDelay = FMath::Min(NextDelay, (float)(RepackagingTime - ElapsedTime));
+					}
 				}
 			}
 		}
 
-		for (auto& Tmp : RemoveBatchID)
+		//一次定时器只算一次超时 窗口回到1 重传超时翻倍
+		if (bTimeout && ConfigInfo.bCongestionControl)
 		{
-			Batchs.Remove(Tmp);
+			Congestion.OnTimeout();
 		}
 	}
+
+	ScheduleRepackaging(*Batch, InGuid, NextDelay);
 }
 
-void FSimpleNetBatchManage::Add(const FGuid& InGuid, const FSimpleNetBatchManage::FBatch& InCache)
+void FSimpleNetBatchManage::Discard(FSimpleNetBatchManage::FBatch& InBatch)
 {
-	FScopeLock ScopeLock(&BatchsReadWrite);
+	if (InBatch.RepackagingTimer != 0)
+	{
+		if (FSimpleNetTimerWheel* TimerWheel = GetTimerWheel())
+		{
+			TimerWheel->Cancel(InBatch.RepackagingTimer);
+		}
+
+		InBatch.RepackagingTimer = 0;
+	}
+
+	if (!FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl)
+	{
+		return;
+	}
+
+	TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin();
+	if (!Connetion.IsValid())
+	{
+		return;
+	}
+
+	int32 InFlightNum = 0;
+	for (auto& Tmp : InBatch.Sequence)
+	{
+		if (Tmp.Value.bStartUpRepackaging && !Tmp.Value.bAck)
+		{
+			InFlightNum++;
+		}
+	}
 
-	Batchs.Add(InGuid, InCache);
+	if (InFlightNum > 0)
+	{
+		Connetion->GetCongestion().OnDiscard(InFlightNum);
+	}
 }
 
-FSimpleNetBatchManage::FBatch* FSimpleNetBatchManage::Find(const FGuid& InGuid)
+void FSimpleNetBatchManage::Add(const FGuid& InGuid, FSimpleNetBatchManage::FBatch&& InCache)
 {
 	FScopeLock ScopeLock(&BatchsReadWrite);
 
-	FSimpleNetBatchManage::FBatch* InBatch = nullptr;
+	FBatch& Batch = Batchs.Add(InGuid, MoveTemp(InCache));
+	Batch.HandshakeTime = GetTime();
 
-	InBatch = Batchs.Find(InGuid);
+	float RepackagingTime = FSimpleNetGlobalInfo::Get()->GetInfo().RepackagingTime;
+	if (FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl)
+	{
+		if (TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin())
+		{
+			RepackagingTime = Connetion->GetCongestion().GetRTO();
+		}
+	}
 
-	return InBatch;
+	ScheduleRepackaging(Batch, InGuid, RepackagingTime);
+}
+
+bool FSimpleNetBatchManage::WithBatch(const FGuid& InGuid, TFunctionRef<void(FSimpleNetBatchManage::FBatch&)> InFunc)
+{
+	FScopeLock ScopeLock(&BatchsReadWrite);
+
+	if (FBatch* Batch = Batchs.Find(InGuid))
+	{
+		InFunc(*Batch);
+		return true;
+	}
+
+	return false;
 }
 
 void FSimpleNetBatchManage::Remove(const FGuid& InGuid)
 {
 	FScopeLock ScopeLock(&BatchsReadWrite);
 
-	Batchs.Remove(InGuid);
+	if (FBatch* Batch = Batchs.Find(InGuid))
+	{
+		Discard(*Batch);
+		Batchs.Remove(InGuid);
+	}
 }
 
 void FSimpleNetBatchManage::Reset()
 {
 	FScopeLock ScopeLock(&BatchsReadWrite);
 
+	for (auto& Tmp : Batchs)
+	{
+		Discard(Tmp.Value);
+	}
+
 	Batchs.Empty();
 }
\ No newline at end of file
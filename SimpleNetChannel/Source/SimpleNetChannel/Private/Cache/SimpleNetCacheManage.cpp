@@ -1,16 +1,35 @@
 #include "Cache/SimpleNetCacheManage.h"
+#include "Global/SimpleNetGlobalInfo.h"
 #include "Misc/ScopeLock.h"
 
 FSimpleNetCacheManage::FSimpleNetCacheManage()
+	:FreeBufferSize(0)
+	, AllocateNum(0)
+	, ReuseNum(0)
 {
 
 }
 
-void FSimpleNetCacheManage::Add(const FGuid& InGuid, const FSimpleNetCacheManage::FCache& InCache)
+FSimpleNetCacheManage::FCache* FSimpleNetCacheManage::Create(const FGuid& InGuid, uint32 InTotalSize, uint32 InChunkSize)
 {
+	if (InTotalSize > (uint32)FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().MaxPackageSize, 0))
+	{
+		return nullptr;
+	}
+
 	FScopeLock ScopeLock(&CachesReadWrite);
 
-	Caches.Add(InGuid, InCache);
+	if (FSimpleNetCacheManage::FCache* InCache = Caches.Find(InGuid))
+	{
+		ReleaseBuffer(InCache->Cache);
+		Caches.Remove(InGuid);
+	}
+
+	FSimpleNetCacheManage::FCache& NewCache = Caches.Add(InGuid);
+	NewCache.Cache = AcquireBuffer(InTotalSize);
+	NewCache.Init(InTotalSize, InChunkSize);
+
+	return &NewCache;
 }
 
 FSimpleNetCacheManage::FCache* FSimpleNetCacheManage::Find(const FGuid& InGuid)
@@ -27,7 +46,11 @@ void FSimpleNetCacheManage::Remove(const FGuid& InGuid)
 {
 	FScopeLock ScopeLock(&CachesReadWrite);
 
-	Caches.Remove(InGuid);
+	if (FSimpleNetCacheManage::FCache* InCache = Caches.Find(InGuid))
+	{
+		ReleaseBuffer(InCache->Cache);
+		Caches.Remove(InGuid);
+	}
 }
 
 void FSimpleNetCacheManage::Reset()
@@ -35,6 +58,63 @@ void FSimpleNetCacheManage::Reset()
 	FScopeLock ScopeLock(&CachesReadWrite);
 
 	Caches.Empty();
+
+	for (int32 i = 0; i < BufferClassNum; i++)
+	{
+		FreeBuffers[i].Empty();
+	}
+
+	FreeBufferSize = 0;
+}
+
+TArray<uint8> FSimpleNetCacheManage::AcquireBuffer(uint32 InSize)
+{
+	TArray<uint8> Buffer;
+
+	uint32 Bits = FMath::Max(FMath::CeilLogTwo(InSize), (uint32)MinBufferBits);
+	if (Bits > MaxBufferBits)
+	{
+		//超大的包不进池子
+		AllocateNum++;
+		Buffer.Reserve(InSize);
+
+		return Buffer;
+	}
+
+	//同一级里的缓冲都能装下这一级最大的包
+	TArray<TArray<uint8>>& ClassBuffers = FreeBuffers[Bits - MinBufferBits];
+	if (ClassBuffers.Num() > 0)
+	{
+		ReuseNum++;
+		Buffer = ClassBuffers.Pop(false);
+		FreeBufferSize -= Buffer.Max();
+	}
+	else
+	{
+		AllocateNum++;
+		Buffer.Reserve(1 << Bits);
+	}
+
+	return Buffer;
+}
+
+void FSimpleNetCacheManage::ReleaseBuffer(TArray<uint8>& InBuffer)
+{
+	uint32 Capacity = (uint32)InBuffer.Max();
+	uint32 Bits = Capacity > 0 ? FMath::FloorLog2(Capacity) : 0;
+
+	if (Bits >= MinBufferBits && Bits <= MaxBufferBits &&
+		FreeBufferSize + Capacity <= (uint32)FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().CacheArenaSize, 0))
+	{
+		InBuffer.Reset();
+
+		FreeBufferSize += Capacity;
+		FreeBuffers[Bits - MinBufferBits].Add(MoveTemp(InBuffer));
+	}
+	else
+	{
+		InBuffer.Empty();
+	}
 }
 
 FSimpleNetCacheManage::FCache::FCache()
@@ -45,5 +125,77 @@ FSimpleNetCacheManage::FCache::FCache()
 void FSimpleNetCacheManage::FCache::Reset()
 {
 	TotalSize = 0;
-	Cache.Empty();
+	Cache.Reset();
+
+	ChunkSize = 0;
+	RecvSize = 0;
+	AckBase = 0;
+	Received.Empty();
+	StartTime = 0.0;
+}
+
+void FSimpleNetCacheManage::FCache::Init(uint32 InTotalSize, uint32 InChunkSize)
+{
+	Reset();
+
+	TotalSize = InTotalSize;
+	ChunkSize = (InChunkSize == 0 || InChunkSize > InTotalSize) ? InTotalSize : InChunkSize;
+
+	Cache.SetNumUninitialized(TotalSize, false);
+	if (ChunkSize > 0)
+	{
+		Received.Init(false, (TotalSize + ChunkSize - 1) / ChunkSize);
+	}
+
+	StartTime = FPlatformTime::Seconds();
+}
+
+bool FSimpleNetCacheManage::FCache::Write(int32 InIndex, const uint8* InData, int32 InLen)
+{
+	if (InIndex < 0 || InIndex >= Received.Num())
+	{
+		return false;
+	}
+
+	uint32 Offset = (uint32)InIndex * ChunkSize;
+	uint32 ExpectSize = FMath::Min(ChunkSize, TotalSize - Offset);
+	if ((uint32)InLen != ExpectSize)
+	{
+		return false;
+	}
+
+	if (!Received[InIndex])
+	{
+		FMemory::Memcpy(&Cache[Offset], InData, InLen);
+
+		Received[InIndex] = true;
+		RecvSize += InLen;
+
+		while (AckBase < Received.Num() && Received[AckBase])
+		{
+			AckBase++;
+		}
+	}
+
+	return true;
+}
+
+uint32 FSimpleNetCacheManage::FCache::GetAckBits() const
+{
+	uint32 AckBits = 0;
+	for (int32 i = 0; i < 32; i++)
+	{
+		int32 Index = AckBase + 1 + i;
+		if (Index >= Received.Num())
+		{
+			break;
+		}
+
+		if (Received[Index])
+		{
+			AckBits |= (1u << i);
+		}
+	}
+
+	return AckBits;
 }
\ No newline at end of file
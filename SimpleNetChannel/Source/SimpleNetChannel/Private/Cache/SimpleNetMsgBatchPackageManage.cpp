@@ -1,94 +1,258 @@
 #include "Cache/SimpleNetMsgBatchPackageManage.h"
-#include "Misc/ScopeLock.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "Log/SimpleNetChannelLog.h"
+#include "Misc/ScopeRWLock.h"
 
 FSimpleNetMsgBatchPackageManage::FSimpleNetMsgBatchPackageManage()
+	:Slots(nullptr)
+	, Capacity(FMath::RoundUpToPowerOfTwo(FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().MsgQueueSize, 2)))
+	, MaxCapacity(FMath::Max<uint64>(FMath::RoundUpToPowerOfTwo(FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().MsgQueueMaxSize, 2)), Capacity))
+	, EnqueuePos(0)
+	, DequeuePos(0)
+	, MsgQueueID(0)
+	, Received(0)
+	, Discarded(0)
+	, HighWater(0)
+	, Grown(0)
 {
 }
 
-FSimpleNetMsgBatchPackageManage::~FSimpleNetMsgBatchPackageManage()
+FSimpleNetMsgBatchPackageManage::FSimpleNetMsgBatchPackageManage(const FSimpleNetMsgBatchPackageManage& InOther)
+	:FSimpleNetMsgBatchPackageManage()
+{
+}
+
+FSimpleNetMsgBatchPackageManage& FSimpleNetMsgBatchPackageManage::operator=(const FSimpleNetMsgBatchPackageManage& InOther)
 {
+	Reset();
+	return *this;
 }
 
-void FSimpleNetMsgBatchPackageManage::SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionPtr)
+FSimpleNetMsgBatchPackageManage::~FSimpleNetMsgBatchPackageManage()
 {
+	delete[] Slots;
 }
 
-void FSimpleNetMsgBatchPackageManage::Tick(float DeltaSeconds)
+bool FSimpleNetMsgBatchPackageManage::TryAdd(TArray<uint8>& InData, uint64& OutID)
 {
+	FReadScopeLock ReadScopeLock(SlotsLock);
+
+	if (!Slots)
 	{
-		FScopeLock ScopeLock(&ThreadCritical);
+		return false;
+	}
 
-		TArray<FGuid> RemoveOutTimeQueue;
-		for (auto& Tmp : MsgQueue)
+	uint64 Pos = EnqueuePos.load(std::memory_order_relaxed);
+	FSlot* Slot = nullptr;
+	for (;;)
+	{
+		Slot = &Slots[Pos & (Capacity - 1)];
+		uint64 Sequence = Slot->Sequence.load(std::memory_order_acquire);
+		int64 Diff = (int64)Sequence - (int64)Pos;
+		if (Diff == 0)
 		{
-			Tmp.Value.Tick(DeltaSeconds);
-
-			if (Tmp.Value.bOutTime)
+			if (EnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
 			{
-				RemoveOutTimeQueue.Add(Tmp.Key);
+				break;
 			}
 		}
-
-		for (auto& Tmp : RemoveOutTimeQueue)
+		else if (Diff < 0)
 		{
-			MsgQueue.Remove(Tmp);
+			//消费者跟不上 交给扩容
+			return false;
+		}
+		else
+		{
+			Pos = EnqueuePos.load(std::memory_order_relaxed);
 		}
 	}
+
+	Slot->Data = MoveTemp(InData);
+	Slot->Sequence.store(Pos + 1, std::memory_order_release);
+
+	OutID = Pos + 1;
+	return true;
 }
 
-void FSimpleNetMsgBatchPackageManage::Add(const FGuid& InGuid, TArray<uint8>& InData)
+bool FSimpleNetMsgBatchPackageManage::Grow()
 {
-	FScopeLock ScopeLock(&ThreadCritical);
+	FWriteScopeLock WriteScopeLock(SlotsLock);
 
-	MsgQueue.Add(InGuid, FMsgBatchPackage());
+	//写锁里没有正在写入的生产者 也没有正在读取的消费者 积压的位置都已经写完
+	uint64 Enqueue = EnqueuePos.load(std::memory_order_relaxed);
+	if (Slots && Enqueue - DequeuePos < Capacity)
+	{
+		//别的生产者已经扩过了 或者消费者已经取走了一些
+		return true;
+	}
 
-	FMsgBatchPackage& InBatchPackage = MsgQueue[InGuid];
-	InBatchPackage.Data = MoveTemp(InData);
-}
+	if (Slots && Capacity >= MaxCapacity)
+	{
+		//消费者长时间跟不上 再扩下去只会把内存吃光
+		return false;
+	}
 
-bool FSimpleNetMsgBatchPackageManage::Receive(TArray<uint8>& InData)
-{
-	FScopeLock ScopeLock(&ThreadCritical);
+	uint64 NewCapacity = Slots ? Capacity * 2 : Capacity;
+	FSlot* NewSlots = new FSlot[NewCapacity];
 
-	//check(MsgQueueGuid.IsValid());
+	//空位的序号就是下一次写到这里的位置
+	for (uint64 Pos = Enqueue; Pos < DequeuePos + NewCapacity; Pos++)
+	{
+		NewSlots[Pos & (NewCapacity - 1)].Sequence.store(Pos, std::memory_order_relaxed);
+	}
 
-	if (FMsgBatchPackage* InBatchPackage = MsgQueue.Find(MsgQueueGuid))
+	//积压的消息按位置搬过去 消息ID不变
+	for (uint64 Pos = DequeuePos; Pos < Enqueue; Pos++)
 	{
-		InData = MoveTemp(InBatchPackage->Data);
-		MsgQueue.Remove(MsgQueueGuid);
+		FSlot& Slot = NewSlots[Pos & (NewCapacity - 1)];
+		Slot.Data = MoveTemp(Slots[Pos & (Capacity - 1)].Data);
+		Slot.Sequence.store(Pos + 1, std::memory_order_relaxed);
+	}
 
-		return true;
+	if (Slots)
+	{
+		Grown++;
+		UE_LOG(LogSimpleNetChannel, Warning, TEXT("Channel message queue is full, grow to %llu."), NewCapacity);
+
+		delete[] Slots;
 	}
 
-	return false;
+	Slots = NewSlots;
+	Capacity = NewCapacity;
+
+	return true;
 }
 
-void FSimpleNetMsgBatchPackageManage::Reset()
+uint64 FSimpleNetMsgBatchPackageManage::Add(TArray<uint8>& InData)
 {
-	FScopeLock ScopeLock(&ThreadCritical);
+	uint64 ID = 0;
+	while (!TryAdd(InData, ID))
+	{
+		if (!Grow())
+		{
+			if (Rejected.Increment() == 1)
+			{
+				UE_LOG(LogSimpleNetChannel, Error, TEXT("Channel message queue reached MsgQueueMaxSize %llu, new messages are rejected."), MaxCapacity);
+			}
+
+			return 0;
+		}
+	}
+
+	Pushed.Increment();
 
-	MsgQueue.Empty();
+	return ID;
 }
 
-void FSimpleNetMsgBatchPackageManage::SetMsgQueueGuid(const FGuid& InNewGuid)
+bool FSimpleNetMsgBatchPackageManage::WaitForHead(FSlot*& OutSlot)
 {
-	MsgQueueGuid = InNewGuid;
+	if (!Slots)
+	{
+		return false;
+	}
+
+	OutSlot = &Slots[DequeuePos & (Capacity - 1)];
+	while (OutSlot->Sequence.load(std::memory_order_acquire) != DequeuePos + 1)
+	{
+		//没有生产者占住这个位置 说明是空的
+		if (EnqueuePos.load(std::memory_order_relaxed) <= DequeuePos)
+		{
+			return false;
+		}
+
+		FPlatformProcess::Yield();
+	}
+
+	return true;
+}
+
+void FSimpleNetMsgBatchPackageManage::PopHead(FSlot& InSlot)
+{
+	InSlot.Sequence.store(DequeuePos + Capacity, std::memory_order_release);
+	DequeuePos++;
 }
 
-FSimpleNetMsgBatchPackageManage::FMsgBatchPackage::FMsgBatchPackage()
+void FSimpleNetMsgBatchPackageManage::SetMsgQueueID(uint64 InID)
 {
-	CurrentTime = 0.f;
-	bOutTime = false;
+	FReadScopeLock ReadScopeLock(SlotsLock);
+
+	MsgQueueID = InID;
+
+	int64 Backlog = (int64)(EnqueuePos.load(std::memory_order_relaxed) - DequeuePos);
+	HighWater = FMath::Max(HighWater, Backlog);
+
+	//比当前旧的消息是没有被Receive取走的 不会再有人要了
+	FSlot* Slot = nullptr;
+	while (InID != 0 && DequeuePos + 1 < InID && WaitForHead(Slot))
+	{
+		Slot->Data.Empty();
+		PopHead(*Slot);
+		Discarded++;
+	}
 }
 
-void FSimpleNetMsgBatchPackageManage::FMsgBatchPackage::Tick(float DeltaSeconds)
+bool FSimpleNetMsgBatchPackageManage::Receive(TArray<uint8>& InData)
 {
-	if (!bOutTime)
+	if (MsgQueueID == 0)
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadScopeLock(SlotsLock);
+
+	FSlot* Slot = nullptr;
+	while (WaitForHead(Slot))
 	{
-		CurrentTime += DeltaSeconds;
-		if (CurrentTime >= 10.f)
+		uint64 ID = DequeuePos + 1;
+		if (ID < MsgQueueID)
 		{
-			bOutTime = true;
+			Slot->Data.Empty();
+			PopHead(*Slot);
+			Discarded++;
 		}
+		else if (ID == MsgQueueID)
+		{
+			InData = MoveTemp(Slot->Data);
+			PopHead(*Slot);
+			Received++;
+
+			//一条消息只能取一次
+			MsgQueueID = 0;
+			return true;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return false;
+}
+
+void FSimpleNetMsgBatchPackageManage::Reset()
+{
+	FReadScopeLock ReadScopeLock(SlotsLock);
+
+	FSlot* Slot = nullptr;
+	while (WaitForHead(Slot))
+	{
+		Slot->Data.Empty();
+		PopHead(*Slot);
 	}
-}
\ No newline at end of file
+
+	MsgQueueID = 0;
+}
+
+FSimpleNetMsgQueueStats FSimpleNetMsgBatchPackageManage::GetStats() const
+{
+	FSimpleNetMsgQueueStats Stats;
+	Stats.Pushed = Pushed.GetValue();
+	Stats.Received = Received;
+	Stats.Discarded = Discarded;
+	Stats.Grown = Grown;
+	Stats.Rejected = Rejected.GetValue();
+	Stats.Capacity = Slots ? Capacity : 0;
+	Stats.HighWater = HighWater;
+
+	return Stats;
+}
@@ -9,6 +9,8 @@
 #include "Protocols/SimpleNetProtocols.h"
 #include "Log/SimpleNetChannelLog.h"
 #include "Async/TaskGraphInterfaces.h"
+#include "HAL/Event.h"
+#include "Core/Compression/SimpleNetCompression.h"
 
  FSimpleReturnDelegate FSimpleChannel::SimpleControllerDelegate;
  FSimpleReturnDelegate FSimpleChannel::SimplePlayerDelegate;
@@ -18,6 +20,12 @@
 #endif
 
 FSimpleChannel::FSimpleChannel()
+	:Priority(ESimpleNetChannelPriority::NORMAL)
+	,Weight(1)
+	,bObjectPending(false)
+	,bInitPending(false)
+	,ObjectSerial(0)
+	,Index(INDEX_NONE)
 {
 	TagBackups = 0;
 }
@@ -29,24 +37,41 @@ void FSimpleChannel::Init()
 
 void FSimpleChannel::PreClose()
 {
-	if (Object.IsValid())
-	{
-		Object->Close();
-	}
+	CancelSynchronize();
 }
 
 void FSimpleChannel::Close()
 {	
-	if (Object.IsValid())
+	ReleaseObject();
+
+	//离开视野网格 通道会被下一个链接复用
+	if (TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin())
 	{
-		Object->MarkAsGarbage();
-		Object.Reset();
-		Object = NULL;
+		if (FSimpleNetManage* InManage = Connetion->GetManage())
+		{
+			InManage->GetInterestGrid().Remove(this);
+		}
 	}
 
-	ID = FGuid();
+	SetGuid(FGuid());
 	BatchManage.Reset();
+
+	{
+		FScopeLock ScopeLock(&ThreadMsgMutex);
+		ThreadMsgs.Empty();
+	}
+
 	BatchPackageManage.Reset();
+	Replication.Reset();
+
+	//通道会被下一个链接复用
+	SetPriority(ESimpleNetChannelPriority::NORMAL);
+}
+
+void FSimpleChannel::SetPriority(ESimpleNetChannelPriority InPriority, int32 InWeight)
+{
+	Priority = InPriority < ESimpleNetChannelPriority::MAX ? InPriority : ESimpleNetChannelPriority::NORMAL;
+	Weight = FMath::Max(InWeight, 1);
 }
 
 void FSimpleChannel::Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNewAddr, bool bForceSend)
@@ -64,44 +89,71 @@ void FSimpleChannel::Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNew
 				}
 			}
 
+			if (FSimpleNetManage* InManage = ConnetionPtr.Pin()->GetManage())
+			{
+				InManage->SendCaptureDelegate.ExecuteIfBound(this, InData);
+			}
+
+			//分片之前压缩 大消息少拆几片
+			if (ConnetionPtr.Pin()->HasSendWireFeature(ESimpleNetWireFeature::COMPRESSION))
+			{
+				SimpleNetCompression::Compress(InData, FSimpleNetGlobalInfo::Get()->GetInfo().CompressionThreshold);
+				HeadPtr = (FSimpleBunchHead*)InData.GetData();
+			}
+
 			FSimpleBunchHead Head = *HeadPtr;
 
+			if (FSimpleNetManage* InManage = ConnetionPtr.Pin()->GetManage())
+			{
+				InManage->GetProtocolTelemetry().OnSend(Head.ProtocolsNumber, InData.Num());
+			}
+
 			TArray<uint8> OutData;
 			BuildBytes(InData, OutData, bForceSend);
 
 			if (OutData.Num() > 0)
 			{
+				//如果TagBackups不等于零 代表它是接受方 无需等待
+				//发送方在发出前注册 回应可能比Send返回得还快
+				FEvent* SynchronizeEvent = nullptr;
+				if (TagBackups == 0 && !Head.bAsynchronous)
+				{
+					SynchronizeEvent = FPlatformProcess::GetSynchEventFromPool(true);
+
+					FScopeLock ScopeLock(&SynchronizeMutex);
+					SynchronizeTag.Add(Head.Tag, SynchronizeEvent);
+				}
+
 				ConnetionPtr.Pin()->Send(OutData, InNewAddr);
 
 				if (TagBackups != 0)//如果不等于零 说明是被发送方
 				{
-					//如果不等于零 代表它是接受方 无需等待
 					TagBackups = 0;
 				}
-				else if (!Head.bAsynchronous)//如果执行到这里，代表是发送方
+				else if (SynchronizeEvent)//如果执行到这里，代表是发送方
 				{
-					uint64 InTag = Head.Tag;
+					//同步等待前先把自己发出去 不等下一个网络Tick
+					ConnetionPtr.Pin()->FlushSend();
 
-					SynchronizeTag.Add(InTag);
-					
-					FDateTime LastDataTime = FDateTime::Now();
+					float WaitSecond = FSimpleNetGlobalInfo::Get()->GetInfo().OutTimeSynchronizationTime;
+					if (!SynchronizeEvent->Wait(FTimespan::FromSeconds(WaitSecond)))
+					{
+						UE_LOG(LogSimpleNetChannel, Warning, TEXT("Synchronous protocol %u did not get a response within %.2f seconds."), Head.ProtocolsNumber, WaitSecond);
+					}
 
-					bool bBreakCheck = false;
-					while (SynchronizeTag.Contains(InTag) && !bBreakCheck)
+					//回应留给这个线程接下来的Receive
 					{
-						FPlatformProcess::Sleep(0.03f);
+						FScopeLock ScopeLock(&SynchronizeMutex);
+						SynchronizeTag.Remove(Head.Tag);
 
-						FDateTime CurrentDataTime = FDateTime::Now();
-						FDateTime TimeInterval = CurrentDataTime.GetTicks() - LastDataTime.GetTicks();
-					
-						float WaitSecond =(float)TimeInterval.GetSecond();
-						if (WaitSecond >= FSimpleNetGlobalInfo::Get()->GetInfo().OutTimeSynchronizationTime)
+						TArray<uint8> Msg;
+						if (SynchronizeMsgs.RemoveAndCopyValue(Head.Tag, Msg))
 						{
-							bBreakCheck = true;
+							SetThreadMsg(Msg);
 						}
 					}
 
-					SynchronizeTag.Remove(InTag);
+					FPlatformProcess::ReturnSynchEventToPool(SynchronizeEvent);
 				}		
 			}
 			else
@@ -120,11 +172,196 @@ void FSimpleChannel::Send(TArray<uint8>& InData, bool bForceSend)
 	}
 }
 
+void FSimpleChannel::SendShared(const FSimpleBunchHead& InHead, const FSimpleSharedBody& InBody, TSharedPtr<FInternetAddr> InNewAddr, bool bForceSend)
+{
+	if (!ConnetionPtr.IsValid() || !InBody.IsValid())
+	{
+		return;
+	}
+
+	TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin();
+
+	int32 BunchHeadSize = sizeof(FSimpleBunchHead);
+	int32 PackageHeadSize = sizeof(FSimplePackageHead);
+
+	//和Send一样 抓包拿到的是压缩前的整条消息 没人抓包就不用拼
+	if (FSimpleNetManage* InManage = Connetion->GetManage())
+	{
+		if (InManage->SendCaptureDelegate.IsBound())
+		{
+			TArray<uint8> Bunch;
+			Bunch.Reserve(BunchHeadSize + InBody.Raw->Num());
+			Bunch.Append((const uint8*)&InHead, BunchHeadSize);
+			Bunch.Append(*InBody.Raw);
+
+			InManage->SendCaptureDelegate.Execute(this, Bunch);
+		}
+	}
+
+	//压缩只做了一次 对方协商过压缩才用压缩后的包体
+	FSimpleBunchHead Head = InHead;
+	FSimpleSharedBytes BodyBytes = InBody.Raw;
+	if (InBody.Compressed.IsValid() && Connetion->HasSendWireFeature(ESimpleNetWireFeature::COMPRESSION))
+	{
+		Head.Flags |= BUNCH_COMPRESSED;
+		BodyBytes = InBody.Compressed;
+	}
+
+	int32 TotalSize = BunchHeadSize + BodyBytes->Num();
+
+	FSimpleSharedSlice Body(BodyBytes, 0, BodyBytes->Num());
+
+	if (FSimpleNetManage* InManage = Connetion->GetManage())
+	{
+		InManage->GetProtocolTelemetry().OnSend(Head.ProtocolsNumber, TotalSize);
+	}
+
+	TArray<uint8> HeadBytes;
+	if (FSimpleNetGlobalInfo::Get()->GetInfo().bSlidingWindow)
+	{
+		FSimplePackageHead PackageHead;
+		PackageHead.Protocol = Head.ProtocolsNumber;
+		PackageHead.PackageSize = TotalSize;
+		PackageHead.ChannelID = Head.ChannelID;
+		PackageHead.Tag = Head.Tag;
+
+		if (Connetion->HasSendWireFeature(ESimpleNetWireFeature::COMPACT_HEADER))
+		{
+			PackageHead.PackageID = Connetion->MakeSequencePackageID();
+		}
+
+		if (!bForceSend)
+		{
+			int32 SendDataNumber = FSimpleNetGlobalInfo::Get()->GetInfo().SendDataNumber;
+
+			//填好以后再加入 加入后别的线程就可能访问
+			FSimpleNetBatchManage::FBatch Batch;
+
+			PackageHead.Protocol = SP_HandshaketoSend;
+
+			//和BuildBytes一样分片 只是分片里只保存包头 包体引用共享数据的一段
+			int32 BatchsNumber = (TotalSize + SendDataNumber - 1) / SendDataNumber;
+			for (int32 i = 0; i < BatchsNumber; i++)
+			{
+				int32 Begin = i * SendDataNumber;
+				int32 End = FMath::Min(Begin + SendDataNumber, TotalSize);
+
+				PackageHead.PackageIndex = i;
+
+				Batch.Sequence.Add(i, FSimpleNetBatchManage::FBatch::FElement());
+				FSimpleNetBatchManage::FBatch::FElement& Tmp = Batch.Sequence[i];
+
+				Tmp.Package.Append((uint8*)&PackageHead, PackageHeadSize);
+				if (Begin < BunchHeadSize)
+				{
+					Tmp.Package.Append((const uint8*)&Head + Begin, FMath::Min(End, BunchHeadSize) - Begin);
+				}
+
+				int32 BodyBegin = FMath::Max(Begin, BunchHeadSize) - BunchHeadSize;
+				int32 BodyEnd = End - BunchHeadSize;
+				if (BodyEnd > BodyBegin)
+				{
+					Tmp.Body = FSimpleSharedSlice(BodyBytes, BodyBegin, BodyEnd - BodyBegin);
+				}
+			}
+
+			PackageHead.PackageIndex = SendDataNumber;
+			HeadBytes.Append((uint8*)&PackageHead, PackageHeadSize);
+
+			Batch.Handshake = HeadBytes;
+			BatchManage.Add(PackageHead.PackageID, MoveTemp(Batch));
+
+			Connetion->Send(HeadBytes, InNewAddr);
+		}
+		else
+		{
+			PackageHead.bForceSend = true;
+
+			HeadBytes.Append((uint8*)&PackageHead, PackageHeadSize);
+			HeadBytes.Append((const uint8*)&Head, BunchHeadSize);
+
+			Connetion->Send(HeadBytes, Body, InNewAddr);
+		}
+	}
+	else
+	{
+		HeadBytes.Append((const uint8*)&Head, BunchHeadSize);
+
+		Connetion->Send(HeadBytes, Body, InNewAddr);
+	}
+
+	if (TagBackups != 0)
+	{
+		TagBackups = 0;
+	}
+}
+
+FSimpleSharedBody FSimpleChannel::MakeSharedBody(TArray<uint8>& InBody)
+{
+	FSimpleSharedBody Body;
+
+	//压缩也只做一次 用不用由每个接收者的协商结果决定
+	if (FSimpleNetGlobalInfo::Get()->GetInfo().bCompression)
+	{
+		TArray<uint8> CompressedBody;
+		if (SimpleNetCompression::CompressBody(InBody.GetData(), InBody.Num(), CompressedBody, FSimpleNetGlobalInfo::Get()->GetInfo().CompressionThreshold))
+		{
+			Body.Compressed = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(CompressedBody));
+		}
+	}
+
+	//每个包的Nonce不同 加密在各自链接发送时进行
+	Body.Raw = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(InBody));
+
+	return Body;
+}
+
 bool FSimpleChannel::Receive(TArray<uint8>& InData)
 {
+	{
+		FScopeLock ScopeLock(&ThreadMsgMutex);
+
+		if (TArray<uint8>* Msg = ThreadMsgs.Find(FPlatformTLS::GetCurrentThreadId()))
+		{
+			InData = MoveTemp(*Msg);
+			ThreadMsgs.Remove(FPlatformTLS::GetCurrentThreadId());
+
+			return InData.Num() > 0;
+		}
+	}
+
+	//和DispatchProtocol使用同一把锁 消息队列同时只有一个消费者
+	FScopeLock ScopeLock(&ObjectMutex);
+
 	return BatchPackageManage.Receive(InData);
 }
 
+void FSimpleChannel::SetThreadMsg(TArray<uint8>& InData)
+{
+	FScopeLock ScopeLock(&ThreadMsgMutex);
+
+	ThreadMsgs.Add(FPlatformTLS::GetCurrentThreadId(), MoveTemp(InData));
+}
+
+void FSimpleChannel::ResetThreadMsg()
+{
+	FScopeLock ScopeLock(&ThreadMsgMutex);
+
+	ThreadMsgs.Remove(FPlatformTLS::GetCurrentThreadId());
+}
+
+void FSimpleChannel::AcceptSynchronize(uint64 InTag, TArray<uint8>& InData)
+{
+	FScopeLock ScopeLock(&SynchronizeMutex);
+
+	//发送方已经等待超时 回应直接丢弃
+	if (SynchronizeTag.Contains(InTag))
+	{
+		SynchronizeMsgs.Add(InTag, MoveTemp(InData));
+		RemoveSynchronizeTag(InTag);
+	}
+}
+
 TSharedPtr<FInternetAddr> FSimpleChannel::GetLocalAddr() const
 {
 	return ConnetionPtr.Pin()->GetAddr();
@@ -135,13 +372,27 @@ TSharedPtr<FInternetAddr> FSimpleChannel::GetRemoteAddr() const
 	return ConnetionPtr.Pin()->GetRemoteAddr();
 }
 
-void FSimpleChannel::AddMsg(const FGuid& InGuid, TArray<uint8>& InData)
+uint64 FSimpleChannel::AddMsg(TArray<uint8>& InData)
+{
+	return BatchPackageManage.Add(InData);
+}
+
+FSimpleNetMsgQueueStats FSimpleChannel::GetMsgQueueStats() const
 {
-	BatchPackageManage.Add(InGuid, InData);
+	return BatchPackageManage.GetStats();
 }
 
 void FSimpleChannel::InitController()
 {
+	FScopeLock ScopeLock(&ObjectMutex);
+
+	//控制器还没创建好 创建完成后再初始化
+	if (bObjectPending)
+	{
+		bInitPending = true;
+		return;
+	}
+
 	if (GetNetObject())
 	{
 		if (IsInGameThread())
@@ -152,7 +403,11 @@ void FSimpleChannel::InitController()
 		{
 			FFunctionGraphTask::CreateAndDispatchWhenReady([&]()
 			{
-				GetNetObject()->Init();
+				//到主线程时链接可能已经关闭
+				if (USimpleNetworkObject* InObject = GetNetObject())
+				{
+					InObject->Init();
+				}
 			}, TStatId(), NULL, ENamedThreads::GameThread);
 		}
 	}
@@ -165,28 +420,33 @@ USimpleNetworkObject* FSimpleChannel::GetNetObject()
 
 void FSimpleChannel::SpawnController()
 {
-	if (ConnetionPtr.IsValid())
+	auto SpawnMyObject = [this]()
 	{
-		if (ConnetionPtr.Pin()->GetManage()->NetworkObjectClass)
+		if (ConnetionPtr.IsValid())
 		{
-			RegisterObject(ConnetionPtr.Pin()->GetManage()->NetworkObjectClass, USimpleController::StaticClass());
+			if (ConnetionPtr.Pin()->GetManage()->NetworkObjectClass)
+			{
+				RegisterObject(ConnetionPtr.Pin()->GetManage()->NetworkObjectClass, USimpleController::StaticClass());
+			}
+			else
+			{
+				RegisterObject(SimpleControllerDelegate, USimpleController::StaticClass());
+			}
 		}
 		else
 		{
 			RegisterObject(SimpleControllerDelegate, USimpleController::StaticClass());
 		}
-	}
-	else
-	{
-		RegisterObject(SimpleControllerDelegate, USimpleController::StaticClass());
-	}
+	};
+
+	SpawnOnGameThread(SpawnMyObject);
 	
-	ID = FGuid::NewGuid();
+	SetGuid(FGuid::NewGuid());
 }
 
 void FSimpleChannel::SpawnPlayer()
 {
-	auto SpawnMyObject = [&]()
+	auto SpawnMyObject = [this]()
 	{
 		if (ConnetionPtr.IsValid())
 		{
@@ -205,19 +465,117 @@ void FSimpleChannel::SpawnPlayer()
 		}
 	};
 
+	SpawnOnGameThread(SpawnMyObject);
+	
+	SetGuid(FGuid::NewGuid());
+}
+
+void FSimpleChannel::SpawnOnGameThread(TFunction<void()> InSpawn)
+{
 	if (IsInGameThread())
 	{
-		SpawnMyObject();
+		FScopeLock ScopeLock(&ObjectMutex);
+
+		ObjectSerial++;
+		InSpawn();
+
+		return;
 	}
-	else
+
+	uint32 Serial = 0;
+	{
+		FScopeLock ScopeLock(&ObjectMutex);
+
+		bObjectPending = true;
+		Serial = ++ObjectSerial;
+	}
+
+	TWeakPtr<FSimpleConnetion> WeakConnetion = ConnetionPtr;
+	FFunctionGraphTask::CreateAndDispatchWhenReady([this, WeakConnetion, Serial, InSpawn]()
 	{
-		FFunctionGraphTask::CreateAndDispatchWhenReady([SpawnMyObject]()
+		//链接已经释放 通道也不在了
+		TSharedPtr<FSimpleConnetion> Connetion = WeakConnetion.Pin();
+		if (!Connetion.IsValid())
+		{
+			return;
+		}
+
+		FScopeLock ScopeLock(&ObjectMutex);
+
+		//创建前通道已经关闭
+		if (Serial != ObjectSerial)
+		{
+			return;
+		}
+
+		InSpawn();
+		bObjectPending = false;
+
+		if (bInitPending)
 		{
-			SpawnMyObject();
-		}, TStatId(), nullptr, ENamedThreads::GameThread);
+			bInitPending = false;
+
+			if (Object.IsValid())
+			{
+				Object->Init();
+			}
+		}
+
+		//网络线程在这期间收到的协议 按顺序交付 新到的协议会等这把锁
+		TArray<FPendingProtocol> Protocols = MoveTemp(PendingProtocols);
+		for (const FPendingProtocol& Tmp : Protocols)
+		{
+			DispatchProtocol(Tmp.ProtocolsNumber, Tmp.MsgID, Tmp.Tag);
+		}
+	}, TStatId(), nullptr, ENamedThreads::GameThread);
+}
+
+void FSimpleChannel::ReleaseObject()
+{
+	FScopeLock ScopeLock(&ObjectMutex);
+
+	//还在排队的创建任务作废
+	ObjectSerial++;
+	bObjectPending = false;
+	bInitPending = false;
+	PendingProtocols.Empty();
+
+	if (!Object.IsValid())
+	{
+		return;
 	}
-	
-	ID = FGuid::NewGuid();
+
+	if (IsInGameThread())
+	{
+		Object->Close();
+		Object->MarkAsGarbage();
+		Object.Reset();
+
+		return;
+	}
+
+	//通道马上会被新的链接复用 对象不能再访问它
+	USimpleNetworkObject* InObject = Object.Get();
+	InObject->Channel = nullptr;
+
+	//主线程任务按投递顺序执行 一定在复用后的创建任务之前
+	TWeakPtr<FSimpleConnetion> WeakConnetion = ConnetionPtr;
+	FFunctionGraphTask::CreateAndDispatchWhenReady([this, WeakConnetion, InObject]()
+	{
+		if (!WeakConnetion.IsValid())
+		{
+			return;
+		}
+
+		FScopeLock ScopeLock(&ObjectMutex);
+
+		if (Object.Get() == InObject)
+		{
+			InObject->Close();
+			InObject->MarkAsGarbage();
+			Object.Reset();
+		}
+	}, TStatId(), nullptr, ENamedThreads::GameThread);
 }
 
 bool FSimpleChannel::GetLocalAddrInfo(FSimpleAddrInfo& InAddrInfo)
@@ -266,9 +624,12 @@ USimpleNetworkObject* FSimpleChannel::SpawnObject(UClass* InClass)
 
 void FSimpleChannel::RegisterObject(UClass* InClass, UClass* InObjectClass)
 {
+	//在主线程执行 替换掉旧的对象
 	if (Object.IsValid())
 	{
-		Close();
+		Object->Close();
+		Object->MarkAsGarbage();
+		Object.Reset();
 	}
 
 	if (InClass)
@@ -306,42 +667,291 @@ bool FSimpleChannel::IsValid() const
 
 void FSimpleChannel::AcceptSuccess(const FGuid& InDataID, uint32 InIndex, bool bAck, bool bAllSuccessful)
 {
-	if (FSimpleNetBatchManage::FBatch *InBatch = BatchManage.Find(InDataID))
+	BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
 	{
 		if (bAllSuccessful)
 		{
-			InBatch->bAck = true;
+			if (!InBatch.bAck && FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl && ConnetionPtr.IsValid())
+			{
+				//剩下还没确认的分片在这里一起确认
+				int32 AckNum = 0;
+				for (auto& Tmp : InBatch.Sequence)
+				{
+					if (!Tmp.Value.bAck && Tmp.Value.bStartUpRepackaging)
+					{
+						AckNum++;
+					}
+				}
+
+				if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(InIndex))
+				{
+					if (!Element->bAck)
+					{
+						SampleRTT(*Element);
+					}
+				}
+
+				ConnetionPtr.Pin()->GetCongestion().OnAck(AckNum);
+			}
+
+			//已经算过确认 删除批次时不再从在途里扣
+			for (auto& Tmp : InBatch.Sequence)
+			{
+				Tmp.Value.bAck = true;
+			}
+
+			InBatch.bAck = true;
 		}
 		else
 		{
-			if (FSimpleNetBatchManage::FBatch::FElement *Element = InBatch->Sequence.Find(InIndex))
+			if (FSimpleNetBatchManage::FBatch::FElement *Element = InBatch.Sequence.Find(InIndex))
 			{
+				if (bAck && !Element->bAck && Element->bStartUpRepackaging &&
+					FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl && ConnetionPtr.IsValid())
+				{
+					ConnetionPtr.Pin()->GetCongestion().OnAck(1);
+				}
+
 				Element->bAck = bAck;
 			}
 		}
-	}
+	});
 }
 
 void FSimpleChannel::SendBatch(const FGuid& InDataID, uint32 InIndex, uint32 InProtocol)
 {
 	if (ConnetionPtr.IsValid())
 	{
-		if (FSimpleNetBatchManage::FBatch* InBatch = BatchManage.Find(InDataID))
+		BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
 		{
-			if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch->Sequence.Find(InIndex))
+			if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(InIndex))
 			{
-				FSimplePackageHead *PackageHead = (FSimplePackageHead*)Element->Package.GetData();
-				PackageHead->Protocol = InProtocol;
+				SendElement(*Element, InProtocol);
+			}
+		});
+	}
+}
+
+void FSimpleChannel::SendWindow(const FGuid& InDataID)
+{
+	if (ConnetionPtr.IsValid())
+	{
+		//拥塞控制打开时由发送调度决定先发哪个通道
+		//调度器持有自己的锁再来取批次 这里不能持有批次的锁
+		if (FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl)
+		{
+			FSimpleNetSendScheduler& Scheduler = ConnetionPtr.Pin()->GetSendScheduler();
+			Scheduler.Add(ID, InDataID);
+			Scheduler.Run();
+			return;
+		}
+
+		BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
+		{
+			int32 WindowSize = FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().SlidingWindowSize, 1);
+			int32 SequenceNum = InBatch.Sequence.Num();
+
+			InBatch.NextSend = FMath::Max(InBatch.NextSend, InBatch.AckBase);
+			while (InBatch.NextSend < SequenceNum &&
+				InBatch.NextSend < InBatch.AckBase + WindowSize)
+			{
+				if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(InBatch.NextSend))
+				{
+					SendElement(*Element, SP_Recv);
+				}
 
-				ConnetionPtr.Pin()->Send(Element->Package);
+				InBatch.NextSend++;
+			}
+		});
+	}
+}
 
-				//Enable patch detection
-				Element->bStartUpRepackaging = true;
+int32 FSimpleChannel::GetWindowElementSize(const FGuid& InDataID)
+{
+	int32 ElementSize = INDEX_NONE;
+	if (ConnetionPtr.IsValid())
+	{
+		//这里只限制对方的接收窗口 拥塞窗口由发送调度按整个连接限制
+		int32 WindowSize = FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().SlidingWindowSize, 1);
+
+		BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
+		{
+			InBatch.NextSend = FMath::Max(InBatch.NextSend, InBatch.AckBase);
+			if (!InBatch.bAck &&
+				InBatch.NextSend < InBatch.Sequence.Num() &&
+				InBatch.NextSend < InBatch.AckBase + WindowSize)
+			{
+				if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(InBatch.NextSend))
+				{
+					ElementSize = Element->Package.Num() + Element->Body.Size;
+				}
 			}
+		});
+	}
+
+	return ElementSize;
+}
+
+void FSimpleChannel::SendWindowElement(const FGuid& InDataID)
+{
+	BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
+	{
+		if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(InBatch.NextSend))
+		{
+			SendElement(*Element, SP_Recv);
+		}
+
+		InBatch.NextSend++;
+	});
+}
+
+void FSimpleChannel::AcceptReady(const FGuid& InDataID)
+{
+	BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
+	{
+		//握手没有重发过的话 这就是一次往返时间
+		if (InBatch.NextSend == 0 && InBatch.HandshakeRepeatCount == 0 && ConnetionPtr.IsValid() &&
+			FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl)
+		{
+			ConnetionPtr.Pin()->GetCongestion().OnRTTSample(BatchManage.GetTime() - InBatch.HandshakeTime);
+			ConnetionPtr.Pin()->GetTelemetry().OnRTTSample(BatchManage.GetTime() - InBatch.HandshakeTime);
 		}
+	});
+
+	SendWindow(InDataID);
+}
+
+void FSimpleChannel::SampleRTT(const FSimpleNetBatchManage::FBatch::FElement& InElement)
+{
+	if (InElement.bStartUpRepackaging && InElement.RepeatCount == 0 && !InElement.bFastRetransmitted && ConnetionPtr.IsValid())
+	{
+		ConnetionPtr.Pin()->GetCongestion().OnRTTSample(BatchManage.GetTime() - InElement.SendTime);
+		ConnetionPtr.Pin()->GetTelemetry().OnRTTSample(BatchManage.GetTime() - InElement.SendTime);
 	}
 }
 
+void FSimpleChannel::AcceptSelective(const FGuid& InDataID, uint32 InAckBase, uint32 InAckBits)
+{
+	bool bFound = BatchManage.WithBatch(InDataID, [&](FSimpleNetBatchManage::FBatch& InBatch)
+	{
+		int32 AckBase = FMath::Min((int32)InAckBase, InBatch.Sequence.Num());
+		bool bAdvance = AckBase > InBatch.AckBase;
+
+		//这次新确认的分片 最后一个用来采样往返时间
+		int32 NewAckNum = 0;
+		FSimpleNetBatchManage::FBatch::FElement* SampleElement = nullptr;
+		auto MarkAck = [&](FSimpleNetBatchManage::FBatch::FElement* Element)
+		{
+			if (!Element->bAck)
+			{
+				Element->bAck = true;
+				NewAckNum++;
+				SampleElement = Element;
+			}
+		};
+
+		//累计确认
+		for (int32 i = InBatch.AckBase; i < AckBase; i++)
+		{
+			if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(i))
+			{
+				MarkAck(Element);
+			}
+		}
+		InBatch.AckBase = FMath::Max(InBatch.AckBase, AckBase);
+
+		//选择确认
+		int32 HighestAck = INDEX_NONE;
+		for (int32 i = 0; i < 32 && InAckBits != 0; i++)
+		{
+			if (InAckBits & (1u << i))
+			{
+				HighestAck = AckBase + 1 + i;
+				if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(HighestAck))
+				{
+					MarkAck(Element);
+				}
+			}
+		}
+
+		bool bCongestionControl = FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl && ConnetionPtr.IsValid();
+		if (bCongestionControl)
+		{
+			if (SampleElement)
+			{
+				SampleRTT(*SampleElement);
+			}
+
+			ConnetionPtr.Pin()->GetCongestion().OnAck(NewAckNum);
+		}
+
+		if (bAdvance)
+		{
+			InBatch.DupAckCount = 0;
+		}
+		else if (HighestAck != INDEX_NONE)
+		{
+			InBatch.DupAckCount++;
+		}
+
+		//快速重传 只补发空洞 不等超时
+		if (InBatch.DupAckCount >= 3)
+		{
+			InBatch.DupAckCount = 0;
+
+			bool bRetransmitted = false;
+			for (int32 i = InBatch.AckBase; i < HighestAck; i++)
+			{
+				if (FSimpleNetBatchManage::FBatch::FElement* Element = InBatch.Sequence.Find(i))
+				{
+					if (!Element->bAck && !Element->bFastRetransmitted && Element->bStartUpRepackaging)
+					{
+						Element->bFastRetransmitted = true;
+						SendElement(*Element, SP_Recv);
+						bRetransmitted = true;
+					}
+				}
+			}
+
+			//一次丢包事件只减半一次
+			if (bRetransmitted && bCongestionControl)
+			{
+				ConnetionPtr.Pin()->GetCongestion().OnFastRetransmit();
+			}
+		}
+	});
+
+	//窗口向前移动了 在锁外面继续发送
+	if (bFound)
+	{
+		SendWindow(InDataID);
+	}
+}
+
+void FSimpleChannel::SendElement(FSimpleNetBatchManage::FBatch::FElement& InElement, uint32 InProtocol)
+{
+	FSimplePackageHead* PackageHead = (FSimplePackageHead*)InElement.Package.GetData();
+	PackageHead->Protocol = InProtocol;
+
+	ConnetionPtr.Pin()->Send(InElement.Package, InElement.Body);
+
+	if (FSimpleNetGlobalInfo::Get()->GetInfo().bCongestionControl)
+	{
+		//首次发送的令牌在发送调度里已经扣过了
+		bool bRetransmit = InElement.bStartUpRepackaging;
+		if (bRetransmit)
+		{
+			ConnetionPtr.Pin()->GetCongestion().ForceConsumeTokens(InElement.Package.Num() + InElement.Body.Size, BatchManage.GetTime());
+		}
+
+		ConnetionPtr.Pin()->GetCongestion().OnSend(bRetransmit);
+	}
+
+	//Enable patch detection
+	InElement.bStartUpRepackaging = true;
+	InElement.SendTime = BatchManage.GetTime();
+}
+
 void FSimpleChannel::BuildBytes(TArray<uint8>& InBytes, TArray<uint8>& OutBytes, bool bForceSend)
 {
 	if (InBytes.Num())
@@ -357,13 +967,22 @@ void FSimpleChannel::BuildBytes(TArray<uint8>& InBytes, TArray<uint8>& OutBytes,
 			PackageHead.ChannelID = Head->ChannelID;
 			PackageHead.Tag = Head->Tag;
 
+			//紧凑包头只需要写序号
+			if (ConnetionPtr.IsValid() && ConnetionPtr.Pin()->HasSendWireFeature(ESimpleNetWireFeature::COMPACT_HEADER))
+			{
+				PackageHead.PackageID = ConnetionPtr.Pin()->MakeSequencePackageID();
+			}
+
 			if (!bForceSend)
 			{
-				BatchManage.Add(PackageHead.PackageID, FSimpleNetBatchManage::FBatch());
-				FSimpleNetBatchManage::FBatch& Batch = BatchManage[PackageHead.PackageID];
+				//填好以后再加入 加入后别的线程就可能访问
+				FSimpleNetBatchManage::FBatch Batch;
 
 				PackageHead.Protocol = SP_HandshaketoSend;
 
+				//握手阶段告诉对方分片大小 对方按偏移直接写入
+				PackageHead.PackageIndex = SendDataNumber;
+
 				OutBytes.Empty();
 
 				int32 HeadSize = sizeof(FSimplePackageHead);
@@ -372,6 +991,8 @@ void FSimpleChannel::BuildBytes(TArray<uint8>& InBytes, TArray<uint8>& OutBytes,
 
 				FMemory::Memcpy(OutBytes.GetData(), &PackageHead, HeadSize);
 
+				Batch.Handshake = OutBytes;
+
 				//包体过大开始拆分
 				if (InBytes.Num() > SendDataNumber)
 				{
@@ -402,6 +1023,8 @@ void FSimpleChannel::BuildBytes(TArray<uint8>& InBytes, TArray<uint8>& OutBytes,
 				}
 				else
 				{
+					PackageHead.PackageIndex = 0;
+
 					Batch.Sequence.Add(0, FSimpleNetBatchManage::FBatch::FElement());
 					FSimpleNetBatchManage::FBatch::FElement& Tmp = Batch.Sequence[0];
 
@@ -411,6 +1034,8 @@ void FSimpleChannel::BuildBytes(TArray<uint8>& InBytes, TArray<uint8>& OutBytes,
 					int32 Pos = Tmp.Package.AddUninitialized(InBytes.Num());
 					FMemory::Memcpy(&Tmp.Package[Pos], InBytes.GetData(), InBytes.Num());
 				}
+
+				BatchManage.Add(PackageHead.PackageID, MoveTemp(Batch));
 			}
 			else
 			{
@@ -434,9 +1059,13 @@ void FSimpleChannel::BuildBytes(TArray<uint8>& InBytes, TArray<uint8>& OutBytes,
 
 bool FSimpleChannel::RemoveSynchronizeTag(uint64 InNewTags)
 {
-	if (SynchronizeTag.Contains(InNewTags))
+	FScopeLock ScopeLock(&SynchronizeMutex);
+
+	FEvent* SynchronizeEvent = nullptr;
+	if (SynchronizeTag.RemoveAndCopyValue(InNewTags, SynchronizeEvent))
 	{
-		SynchronizeTag.Remove(InNewTags);
+		//在锁内触发 发送方拿到锁之后才会归还事件
+		SynchronizeEvent->Trigger();
 
 		return true;
 	}
@@ -444,18 +1073,50 @@ bool FSimpleChannel::RemoveSynchronizeTag(uint64 InNewTags)
 	return false;
 }
 
-void FSimpleChannel::Tick(float DeltaSeconds)
+void FSimpleChannel::CancelSynchronize()
 {
-	BatchManage.Tick(DeltaSeconds);
+	FScopeLock ScopeLock(&SynchronizeMutex);
 
-	BatchPackageManage.Tick(DeltaSeconds);
+	for (auto& Tmp : SynchronizeTag)
+	{
+		Tmp.Value->Trigger();
+	}
+
+	SynchronizeTag.Empty();
+	SynchronizeMsgs.Empty();
+}
 
+void FSimpleChannel::Tick(float DeltaSeconds)
+{
 	if (Object.IsValid())
 	{
 		Object->Tick(DeltaSeconds);
 	}
 }
 
+void FSimpleChannel::DispatchProtocol(uint32 InProtocolsNumber, uint64 InMsgID, uint64 InTag)
+{
+	FScopeLock ScopeLock(&ObjectMutex);
+
+	if (bObjectPending)
+	{
+		PendingProtocols.Add({ InProtocolsNumber, InMsgID, InTag });
+		return;
+	}
+
+	//分发的协议从消息队列里取 这个线程之前没有取走的直接消息不再需要
+	ResetThreadMsg();
+
+	//方便提取和查询
+	SetMsgQueueID(InMsgID);
+
+	ResetTagBackups(InTag);
+	{
+		RecvProtocol(InProtocolsNumber);
+	}
+	ResetTagBackups(0ll);
+}
+
 void FSimpleChannel::RecvProtocol(uint32 InProtocolsNumber)
 {
 	if (Object.IsValid())
@@ -476,12 +1137,22 @@ void FSimpleChannel::DestroySelf()
 
 void FSimpleChannel::SetGuid(const FGuid& NewGuid)
 {
+	FGuid OldGuid = ID;
 	ID = NewGuid;
+
+	//链接按ID索引通道
+	if (OldGuid != NewGuid)
+	{
+		if (TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin())
+		{
+			Connetion->OnChannelGuidChanged(Index, OldGuid, NewGuid);
+		}
+	}
 }
 
-void FSimpleChannel::SetMsgQueueGuid(const FGuid& InNewGuid)
+void FSimpleChannel::SetMsgQueueID(uint64 InID)
 {
-	BatchPackageManage.SetMsgQueueGuid(InNewGuid);
+	BatchPackageManage.SetMsgQueueID(InID);
 }
 
 void FSimpleChannel::SetConnetion(TWeakPtr<FSimpleConnetion> InConnetion)
@@ -489,6 +1160,7 @@ void FSimpleChannel::SetConnetion(TWeakPtr<FSimpleConnetion> InConnetion)
 	ConnetionPtr = InConnetion;
 
 	BatchManage.SetConnetion(InConnetion);
+	Replication.SetChannel(this);
 }
 
 TSharedPtr<FSimpleConnetion > FSimpleChannel::GetConnetion()
@@ -0,0 +1,169 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Channel/SimpleNetChannelTable.h"
+#include "Misc/ScopeRWLock.h"
+
+FSimpleNetChannelTable::FSimpleNetChannelTable()
+	:Count(0)
+{
+	Rehash(8);
+}
+
+uint32 FSimpleNetChannelTable::GetHash(const FGuid& InID)
+{
+	//GUID本身是随机的 混合一下就够了
+	uint32 Hash = InID.A ^ InID.B ^ InID.C ^ InID.D;
+	Hash *= 0x9E3779B1u;
+
+	return Hash ^ (Hash >> 16);
+}
+
+void FSimpleNetChannelTable::Reserve(int32 InNum)
+{
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	int32 BucketNum = FMath::RoundUpToPowerOfTwo(FMath::Max(InNum * 2, 8));
+	if (BucketNum > Buckets.Num())
+	{
+		Rehash(BucketNum);
+	}
+}
+
+void FSimpleNetChannelTable::Rehash(int32 InBucketNum)
+{
+	TArray<FBucket> OldBuckets = MoveTemp(Buckets);
+
+	Buckets.SetNumUninitialized(InBucketNum);
+	for (FBucket& Tmp : Buckets)
+	{
+		Tmp.Slot = INDEX_NONE;
+	}
+
+	Count = 0;
+	for (const FBucket& Tmp : OldBuckets)
+	{
+		if (Tmp.Slot != INDEX_NONE)
+		{
+			Insert(Tmp.ID, Tmp.Slot);
+		}
+	}
+}
+
+void FSimpleNetChannelTable::Insert(const FGuid& InID, int32 InSlot)
+{
+	uint32 Mask = Buckets.Num() - 1;
+	for (uint32 i = GetHash(InID) & Mask;; i = (i + 1) & Mask)
+	{
+		FBucket& Bucket = Buckets[i];
+		if (Bucket.Slot == INDEX_NONE)
+		{
+			Bucket.ID = InID;
+			Bucket.Slot = InSlot;
+			Count++;
+			return;
+		}
+
+		if (Bucket.ID == InID)
+		{
+			Bucket.Slot = InSlot;
+			return;
+		}
+	}
+}
+
+void FSimpleNetChannelTable::Add(const FGuid& InID, int32 InSlot)
+{
+	if (!InID.IsValid())
+	{
+		return;
+	}
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	//装载率不超过一半 探测长度很短
+	if ((Count + 1) * 2 > Buckets.Num())
+	{
+		Rehash(Buckets.Num() * 2);
+	}
+
+	Insert(InID, InSlot);
+}
+
+void FSimpleNetChannelTable::Remove(const FGuid& InID)
+{
+	if (!InID.IsValid())
+	{
+		return;
+	}
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	uint32 Mask = Buckets.Num() - 1;
+	uint32 i = GetHash(InID) & Mask;
+	for (;; i = (i + 1) & Mask)
+	{
+		if (Buckets[i].Slot == INDEX_NONE)
+		{
+			return;
+		}
+
+		if (Buckets[i].ID == InID)
+		{
+			break;
+		}
+	}
+
+	//后面同一串里的元素 如果它的理想位置不在空出来的桶之后 就移过来
+	uint32 Hole = i;
+	for (uint32 j = (Hole + 1) & Mask; Buckets[j].Slot != INDEX_NONE; j = (j + 1) & Mask)
+	{
+		uint32 Ideal = GetHash(Buckets[j].ID) & Mask;
+		if (((j - Ideal) & Mask) >= ((j - Hole) & Mask))
+		{
+			Buckets[Hole] = Buckets[j];
+			Hole = j;
+		}
+	}
+
+	Buckets[Hole].Slot = INDEX_NONE;
+	Count--;
+}
+
+int32 FSimpleNetChannelTable::Find(const FGuid& InID) const
+{
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+
+	uint32 Mask = Buckets.Num() - 1;
+	for (uint32 i = GetHash(InID) & Mask;; i = (i + 1) & Mask)
+	{
+		const FBucket& Bucket = Buckets[i];
+		if (Bucket.Slot == INDEX_NONE)
+		{
+			return INDEX_NONE;
+		}
+
+		if (Bucket.ID == InID)
+		{
+			return Bucket.Slot;
+		}
+	}
+}
+
+int32 FSimpleNetChannelTable::Num() const
+{
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+
+	return Count;
+}
+
+void FSimpleNetChannelTable::Reset()
+{
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	for (FBucket& Tmp : Buckets)
+	{
+		Tmp.Slot = INDEX_NONE;
+	}
+
+	Count = 0;
+}
@@ -0,0 +1,284 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Congestion/SimpleNetCongestion.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "Misc/ScopeLock.h"
+
+namespace SimpleNetCongestion
+{
+	//初始窗口 和TCP一样从几个分片开始
+	const float InitialWindow = 4.f;
+	const float MinWindow = 1.f;
+
+	//比估算的速率稍快一点 让窗口有机会增长
+	const double PacingGain = 1.25;
+
+	//至少能攒几个分片的令牌
+	const int32 BurstSegments = 4;
+
+	//令牌桶按时间轮补充 至少要能攒够两格时间轮的量
+	const double BurstTime = 0.02;
+
+	//RFC 6298 时钟粒度
+	const double ClockGranularity = 0.01;
+
+	static double GetMinRTO()
+	{
+		return FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().MinRepackagingTime, 0.01f);
+	}
+
+	static double GetMaxRTO()
+	{
+		return FMath::Max((double)FSimpleNetGlobalInfo::Get()->GetInfo().MaxRepackagingTime, GetMinRTO());
+	}
+
+	static float GetMaxWindow()
+	{
+		return (float)FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().SlidingWindowSize, 1);
+	}
+
+	static int32 GetSegmentSize()
+	{
+		return FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().SendDataNumber, 1);
+	}
+}
+
+FSimpleNetCongestion::FSimpleNetCongestion()
+{
+	Reset();
+}
+
+void FSimpleNetCongestion::Reset()
+{
+	using namespace SimpleNetCongestion;
+
+	FScopeLock ScopeLock(&Mutex);
+
+	SRTT = 0.0;
+	RTTVar = 0.0;
+	RTO = FMath::Clamp((double)FSimpleNetGlobalInfo::Get()->GetInfo().RepackagingTime, GetMinRTO(), GetMaxRTO());
+
+	Window = FMath::Min(InitialWindow, GetMaxWindow());
+	SlowStartThreshold = GetMaxWindow();
+	InFlight = 0;
+
+	Tokens = 0.0;
+	LastRefillTime = -1.0;
+
+	SendNum = 0;
+	RetransmitNum = 0;
+}
+
+void FSimpleNetCongestion::OnRTTSample(double InRTT)
+{
+	using namespace SimpleNetCongestion;
+
+	if (InRTT < 0.0)
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Mutex);
+
+	if (SRTT <= 0.0)
+	{
+		SRTT = FMath::Max(InRTT, ClockGranularity);
+		RTTVar = InRTT * 0.5;
+	}
+	else
+	{
+		RTTVar = 0.75 * RTTVar + 0.25 * FMath::Abs(SRTT - InRTT);
+		SRTT = 0.875 * SRTT + 0.125 * InRTT;
+	}
+
+	RTO = FMath::Clamp(SRTT + FMath::Max(ClockGranularity, 4.0 * RTTVar), GetMinRTO(), GetMaxRTO());
+}
+
+void FSimpleNetCongestion::OnAck(int32 InAckNum)
+{
+	using namespace SimpleNetCongestion;
+
+	FScopeLock ScopeLock(&Mutex);
+
+	InFlight = FMath::Max(InFlight - InAckNum, 0);
+
+	for (int32 i = 0; i < InAckNum; i++)
+	{
+		if (Window < SlowStartThreshold)
+		{
+			Window += 1.f;//慢启动 每个往返翻倍
+		}
+		else
+		{
+			Window += 1.f / Window;//拥塞避免 每个往返加一
+		}
+	}
+
+	Window = FMath::Min(Window, GetMaxWindow());
+}
+
+void FSimpleNetCongestion::OnDiscard(int32 InNum)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	InFlight = FMath::Max(InFlight - InNum, 0);
+}
+
+void FSimpleNetCongestion::OnFastRetransmit()
+{
+	using namespace SimpleNetCongestion;
+
+	FScopeLock ScopeLock(&Mutex);
+
+	SlowStartThreshold = FMath::Max(Window * 0.5f, 2.f);
+	Window = SlowStartThreshold;
+}
+
+void FSimpleNetCongestion::OnTimeout()
+{
+	using namespace SimpleNetCongestion;
+
+	FScopeLock ScopeLock(&Mutex);
+
+	SlowStartThreshold = FMath::Max(Window * 0.5f, 2.f);
+	Window = MinWindow;
+
+	RTO = FMath::Min(RTO * 2.0, GetMaxRTO());
+}
+
+void FSimpleNetCongestion::OnSend(bool bRetransmit)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	if (bRetransmit)
+	{
+		RetransmitNum++;
+	}
+	else
+	{
+		SendNum++;
+		InFlight++;
+	}
+}
+
+double FSimpleNetCongestion::GetRTO() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	return RTO;
+}
+
+int32 FSimpleNetCongestion::GetWindow() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	return FMath::Max(FMath::FloorToInt(Window), 1);
+}
+
+bool FSimpleNetCongestion::CanSend() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	return InFlight < FMath::Max(FMath::FloorToInt(Window), 1);
+}
+
+double FSimpleNetCongestion::GetPacingRate() const
+{
+	using namespace SimpleNetCongestion;
+
+	if (SRTT <= 0.0)
+	{
+		return 0.0;
+	}
+
+	return PacingGain * Window * GetSegmentSize() / SRTT;
+}
+
+double FSimpleNetCongestion::GetBurstSize(double InPacingRate) const
+{
+	using namespace SimpleNetCongestion;
+
+	return FMath::Max((double)(BurstSegments * GetSegmentSize()), InPacingRate * BurstTime);
+}
+
+void FSimpleNetCongestion::RefillTokens(double InTime)
+{
+	double PacingRate = GetPacingRate();
+	double BurstSize = GetBurstSize(PacingRate);
+
+	if (LastRefillTime < 0.0)
+	{
+		Tokens = BurstSize;
+	}
+	else if (InTime > LastRefillTime)
+	{
+		Tokens = FMath::Min(Tokens + (InTime - LastRefillTime) * PacingRate, BurstSize);
+	}
+
+	LastRefillTime = FMath::Max(LastRefillTime, InTime);
+}
+
+bool FSimpleNetCongestion::ConsumeTokens(int32 InBytes, double InTime)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	if (GetPacingRate() <= 0.0)
+	{
+		return true;
+	}
+
+	RefillTokens(InTime);
+
+	//一个分片比桶还大的话 桶满了就放行
+	if (Tokens >= InBytes || Tokens >= GetBurstSize(GetPacingRate()))
+	{
+		Tokens -= InBytes;
+		return true;
+	}
+
+	return false;
+}
+
+void FSimpleNetCongestion::ForceConsumeTokens(int32 InBytes, double InTime)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	if (GetPacingRate() > 0.0)
+	{
+		RefillTokens(InTime);
+
+		//最多欠一个桶 不然重传风暴之后会饿死很久
+		Tokens = FMath::Max(Tokens - InBytes, -GetBurstSize(GetPacingRate()));
+	}
+}
+
+double FSimpleNetCongestion::GetTokenWaitTime(int32 InBytes, double InTime) const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	double PacingRate = GetPacingRate();
+	if (PacingRate <= 0.0)
+	{
+		return 0.0;
+	}
+
+	double ElapsedTime = LastRefillTime < 0.0 ? 0.0 : FMath::Max(InTime - LastRefillTime, 0.0);
+	double NeedTokens = FMath::Min((double)InBytes, GetBurstSize(PacingRate)) - (Tokens + ElapsedTime * PacingRate);
+
+	return FMath::Max(NeedTokens / PacingRate, 0.0);
+}
+
+FSimpleNetCongestionStats FSimpleNetCongestion::GetStats() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	FSimpleNetCongestionStats Stats;
+	Stats.SRTT = SRTT;
+	Stats.RTO = RTO;
+	Stats.Window = Window;
+	Stats.InFlight = InFlight;
+	Stats.SendNum = SendNum;
+	Stats.RetransmitNum = RetransmitNum;
+
+	return Stats;
+}
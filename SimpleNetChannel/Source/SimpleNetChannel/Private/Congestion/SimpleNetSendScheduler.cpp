@@ -0,0 +1,163 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Congestion/SimpleNetSendScheduler.h"
+#include "Connetion/Core/SimpleConnetion.h"
+#include "Channel/SimpleChannel.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "Misc/ScopeLock.h"
+
+FSimpleNetSendScheduler::FSimpleNetSendScheduler()
+	:Timer(0)
+{
+	FMemory::Memzero(Cursor);
+}
+
+void FSimpleNetSendScheduler::SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionPtr)
+{
+	ConnetionPtr = InConnetionPtr;
+}
+
+void FSimpleNetSendScheduler::Add(const FGuid& InChannelID, const FGuid& InBatchID)
+{
+	TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin();
+	if (!Connetion.IsValid())
+	{
+		return;
+	}
+
+	FSimpleChannel* Channel = Connetion->GetChannel(InChannelID);
+	if (!Channel)
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Mutex);
+
+	TArray<FFlow>& ClassFlows = Flows[(int32)Channel->GetPriority()];
+
+	FFlow* Flow = ClassFlows.FindByPredicate([&](const FFlow& InFlow) { return InFlow.ChannelID == InChannelID; });
+	if (!Flow)
+	{
+		Flow = &ClassFlows.AddDefaulted_GetRef();
+		Flow->ChannelID = InChannelID;
+	}
+
+	Flow->Batchs.AddUnique(InBatchID);
+}
+
+void FSimpleNetSendScheduler::Run()
+{
+	TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin();
+	if (!Connetion.IsValid())
+	{
+		return;
+	}
+
+	FSimpleNetTimerWheel* TimerWheel = Connetion->GetTimerWheel();
+	FSimpleNetCongestion& Congestion = Connetion->GetCongestion();
+
+	double CurrentTime = TimerWheel ? TimerWheel->GetTime() : 0.0;
+	int32 SendDataNumber = FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().SendDataNumber, 1);
+
+	FScopeLock ScopeLock(&Mutex);
+
+	for (int32 Priority = 0; Priority < (int32)ESimpleNetChannelPriority::MAX;)
+	{
+		TArray<FFlow>& ClassFlows = Flows[Priority];
+		if (ClassFlows.Num() == 0)
+		{
+			Priority++;
+			continue;
+		}
+
+		int32& Index = Cursor[Priority];
+		if (Index >= ClassFlows.Num())
+		{
+			Index = 0;
+		}
+
+		FFlow& Flow = ClassFlows[Index];
+
+		//通道已经关闭 或者这个批次的窗口满了(等确认后重新加入)
+		FSimpleChannel* Channel = Connetion->GetChannel(Flow.ChannelID);
+		int32 ElementSize = INDEX_NONE;
+		while (Channel && Flow.Batchs.Num() > 0)
+		{
+			ElementSize = Channel->GetWindowElementSize(Flow.Batchs[0]);
+			if (ElementSize != INDEX_NONE)
+			{
+				break;
+			}
+
+			Flow.Batchs.RemoveAt(0);
+		}
+
+		if (ElementSize == INDEX_NONE)
+		{
+			ClassFlows.RemoveAt(Index);
+			continue;
+		}
+
+		//额度不够 加一份权重的额度后轮到下一个通道
+		if (Flow.Deficit < ElementSize)
+		{
+			Flow.Deficit += Channel->GetWeight() * SendDataNumber;
+			Index++;
+			continue;
+		}
+
+		//整个连接在途的分片已经占满窗口 等确认回来SendWindow会再调度
+		if (!Congestion.CanSend())
+		{
+			return;
+		}
+
+		if (!Congestion.ConsumeTokens(ElementSize, CurrentTime))
+		{
+			if (!Timer && TimerWheel)
+			{
+				Timer = TimerWheel->Schedule(Congestion.GetTokenWaitTime(ElementSize, CurrentTime),
+					FSimpleDelegate::CreateRaw(this, &FSimpleNetSendScheduler::OnTimer));
+			}
+
+			return;
+		}
+
+		Channel->SendWindowElement(Flow.Batchs[0]);
+		Flow.Deficit -= ElementSize;
+	}
+}
+
+void FSimpleNetSendScheduler::OnTimer()
+{
+	{
+		FScopeLock ScopeLock(&Mutex);
+		Timer = 0;
+	}
+
+	Run();
+}
+
+void FSimpleNetSendScheduler::Reset()
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	if (Timer)
+	{
+		if (TSharedPtr<FSimpleConnetion> Connetion = ConnetionPtr.Pin())
+		{
+			if (FSimpleNetTimerWheel* TimerWheel = Connetion->GetTimerWheel())
+			{
+				TimerWheel->Cancel(Timer);
+			}
+		}
+
+		Timer = 0;
+	}
+
+	for (int32 i = 0; i < (int32)ESimpleNetChannelPriority::MAX; i++)
+	{
+		Flows[i].Empty();
+		Cursor[i] = 0;
+	}
+}
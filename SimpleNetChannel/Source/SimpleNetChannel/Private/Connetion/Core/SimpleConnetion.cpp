@@ -2,13 +2,19 @@
 
 #include "Connetion/Core/SimpleConnetion.h"
 #include "SocketSubsystem.h"
+#include "IPAddress.h"
 #include "Channel/SimpleChannel.h"
 #include "Protocols/SimpleNetProtocols.h"
 #include "Global/SimpleNetGlobalInfo.h"
 #include "Log/SimpleNetChannelLog.h"
 #include "SimpleNetManage.h"
 #include "Core/EncryptionAndDecryption/SimpleEncryptionAndDecryption.h"
+#include "Core/EncryptionAndDecryption/SimpleStreamCipher.h"
 #include "Thread/SimpleNetThreadManage.h"
+#include "Core/WireHeader/SimpleNetWireHeader.h"
+#include "Core/Compression/SimpleNetCompression.h"
+#include "Stream/SimpleNetBufferPool.h"
+#include "Misc/ScopeRWLock.h"
 
 #if PLATFORM_WINDOWS
 #pragma optimize("",off) 
@@ -18,19 +24,35 @@ FSimpleConnetion::FSimpleConnetion()
 	:State(ESimpleConnetionLinkType::LINK_UNINITIALIZED)
 	, Socket(NULL)
 	, bLock(false)
-	, HeartTime(0.0)
+	, bSharedSocket(false)
 	, LastTime(0.0)
+	, HeartBeatTimer(0)
+	, TimeOutTimer(0)
 	, RequiredReconnectionTime(0.0)
 	, TimeoutLink(0.0)
 	, GroupID(INDEX_NONE)
+	, SlotIndex(INDEX_NONE)
+	, SendWireFeatures(ESimpleNetWireFeature::NONE)
+	, RecvWireFeatures(ESimpleNetWireFeature::NONE)
+	, PendingWireFeatures(ESimpleNetWireFeature::NONE)
+	, bPendingWireFeatures(false)
+	, CipherSalt(0)
 	, Manage(nullptr)
 {
 	bIntoOutTime = false;
 	bStopListen = true;
 
+	ResetCipher();
+
 	ConnetionType = ESimpleConnetionType::CONNETION_LISTEN;
 
-	Channels.SetNum(FSimpleNetGlobalInfo::Get()->GetInfo().MaxChannels);//Pre allocation strategy
+	//只预留槽位 主通道以外的通道用到时才创建
+	int32 MaxChannels = FMath::Max(FSimpleNetGlobalInfo::Get()->GetInfo().MaxChannels, 1);
+	Channels.SetNum(MaxChannels);
+	ChannelTable.Reserve(MaxChannels);
+
+	Channels[0] = MakeUnique<FSimpleChannel>();
+	Channels[0]->SetIndex(0);
 
 	if (ISocketSubsystem* SocketSubsystem = GetSocketSubsystem())
 	{
@@ -53,141 +75,130 @@ void FSimpleConnetion::GetChannelActiveID(TArray<FGuid>& InIDs)
 {
 	for(int32 i = 0;i < Channels.Num();i++)
 	{
-		if (Channels[i].IsValid())
+		if (Channels[i] && Channels[i]->IsValid())
 		{
-			InIDs.Add(Channels[i].GetGuid());
+			InIDs.Add(Channels[i]->GetGuid());
 		}
 	}
 }
 
 void FSimpleConnetion::Init()
 {
-	auto Init_Connetion = [&]()
+	FScopeLock ScopeLock(&LifecycleMutex);
+
+	for (auto& Tmp : Channels)
 	{
-		for (auto& Tmp : Channels)
+		if (Tmp)
 		{
-			Tmp.SetConnetion(this->AsShared());
+			Tmp->SetConnetion(this->AsShared());
 		}
+	}
 
-		//Register the main channel first
-		if (FSimpleChannel* MainChannel = GetMainChannel())
-		{
-			MainChannel->SpawnController();
-			MainChannel->Init();
-		}
-	};
+	SendScheduler.SetConnetion(this->AsShared());
 
+	SetImpairment(FSimpleNetImpairmentConfig::FromConfigInfo());
 
-	if (IsInGameThread())
+	//Register the main channel first
+	//控制器投递给主线程创建 网络线程不等待 创建好之前的协议由通道缓存
+	if (FSimpleChannel* MainChannel = GetMainChannel())
 	{
-		Init_Connetion();
+		MainChannel->SpawnController();
+		MainChannel->Init();
 	}
-	else
-	{
-		FGraphEventRef Task = FFunctionGraphTask::CreateAndDispatchWhenReady([Init_Connetion]()
-		{
-			Init_Connetion();
-		}, TStatId(), nullptr, ENamedThreads::GameThread);
-
-		//等待主线程完成 功能性注册
-		FTaskGraphInterface::Get().WaitUntilTaskCompletes(Task);
-	}	
 }
 
 void FSimpleConnetion::Close()
 {
-	auto OnClose = [&]()
+	//网络线程和主线程都可能关闭链接 对象由通道投递给主线程销毁
+	FScopeLock ScopeLock(&LifecycleMutex);
+
+	//Pre closing
+	for (auto& Tmp : Channels)
 	{
-		//Pre closing
-		for (auto& Tmp : Channels)
+		if (Tmp)
 		{
-			Tmp.PreClose();
+			Tmp->PreClose();
 		}
+	}
 
-		//Send broken link
-		if (FSimpleChannel* Channel = GetMainChannel())
-		{
-			//Client request disconnect
-			SIMPLE_PROTOCOLS_SEND(SP_Close)
-		}
+	//Send broken link
+	if (FSimpleChannel* Channel = GetMainChannel())
+	{
+		//Client request disconnect
+		SIMPLE_PROTOCOLS_SEND(SP_Close)
+	}
 
-		UE_LOG(LogSimpleNetChannel,
-			Display,
-			TEXT("[Close] Connetion Close.Socket :[IP:%s Port:%d]"),
-			*GetAddr()->ToString(false),
-			GetAddr()->GetPort());
+	FlushSend();
 
-		HeartTime = 0.0;
-		bHeartBeat = false;
-		bIntoOutTime = false;
+	//还在延迟的数据报不再等待 断开消息也可能被丢弃
+	FlushImpairment(DBL_MAX);
 
-		//Turn off channels first
-		for (auto& Tmp : Channels)
-		{
-			Tmp.Close();
-		}
+	UE_LOG(LogSimpleNetChannel,
+		Display,
+		TEXT("[Close] Connetion Close.Socket :[IP:%s Port:%d]"),
+		*GetAddr()->ToString(false),
+		GetAddr()->GetPort());
 
-		State = ESimpleConnetionLinkType::LINK_UNINITIALIZED;
+	bHeartBeat = false;
+	if (FSimpleNetTimerWheel* TimerWheel = GetTimerWheel())
+	{
+		TimerWheel->Cancel(HeartBeatTimer);
+		TimerWheel->Cancel(TimeOutTimer);
+	}
+	HeartBeatTimer = 0;
+	TimeOutTimer = 0;
+	bTimeOutTimer = false;
+	bIntoOutTime = false;
 
-		//Release the last one
-		if (ISocketSubsystem* SocketSubsystem = GetSocketSubsystem())
+	//Turn off channels first
+	for (auto& Tmp : Channels)
+	{
+		if (Tmp)
 		{
-			LocalAddr = SocketSubsystem->CreateInternetAddr();
+			Tmp->Close();
 		}
+	}
 
-		if (Manage->IsHighConcurrency())
-		{
-			CloseSocket();
-		}
-	};
+	ChannelTable.Reset();
+
+	SetState(ESimpleConnetionLinkType::LINK_UNINITIALIZED);
+
+	//链接可能被复用 下次重新协商
+	SendWireFeatures = ESimpleNetWireFeature::NONE;
+	RecvWireFeatures = ESimpleNetWireFeature::NONE;
+	PendingWireFeatures = ESimpleNetWireFeature::NONE;
+	bPendingWireFeatures = false;
+	ResetCipher();
+
+	//往返时间和窗口属于上一个对方
+	Congestion.Reset();
+	SendScheduler.Reset();
+	Telemetry.Reset();
+	SendImpairment.Reset();
+	RecvImpairment.Reset();
 
-	if (IsInGameThread())
+	//Release the last one
+	if (ISocketSubsystem* SocketSubsystem = GetSocketSubsystem())
 	{
-		OnClose();
+		LocalAddr = SocketSubsystem->CreateInternetAddr();
 	}
-	else
-	{
-		FGraphEventRef Task = FFunctionGraphTask::CreateAndDispatchWhenReady([this, OnClose]()
-		{
-			OnClose();
-		},TStatId(), NULL, ENamedThreads::GameThread);
 
-		FTaskGraphInterface::Get().WaitUntilTaskCompletes(Task);
+	if (Manage->IsHighConcurrency())
+	{
+		CloseSocket();
 	}
+
+	//归还槽位 可以分配给新的客户端
+	UnLock();
 }
 
 void FSimpleConnetion::Tick(float DeltaSeconds)
 {
 	for (auto &Tmp : Channels)
 	{
-		if (Tmp.IsValid())
-		{
-			Tmp.Tick(DeltaSeconds);
-		}
-	}
-
-	//Time overflow
-	if (LinkState == ESimpleNetLinkState::LINKSTATE_LISTEN)
-	{
-		if (ConnetionType == ESimpleConnetionType::CONNETION_LISTEN) //Non main channel
-		{
-			CheckTimeOut();
-		}
-	}
-	else
-	{
-		if (State == ESimpleConnetionLinkType::LINK_JOIN)
+		if (Tmp && Tmp->IsValid())
 		{
-			if (bHeartBeat)
-			{
-				HeartTime += DeltaSeconds;
-				if (HeartTime >= FSimpleNetGlobalInfo::Get()->GetInfo().HeartBeatTimeTnterval)
-				{
-					HeartTime = 0.0;
-
-					SendHeartBeat();
-				}
-			}
+			Tmp->Tick(DeltaSeconds);
 		}
 	}
 }
@@ -242,7 +253,8 @@ void FSimpleConnetion::CheckLoginTimeout(float DeltaSeconds)
 
 void FSimpleConnetion::ActivateListen()
 {
-	FSimpleNetThreadManage::Get()->AddTask(FSimpleDelegate::CreateRaw(this,&FSimpleConnetion::Listen));
+	//监听循环直到链接关闭才返回 不能占用线程池的队列
+	FSimpleNetThreadManage::Get()->AddLongTask(FSimpleDelegate::CreateRaw(this,&FSimpleConnetion::Listen));
 }
 
 ISocketSubsystem* FSimpleConnetion::GetSocketSubsystem()
@@ -263,6 +275,80 @@ TSharedRef<FInternetAddr> FSimpleConnetion::GetRemoteAddr()
 void FSimpleConnetion::StartSendHeartBeat()
 {
 	bHeartBeat = true;
+
+	ScheduleHeartBeat();
+}
+
+FSimpleNetTimerWheel* FSimpleConnetion::GetTimerWheel()
+{
+	return Manage ? &Manage->GetTimerWheel() : nullptr;
+}
+
+void FSimpleConnetion::ScheduleHeartBeat()
+{
+	if (FSimpleNetTimerWheel* TimerWheel = GetTimerWheel())
+	{
+		TimerWheel->Cancel(HeartBeatTimer);
+		HeartBeatTimer = TimerWheel->Schedule(
+			FSimpleNetGlobalInfo::Get()->GetInfo().HeartBeatTimeTnterval,
+			FSimpleDelegate::CreateRaw(this, &FSimpleConnetion::OnHeartBeatTimer));
+	}
+}
+
+void FSimpleConnetion::OnHeartBeatTimer()
+{
+	HeartBeatTimer = 0;
+
+	if (bHeartBeat)
+	{
+		if (LinkState != ESimpleNetLinkState::LINKSTATE_LISTEN &&
+			State == ESimpleConnetionLinkType::LINK_JOIN)
+		{
+			SendHeartBeat();
+		}
+
+		ScheduleHeartBeat();
+	}
+}
+
+void FSimpleConnetion::ScheduleTimeOut(float InDelay)
+{
+	if (FSimpleNetTimerWheel* TimerWheel = GetTimerWheel())
+	{
+		TimeOutTimer = TimerWheel->Schedule(InDelay, FSimpleDelegate::CreateRaw(this, &FSimpleConnetion::OnTimeOutTimer));
+	}
+	else
+	{
+		bTimeOutTimer = false;
+	}
+}
+
+void FSimpleConnetion::OnTimeOutTimer()
+{
+	TimeOutTimer = 0;
+
+	if (State == ESimpleConnetionLinkType::LINK_JOIN)
+	{
+		double RemainingTime = 0.0;
+		{
+			FReadScopeLock ScopeLock(HeartBeatReadWrite);
+			RemainingTime = LastTime + FSimpleNetGlobalInfo::Get()->GetInfo().OutTimeLink - FPlatformTime::Seconds();
+		}
+
+		//期间收到过心跳 按最后一次心跳重新计时
+		if (RemainingTime > 0.0)
+		{
+			ScheduleTimeOut((float)RemainingTime);
+			return;
+		}
+	}
+
+	bTimeOutTimer = false;
+
+	if (State == ESimpleConnetionLinkType::LINK_JOIN)
+	{
+		CheckTimeOut();
+	}
 }
 
 void FSimpleConnetion::SendHeartBeat()
@@ -294,7 +380,8 @@ void FSimpleConnetion::CheckTimeOut()
 	{
 		HeartBeatReadWrite.ReadUnlock();
 
-		if (Manage->IsHighConcurrency())
+		//高并发给自己发关闭包 共享端口交给解析它的线程关闭 其他直接关闭
+		if (Manage->IsHighConcurrency() && !bSharedSocket)
 		{
 			if (!bIntoOutTime)
 			{
@@ -330,6 +417,25 @@ void FSimpleConnetion::CheckTimeOut()
 				}
 			}	
 		}
+		else if (bSharedSocket && GetRemoteAddr().IsValid())
+		{
+			//共享端口的数据报由线程池按地址分通道解析 关闭也投递到同一个通道
+			//不然计时器线程上的关闭会和正在解析的任务同时改链接
+			TWeakPtr<FSimpleConnetion> WeakConnetion = this->AsShared();
+			TSharedPtr<FInternetAddr> InAddr(GetRemoteAddr()->Clone());
+			FSimpleNetThreadManage::Get()->AddTask(FSimpleDelegate::CreateLambda([WeakConnetion, InAddr]()
+			{
+				//排队期间链接可能已经关闭 复用给了别的客户端 或者又收到了心跳
+				TSharedPtr<FSimpleConnetion> InConnetion = WeakConnetion.Pin();
+				if (InConnetion.IsValid() && InConnetion->IsSharedSocket() &&
+					InConnetion->GetState() == ESimpleConnetionLinkType::LINK_JOIN &&
+					InConnetion->GetRemoteAddr().IsValid() && *InConnetion->GetRemoteAddr() == *InAddr &&
+					InConnetion->IsTimeOut())
+				{
+					InConnetion->Close();
+				}
+			}), InAddr->GetTypeHash());
+		}
 		else
 		{
 			Close();
@@ -341,14 +447,49 @@ void FSimpleConnetion::CheckTimeOut()
 	}
 }
 
+bool FSimpleConnetion::IsTimeOut()
+{
+	FReadScopeLock ScopeLock(HeartBeatReadWrite);
+
+	return FPlatformTime::Seconds() - LastTime > FSimpleNetGlobalInfo::Get()->GetInfo().OutTimeLink;
+}
+
 void FSimpleConnetion::Send(TArray<uint8>& InData)
 {
-	SimpleEncryptionAndDecryption::Encryption(InData);
+	Send(InData, GetRemoteAddr());
 }
 
 void FSimpleConnetion::Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNewAddr)
 {
-	SimpleEncryptionAndDecryption::Encryption(InData);
+	ESimpleNetWireFeature Features = SendWireFeatures;
+	if (int32 CipherHeadSize = GetCipherHeadSize(Features))
+	{
+		InData.InsertUninitialized(0, CipherHeadSize);
+	}
+
+	EncryptPackage(InData, Features);
+}
+
+void FSimpleConnetion::Send(TArray<uint8>& InHead, const FSimpleSharedSlice& InBody, TSharedPtr<FInternetAddr> InNewAddr)
+{
+	if (InBody.IsValid())
+	{
+		InHead.Append(InBody.GetData(), InBody.Size);
+	}
+
+	Send(InHead, InNewAddr);
+}
+
+void FSimpleConnetion::Send(TArray<uint8>& InHead, const FSimpleSharedSlice& InBody)
+{
+	if (InBody.IsValid())
+	{
+		Send(InHead, InBody, GetRemoteAddr());
+	}
+	else
+	{
+		Send(InHead);
+	}
 }
 //
 //void FSimpleConnetion::Receive(const FGuid& InChannelID,TArray<uint8>& InData)
@@ -373,6 +514,16 @@ void FSimpleConnetion::ResetHeartBeat()
 	LastTime = FPlatformTime::Seconds();
 
 	HeartBeatReadWrite.WriteUnlock();
+
+	//Time overflow
+	if (LinkState == ESimpleNetLinkState::LINKSTATE_LISTEN &&
+		ConnetionType == ESimpleConnetionType::CONNETION_LISTEN) //Non main channel
+	{
+		if (!bTimeOutTimer.AtomicSet(true))
+		{
+			ScheduleTimeOut(FSimpleNetGlobalInfo::Get()->GetInfo().OutTimeLink);
+		}
+	}
 }
 
 void FSimpleConnetion::Analysis(uint8* InData, int32 BytesNumber)//Location of system resolution
@@ -385,31 +536,39 @@ void FSimpleConnetion::Analysis(uint8* InData, int32 BytesNumber)//Location of s
 		{
 			if (FSimpleChannel* Channel = GetChannel(Head.ChannelID))
 			{
-				FGuid NewMsgGuid = FGuid::NewGuid();
-				if (Head.ParamNum > 0)
+				if (GetLinkState() != ESimpleNetLinkState::LINKSTATE_LISTEN && !Head.bAsynchronous)
 				{
-					TArray<uint8> InNewData(InData, BytesNumber);
-					Channel->AddMsg(NewMsgGuid,InNewData);
-				}
+					//同步回应不进消息队列 直接交给等待的线程
+					TArray<uint8> InNewData;
+					if (Head.ParamNum > 0)
+					{
+						InNewData.Append(InData, BytesNumber);
+					}
 
-				//方便提取和查询
-				Channel->SetMsgQueueGuid(NewMsgGuid);
+					Channel->AcceptSynchronize(Head.Tag, InNewData);
+					return;
+				}
 
-				if (GetLinkState() == ESimpleNetLinkState::LINKSTATE_LISTEN)
+				uint64 MsgID = 0;
+				if (Head.ParamNum > 0)
 				{
-					Channel->ResetTagBackups(Head.Tag);
+					TArray<uint8> InNewData(InData, BytesNumber);
+					MsgID = Channel->AddMsg(InNewData);
+
+					//队列到了上限 已经计数 没有消息可取就不分发了
+					if (MsgID == 0)
 					{
-						Channel->RecvProtocol(Head.ProtocolsNumber);
+						return;
 					}
-					Channel->ResetTagBackups(0ll);
 				}
-				else if (!Head.bAsynchronous)			
+
+				if (GetLinkState() == ESimpleNetLinkState::LINKSTATE_LISTEN)
 				{
-					Channel->RemoveSynchronizeTag(Head.Tag);
+					Channel->DispatchProtocol(Head.ProtocolsNumber, MsgID, Head.Tag);
 				}
 				else
 				{
-					Channel->RecvProtocol(Head.ProtocolsNumber);
+					Channel->DispatchProtocol(Head.ProtocolsNumber, MsgID, 0ll);
 				}
 			}
 		};
@@ -453,6 +612,16 @@ void FSimpleConnetion::Analysis(uint8* InData, int32 BytesNumber)//Location of s
 					
 					break;
 				}
+				case SP_Replicate:
+				case SP_ReplicateAck:
+				{
+					if (FSimpleChannel* Channel = GetChannel(Head.ChannelID))
+					{
+						Channel->GetReplication().Receive(Head.ProtocolsNumber, InData + sizeof(FSimpleBunchHead), BytesNumber - sizeof(FSimpleBunchHead));
+					}
+
+					break;
+				}
 				default:
 				{
 					UpdateObject();
@@ -469,6 +638,16 @@ void FSimpleConnetion::Analysis(uint8* InData, int32 BytesNumber)//Location of s
 
 					break;
 				}
+				case SP_Replicate:
+				case SP_ReplicateAck:
+				{
+					if (FSimpleChannel* Channel = GetChannel(Head.ChannelID))
+					{
+						Channel->GetReplication().Receive(Head.ProtocolsNumber, InData + sizeof(FSimpleBunchHead), BytesNumber - sizeof(FSimpleBunchHead));
+					}
+
+					break;
+				}
 				default:
 				{
 					//UE_LOG(LogSimpleNetChannel, Log, TEXT("recv %s byte"), BytesNumber);
@@ -482,7 +661,30 @@ void FSimpleConnetion::Analysis(uint8* InData, int32 BytesNumber)//Location of s
 
 void FSimpleConnetion::SetState(ESimpleConnetionLinkType InState)
 {
+	ESimpleConnetionLinkType OldState = State;
 	State = InState;
+
+	//加入以后对方一定已经切换 没等到新格式的数据报也不再接受旧格式
+	if (InState == ESimpleConnetionLinkType::LINK_JOIN && bPendingWireFeatures)
+	{
+		ApplyPendingWireFeatures();
+	}
+
+	if (Manage && SlotIndex != INDEX_NONE && OldState != InState)
+	{
+		Manage->OnConnetionStateChanged(OldState, InState);
+	}
+}
+
+void FSimpleConnetion::SetGroupID(int32 InNewGroupID)
+{
+	int32 OldGroupID = GroupID;
+	GroupID = InNewGroupID;
+
+	if (Manage && SlotIndex != INDEX_NONE)
+	{
+		Manage->OnConnetionGroupChanged(SlotIndex, OldGroupID, InNewGroupID);
+	}
 }
 
 void FSimpleConnetion::RequestSocketAddressRequest()
@@ -504,7 +706,11 @@ void FSimpleConnetion::ConnectVerification()
 	if (FSimpleChannel *Channel = GetMainChannel())
 	{
 		FString LocalVersion = FSimpleNetGlobalInfo::Get()->GetInfo().Version;
-		SIMPLE_PROTOCOLS_SEND(SP_Hello,LocalVersion);
+
+		//Challenge本身按旧格式发出 接收方向在处理完Challenge以后才切换
+		uint32 LocalWireFeatures = (uint32)GetLocalWireFeatures();
+
+		SIMPLE_PROTOCOLS_SEND(SP_Hello,LocalVersion,LocalWireFeatures);
 		
 		SetState(ESimpleConnetionLinkType::LINK_VERIFICATION);
 		
@@ -519,13 +725,20 @@ void FSimpleConnetion::ConnectVerification()
 void FSimpleConnetion::SetSocket(FSocket* InSocket)
 {
 	Socket = InSocket;
+	bSharedSocket = false;
+}
+
+void FSimpleConnetion::SetSharedSocket(FSocket* InSocket)
+{
+	Socket = InSocket;
+	bSharedSocket = InSocket != nullptr;
 }
 
 FSimpleChannel* FSimpleConnetion::GetMainChannel()
 {
 	if (Channels.IsValidIndex(0))
 	{
-		return &Channels[0];
+		return Channels[0].Get();
 	}
 
 	return NULL;
@@ -533,17 +746,74 @@ FSimpleChannel* FSimpleConnetion::GetMainChannel()
 
 FSimpleChannel* FSimpleConnetion::GetChannel(const FGuid& InChannelGuid)
 {
-	for (auto &Tmp : Channels)
+	int32 Index = ChannelTable.Find(InChannelGuid);
+	if (Channels.IsValidIndex(Index))
+	{
+		return Channels[Index].Get();
+	}
+
+	return NULL;
+}
+
+FSimpleChannel* FSimpleConnetion::AddChannel()
+{
+	FScopeLock ScopeLock(&LifecycleMutex);
+
+	for (int32 i = 1; i < Channels.Num(); i++)
 	{
-		if (Tmp.GetGuid() == InChannelGuid)
+		if (!Channels[i])
 		{
-			return &Tmp;
+			TUniquePtr<FSimpleChannel> Channel = MakeUnique<FSimpleChannel>();
+			Channel->SetIndex(i);
+			Channel->SetConnetion(this->AsShared());
+
+			//先分配ID再放进槽位 其他线程遍历时看到的一定是完整的通道
+			Channel->SetGuid(FGuid::NewGuid());
+			Channels[i] = MoveTemp(Channel);
+
+			return Channels[i].Get();
+		}
+		else if (!Channels[i]->IsValid())
+		{
+			Channels[i]->SetGuid(FGuid::NewGuid());
+
+			return Channels[i].Get();
 		}
 	}
 
 	return NULL;
 }
 
+void FSimpleConnetion::OnChannelGuidChanged(int32 InIndex, const FGuid& InOldGuid, const FGuid& InNewGuid)
+{
+	ChannelTable.Remove(InOldGuid);
+	ChannelTable.Add(InNewGuid, InIndex);
+}
+
+void FSimpleConnetion::GetStats(FSimpleNetConnetionStats& OutStats)
+{
+	Telemetry.GetStats(OutStats);
+
+	OutStats.SlotIndex = SlotIndex;
+	if (RemoteAddr.IsValid())
+	{
+		OutStats.Addr = RemoteAddr->ToString(true);
+	}
+
+	FSimpleNetCongestionStats CongestionStats = Congestion.GetStats();
+	OutStats.RetransmitNum = CongestionStats.RetransmitNum;
+	OutStats.SRTT = CongestionStats.SRTT;
+
+	for (auto& Tmp : Channels)
+	{
+		if (Tmp && Tmp->IsValid())
+		{
+			FSimpleNetMsgQueueStats QueueStats = Tmp->GetMsgQueueStats();
+			OutStats.QueueDepth += QueueStats.Pushed - QueueStats.Received - QueueStats.Discarded;
+		}
+	}
+}
+
 void FSimpleConnetion::SetLinkState(ESimpleNetLinkState NewLinkState)
 {
 	LinkState = NewLinkState;
@@ -558,7 +828,13 @@ bool FSimpleConnetion::CloseSocket()
 
 void FSimpleConnetion::SetRemoteAddr(TSharedPtr<FInternetAddr> InAddr)
 {
-	RemoteAddr = InAddr;
+	//接收缓冲里的地址是复用的 这里保存一份自己的
+	RemoteAddr = InAddr.IsValid() ? TSharedPtr<FInternetAddr>(InAddr->Clone()) : InAddr;
+
+	if (Manage && SlotIndex != INDEX_NONE)
+	{
+		Manage->OnConnetionAddrChanged(SlotIndex, RemoteAddr);
+	}
 }
 
 void FSimpleConnetion::SetLocalAddr(TSharedPtr<FInternetAddr> InAddr)
@@ -594,14 +870,12 @@ bool FSimpleConnetion::IsCompletePackage(
 				else
 				{
 					//Remove the head
-					CacheManage.Add(PackageHead.PackageID, FSimpleNetCacheManage::FCache());
+					int32 BoySize = InRecvNum - sizeof(FSimplePackageHead);
+					InData += sizeof(FSimplePackageHead);
 
-					if (FSimpleNetCacheManage::FCache* InUPDCache = CacheManage.Find(PackageHead.PackageID))
+					if (FSimpleNetCacheManage::FCache* InUPDCache = CacheManage.Create(PackageHead.PackageID, FMath::Max(BoySize, 0), 0))
 					{
-						int32 BoySize = InRecvNum - sizeof(FSimplePackageHead);
-						InData += sizeof(FSimplePackageHead);
-						int32 Pos = InUPDCache->Cache.AddUninitialized(BoySize);
-						FMemory::Memcpy(&InUPDCache->Cache[Pos], InData, BoySize);
+						InUPDCache->Write(0, InData, BoySize);
 						OutData = InUPDCache->Cache.GetData();
 						OutLen = InUPDCache->Cache.Num();
 						OutGUID = PackageHead.PackageID;
@@ -616,7 +890,7 @@ bool FSimpleConnetion::IsCompletePackage(
 					}
 					else
 					{
-						UE_LOG(LogSimpleNetChannel, Error, TEXT("ForceRecv not found PackageID = %s "), *PackageHead.PackageID.ToString());
+						UE_LOG(LogSimpleNetChannel, Error, TEXT("ForceRecv PackageID = %s BoySize = %i exceeds MaxPackageSize."), *PackageHead.PackageID.ToString(), BoySize);
 					}
 				}
 			}
@@ -626,15 +900,32 @@ bool FSimpleConnetion::IsCompletePackage(
 				{
 				case SP_HandshaketoSend:
 				{
+					//握手里携带的是分片大小
+					uint32 ChunkSize = PackageHead.PackageIndex;
+
 					PackageHead.Protocol = SP_ReadytoAccept;
+					PackageHead.PackageIndex = 0;
 					TArray<uint8> MyData;
 
 					FSimpleIOStream IOStream(MyData);
 					IOStream << PackageHead;
 
 					//Create accepted cache pool
-					CacheManage.Add(PackageHead.PackageID, FSimpleNetCacheManage::FCache());
-					CacheManage[PackageHead.PackageID].TotalSize = PackageHead.PackageSize;
+					//重发的握手不要把已经收到的分片清掉
+					FSimpleNetCacheManage::FCache* InCache = CacheManage.Find(PackageHead.PackageID);
+					if (!InCache)
+					{
+						InCache = CacheManage.Create(PackageHead.PackageID, PackageHead.PackageSize, ChunkSize);
+					}
+
+					//声明的包太大 不回应 对方会超时放弃
+					if (!InCache)
+					{
+						UE_LOG(LogSimpleNetChannel, Error, TEXT("[SP_HandshaketoSend] PackageID=%s PackageSize=%u exceeds MaxPackageSize."),
+							*PackageHead.PackageID.ToString(),
+							PackageHead.PackageSize);
+						break;
+					}
 
 					Send(MyData);
 
@@ -642,7 +933,7 @@ bool FSimpleConnetion::IsCompletePackage(
 					{
 						UE_LOG(LogSimpleNetChannel, Display, TEXT("[SP_HandshaketoSend] PackageHead.PackageID=%s, ReadyRecv=%i"),
 							*PackageHead.PackageID.ToString(),
-							CacheManage[PackageHead.PackageID].TotalSize);
+							InCache->TotalSize);
 					}
 					break;
 				}
@@ -650,7 +941,8 @@ bool FSimpleConnetion::IsCompletePackage(
 				{
 					if (FSimpleChannel* InChannel = GetChannel(PackageHead.ChannelID))
 					{
-						InChannel->SendBatch(PackageHead.PackageID, PackageHead.PackageIndex, SP_Recv);
+						//对方准备好了 一次发出整个窗口
+						InChannel->AcceptReady(PackageHead.PackageID);
 
 						if (bShowCompletePackProtocolInfo)
 						{
@@ -692,17 +984,16 @@ bool FSimpleConnetion::IsCompletePackage(
 				{
 					if (FSimpleChannel* InChannel = GetChannel(PackageHead.ChannelID))
 					{
-						//Last package accepted successfully
-						InChannel->AcceptSuccess(PackageHead.PackageID, PackageHead.PackageIndex - 1, true);
-
-						//Send the next packet
-						InChannel->SendBatch(PackageHead.PackageID, PackageHead.PackageIndex, SP_Recv);
+						//PackageIndex之前的分片全部收到 AckBits是之后收到的分片
+						//确认后窗口向前滑动 有空洞的话会快速重传
+						InChannel->AcceptSelective(PackageHead.PackageID, PackageHead.PackageIndex, PackageHead.AckBits);
 
 						if (bShowCompletePackProtocolInfo)
 						{
-							UE_LOG(LogSimpleNetChannel, Display, TEXT("[SP_Send] PackageHead.ChannelID=%s,PackageHead.PackageIndex=%i"),
+							UE_LOG(LogSimpleNetChannel, Display, TEXT("[SP_Send] PackageHead.ChannelID=%s,PackageHead.PackageIndex=%i,AckBits=%x"),
 								*PackageHead.ChannelID.ToString(),
-								PackageHead.PackageIndex);
+								PackageHead.PackageIndex,
+								PackageHead.AckBits);
 						}
 					}
 					else
@@ -715,28 +1006,44 @@ bool FSimpleConnetion::IsCompletePackage(
 				}
 				case SP_Recv:
 				{
+					TArray<uint8> MyData;
 					if (FSimpleNetCacheManage::FCache* InCache = CacheManage.Find(PackageHead.PackageID))
 					{
-						int32 InDataSize = InRecvNum - sizeof(FSimplePackageHead);
-						int32 Pos = InCache->Cache.AddUninitialized(InDataSize);
-
-						InData += sizeof(FSimplePackageHead);
-
-						FMemory::Memcpy(&InCache->Cache[Pos], InData, InDataSize);
-
-						TArray<uint8> MyData;
-						if (InCache->Cache.Num() < (int32)InCache->TotalSize)//Representative data not accepted
+						if (InCache->IsComplete())
 						{
-							//Continue sending
-							PackageHead.Protocol = SP_Send;
-							PackageHead.PackageIndex++;
+							//已经交付过了 对方没收到完成确认 重新回应即可
+							PackageHead.Protocol = SP_RecvComplete;
 						}
 						else
 						{
-							PackageHead.Protocol = SP_RecvComplete;
-							OutData = InCache->Cache.GetData();
-							OutLen = InCache->Cache.Num();
-							OutGUID = PackageHead.PackageID;
+							int32 InDataSize = InRecvNum - sizeof(FSimplePackageHead);
+							InData += sizeof(FSimplePackageHead);
+
+							if (!InCache->Write(PackageHead.PackageIndex, InData, InDataSize))
+							{
+								UE_LOG(LogSimpleNetChannel, Error, TEXT("[SP_Recv] Invalid chunk PackageID=%s,PackageIndex=%i,Size=%i"),
+									*PackageHead.PackageID.ToString(),
+									PackageHead.PackageIndex,
+									InDataSize);
+								break;
+							}
+
+							if (!InCache->IsComplete())//Representative data not accepted
+							{
+								//Continue sending
+								PackageHead.Protocol = SP_Send;
+								PackageHead.PackageIndex = InCache->AckBase;
+								PackageHead.AckBits = InCache->GetAckBits();
+							}
+							else
+							{
+								Telemetry.OnReassembly(FPlatformTime::Seconds() - InCache->StartTime);
+
+								PackageHead.Protocol = SP_RecvComplete;
+								OutData = InCache->Cache.GetData();
+								OutLen = InCache->Cache.Num();
+								OutGUID = PackageHead.PackageID;
+							}
 						}
 
 						FSimpleIOStream IOStream(MyData);
@@ -753,6 +1060,16 @@ bool FSimpleConnetion::IsCompletePackage(
 								PackageHead.Protocol == SP_RecvComplete ? TEXT("SP_RecvComplete") : TEXT("ERROR"));
 						}
 					}
+					else
+					{
+						//缓存已经交付并移除 说明是迟到的重传分片
+						PackageHead.Protocol = SP_RecvComplete;
+
+						FSimpleIOStream IOStream(MyData);
+						IOStream << PackageHead;
+
+						Send(MyData);
+					}
 
 					break;
 				}
@@ -771,18 +1088,60 @@ bool FSimpleConnetion::IsCompletePackage(
 
 void FSimpleConnetion::HandleMergePackage(int32 InRecvNum, uint8* InData, TSharedPtr<FInternetAddr> InAddr)
 {
+	//紧凑包头先还原成原来的结构
+	TArray<uint8, TInlineAllocator<1024>> WireData;
+	if (IsCompactPackage(InData, InRecvNum))
+	{
+		WireData.SetNumUninitialized(InRecvNum + SimpleNetWireHeader::GetMaxExpandSize());
+
+		FSimpleChannel* MainChannel = GetMainChannel();
+		int32 WireDataSize = SimpleNetWireHeader::Decode(InData, InRecvNum,
+			MainChannel ? MainChannel->GetGuid() : FGuid(),
+			WireData.GetData(), WireData.Num());
+
+		if (WireDataSize == INDEX_NONE)
+		{
+			UE_LOG(LogSimpleNetChannel, Error, TEXT("Invalid compact package, size = %i"), InRecvNum);
+			return;
+		}
+
+		InData = WireData.GetData();
+		InRecvNum = WireDataSize;
+	}
+
 	FGuid InGUID;
 	uint8* NewRecvData = nullptr;
 	int32 NewRecvLen = 0;
 	if (IsCompletePackage(InRecvNum, InData, InGUID, NewRecvData, NewRecvLen))
 	{
-		if (State == ESimpleConnetionLinkType::LINK_JOIN)
+		//合包以后再解压 没有协商过的对方这个字节是对齐空间 不能当标志看
+		FSimpleNetPooledBuffer RawData;
+		if (EnumHasAnyFlags(RecvWireFeatures, ESimpleNetWireFeature::COMPRESSION) &&
+			SimpleNetCompression::IsCompressed(NewRecvData, NewRecvLen))
 		{
-			Analysis(NewRecvData, NewRecvLen);//Analysis
+			NewRecvLen = SimpleNetCompression::Decompress(NewRecvData, NewRecvLen, RawData.Get());
+			NewRecvData = RawData.Get().GetData();
+		}
+
+		if (NewRecvLen == INDEX_NONE)
+		{
+			UE_LOG(LogSimpleNetChannel, Error, TEXT("Invalid compressed package."));
 		}
 		else
 		{
-			VerificatioConnetionInfo(NewRecvData, NewRecvLen, InAddr);
+			if (Manage && NewRecvLen >= (int32)sizeof(FSimpleBunchHead))
+			{
+				Manage->GetProtocolTelemetry().OnRecv(((FSimpleBunchHead*)NewRecvData)->ProtocolsNumber, NewRecvLen);
+			}
+
+			if (State == ESimpleConnetionLinkType::LINK_JOIN)
+			{
+				Analysis(NewRecvData, NewRecvLen);//Analysis
+			}
+			else
+			{
+				VerificatioConnetionInfo(NewRecvData, NewRecvLen, InAddr);
+			}
 		}
 	}
 
@@ -795,6 +1154,21 @@ void FSimpleConnetion::HandleMergePackage(int32 InRecvNum, uint8* InData, TShare
 	}
 }
 
+void FSimpleConnetion::HandleCoalescedPackage(int32 InRecvNum, uint8* InData, TSharedPtr<FInternetAddr> InAddr)
+{
+	//整个数据报只解密一次 里面每个都是独立的紧凑数据报
+	bool bValid = SimpleNetWireHeader::SplitCoalesced(InData, InRecvNum,
+		[&](uint8* InPackageData, int32 InPackageSize)
+		{
+			HandleMergePackage(InPackageSize, InPackageData, InAddr);
+		});
+
+	if (!bValid)
+	{
+		UE_LOG(LogSimpleNetChannel, Error, TEXT("Invalid coalesced package, size = %i"), InRecvNum);
+	}
+}
+
 void FSimpleConnetion::VerificatioConnetionInfo(uint8* InData, int32 InByteNumber, TSharedPtr<FInternetAddr> InAddr)
 {
 	FSimpleBunchHead Head = *(FSimpleBunchHead*)InData;
@@ -802,16 +1176,15 @@ void FSimpleConnetion::VerificatioConnetionInfo(uint8* InData, int32 InByteNumbe
 	{
 		if (FSimpleChannel* Channel = GetMainChannel())
 		{
+			//握手在网络线程直接处理 不经过消息队列 不会丢掉还在等待分发的消息
+			TArray<uint8> InNewData;
 			if (Head.ParamNum > 0)
 			{
-				TArray<uint8> InNewData(InData, InByteNumber);
-
-				FGuid InNewGuid = FGuid::NewGuid();
-
-				Channel->SetMsgQueueGuid(InNewGuid);
-				Channel->AddMsg(InNewGuid, InNewData);
+				InNewData.Append(InData, InByteNumber);
 			}
 
+			Channel->SetThreadMsg(InNewData);
+
 			if (LinkState == ESimpleNetLinkState::LINKSTATE_LISTEN)
 			{
 				switch (Head.ProtocolsNumber)
@@ -819,12 +1192,30 @@ void FSimpleConnetion::VerificatioConnetionInfo(uint8* InData, int32 InByteNumbe
 				case SP_Hello:
 				{
 					FString RemoteVersion;
-					SIMPLE_PROTOCOLS_RECEIVE(SP_Hello, RemoteVersion);
+					uint32 RemoteWireFeatures = 0;
+
+					//旧版本客户端只发送版本号
+					if (Head.ParamNum >= 2)
+					{
+						SIMPLE_PROTOCOLS_RECEIVE(SP_Hello, RemoteVersion, RemoteWireFeatures);
+					}
+					else
+					{
+						SIMPLE_PROTOCOLS_RECEIVE(SP_Hello, RemoteVersion);
+					}
+
 					if (!RemoteVersion.IsEmpty())
 					{
 						if (FSimpleNetGlobalInfo::Get()->GetInfo().Version == RemoteVersion)
 						{
-							SIMPLE_PROTOCOLS_SEND(SP_Challenge);
+							ESimpleNetWireFeature WireFeatures = (ESimpleNetWireFeature)RemoteWireFeatures & GetLocalWireFeatures();
+							uint32 WireFeaturesValue = (uint32)WireFeatures;
+
+							//客户端处理完挑战协议之前发来的都是旧格式(重发的Hello 挑战协议的确认)
+							//挑战协议和它的分片 重发也都按旧格式发出 收到客户端第一个新格式的数据报再切换
+							SetPendingWireFeatures(WireFeatures, false);
+							SIMPLE_PROTOCOLS_SEND(SP_Challenge, WireFeaturesValue);
+
 							SetState(ESimpleConnetionLinkType::LINK_VERIFICATION);
 
 							//Reset heartbeat time
@@ -946,6 +1337,16 @@ GetAddr()->GetPort());
 				{
 				case SP_Challenge:
 				{
+					uint32 WireFeaturesValue = 0;
+					if (Head.ParamNum >= 1)
+					{
+						SIMPLE_PROTOCOLS_RECEIVE(SP_Challenge, WireFeaturesValue);
+					}
+
+					//服务器收到登录请求之前还会按旧格式发送(挑战协议的重发)
+					ESimpleNetWireFeature WireFeatures = (ESimpleNetWireFeature)WireFeaturesValue & GetLocalWireFeatures();
+					SetPendingWireFeatures(WireFeatures, true);
+
 					TArray<FGuid> ChannelIDs;
 					GetChannelActiveID(ChannelIDs);
 					int32 InGroupID = GetGroupID();
@@ -1020,11 +1421,375 @@ GetAddr()->GetPort());
 	}
 }
 
-void FSimpleConnetion::RecvByRemote(int32 InBytesSize, uint8* InData)
+void FSimpleConnetion::RecvByRemote(int32 InBytesSize, uint8* InData, TSharedPtr<FInternetAddr> InAddr)
 {
-	SimpleEncryptionAndDecryption::Decryption(InData, InBytesSize);
+	Telemetry.OnRecv(InBytesSize);
+
+	if (RecvImpairment.IsEnabled())
+	{
+		//数据和地址都在接收缓冲里 会被下一个数据报改写 入队时保存一份
+		RecvImpairment.Add(InData, InBytesSize, InAddr.IsValid() ? TSharedPtr<FInternetAddr>(InAddr->Clone()) : nullptr, FPlatformTime::Seconds());
+
+		UpdateImpairment();
+		return;
+	}
 
-	HandleMergePackage(InBytesSize,InData,RemoteAddr);
+	HandleDatagram(InBytesSize, InData, InAddr);
+}
+
+void FSimpleConnetion::HandleDatagram(int32 InBytesSize, uint8* InData, TSharedPtr<FInternetAddr> InAddr)
+{
+	InBytesSize = DecryptPackage(InData, InBytesSize);
+	if (InBytesSize == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (IsCoalescedPackage(InData, InBytesSize))
+	{
+		HandleCoalescedPackage(InBytesSize, InData, InAddr.IsValid() ? InAddr : RemoteAddr);
+		return;
+	}
+
+	HandleMergePackage(InBytesSize,InData,InAddr.IsValid() ? InAddr : RemoteAddr);
+}
+
+void FSimpleConnetion::UpdateImpairment()
+{
+	if (!RecvImpairment.IsEnabled())
+	{
+		return;
+	}
+
+	//独立的接收线程和管理器都会取 同一个链接的数据报不能并行解析
+	FScopeLock ScopeLock(&ImpairmentMutex);
+
+	RecvImpairment.Release(FPlatformTime::Seconds(), [this](FSimpleNetImpairment::FPacket& InPacket)
+	{
+		HandleDatagram(InPacket.Data.Num(), InPacket.Data.GetData(), InPacket.Addr);
+	});
+}
+
+void FSimpleConnetion::SetImpairment(const FSimpleNetImpairmentConfig& InConfig)
+{
+	//两个方向用不同的序列 同一个槽位每次测试一样
+	int32 Seed = (SlotIndex + 1) * 2;
+	SendImpairment.Init(InConfig, Seed);
+	RecvImpairment.Init(InConfig, Seed + 1);
+}
+
+ESimpleNetWireFeature FSimpleConnetion::GetLocalWireFeatures()
+{
+	const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+
+	//紧凑包头只用于滑动窗口模式 这时每个数据报都以FSimplePackageHead开头 编码不会失败
+	ESimpleNetWireFeature Features = ESimpleNetWireFeature::NONE;
+	if (ConfigInfo.bCompactHeader && ConfigInfo.bSlidingWindow)
+	{
+		Features |= ESimpleNetWireFeature::COMPACT_HEADER;
+	}
+
+	//流加密的密钥由SecretKey派生 没有配置就不启用
+	if (ConfigInfo.bStreamCipher && !ConfigInfo.SecretKey.IsEmpty())
+	{
+		Features |= ESimpleNetWireFeature::STREAM_CIPHER;
+
+		if (ConfigInfo.bCipherAuthentication)
+		{
+			Features |= ESimpleNetWireFeature::CIPHER_AUTH;
+		}
+	}
+
+	if (ConfigInfo.bCompression)
+	{
+		Features |= ESimpleNetWireFeature::COMPRESSION;
+	}
+
+	//只合并紧凑数据报 没有紧凑包头就不合并
+	if (ConfigInfo.bCoalesce && EnumHasAnyFlags(Features, ESimpleNetWireFeature::COMPACT_HEADER))
+	{
+		Features |= ESimpleNetWireFeature::COALESCE;
+	}
+
+	return Features;
+}
+
+int32 FSimpleConnetion::GetCipherHeadSize(ESimpleNetWireFeature InFeatures)
+{
+	return EnumHasAnyFlags(InFeatures, ESimpleNetWireFeature::STREAM_CIPHER) ?
+		SimpleEncryptionAndDecryption::GetStreamHeadSize() : 0;
+}
+
+void FSimpleConnetion::EncryptPackage(TArray<uint8>& InOutPackage, ESimpleNetWireFeature InFeatures)
+{
+	if (EnumHasAnyFlags(InFeatures, ESimpleNetWireFeature::STREAM_CIPHER))
+	{
+		bool bAuthentication = EnumHasAnyFlags(InFeatures, ESimpleNetWireFeature::CIPHER_AUTH);
+		int32 PayloadLen = InOutPackage.Num() - SimpleEncryptionAndDecryption::GetStreamHeadSize();
+
+		InOutPackage.AddUninitialized(SimpleEncryptionAndDecryption::GetStreamTailSize(bAuthentication));
+
+		//每个包的Nonce由序号生成 不会重复
+		uint8 Nonce[SimpleStreamCipher::NonceSize];
+		uint64 Sequence = (uint64)CipherSequence.Increment();
+		FMemory::Memcpy(Nonce, &CipherSalt, sizeof(uint32));
+		FMemory::Memcpy(Nonce + sizeof(uint32), &Sequence, sizeof(uint64));
+
+		SimpleEncryptionAndDecryption::StreamEncryption(InOutPackage.GetData(), PayloadLen, Nonce, bAuthentication);
+	}
+	else
+	{
+		SimpleEncryptionAndDecryption::Encryption(InOutPackage);
+	}
+}
+
+int32 FSimpleConnetion::DecryptPackage(uint8*& InOutData, int32 InLen)
+{
+	//对方切换之前发来的还是旧格式(重发的Hello 握手的确认) 收到第一个按协商结果加密的包才切换
+	//切换以后只接受流加密的包 没有标记的直接丢弃
+	if (bPendingWireFeatures && EnumHasAnyFlags(PendingWireFeatures, ESimpleNetWireFeature::STREAM_CIPHER) &&
+		IsPendingStreamPackage(InOutData, InLen))
+	{
+		ApplyPendingWireFeatures();
+	}
+
+	if (EnumHasAnyFlags(RecvWireFeatures, ESimpleNetWireFeature::STREAM_CIPHER))
+	{
+		uint8* Payload = nullptr;
+		int32 PayloadLen = SimpleEncryptionAndDecryption::StreamDecryption(InOutData, InLen,
+			EnumHasAnyFlags(RecvWireFeatures, ESimpleNetWireFeature::CIPHER_AUTH),
+			Payload);
+
+		if (PayloadLen == INDEX_NONE)
+		{
+			UE_LOG(LogSimpleNetChannel, Warning, TEXT("Stream package authentication failed, size = %i"), InLen);
+			return INDEX_NONE;
+		}
+
+		InOutData = Payload;
+		InLen = PayloadLen;
+	}
+	else
+	{
+		SimpleEncryptionAndDecryption::Decryption(InOutData, InLen);
+	}
+
+	//没有协商流加密时 按解密后的包头分辨
+	if (bPendingWireFeatures && !EnumHasAnyFlags(PendingWireFeatures, ESimpleNetWireFeature::STREAM_CIPHER) &&
+		IsPendingWireFormat(InOutData, InLen))
+	{
+		ApplyPendingWireFeatures();
+	}
+
+	return InLen;
+}
+
+void FSimpleConnetion::SetPendingWireFeatures(ESimpleNetWireFeature InFeatures, bool bSendNow)
+{
+	if (bSendNow)
+	{
+		SendWireFeatures = InFeatures;
+	}
+
+	//重复的Hello或者Challenge 已经切换过就不用再等
+	if (!bPendingWireFeatures && RecvWireFeatures == InFeatures && SendWireFeatures == InFeatures)
+	{
+		return;
+	}
+
+	//只有加密和包头格式需要分辨新旧 其他特性不影响解析 马上生效
+	const ESimpleNetWireFeature FormatFeatures =
+		ESimpleNetWireFeature::COMPACT_HEADER |
+		ESimpleNetWireFeature::COALESCE |
+		ESimpleNetWireFeature::STREAM_CIPHER |
+		ESimpleNetWireFeature::CIPHER_AUTH;
+	if (!EnumHasAnyFlags(InFeatures, FormatFeatures))
+	{
+		PendingWireFeatures = InFeatures;
+		ApplyPendingWireFeatures();
+		return;
+	}
+
+	RecvWireFeatures = InFeatures & ~FormatFeatures;
+	PendingWireFeatures = InFeatures;
+	bPendingWireFeatures = true;
+}
+
+void FSimpleConnetion::ApplyPendingWireFeatures()
+{
+	RecvWireFeatures = PendingWireFeatures;
+	SendWireFeatures = PendingWireFeatures;
+	bPendingWireFeatures = false;
+}
+
+bool FSimpleConnetion::IsPendingWireFormat(const uint8* InData, int32 InLen)
+{
+	//合并包里都是紧凑数据报 看第一个就够了
+	if (EnumHasAnyFlags(PendingWireFeatures, ESimpleNetWireFeature::COALESCE) &&
+		SimpleNetWireHeader::IsCoalesced(InData, InLen))
+	{
+		bool bValid = false;
+		bool bFirst = true;
+		SimpleNetWireHeader::SplitCoalesced(const_cast<uint8*>(InData), InLen, [&](uint8* InPackageData, int32 InPackageSize)
+		{
+			if (bFirst)
+			{
+				bFirst = false;
+				bValid = IsValidCompactPackage(InPackageData, InPackageSize);
+			}
+		});
+
+		return bValid;
+	}
+
+	//旧格式以Protocol的低位开头 不会是紧凑包头的标记 这里再解码一次确认
+	if (EnumHasAnyFlags(PendingWireFeatures, ESimpleNetWireFeature::COMPACT_HEADER))
+	{
+		return IsValidCompactPackage(InData, InLen);
+	}
+
+	return FSimpleNetGlobalInfo::Get()->GetInfo().bSlidingWindow ?
+		IsValidPackageHead(InData, InLen) :
+		IsValidBunchHead(InData, InLen);
+}
+
+bool FSimpleConnetion::IsPendingStreamPackage(const uint8* InData, int32 InLen)
+{
+	if (!SimpleEncryptionAndDecryption::IsStreamPackage(InData, InLen))
+	{
+		return false;
+	}
+
+	//在拷贝上试着解密 不是的话原数据还要按旧格式解
+	FSimpleNetPooledBuffer Buffer(InLen);
+	TArray<uint8>& Package = Buffer.Get();
+	Package.Append(InData, InLen);
+
+	bool bAuthentication = EnumHasAnyFlags(PendingWireFeatures, ESimpleNetWireFeature::CIPHER_AUTH);
+
+	uint8* Payload = nullptr;
+	int32 PayloadLen = SimpleEncryptionAndDecryption::StreamDecryption(Package.GetData(), InLen, bAuthentication, Payload);
+	if (PayloadLen == INDEX_NONE)
+	{
+		return false;
+	}
+
+	//认证码通过 一定是对方按协商结果发来的
+	if (bAuthentication)
+	{
+		return true;
+	}
+
+	//没有认证码时 旧格式的包异或以后也可能正好以标记开头 再看一下明文
+	return IsPendingWireFormat(Payload, PayloadLen);
+}
+
+bool FSimpleConnetion::IsValidCompactPackage(const uint8* InData, int32 InLen)
+{
+	if (!SimpleNetWireHeader::IsCompact(InData, InLen))
+	{
+		return false;
+	}
+
+	FSimpleNetPooledBuffer Buffer(InLen + SimpleNetWireHeader::GetMaxExpandSize());
+	TArray<uint8>& WireData = Buffer.Get();
+	WireData.SetNumUninitialized(InLen + SimpleNetWireHeader::GetMaxExpandSize(), false);
+
+	FSimpleChannel* MainChannel = GetMainChannel();
+	int32 WireSize = SimpleNetWireHeader::Decode(InData, InLen,
+		MainChannel ? MainChannel->GetGuid() : FGuid(),
+		WireData.GetData(), WireData.Num());
+
+	return WireSize != INDEX_NONE && IsValidPackageHead(WireData.GetData(), WireSize);
+}
+
+bool FSimpleConnetion::IsValidPackageHead(const uint8* InData, int32 InLen)
+{
+	if (InLen < (int32)sizeof(FSimplePackageHead))
+	{
+		return false;
+	}
+
+	//按字节看bool 不是0或1说明不是包头
+	if (InData[STRUCT_OFFSET(FSimplePackageHead, bAck)] > 1 ||
+		InData[STRUCT_OFFSET(FSimplePackageHead, bForceSend)] > 1)
+	{
+		return false;
+	}
+
+	FSimplePackageHead Head;
+	FMemory::Memcpy(&Head, InData, sizeof(FSimplePackageHead));
+
+	//滑动窗口模式下 不是强制发送的只有握手和分片协议
+	if (Head.bForceSend)
+	{
+		return true;
+	}
+
+	switch (Head.Protocol)
+	{
+	case SP_HandshaketoSend:
+	case SP_ReadytoAccept:
+	case SP_Send:
+	case SP_Recv:
+	case SP_RecvComplete:
+		return true;
+	}
+
+	return false;
+}
+
+bool FSimpleConnetion::IsValidBunchHead(const uint8* InData, int32 InLen)
+{
+	if (InLen < (int32)sizeof(FSimpleBunchHead))
+	{
+		return false;
+	}
+
+	//没有用到的标志位必须是0
+	return InData[STRUCT_OFFSET(FSimpleBunchHead, bAsynchronous)] <= 1 &&
+		(InData[STRUCT_OFFSET(FSimpleBunchHead, Flags)] & ~BUNCH_ALL) == 0;
+}
+
+void FSimpleConnetion::ResetCipher()
+{
+	//随机的起点 多个链接使用同一个密钥也不会撞上
+	FGuid Random = FGuid::NewGuid();
+	CipherSalt = Random.A;
+	CipherSequence.Set((int64)(((uint64)Random.B << 32) | Random.C) & MAX_int64);
+}
+
+FGuid FSimpleConnetion::MakeSequencePackageID()
+{
+	return SimpleNetWireHeader::MakeSequenceGuid((uint32)PackageSequence.Increment());
+}
+
+bool FSimpleConnetion::EncodeWireHeader(const TArray<uint8>& InData, ESimpleNetWireFeature InFeatures, TArray<uint8>& OutData)
+{
+	if (EnumHasAnyFlags(InFeatures, ESimpleNetWireFeature::COMPACT_HEADER))
+	{
+		FSimpleChannel* MainChannel = GetMainChannel();
+		return SimpleNetWireHeader::Encode(
+			InData.GetData(), InData.Num(),
+			FSimpleNetGlobalInfo::Get()->GetInfo().bSlidingWindow,
+			MainChannel ? MainChannel->GetGuid() : FGuid(),
+			OutData);
+	}
+
+	return false;
+}
+
+bool FSimpleConnetion::IsCompactPackage(const uint8* InData, int32 InLen) const
+{
+	//对方切换以后发来的每个数据报都是紧凑包头(合并的在这之前已经拆开) 不按第一个字节猜
+	//切换之前收到的旧格式在DecryptPackage里分辨 切换以后格式不对的在Decode里丢弃
+	return EnumHasAnyFlags(RecvWireFeatures, ESimpleNetWireFeature::COMPACT_HEADER);
+}
+
+bool FSimpleConnetion::IsCoalescedPackage(const uint8* InData, int32 InLen) const
+{
+	return EnumHasAnyFlags(RecvWireFeatures, ESimpleNetWireFeature::COALESCE) &&
+		SimpleNetWireHeader::IsCoalesced(InData, InLen);
 }
 
 void FSimpleConnetion::Lock()
@@ -1034,7 +1799,15 @@ void FSimpleConnetion::Lock()
 
 void FSimpleConnetion::UnLock()
 {
-	bLock = false;
+	if (bLock)
+	{
+		bLock = false;
+
+		if (Manage && SlotIndex != INDEX_NONE)
+		{
+			Manage->OnConnetionUnLock(SlotIndex);
+		}
+	}
 }
 
 #if PLATFORM_WINDOWS
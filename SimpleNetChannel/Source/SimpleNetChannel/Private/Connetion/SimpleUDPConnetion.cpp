@@ -8,11 +8,20 @@
 #include "SimpleNetManage.h"
 #include "Protocols/SimpleNetProtocols.h"
 #include "Core/EncryptionAndDecryption/SimpleEncryptionAndDecryption.h"
+#include "Core/WireHeader/SimpleNetWireHeader.h"
 
 #if PLATFORM_WINDOWS
 #pragma optimize("",off) 
 #endif
 
+FSimpleUDPConnetion::FSimpleUDPConnetion()
+	:CoalesceFeatures(ESimpleNetWireFeature::NONE)
+	,CoalesceNum(0)
+	,CoalesceFirstSize(0)
+	,PendingSendTime(0.0)
+{
+}
+
 void FSimpleUDPConnetion::ConnectVerification()
 {
 	Super::ConnectVerification();
@@ -28,26 +37,233 @@ void FSimpleUDPConnetion::Analysis(uint8* InData, int32 BytesNumber)
 
 void FSimpleUDPConnetion::Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNewAddr)
 {
-	//针对异步情况下 和主线程竞争发送资源
+	if (!InNewAddr.IsValid())
+	{
+		return;
+	}
+
+	//拷贝一份入队 调用方的数据可能会被重发(例如分包) 加密在FlushSend里进行
+	//协商了紧凑包头的话 编码结果本身就是一份拷贝
+	//先取一次发送特性 编码和加密按同一个格式 中途切换也不会混用
+	FSendEntry Entry;
+	Entry.Features = SendWireFeatures;
+	if (!EncodeWireHeader(InData, Entry.Features, Entry.Data))
+	{
+		Entry.Data = InData;
+	}
+
+	//自己的远端地址不会被改写 其他地址(例如接收缓冲里的)需要保存一份
+	Entry.Addr = InNewAddr == RemoteAddr ? InNewAddr : TSharedPtr<FInternetAddr>(InNewAddr->Clone());
+
+	int32 CoalesceSize = EnumHasAnyFlags(Entry.Features, ESimpleNetWireFeature::COALESCE) ? Entry.Data.Num() : 0;
+
+	SendQueue.Enqueue(MoveTemp(Entry));
+
+	CheckCoalesce(CoalesceSize);
+}
+
+void FSimpleUDPConnetion::Send(TArray<uint8>& InHead, const FSimpleSharedSlice& InBody, TSharedPtr<FInternetAddr> InNewAddr)
+{
+	if (!InBody.IsValid())
+	{
+		Send(InHead, InNewAddr);
+		return;
+	}
+
+	if (!InNewAddr.IsValid())
+	{
+		return;
+	}
+
+	//只编码自己的包头 包体引用计数保存到发送完成
+	FSendEntry Entry;
+	Entry.Features = SendWireFeatures;
+	if (!EncodeWireHeader(InHead, Entry.Features, Entry.Data))
+	{
+		Entry.Data = InHead;
+	}
+
+	Entry.Body = InBody;
+	Entry.Addr = InNewAddr == RemoteAddr ? InNewAddr : TSharedPtr<FInternetAddr>(InNewAddr->Clone());
+
+	SendQueue.Enqueue(MoveTemp(Entry));
+}
+
+void FSimpleUDPConnetion::CheckCoalesce(int32 InSize)
+{
+	if (InSize <= 0)
+	{
+		return;
+	}
+
+	const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+
+	double CurrentTime = FPlatformTime::Seconds();
+	double FirstTime = 0.0;
+	if (PendingSendTime.compare_exchange_strong(FirstTime, CurrentTime))
+	{
+		FirstTime = CurrentTime;
+	}
+
+	//一般等网络Tick统一发送 帧很长或者消息很多时通知网络线程马上发
+	//生产者线程不拿Socket锁 也不做加密
+	if (PendingSendBytes.Add(InSize) + InSize >= ConfigInfo.CoalesceMTU ||
+		CurrentTime - FirstTime >= ConfigInfo.CoalesceLatency)
+	{
+		if (FSimpleNetManage* InManage = GetManage())
+		{
+			InManage->RequestFlush();
+		}
+	}
+}
+
+void FSimpleUDPConnetion::FlushSend()
+{
+	if (!SendQueue.IsEmpty())
+	{
+		FlushSendQueue();
+	}
+
+	if (SendImpairment.IsEnabled())
+	{
+		FlushImpairment(FPlatformTime::Seconds());
+	}
+}
+
+void FSimpleUDPConnetion::FlushImpairment(double InTime)
+{
+	if (!SendImpairment.IsEnabled())
+	{
+		return;
+	}
+
 	FScopeLock SocketLock(&SocketMutex);
 
-	FSimpleConnetion::Send(InData, InNewAddr);
+	SendImpairment.Release(InTime, [this](FSimpleNetImpairment::FPacket& InPacket)
+	{
+		if (Socket && InPacket.Addr.IsValid())
+		{
+			SendToSocket(InPacket.Data.GetData(), InPacket.Data.Num(), *InPacket.Addr);
+		}
+	});
+}
 
-	if (Socket)
+void FSimpleUDPConnetion::FlushSendQueue()
+{
+	//一次加锁发送全部 而不是每个数据报都去抢锁
+	FScopeLock SocketLock(&SocketMutex);
+
+	//之后入队的算到下一次
+	PendingSendBytes.Reset();
+	PendingSendTime = 0.0;
+
+	int32 CoalesceMTU = FMath::Clamp(FSimpleNetGlobalInfo::Get()->GetInfo().CoalesceMTU, 64, 65507);
+
+	FSendEntry Entry;
+	while (SendQueue.Dequeue(Entry))
 	{
-		int32 BytesSend = 0;
-		if (Socket->SendTo(InData.GetData(), InData.Num(), BytesSend,*InNewAddr))
+		if (!Socket)
+		{
+			continue;
+		}
+
+		//只合并编码过的紧凑数据报 共享包体的广播分片单独发
+		bool bCoalesce = EnumHasAnyFlags(Entry.Features, ESimpleNetWireFeature::COALESCE) &&
+			!Entry.Body.IsValid() &&
+			SimpleNetWireHeader::IsCompact(Entry.Data.GetData(), Entry.Data.Num()) &&
+			SimpleNetWireHeader::GetCoalescedSize(0, Entry.Data.Num()) + GetCipherHeadSize(Entry.Features) <= CoalesceMTU;
+
+		if (CoalesceNum > 0)
+		{
+			//地址或者加密方式不同 或者放不下了 先把攒着的发出去
+			if (!bCoalesce ||
+				CoalesceFeatures != Entry.Features ||
+				(CoalesceAddr != Entry.Addr && !(*CoalesceAddr == *Entry.Addr)) ||
+				SimpleNetWireHeader::GetCoalescedSize(CoalesceScratch.Num(), Entry.Data.Num()) + GetCipherHeadSize(Entry.Features) > CoalesceMTU)
+			{
+				FlushCoalesced();
+			}
+		}
+
+		if (bCoalesce)
 		{
-			if (FSimpleNetGlobalInfo::Get()->GetInfo().bShowSendDebug)
+			if (CoalesceNum == 0)
 			{
-				UE_LOG(LogSimpleNetChannel, Display, TEXT("SendTo %i Bytes"), BytesSend);
-			}	
+				CoalesceAddr = Entry.Addr;
+				CoalesceFeatures = Entry.Features;
+				CoalesceFirstSize = Entry.Data.Num();
+			}
+
+			SimpleNetWireHeader::AppendCoalesced(CoalesceScratch, Entry.Data.GetData(), Entry.Data.Num());
+			CoalesceNum++;
 		}
 		else
 		{
-			UE_LOG(LogSimpleNetChannel, Error, TEXT(" Send Error!,Please check whether the peer address is correct"));
+			SendDatagram(Entry.Data, Entry.Body, Entry.Features, Entry.Addr);
+		}
+	}
+
+	FlushCoalesced();
+}
+
+void FSimpleUDPConnetion::FlushCoalesced()
+{
+	if (CoalesceNum > 0 && Socket)
+	{
+		if (CoalesceNum == 1)
+		{
+			//只有一个的话按原样发送 省掉合并的标记和长度
+			CoalesceScratch.RemoveAt(0, CoalesceScratch.Num() - CoalesceFirstSize, false);
+		}
+
+		SendDatagram(CoalesceScratch, FSimpleSharedSlice(), CoalesceFeatures, CoalesceAddr);
+	}
+
+	CoalesceScratch.Reset();
+	CoalesceAddr.Reset();
+	CoalesceNum = 0;
+}
+
+void FSimpleUDPConnetion::SendDatagram(const TArray<uint8>& InData, const FSimpleSharedSlice& InBody, ESimpleNetWireFeature InFeatures, const TSharedPtr<FInternetAddr>& InAddr)
+{
+	//FSocket没有分散写 共享包体在这里拼接
+	//加密放在这里 流加密的序号和真正发出的顺序一致
+	SendScratch.Reset();
+	SendScratch.AddUninitialized(GetCipherHeadSize(InFeatures));
+	SendScratch.Append(InData);
+	if (InBody.IsValid())
+	{
+		SendScratch.Append(InBody.GetData(), InBody.Size);
+	}
+
+	EncryptPackage(SendScratch, InFeatures);
+
+	//损伤层按加密后的数据报处理 和真正在线路上看到的一样
+	if (SendImpairment.IsEnabled())
+	{
+		SendImpairment.Add(SendScratch.GetData(), SendScratch.Num(), InAddr, FPlatformTime::Seconds());
+		return;
+	}
+
+	SendToSocket(SendScratch.GetData(), SendScratch.Num(), *InAddr);
+}
+
+void FSimpleUDPConnetion::SendToSocket(const uint8* InData, int32 InLen, const FInternetAddr& InAddr)
+{
+	int32 BytesSend = 0;
+	if (Socket->SendTo(InData, InLen, BytesSend, InAddr))
+	{
+		Telemetry.OnSend(BytesSend);
+
+		if (FSimpleNetGlobalInfo::Get()->GetInfo().bShowSendDebug)
+		{
+			UE_LOG(LogSimpleNetChannel, Display, TEXT("SendTo %i Bytes"), BytesSend);
 		}
 	}
+	else
+	{
+		UE_LOG(LogSimpleNetChannel, Error, TEXT(" Send Error!,Please check whether the peer address is correct"));
+	}
 }
 
 void FSimpleUDPConnetion::Send(TArray<uint8>& InData)
@@ -57,6 +273,14 @@ void FSimpleUDPConnetion::Send(TArray<uint8>& InData)
 
 void FSimpleUDPConnetion::Listen()
 {
+	//和FSimpleUDPManage::Listen一样 一次唤醒尽量多取 只会读取BytesRead
+	if (!RecvBuffer.IsInit())
+	{
+		RecvBuffer.Init(
+			FSimpleNetGlobalInfo::Get()->GetInfo().RecvBatchNumber,
+			FSimpleNetGlobalInfo::Get()->GetInfo().RecvDataNumber);
+	}
+
 	bool bInitRemoteAddr = false;
 	while (Socket && !bStopListen && Manage)
 	{
@@ -66,20 +290,15 @@ void FSimpleUDPConnetion::Listen()
 			return;
 		}
 
-		int32 RecvDataNumber = FSimpleNetGlobalInfo::Get()->GetInfo().RecvDataNumber;
-#if PLATFORM_WINDOWS || PLATFORM_MAC || PLATFORM_LINUX
-		uint8 Data[8196 * 1024] = { 0 };
-#elif /*PLATFORM_IOS || */PLATFORM_ANDROID
-		uint8 Data[8196 * 10] = { 0 };
-#else
-		uint8 Data[8196 * 100] = { 0 };
-#endif
-		int32 BytesRead = 0;
-		ISocketSubsystem* SocketSubsystem = FSimpleConnetion::GetSocketSubsystem();
-		TSharedPtr<FInternetAddr> InRemoteAddr = SocketSubsystem->CreateInternetAddr();
-		bool bRecvFrom = Socket->RecvFrom(Data, RecvDataNumber, BytesRead, *InRemoteAddr);
-		if (bRecvFrom)
+		//阻塞Socket 第一次读取会阻塞 之后只取已经到达的
+		int32 RecvNum = RecvBuffer.Drain(Socket, false);
+		for (int32 i = 0; i < RecvNum && Socket && !bStopListen; i++)
 		{
+			FSimpleNetRecvBuffer::FSlot& Slot = RecvBuffer[i];
+			uint8* Data = Slot.Data;
+			int32 BytesRead = Slot.BytesRead;
+			TSharedPtr<FInternetAddr> InRemoteAddr = Slot.Addr;
+
 			if (bInitRemoteAddr)
 			{
 				//必须保证加入
@@ -96,8 +315,11 @@ void FSimpleUDPConnetion::Listen()
 						InRemoteAddr->GetPort());
 				}
 			}
-			else
+			else if (BytesRead >= (int32)(sizeof(FSimplePackageHead) + sizeof(FSimpleBunchHead)))
 			{
+				//绑定前还没有协商 只会是旧的加密
+				SimpleEncryptionAndDecryption::Decryption(Data, BytesRead);
+
 				if (FSimpleChannel* Channel = GetMainChannel())
 				{
 					int32 PackageHeadSize = sizeof(FSimplePackageHead);
@@ -105,16 +327,14 @@ void FSimpleUDPConnetion::Listen()
 					FSimplePackageHead PackageHead = *(FSimplePackageHead*)Data;
 					FSimpleBunchHead InHead = *(FSimpleBunchHead*)&Data[PackageHeadSize];
 
-					FGuid InNewGuid = FGuid::NewGuid();
-					Channel->SetMsgQueueGuid(InNewGuid);
-
+					TArray<uint8> InNewData;
 					if (InHead.ParamNum > 0)
 					{
-						TArray<uint8> InNewData(&Data[PackageHeadSize], BytesRead - PackageHeadSize);
-
-						Channel->AddMsg(InNewGuid, InNewData);
+						InNewData.Append(&Data[PackageHeadSize], BytesRead - PackageHeadSize);
 					}
 
+					Channel->SetThreadMsg(InNewData);
+
 					switch (PackageHead.Protocol)
 					{
 						case SP_BindingAddressRequest:
@@ -301,6 +521,19 @@ bool FSimpleUDPConnetion::CloseSocket()
 
 	FScopeLock SocketLock(&SocketMutex);
 
+	//关闭前把还在队列里的数据发出去(例如SP_Close)
+	FlushSend();
+
+	//共享端口的Socket由管理器释放
+	if (bSharedSocket)
+	{
+		bStopListen = true;
+		bSharedSocket = false;
+		Socket = nullptr;
+
+		return true;
+	}
+
 	ISocketSubsystem* SocketSubsystem = FSimpleConnetion::GetSocketSubsystem();
 	if (!SocketSubsystem)
 	{
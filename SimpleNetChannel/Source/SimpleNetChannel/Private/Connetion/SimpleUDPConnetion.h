@@ -3,18 +3,32 @@
 #pragma once
 
 #include "Connetion/Core/SimpleConnetion.h"
+#include "Containers/Queue.h"
+#include "Core/RecvBuffer/SimpleNetRecvBuffer.h"
+#include <atomic>
 
 //一个Connetion Corresponding to a client
 class FSimpleUDPConnetion :public FSimpleConnetion
 {
 public:
+	FSimpleUDPConnetion();
 
 	virtual void ConnectVerification();
 
 	virtual void Analysis(uint8* InData, int32 BytesNumber);
 
+	//只负责入队 不持有Socket锁 真正的发送在FlushSend
 	virtual void Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNewAddr);
 	virtual void Send(TArray<uint8>& InData);
+	virtual void Send(TArray<uint8>& InHead, const FSimpleSharedSlice& InBody, TSharedPtr<FInternetAddr> InNewAddr);
+	using FSimpleConnetion::Send;
+
+	//每个网络Tick把队列里积攒的数据报一次性发出去
+	//协商了合并发送的话 同一个地址的小数据报合并到CoalesceMTU再发
+	virtual void FlushSend();
+
+	//损伤层延迟到期的数据报在FlushSend里发出
+	virtual void FlushImpairment(double InTime);
 
 	//virtual void Receive(const FGuid& InChannelID, TArray<uint8>& InData);
 
@@ -26,4 +40,48 @@ public:
 	virtual bool CloseSocket();
 
 	int32 ResetBindPort(uint32 &InPort, ISocketSubsystem* InSocketSubsystem);
+
+protected:
+	struct FSendEntry
+	{
+		TArray<uint8> Data;
+		FSimpleSharedSlice Body;//共享包体 发送时拼接在Data后面
+		TSharedPtr<FInternetAddr> Addr;
+		ESimpleNetWireFeature Features;//入队时的发送特性 决定怎么加密
+	};
+
+	//加密后发出一个数据报 持有SocketMutex时调用
+	void SendDatagram(const TArray<uint8>& InData, const FSimpleSharedSlice& InBody, ESimpleNetWireFeature InFeatures, const TSharedPtr<FInternetAddr>& InAddr);
+
+	//把攒着的合并数据报发出去
+	void FlushCoalesced();
+
+	//发送队列里的数据报加密后发出或者交给损伤层
+	void FlushSendQueue();
+
+	//真正调用Socket发送 持有SocketMutex时调用
+	void SendToSocket(const uint8* InData, int32 InLen, const FInternetAddr& InAddr);
+
+	//入队后检查 攒够一个MTU或者等待超过CoalesceLatency就通知网络线程提前发送
+	void CheckCoalesce(int32 InSize);
+
+	//多生产者 单消费者(持有SocketMutex的刷新者)
+	TQueue<FSendEntry, EQueueMode::Mpsc> SendQueue;
+
+	//预留加密头 拼接包头和共享包体后整体加密 只在FlushSend里使用
+	TArray<uint8> SendScratch;
+
+	//正在合并的数据报 只在FlushSend里使用
+	TArray<uint8> CoalesceScratch;
+	TSharedPtr<FInternetAddr> CoalesceAddr;
+	ESimpleNetWireFeature CoalesceFeatures;
+	int32 CoalesceNum;
+	int32 CoalesceFirstSize;
+
+	//队列里等待合并的字节数和最早入队的时间
+	FThreadSafeCounter PendingSendBytes;
+	std::atomic<double> PendingSendTime;
+
+	//独立端口的监听线程使用 第一次监听时分配 之后重复使用
+	FSimpleNetRecvBuffer RecvBuffer;
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "SimpleNetCompression.h"
+#include "SimpleNetChannelType.h"
+#include "Stream/SimpleNetBufferPool.h"
+#include "Misc/Compression.h"
+
+namespace SimpleNetCompression
+{
+	//原长度字段
+	const int32 RawSizeBytes = sizeof(uint32);
+
+	//还原时最多申请这么多 防止伪造的长度
+	const int32 MaxRawSize = 16 * 1024 * 1024;
+
+	bool CompressBody(const uint8* InBody, int32 InSize, TArray<uint8>& OutBody, int32 InThreshold)
+	{
+		if (!InBody || InSize < FMath::Max(InThreshold, 1) || InSize > MaxRawSize)
+		{
+			return false;
+		}
+
+		const int32 Bound = FCompression::CompressMemoryBound(NAME_LZ4, InSize);
+		OutBody.SetNumUninitialized(RawSizeBytes + Bound, false);
+
+		int32 CompressedSize = Bound;
+		if (!FCompression::CompressMemory(NAME_LZ4,
+			OutBody.GetData() + RawSizeBytes, CompressedSize,
+			InBody, InSize))
+		{
+			return false;
+		}
+
+		//没有变小就按原样发送 对方不需要解压
+		const int32 BodySize = RawSizeBytes + CompressedSize;
+		if (BodySize >= InSize)
+		{
+			return false;
+		}
+
+		uint32 RawSizeValue = InSize;
+		FMemory::Memcpy(OutBody.GetData(), &RawSizeValue, RawSizeBytes);
+		OutBody.SetNumUninitialized(BodySize, false);
+
+		return true;
+	}
+
+	bool Compress(TArray<uint8>& InOutBunch, int32 InThreshold)
+	{
+		const int32 HeadSize = sizeof(FSimpleBunchHead);
+		const int32 RawSize = InOutBunch.Num() - HeadSize;
+		if (RawSize < FMath::Max(InThreshold, 1) || RawSize > MaxRawSize)
+		{
+			return false;
+		}
+
+		FSimpleBunchHead* BunchHead = (FSimpleBunchHead*)InOutBunch.GetData();
+		if (BunchHead->Flags & BUNCH_COMPRESSED)
+		{
+			return false;
+		}
+
+		FSimpleNetPooledBuffer Scratch(RawSizeBytes + FCompression::CompressMemoryBound(NAME_LZ4, RawSize));
+		TArray<uint8>& CompressedData = Scratch.Get();
+		if (!CompressBody(InOutBunch.GetData() + HeadSize, RawSize, CompressedData, InThreshold))
+		{
+			return false;
+		}
+
+		//只会变小 原缓冲直接覆盖
+		const int32 BodySize = CompressedData.Num();
+		FMemory::Memcpy(InOutBunch.GetData() + HeadSize, CompressedData.GetData(), BodySize);
+		InOutBunch.SetNumUninitialized(HeadSize + BodySize, false);
+
+		BunchHead = (FSimpleBunchHead*)InOutBunch.GetData();
+		BunchHead->Flags |= BUNCH_COMPRESSED;
+
+		return true;
+	}
+
+	bool IsCompressed(const uint8* InData, int32 InLen)
+	{
+		return InData && InLen >= (int32)sizeof(FSimpleBunchHead) &&
+			(((const FSimpleBunchHead*)InData)->Flags & BUNCH_COMPRESSED);
+	}
+
+	int32 Decompress(const uint8* InData, int32 InLen, TArray<uint8>& OutData)
+	{
+		const int32 HeadSize = sizeof(FSimpleBunchHead);
+		if (!IsCompressed(InData, InLen) || InLen < HeadSize + RawSizeBytes)
+		{
+			return INDEX_NONE;
+		}
+
+		uint32 RawSize = 0;
+		FMemory::Memcpy(&RawSize, InData + HeadSize, RawSizeBytes);
+		if (RawSize == 0 || RawSize > (uint32)MaxRawSize)
+		{
+			return INDEX_NONE;
+		}
+
+		OutData.SetNumUninitialized(HeadSize + RawSize, false);
+		FMemory::Memcpy(OutData.GetData(), InData, HeadSize);
+
+		if (!FCompression::UncompressMemory(NAME_LZ4,
+			OutData.GetData() + HeadSize, RawSize,
+			InData + HeadSize + RawSizeBytes, InLen - HeadSize - RawSizeBytes))
+		{
+			return INDEX_NONE;
+		}
+
+		//上层看到的是没有压缩过的消息
+		FSimpleBunchHead* BunchHead = (FSimpleBunchHead*)OutData.GetData();
+		BunchHead->Flags &= ~BUNCH_COMPRESSED;
+
+		return HeadSize + RawSize;
+	}
+}
@@ -0,0 +1,23 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//大消息压缩
+//角色列表 背包 聊天记录这类消息动辄几KB 不压缩会被拆成很多分片
+//在分片之前把通道头后面的包体用LZ4压缩 通道头标记BUNCH_COMPRESSED 接收端合包后还原
+//临时缓冲从线程本地的缓冲池借用 稳定运行后不再申请内存
+namespace SimpleNetCompression
+{
+	//InOutBunch为[FSimpleBunchHead][包体] 包体不小于InThreshold并且压缩后变小才会改写
+	bool Compress(TArray<uint8>& InOutBunch, int32 InThreshold);
+
+	//只压缩包体 OutBody为[uint32 原长度][LZ4数据] 广播时所有接收者共用一份
+	bool CompressBody(const uint8* InBody, int32 InSize, TArray<uint8>& OutBody, int32 InThreshold);
+
+	bool IsCompressed(const uint8* InData, int32 InLen);
+
+	//还原成[FSimpleBunchHead][包体]写入OutData 返回还原后的长度 失败返回INDEX_NONE
+	int32 Decompress(const uint8* InData, int32 InLen, TArray<uint8>& OutData);
+}
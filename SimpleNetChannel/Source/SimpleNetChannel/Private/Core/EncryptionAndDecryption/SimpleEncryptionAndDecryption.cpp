@@ -2,43 +2,107 @@
 
 #include "SimpleEncryptionAndDecryption.h"
 #include "Global/SimpleNetGlobalInfo.h"
+#include "SimpleStreamCipher.h"
 
 namespace SimpleEncryptionAndDecryption
 {
 	void Encryption(TArray<uint8>& InData)
 	{
+		Encryption(InData.GetData(), InData.Num());
+	}
+
+	void Encryption(uint8* InData, int32 InLen)
+	{
+		//每个字节和所有密钥字节异或 等价于和折叠后的一个字节异或
 		const FString& SecretKey = FSimpleNetGlobalInfo::Get()->GetInfo().SecretKey;
 		if (!SecretKey.IsEmpty())
 		{
-			const TArray<uint8>& SecretKeyArray = FSimpleNetGlobalInfo::Get()->GetSecretKey();
-			for (auto& Tmp : InData)
-			{
-				for (auto& TmpSecretKey : SecretKeyArray)
-				{
-					Tmp ^= TmpSecretKey;
-				}
-			}
+			SimpleStreamCipher::XorByte(InData, InLen, FSimpleNetGlobalInfo::Get()->GetFoldedSecretKey());
 		}
 	}
 
 	void Decryption(uint8* InData, int32 InLen)
 	{
-		const FString& SecretKey = FSimpleNetGlobalInfo::Get()->GetInfo().SecretKey;
-		if (!SecretKey.IsEmpty())
-		{
-			const TArray<uint8>& SecretKeyArray = FSimpleNetGlobalInfo::Get()->GetSecretKey();
-			for (int32 i = 0; i < InLen; i++)
-			{
-				for (int32 j = (SecretKeyArray.Num() - 1); j > -1; j--)
-				{
-					InData[i] ^= SecretKeyArray[j];
-				}
-			}
-		}
+		Encryption(InData, InLen);
 	}
 
 	void Decryption(TArray<uint8>& InData)
 	{
 		Decryption(InData.GetData(), InData.Num());
 	}
+
+	int32 GetStreamHeadSize()
+	{
+		return 1 + SimpleStreamCipher::NonceSize;
+	}
+
+	int32 GetStreamTailSize(bool bAuthentication)
+	{
+		return bAuthentication ? SimpleStreamCipher::TagSize : 0;
+	}
+
+	bool IsStreamPackage(const uint8* InData, int32 InLen)
+	{
+		return InData && InLen >= GetStreamHeadSize() &&
+			(InData[0] == StreamMarker || InData[0] == StreamAuthMarker);
+	}
+
+	void StreamEncryption(uint8* InPackage, int32 InPayloadLen, const uint8* InNonce, bool bAuthentication)
+	{
+		const uint8* Key = FSimpleNetGlobalInfo::Get()->GetStreamKey();
+		int32 HeadSize = GetStreamHeadSize();
+
+		InPackage[0] = bAuthentication ? StreamAuthMarker : StreamMarker;
+		FMemory::Memcpy(InPackage + 1, InNonce, SimpleStreamCipher::NonceSize);
+
+		uint8* Payload = InPackage + HeadSize;
+		if (bAuthentication)
+		{
+			//标记和Nonce作为附加认证数据
+			SimpleStreamCipher::Seal(Key, InNonce, InPackage, HeadSize, Payload, InPayloadLen, Payload + InPayloadLen);
+		}
+		else
+		{
+			SimpleStreamCipher::Xor(Key, InNonce, 1, Payload, InPayloadLen);
+		}
+	}
+
+	int32 StreamDecryption(uint8* InData, int32 InLen, bool bRequireAuthentication, uint8*& OutPayload)
+	{
+		if (!IsStreamPackage(InData, InLen))
+		{
+			return INDEX_NONE;
+		}
+
+		bool bAuthentication = InData[0] == StreamAuthMarker;
+		if (bRequireAuthentication && !bAuthentication)
+		{
+			return INDEX_NONE;
+		}
+
+		int32 HeadSize = GetStreamHeadSize();
+		int32 PayloadLen = InLen - HeadSize - GetStreamTailSize(bAuthentication);
+		if (PayloadLen < 0)
+		{
+			return INDEX_NONE;
+		}
+
+		const uint8* Key = FSimpleNetGlobalInfo::Get()->GetStreamKey();
+		const uint8* Nonce = InData + 1;
+		uint8* Payload = InData + HeadSize;
+		if (bAuthentication)
+		{
+			if (!SimpleStreamCipher::Open(Key, Nonce, InData, HeadSize, Payload, PayloadLen, Payload + PayloadLen))
+			{
+				return INDEX_NONE;
+			}
+		}
+		else
+		{
+			SimpleStreamCipher::Xor(Key, Nonce, 1, Payload, PayloadLen);
+		}
+
+		OutPayload = Payload;
+		return PayloadLen;
+	}
 }
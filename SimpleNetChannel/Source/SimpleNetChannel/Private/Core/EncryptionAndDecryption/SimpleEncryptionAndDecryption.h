@@ -7,7 +7,28 @@
 
 namespace SimpleEncryptionAndDecryption
 {
+	//旧的加密方式 握手完成前和不支持流加密的对方使用
 	void Encryption(TArray<uint8>& InData);
+	void Encryption(uint8* InData, int32 InLen);
 	void Decryption(uint8* InData, int32 InLen);
 	void Decryption(TArray<uint8>& InData);
+
+	//流加密的包 [标记][Nonce][密文][认证码]
+	enum
+	{
+		StreamMarker		= 0xC5,//不带认证码
+		StreamAuthMarker	= 0xC6,//带认证码
+	};
+
+	int32 GetStreamHeadSize();
+	int32 GetStreamTailSize(bool bAuthentication);
+
+	bool IsStreamPackage(const uint8* InData, int32 InLen);
+
+	//InPackage前面预留GetStreamHeadSize 后面预留GetStreamTailSize InPayloadLen是中间明文的长度
+	void StreamEncryption(uint8* InPackage, int32 InPayloadLen, const uint8* InNonce, bool bAuthentication);
+
+	//成功返回明文长度 OutPayload指向原地解密后的明文 失败返回INDEX_NONE
+	//bRequireAuthentication 不接受没有认证码的包
+	int32 StreamDecryption(uint8* InData, int32 InLen, bool bRequireAuthentication, uint8*& OutPayload);
 }
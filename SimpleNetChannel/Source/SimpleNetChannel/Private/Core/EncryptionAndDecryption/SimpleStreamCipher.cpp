@@ -0,0 +1,439 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "SimpleStreamCipher.h"
+#include "Misc/SecureHash.h"
+
+#define SIMPLE_STREAM_CIPHER_SIMD PLATFORM_ENABLE_VECTORINTRINSICS
+
+#define SNC_ROTL32(v,n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define SNC_QUARTERROUND(a,b,c,d) \
+	a += b; d ^= a; d = SNC_ROTL32(d,16); \
+	c += d; b ^= c; b = SNC_ROTL32(b,12); \
+	a += b; d ^= a; d = SNC_ROTL32(d,8); \
+	c += d; b ^= c; b = SNC_ROTL32(b,7);
+
+namespace SimpleStreamCipher
+{
+	enum
+	{
+		BlockSize = 64,
+		ParallelBlocks = 4,
+	};
+
+	//所有支持的平台都是小端
+	static FORCEINLINE uint32 LoadLE32(const uint8* InData)
+	{
+		uint32 Value;
+		FMemory::Memcpy(&Value, InData, sizeof(uint32));
+		return Value;
+	}
+
+	static FORCEINLINE void StoreLE32(uint8* OutData, uint32 InValue)
+	{
+		FMemory::Memcpy(OutData, &InValue, sizeof(uint32));
+	}
+
+	static FORCEINLINE void StoreLE64(uint8* OutData, uint64 InValue)
+	{
+		FMemory::Memcpy(OutData, &InValue, sizeof(uint64));
+	}
+
+	static void InitState(const uint8* InKey, const uint8* InNonce, uint32 InCounter, uint32* OutState)
+	{
+		//"expand 32-byte k"
+		OutState[0] = 0x61707865;
+		OutState[1] = 0x3320646e;
+		OutState[2] = 0x79622d32;
+		OutState[3] = 0x6b206574;
+
+		for (int32 i = 0; i < 8; i++)
+		{
+			OutState[4 + i] = LoadLE32(InKey + i * 4);
+		}
+
+		OutState[12] = InCounter;
+		OutState[13] = LoadLE32(InNonce);
+		OutState[14] = LoadLE32(InNonce + 4);
+		OutState[15] = LoadLE32(InNonce + 8);
+	}
+
+	static void Block(const uint32* InState, uint8* OutKeyStream)
+	{
+		uint32 X[16];
+		FMemory::Memcpy(X, InState, sizeof(X));
+
+		for (int32 i = 0; i < 10; i++)
+		{
+			SNC_QUARTERROUND(X[0], X[4], X[8], X[12]);
+			SNC_QUARTERROUND(X[1], X[5], X[9], X[13]);
+			SNC_QUARTERROUND(X[2], X[6], X[10], X[14]);
+			SNC_QUARTERROUND(X[3], X[7], X[11], X[15]);
+			SNC_QUARTERROUND(X[0], X[5], X[10], X[15]);
+			SNC_QUARTERROUND(X[1], X[6], X[11], X[12]);
+			SNC_QUARTERROUND(X[2], X[7], X[8], X[13]);
+			SNC_QUARTERROUND(X[3], X[4], X[9], X[14]);
+		}
+
+		for (int32 i = 0; i < 16; i++)
+		{
+			StoreLE32(OutKeyStream + i * 4, X[i] + InState[i]);
+		}
+	}
+
+#if SIMPLE_STREAM_CIPHER_SIMD
+	template<int32 N>
+	static FORCEINLINE VectorRegister4Int VectorRotl32(const VectorRegister4Int& InValue)
+	{
+		return VectorIntOr(VectorShiftLeftImm(InValue, N), VectorShiftRightImmLogical(InValue, 32 - N));
+	}
+
+	static FORCEINLINE void VectorQuarterRound(VectorRegister4Int& A, VectorRegister4Int& B, VectorRegister4Int& C, VectorRegister4Int& D)
+	{
+		A = VectorIntAdd(A, B); D = VectorRotl32<16>(VectorIntXor(D, A));
+		C = VectorIntAdd(C, D); B = VectorRotl32<12>(VectorIntXor(B, C));
+		A = VectorIntAdd(A, B); D = VectorRotl32<8>(VectorIntXor(D, A));
+		C = VectorIntAdd(C, D); B = VectorRotl32<7>(VectorIntXor(B, C));
+	}
+
+	//每个通道是一个块 4个块同时计算
+	static void Block4(const uint32* InState, uint8* OutKeyStream)
+	{
+		VectorRegister4Int X[16];
+		VectorRegister4Int Origin[16];
+		for (int32 i = 0; i < 16; i++)
+		{
+			int32 Value = (int32)InState[i];
+			X[i] = i == 12 ?
+				MakeVectorRegisterInt(Value, Value + 1, Value + 2, Value + 3) :
+				MakeVectorRegisterInt(Value, Value, Value, Value);
+
+			Origin[i] = X[i];
+		}
+
+		for (int32 i = 0; i < 10; i++)
+		{
+			VectorQuarterRound(X[0], X[4], X[8], X[12]);
+			VectorQuarterRound(X[1], X[5], X[9], X[13]);
+			VectorQuarterRound(X[2], X[6], X[10], X[14]);
+			VectorQuarterRound(X[3], X[7], X[11], X[15]);
+			VectorQuarterRound(X[0], X[5], X[10], X[15]);
+			VectorQuarterRound(X[1], X[6], X[11], X[12]);
+			VectorQuarterRound(X[2], X[7], X[8], X[13]);
+			VectorQuarterRound(X[3], X[4], X[9], X[14]);
+		}
+
+		//按块转置写出
+		uint32 Words[16][4];
+		for (int32 i = 0; i < 16; i++)
+		{
+			VectorIntStore(VectorIntAdd(X[i], Origin[i]), Words[i]);
+		}
+
+		for (int32 b = 0; b < ParallelBlocks; b++)
+		{
+			for (int32 i = 0; i < 16; i++)
+			{
+				StoreLE32(OutKeyStream + b * BlockSize + i * 4, Words[i][b]);
+			}
+		}
+	}
+#endif
+
+	static void XorBytes(uint8* InOutData, const uint8* InKeyStream, int32 InLen)
+	{
+		int32 i = 0;
+#if SIMPLE_STREAM_CIPHER_SIMD
+		for (; i + 16 <= InLen; i += 16)
+		{
+			VectorIntStore(VectorIntXor(VectorIntLoad(InOutData + i), VectorIntLoad(InKeyStream + i)), InOutData + i);
+		}
+#endif
+		for (; i < InLen; i++)
+		{
+			InOutData[i] ^= InKeyStream[i];
+		}
+	}
+
+	void XorByte(uint8* InOutData, int32 InLen, uint8 InValue)
+	{
+		int32 i = 0;
+#if SIMPLE_STREAM_CIPHER_SIMD
+		int32 Splat = (int32)(InValue * 0x01010101u);
+		VectorRegister4Int Key = MakeVectorRegisterInt(Splat, Splat, Splat, Splat);
+		for (; i + 16 <= InLen; i += 16)
+		{
+			VectorIntStore(VectorIntXor(VectorIntLoad(InOutData + i), Key), InOutData + i);
+		}
+#endif
+		for (; i < InLen; i++)
+		{
+			InOutData[i] ^= InValue;
+		}
+	}
+
+	void Xor(const uint8* InKey, const uint8* InNonce, uint32 InCounter, uint8* InOutData, int32 InLen)
+	{
+		uint32 State[16];
+		InitState(InKey, InNonce, InCounter, State);
+
+		uint8 KeyStream[BlockSize * ParallelBlocks];
+		while (InLen > 0)
+		{
+#if SIMPLE_STREAM_CIPHER_SIMD
+			if (InLen > BlockSize)
+			{
+				Block4(State, KeyStream);
+				State[12] += ParallelBlocks;
+
+				int32 Len = FMath::Min(InLen, (int32)sizeof(KeyStream));
+				XorBytes(InOutData, KeyStream, Len);
+				InOutData += Len;
+				InLen -= Len;
+				continue;
+			}
+#endif
+			Block(State, KeyStream);
+			State[12]++;
+
+			int32 Len = FMath::Min(InLen, (int32)BlockSize);
+			XorBytes(InOutData, KeyStream, Len);
+			InOutData += Len;
+			InLen -= Len;
+		}
+	}
+
+	//Poly1305 26位分段 只用32位乘法
+	struct FPoly1305
+	{
+		FPoly1305(const uint8* InKey)
+			:Leftover(0)
+		{
+			R[0] = (LoadLE32(InKey + 0)) & 0x3ffffff;
+			R[1] = (LoadLE32(InKey + 3) >> 2) & 0x3ffff03;
+			R[2] = (LoadLE32(InKey + 6) >> 4) & 0x3ffc0ff;
+			R[3] = (LoadLE32(InKey + 9) >> 6) & 0x3f03fff;
+			R[4] = (LoadLE32(InKey + 12) >> 8) & 0x00fffff;
+
+			FMemory::Memzero(H, sizeof(H));
+
+			for (int32 i = 0; i < 4; i++)
+			{
+				Pad[i] = LoadLE32(InKey + 16 + i * 4);
+			}
+		}
+
+		void Blocks(const uint8* InData, int32 InLen, uint32 InHiBit)
+		{
+			const uint32 R0 = R[0], R1 = R[1], R2 = R[2], R3 = R[3], R4 = R[4];
+			const uint32 S1 = R1 * 5, S2 = R2 * 5, S3 = R3 * 5, S4 = R4 * 5;
+			uint32 H0 = H[0], H1 = H[1], H2 = H[2], H3 = H[3], H4 = H[4];
+
+			while (InLen >= 16)
+			{
+				H0 += (LoadLE32(InData + 0)) & 0x3ffffff;
+				H1 += (LoadLE32(InData + 3) >> 2) & 0x3ffffff;
+				H2 += (LoadLE32(InData + 6) >> 4) & 0x3ffffff;
+				H3 += (LoadLE32(InData + 9) >> 6) & 0x3ffffff;
+				H4 += (LoadLE32(InData + 12) >> 8) | InHiBit;
+
+				uint64 D0 = (uint64)H0 * R0 + (uint64)H1 * S4 + (uint64)H2 * S3 + (uint64)H3 * S2 + (uint64)H4 * S1;
+				uint64 D1 = (uint64)H0 * R1 + (uint64)H1 * R0 + (uint64)H2 * S4 + (uint64)H3 * S3 + (uint64)H4 * S2;
+				uint64 D2 = (uint64)H0 * R2 + (uint64)H1 * R1 + (uint64)H2 * R0 + (uint64)H3 * S4 + (uint64)H4 * S3;
+				uint64 D3 = (uint64)H0 * R3 + (uint64)H1 * R2 + (uint64)H2 * R1 + (uint64)H3 * R0 + (uint64)H4 * S4;
+				uint64 D4 = (uint64)H0 * R4 + (uint64)H1 * R3 + (uint64)H2 * R2 + (uint64)H3 * R1 + (uint64)H4 * R0;
+
+				uint32 C = (uint32)(D0 >> 26); H0 = (uint32)D0 & 0x3ffffff;
+				D1 += C; C = (uint32)(D1 >> 26); H1 = (uint32)D1 & 0x3ffffff;
+				D2 += C; C = (uint32)(D2 >> 26); H2 = (uint32)D2 & 0x3ffffff;
+				D3 += C; C = (uint32)(D3 >> 26); H3 = (uint32)D3 & 0x3ffffff;
+				D4 += C; C = (uint32)(D4 >> 26); H4 = (uint32)D4 & 0x3ffffff;
+				H0 += C * 5; C = H0 >> 26; H0 &= 0x3ffffff;
+				H1 += C;
+
+				InData += 16;
+				InLen -= 16;
+			}
+
+			H[0] = H0; H[1] = H1; H[2] = H2; H[3] = H3; H[4] = H4;
+		}
+
+		void Update(const uint8* InData, int32 InLen)
+		{
+			if (Leftover)
+			{
+				int32 Want = FMath::Min(16 - Leftover, InLen);
+				FMemory::Memcpy(Buffer + Leftover, InData, Want);
+				InData += Want;
+				InLen -= Want;
+				Leftover += Want;
+
+				if (Leftover < 16)
+				{
+					return;
+				}
+
+				Blocks(Buffer, 16, 1 << 24);
+				Leftover = 0;
+			}
+
+			if (InLen >= 16)
+			{
+				int32 Want = InLen & ~15;
+				Blocks(InData, Want, 1 << 24);
+				InData += Want;
+				InLen -= Want;
+			}
+
+			if (InLen > 0)
+			{
+				FMemory::Memcpy(Buffer, InData, InLen);
+				Leftover = InLen;
+			}
+		}
+
+		//AEAD里每一段都补齐到16字节
+		void PadTo16(int32 InLen)
+		{
+			static const uint8 Zero[16] = { 0 };
+			if (InLen & 15)
+			{
+				Update(Zero, 16 - (InLen & 15));
+			}
+		}
+
+		void Finish(uint8* OutTag)
+		{
+			if (Leftover)
+			{
+				Buffer[Leftover] = 1;
+				FMemory::Memzero(Buffer + Leftover + 1, 16 - Leftover - 1);
+				Blocks(Buffer, 16, 0);
+			}
+
+			uint32 H0 = H[0], H1 = H[1], H2 = H[2], H3 = H[3], H4 = H[4];
+
+			uint32 C = H1 >> 26; H1 &= 0x3ffffff;
+			H2 += C; C = H2 >> 26; H2 &= 0x3ffffff;
+			H3 += C; C = H3 >> 26; H3 &= 0x3ffffff;
+			H4 += C; C = H4 >> 26; H4 &= 0x3ffffff;
+			H0 += C * 5; C = H0 >> 26; H0 &= 0x3ffffff;
+			H1 += C;
+
+			//H - P
+			uint32 G0 = H0 + 5; C = G0 >> 26; G0 &= 0x3ffffff;
+			uint32 G1 = H1 + C; C = G1 >> 26; G1 &= 0x3ffffff;
+			uint32 G2 = H2 + C; C = G2 >> 26; G2 &= 0x3ffffff;
+			uint32 G3 = H3 + C; C = G3 >> 26; G3 &= 0x3ffffff;
+			uint32 G4 = H4 + C - (1 << 26);
+
+			uint32 Mask = (G4 >> 31) - 1;
+			G0 &= Mask; G1 &= Mask; G2 &= Mask; G3 &= Mask; G4 &= Mask;
+			Mask = ~Mask;
+			H0 = (H0 & Mask) | G0;
+			H1 = (H1 & Mask) | G1;
+			H2 = (H2 & Mask) | G2;
+			H3 = (H3 & Mask) | G3;
+			H4 = (H4 & Mask) | G4;
+
+			H0 = (H0) | (H1 << 26);
+			H1 = (H1 >> 6) | (H2 << 20);
+			H2 = (H2 >> 12) | (H3 << 14);
+			H3 = (H3 >> 18) | (H4 << 8);
+
+			uint64 F = (uint64)H0 + Pad[0]; H0 = (uint32)F;
+			F = (uint64)H1 + Pad[1] + (F >> 32); H1 = (uint32)F;
+			F = (uint64)H2 + Pad[2] + (F >> 32); H2 = (uint32)F;
+			F = (uint64)H3 + Pad[3] + (F >> 32); H3 = (uint32)F;
+
+			StoreLE32(OutTag + 0, H0);
+			StoreLE32(OutTag + 4, H1);
+			StoreLE32(OutTag + 8, H2);
+			StoreLE32(OutTag + 12, H3);
+		}
+
+		uint32 R[5];
+		uint32 H[5];
+		uint32 Pad[4];
+		uint8 Buffer[16];
+		int32 Leftover;
+	};
+
+	static void ComputeTag(const uint8* InKey, const uint8* InNonce, const uint8* InAAD, int32 InAADLen, const uint8* InCipherText, int32 InLen, uint8* OutTag)
+	{
+		//0号块的前32字节作为一次性认证密钥
+		uint32 State[16];
+		InitState(InKey, InNonce, 0, State);
+
+		uint8 OneTimeKey[BlockSize];
+		Block(State, OneTimeKey);
+
+		FPoly1305 Mac(OneTimeKey);
+		Mac.Update(InAAD, InAADLen);
+		Mac.PadTo16(InAADLen);
+		Mac.Update(InCipherText, InLen);
+		Mac.PadTo16(InLen);
+
+		uint8 Lengths[16];
+		StoreLE64(Lengths, (uint64)InAADLen);
+		StoreLE64(Lengths + 8, (uint64)InLen);
+		Mac.Update(Lengths, sizeof(Lengths));
+
+		Mac.Finish(OutTag);
+
+		FMemory::Memzero(OneTimeKey, sizeof(OneTimeKey));
+	}
+
+	void Poly1305(const uint8* InKey, const uint8* InData, int32 InLen, uint8* OutTag)
+	{
+		FPoly1305 Mac(InKey);
+		Mac.Update(InData, InLen);
+		Mac.Finish(OutTag);
+	}
+
+	void Seal(const uint8* InKey, const uint8* InNonce, const uint8* InAAD, int32 InAADLen, uint8* InOutData, int32 InLen, uint8* OutTag)
+	{
+		Xor(InKey, InNonce, 1, InOutData, InLen);
+		ComputeTag(InKey, InNonce, InAAD, InAADLen, InOutData, InLen, OutTag);
+	}
+
+	bool Open(const uint8* InKey, const uint8* InNonce, const uint8* InAAD, int32 InAADLen, uint8* InOutData, int32 InLen, const uint8* InTag)
+	{
+		uint8 Tag[TagSize];
+		ComputeTag(InKey, InNonce, InAAD, InAADLen, InOutData, InLen, Tag);
+
+		//固定时间比较
+		uint8 Diff = 0;
+		for (int32 i = 0; i < TagSize; i++)
+		{
+			Diff |= Tag[i] ^ InTag[i];
+		}
+
+		if (Diff != 0)
+		{
+			return false;
+		}
+
+		Xor(InKey, InNonce, 1, InOutData, InLen);
+		return true;
+	}
+
+	void DeriveKey(const uint8* InSecret, int32 InLen, uint8* OutKey)
+	{
+		//两段SHA1拼成32字节 前缀区分用途
+		uint8 Hash[2][FSHA1::DigestSize];
+		for (uint8 i = 0; i < 2; i++)
+		{
+			const uint8 Label[] = { 'S', 'N', 'C', 'K', 'E', 'Y', i };
+
+			FSHA1 Sha1;
+			Sha1.Update(Label, sizeof(Label));
+			Sha1.Update(InSecret, InLen);
+			Sha1.Final();
+			Sha1.GetHash(Hash[i]);
+		}
+
+		FMemory::Memcpy(OutKey, Hash[0], FSHA1::DigestSize);
+		FMemory::Memcpy(OutKey + FSHA1::DigestSize, Hash[1], KeySize - FSHA1::DigestSize);
+	}
+}
@@ -0,0 +1,35 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//ChaCha20流加密和Poly1305认证(RFC 8439)
+//支持向量指令的平台一次生成4个块的密钥流 异或每次处理16字节 其他平台走标量
+namespace SimpleStreamCipher
+{
+	enum
+	{
+		KeySize		= 32,
+		NonceSize	= 12,
+		TagSize		= 16,
+	};
+
+	//从配置的密钥字符串派生32字节密钥
+	void DeriveKey(const uint8* InSecret, int32 InLen, uint8* OutKey);
+
+	//从InCounter号块开始生成密钥流并异或 加密解密相同
+	void Xor(const uint8* InKey, const uint8* InNonce, uint32 InCounter, uint8* InOutData, int32 InLen);
+
+	//原地加密 并对InAAD和密文生成认证码
+	void Seal(const uint8* InKey, const uint8* InNonce, const uint8* InAAD, int32 InAADLen, uint8* InOutData, int32 InLen, uint8* OutTag);
+
+	//先验证认证码 通过后原地解密
+	bool Open(const uint8* InKey, const uint8* InNonce, const uint8* InAAD, int32 InAADLen, uint8* InOutData, int32 InLen, const uint8* InTag);
+
+	//单独计算Poly1305认证码 InKey是32字节的一次性密钥 不能重复使用
+	void Poly1305(const uint8* InKey, const uint8* InData, int32 InLen, uint8* OutTag);
+
+	//所有字节和同一个值异或 旧加密方式使用
+	void XorByte(uint8* InOutData, int32 InLen, uint8 InValue);
+}
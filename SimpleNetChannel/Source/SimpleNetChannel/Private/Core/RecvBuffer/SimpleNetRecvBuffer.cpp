@@ -0,0 +1,90 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "SimpleNetRecvBuffer.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Connetion/Core/SimpleConnetion.h"
+
+FSimpleNetRecvBuffer::FSlot::FSlot()
+	:Data(nullptr)
+	,BytesRead(0)
+{
+}
+
+FSimpleNetRecvBuffer::FSimpleNetRecvBuffer()
+	:SlotSize(0)
+{
+}
+
+void FSimpleNetRecvBuffer::Init(int32 InSlotNum, int32 InSlotSize)
+{
+	Reset();
+
+	InSlotNum = FMath::Max(InSlotNum, 1);
+	SlotSize = FMath::Max(InSlotSize, 1);
+
+	//一次性分配 不需要清零 每次只会读取BytesRead
+	Memory.SetNumUninitialized(InSlotNum * SlotSize);
+	Slots.SetNum(InSlotNum);
+
+	ISocketSubsystem* SocketSubsystem = FSimpleConnetion::GetSocketSubsystem();
+	for (int32 i = 0; i < Slots.Num(); i++)
+	{
+		Slots[i].Data = &Memory[i * SlotSize];
+		if (SocketSubsystem)
+		{
+			Slots[i].Addr = SocketSubsystem->CreateInternetAddr();
+		}
+	}
+}
+
+void FSimpleNetRecvBuffer::Reset()
+{
+	Slots.Empty();
+	Memory.Empty();
+	SlotSize = 0;
+}
+
+bool FSimpleNetRecvBuffer::WaitForRead(FSocket* InSocket, const FTimespan& InWaitTime)
+{
+	if (InSocket)
+	{
+		return InSocket->Wait(ESocketWaitConditions::WaitForRead, InWaitTime);
+	}
+
+	return false;
+}
+
+int32 FSimpleNetRecvBuffer::Drain(FSocket* InSocket, bool bNonBlocking)
+{
+	int32 RecvNum = 0;
+	if (InSocket && IsInit())
+	{
+		for (int32 i = 0; i < Slots.Num(); i++)
+		{
+			if (!bNonBlocking && RecvNum > 0)
+			{
+				uint32 PendingDataSize = 0;
+				if (!InSocket->HasPendingData(PendingDataSize))
+				{
+					break;
+				}
+			}
+
+			FSlot& Slot = Slots[RecvNum];
+			Slot.BytesRead = 0;
+			if (!InSocket->RecvFrom(Slot.Data, SlotSize, Slot.BytesRead, *Slot.Addr))
+			{
+				break;
+			}
+
+			if (Slot.BytesRead > 0)
+			{
+				RecvNum++;
+			}
+		}
+	}
+
+	return RecvNum;
+}
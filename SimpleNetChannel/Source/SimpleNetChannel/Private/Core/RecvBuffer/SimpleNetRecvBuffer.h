@@ -0,0 +1,45 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSocket;
+class FInternetAddr;
+
+//批量接收缓冲 预先分配一组固定大小的槽位并重复使用
+//一次唤醒尽可能多的读取数据报 避免每次接收都在栈上清零一大块内存
+class FSimpleNetRecvBuffer
+{
+public:
+	struct FSlot
+	{
+		FSlot();
+
+		uint8* Data;
+		int32 BytesRead;
+		TSharedPtr<FInternetAddr> Addr;//槽位复用 需要保存的话请Clone
+	};
+
+public:
+	FSimpleNetRecvBuffer();
+
+	void Init(int32 InSlotNum, int32 InSlotSize);
+	void Reset();
+
+	//等待Socket可读 超时返回false
+	bool WaitForRead(FSocket* InSocket, const FTimespan& InWaitTime);
+
+	//尽可能多的读取数据报到槽位内 返回读取的数量
+	//阻塞Socket只有第一次读取会阻塞 之后通过HasPendingData判断
+	int32 Drain(FSocket* InSocket, bool bNonBlocking = true);
+
+	FORCEINLINE FSlot& operator[](int32 InIndex) { return Slots[InIndex]; }
+	FORCEINLINE bool IsInit() const { return Slots.Num() > 0; }
+	FORCEINLINE int32 GetSlotSize() const { return SlotSize; }
+
+protected:
+	TArray<uint8> Memory;
+	TArray<FSlot> Slots;
+	int32 SlotSize;
+};
@@ -0,0 +1,480 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "SimpleNetWireHeader.h"
+#include "SimpleNetChannelType.h"
+
+namespace SimpleNetWireHeader
+{
+	enum EWireFlag : uint32
+	{
+		WF_PackageHead		= 1 << 0,//带FSimplePackageHead
+		WF_Ack				= 1 << 1,
+		WF_ForceSend		= 1 << 2,
+		WF_Bunch			= 1 << 3,//包体开头的FSimpleBunchHead被压缩
+		WF_SequenceID		= 1 << 4,//PackageID只写序号
+		WF_ChannelIndex		= 1 << 5,//ChannelID只写索引
+		WF_Tag				= 1 << 6,
+		WF_PackageIndex		= 1 << 7,
+		WF_PackageSize		= 1 << 8,
+		WF_AckBits			= 1 << 9,
+		WF_Synchronize		= 1 << 10,//bAsynchronous == false
+		WF_SameProtocol		= 1 << 11,//通道头协议号和包头一致
+		WF_Compressed		= 1 << 12,//通道头带BUNCH_COMPRESSED
+	};
+
+	//'SNCH'
+	const uint32 SequenceMagic = 0x534E4348;
+
+	struct FWireReader
+	{
+		FWireReader(const uint8* InData, int32 InLen)
+			:Data(InData)
+			, Len(InLen)
+			, Pos(0)
+		{}
+
+		bool ReadByte(uint8& OutValue)
+		{
+			if (Pos >= Len)
+			{
+				return false;
+			}
+
+			OutValue = Data[Pos++];
+			return true;
+		}
+
+		bool ReadVarint(uint64& OutValue)
+		{
+			OutValue = 0;
+			for (int32 Shift = 0; Shift < 64; Shift += 7)
+			{
+				uint8 Byte = 0;
+				if (!ReadByte(Byte))
+				{
+					return false;
+				}
+
+				OutValue |= (uint64)(Byte & 0x7F) << Shift;
+				if (!(Byte & 0x80))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool ReadVarint32(uint32& OutValue)
+		{
+			uint64 Value = 0;
+			if (ReadVarint(Value) && Value <= MAX_uint32)
+			{
+				OutValue = (uint32)Value;
+				return true;
+			}
+
+			return false;
+		}
+
+		bool ReadBytes(void* OutValue, int32 InNum)
+		{
+			if (Len - Pos < InNum)
+			{
+				return false;
+			}
+
+			FMemory::Memcpy(OutValue, &Data[Pos], InNum);
+			Pos += InNum;
+			return true;
+		}
+
+		const uint8* Data;
+		int32 Len;
+		int32 Pos;
+	};
+
+	static void WriteVarint(TArray<uint8>& OutData, uint64 InValue)
+	{
+		while (InValue >= 0x80)
+		{
+			OutData.Add((uint8)(InValue | 0x80));
+			InValue >>= 7;
+		}
+
+		OutData.Add((uint8)InValue);
+	}
+
+	static int32 GetVarintSize(uint64 InValue)
+	{
+		int32 Size = 1;
+		while (InValue >= 0x80)
+		{
+			InValue >>= 7;
+			Size++;
+		}
+
+		return Size;
+	}
+
+	static bool IsSequenceGuid(const FGuid& InGuid)
+	{
+		return InGuid.A == SequenceMagic && InGuid.B == 0 && InGuid.C == 0;
+	}
+
+	static void WriteGuid(TArray<uint8>& OutData, const FGuid& InGuid)
+	{
+		OutData.Append((const uint8*)&InGuid, sizeof(FGuid));
+	}
+
+	static bool ReadChannel(FWireReader& InReader, uint32 InFlags, const FGuid& InMainChannelID, FGuid& OutChannelID)
+	{
+		if (InFlags & WF_ChannelIndex)
+		{
+			uint32 ChannelIndex = 0;
+			if (!InReader.ReadVarint32(ChannelIndex) || ChannelIndex != 0)
+			{
+				return false;
+			}
+
+			OutChannelID = InMainChannelID;
+			return true;
+		}
+
+		return InReader.ReadBytes(&OutChannelID, sizeof(FGuid));
+	}
+
+	int32 GetMaxExpandSize()
+	{
+		return sizeof(FSimplePackageHead) + sizeof(FSimpleBunchHead);
+	}
+
+	bool IsCompact(const uint8* InData, int32 InLen)
+	{
+		return InData && InLen >= 2 && InData[0] == CompactMarker;
+	}
+
+	FGuid MakeSequenceGuid(uint32 InSequence)
+	{
+		return FGuid(SequenceMagic, 0, 0, InSequence);
+	}
+
+	bool Encode(const uint8* InData, int32 InLen, bool bPackageHead, const FGuid& InMainChannelID, TArray<uint8>& OutData)
+	{
+		OutData.Reset();
+
+		if (!InData)
+		{
+			return false;
+		}
+
+		uint32 Flags = 0;
+		int32 Offset = 0;
+		const FSimplePackageHead* PackageHead = nullptr;
+		const FSimpleBunchHead* BunchHead = nullptr;
+
+		if (bPackageHead)
+		{
+			if (InLen < (int32)sizeof(FSimplePackageHead))
+			{
+				return false;
+			}
+
+			PackageHead = (const FSimplePackageHead*)InData;
+			Offset = sizeof(FSimplePackageHead);
+
+			Flags |= WF_PackageHead;
+			Flags |= PackageHead->bAck ? WF_Ack : 0;
+			Flags |= PackageHead->bForceSend ? WF_ForceSend : 0;
+			Flags |= PackageHead->PackageIndex != 0 ? WF_PackageIndex : 0;
+			Flags |= PackageHead->PackageSize != 0 ? WF_PackageSize : 0;
+			Flags |= PackageHead->AckBits != 0 ? WF_AckBits : 0;
+			Flags |= PackageHead->Tag != 0 ? WF_Tag : 0;
+			Flags |= IsSequenceGuid(PackageHead->PackageID) ? WF_SequenceID : 0;
+			Flags |= PackageHead->ChannelID == InMainChannelID ? WF_ChannelIndex : 0;
+
+			//包体以通道头开头(强制发送或者第一个分片) 并且通道和同步标志与包头一致
+			if (InLen - Offset >= (int32)sizeof(FSimpleBunchHead))
+			{
+				const FSimpleBunchHead* InBunchHead = (const FSimpleBunchHead*)(InData + Offset);
+				if (InBunchHead->ChannelID == PackageHead->ChannelID &&
+					InBunchHead->Tag == PackageHead->Tag &&
+					*(const uint8*)&InBunchHead->bAsynchronous <= 1 &&
+					!(InBunchHead->Flags & ~BUNCH_ALL))
+				{
+					BunchHead = InBunchHead;
+				}
+			}
+		}
+		else
+		{
+			if (InLen < (int32)sizeof(FSimpleBunchHead))
+			{
+				return false;
+			}
+
+			BunchHead = (const FSimpleBunchHead*)InData;
+			if (*(const uint8*)&BunchHead->bAsynchronous > 1 || (BunchHead->Flags & ~BUNCH_ALL))
+			{
+				return false;
+			}
+
+			Flags |= BunchHead->Tag != 0 ? WF_Tag : 0;
+			Flags |= BunchHead->ChannelID == InMainChannelID ? WF_ChannelIndex : 0;
+		}
+
+		if (BunchHead)
+		{
+			Offset += sizeof(FSimpleBunchHead);
+
+			Flags |= WF_Bunch;
+			Flags |= !BunchHead->bAsynchronous ? WF_Synchronize : 0;
+			Flags |= (PackageHead && PackageHead->Protocol == BunchHead->ProtocolsNumber) ? WF_SameProtocol : 0;
+			Flags |= (BunchHead->Flags & BUNCH_COMPRESSED) ? WF_Compressed : 0;
+		}
+
+		OutData.Reserve(InLen - Offset + 64);
+		OutData.Add(CompactMarker);
+		WriteVarint(OutData, Flags);
+
+		const uint64 Tag = PackageHead ? PackageHead->Tag : BunchHead->Tag;
+		const FGuid& ChannelID = PackageHead ? PackageHead->ChannelID : BunchHead->ChannelID;
+
+		if (PackageHead)
+		{
+			WriteVarint(OutData, PackageHead->Protocol);
+
+			if (Flags & WF_PackageIndex)
+			{
+				WriteVarint(OutData, PackageHead->PackageIndex);
+			}
+
+			if (Flags & WF_PackageSize)
+			{
+				WriteVarint(OutData, PackageHead->PackageSize);
+			}
+
+			if (Flags & WF_AckBits)
+			{
+				WriteVarint(OutData, PackageHead->AckBits);
+			}
+
+			if (Flags & WF_SequenceID)
+			{
+				WriteVarint(OutData, PackageHead->PackageID.D);
+			}
+			else
+			{
+				WriteGuid(OutData, PackageHead->PackageID);
+			}
+		}
+
+		if (Flags & WF_Tag)
+		{
+			WriteVarint(OutData, Tag);
+		}
+
+		if (Flags & WF_ChannelIndex)
+		{
+			WriteVarint(OutData, 0);
+		}
+		else
+		{
+			WriteGuid(OutData, ChannelID);
+		}
+
+		if (BunchHead)
+		{
+			if (!(Flags & WF_SameProtocol))
+			{
+				WriteVarint(OutData, BunchHead->ProtocolsNumber);
+			}
+
+			OutData.Add(BunchHead->ParamNum);
+		}
+
+		OutData.Append(InData + Offset, InLen - Offset);
+
+		return true;
+	}
+
+	int32 Decode(const uint8* InData, int32 InLen, const FGuid& InMainChannelID, uint8* OutData, int32 OutCapacity)
+	{
+		if (!IsCompact(InData, InLen) || !OutData)
+		{
+			return INDEX_NONE;
+		}
+
+		FWireReader Reader(InData, InLen);
+		Reader.Pos = 1;
+
+		uint32 Flags = 0;
+		if (!Reader.ReadVarint32(Flags) || !(Flags & (WF_PackageHead | WF_Bunch)))
+		{
+			return INDEX_NONE;
+		}
+
+		int32 OutPos = 0;
+		uint32 Protocol = 0;
+		uint64 Tag = 0;
+		FGuid ChannelID;
+
+		FSimplePackageHead* PackageHead = nullptr;
+		if (Flags & WF_PackageHead)
+		{
+			if (OutCapacity < (int32)sizeof(FSimplePackageHead))
+			{
+				return INDEX_NONE;
+			}
+
+			//不走构造 构造里会生成GUID
+			FMemory::Memzero(OutData, sizeof(FSimplePackageHead));
+			PackageHead = (FSimplePackageHead*)OutData;
+			OutPos += sizeof(FSimplePackageHead);
+
+			PackageHead->bAck = !!(Flags & WF_Ack);
+			PackageHead->bForceSend = !!(Flags & WF_ForceSend);
+
+			if (!Reader.ReadVarint32(Protocol))
+			{
+				return INDEX_NONE;
+			}
+			PackageHead->Protocol = Protocol;
+
+			if ((Flags & WF_PackageIndex) && !Reader.ReadVarint32(PackageHead->PackageIndex))
+			{
+				return INDEX_NONE;
+			}
+
+			if ((Flags & WF_PackageSize) && !Reader.ReadVarint32(PackageHead->PackageSize))
+			{
+				return INDEX_NONE;
+			}
+
+			if ((Flags & WF_AckBits) && !Reader.ReadVarint32(PackageHead->AckBits))
+			{
+				return INDEX_NONE;
+			}
+
+			if (Flags & WF_SequenceID)
+			{
+				uint32 Sequence = 0;
+				if (!Reader.ReadVarint32(Sequence))
+				{
+					return INDEX_NONE;
+				}
+
+				PackageHead->PackageID = MakeSequenceGuid(Sequence);
+			}
+			else if (!Reader.ReadBytes(&PackageHead->PackageID, sizeof(FGuid)))
+			{
+				return INDEX_NONE;
+			}
+		}
+
+		if ((Flags & WF_Tag) && !Reader.ReadVarint(Tag))
+		{
+			return INDEX_NONE;
+		}
+
+		if (!ReadChannel(Reader, Flags, InMainChannelID, ChannelID))
+		{
+			return INDEX_NONE;
+		}
+
+		if (PackageHead)
+		{
+			PackageHead->Tag = Tag;
+			PackageHead->ChannelID = ChannelID;
+		}
+
+		if (Flags & WF_Bunch)
+		{
+			if (OutCapacity - OutPos < (int32)sizeof(FSimpleBunchHead))
+			{
+				return INDEX_NONE;
+			}
+
+			FMemory::Memzero(OutData + OutPos, sizeof(FSimpleBunchHead));
+			FSimpleBunchHead* BunchHead = (FSimpleBunchHead*)(OutData + OutPos);
+			OutPos += sizeof(FSimpleBunchHead);
+
+			BunchHead->ChannelID = ChannelID;
+			BunchHead->Tag = Tag;
+			BunchHead->bAsynchronous = !(Flags & WF_Synchronize);
+			BunchHead->Flags = (Flags & WF_Compressed) ? BUNCH_COMPRESSED : BUNCH_NONE;
+
+			if (Flags & WF_SameProtocol)
+			{
+				BunchHead->ProtocolsNumber = Protocol;
+			}
+			else if (!Reader.ReadVarint32(BunchHead->ProtocolsNumber))
+			{
+				return INDEX_NONE;
+			}
+
+			if (!Reader.ReadByte(BunchHead->ParamNum))
+			{
+				return INDEX_NONE;
+			}
+		}
+
+		int32 BodySize = InLen - Reader.Pos;
+		if (OutCapacity - OutPos < BodySize)
+		{
+			return INDEX_NONE;
+		}
+
+		FMemory::Memcpy(OutData + OutPos, InData + Reader.Pos, BodySize);
+
+		return OutPos + BodySize;
+	}
+
+	bool IsCoalesced(const uint8* InData, int32 InLen)
+	{
+		return InData && InLen >= 2 && InData[0] == CoalesceMarker;
+	}
+
+	int32 GetCoalescedSize(int32 InCoalescedSize, int32 InLen)
+	{
+		return FMath::Max(InCoalescedSize, 1) + GetVarintSize(InLen) + InLen;
+	}
+
+	void AppendCoalesced(TArray<uint8>& OutData, const uint8* InData, int32 InLen)
+	{
+		if (OutData.Num() == 0)
+		{
+			OutData.Add(CoalesceMarker);
+		}
+
+		WriteVarint(OutData, InLen);
+		OutData.Append(InData, InLen);
+	}
+
+	bool SplitCoalesced(uint8* InData, int32 InLen, TFunctionRef<void(uint8*, int32)> InFunc)
+	{
+		if (!IsCoalesced(InData, InLen))
+		{
+			return false;
+		}
+
+		FWireReader Reader(InData, InLen);
+		Reader.Pos = 1;
+
+		while (Reader.Pos < Reader.Len)
+		{
+			uint32 PackageSize = 0;
+			if (!Reader.ReadVarint32(PackageSize) ||
+				(int32)PackageSize > Reader.Len - Reader.Pos ||
+				!IsCompact(InData + Reader.Pos, PackageSize))
+			{
+				return false;
+			}
+
+			InFunc(InData + Reader.Pos, PackageSize);
+			Reader.Pos += PackageSize;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,45 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//紧凑包头
+//FSimplePackageHead和FSimpleBunchHead每个数据报都带着两三个FGuid 小包的包头比包体还大
+//这里把GUID换成连接内的序号和通道索引 可选字段用标志位控制 整数使用变长编码
+//只在滑动窗口模式并且握手协商成功后使用 接收端解码后还原成原来的结构 上层逻辑不需要改变
+//是不是紧凑包头由协商的状态决定 不看第一个字节
+namespace SimpleNetWireHeader
+{
+	//第一个字节 只用来校验和区分合并包
+	enum { CompactMarker = 0xC3 };
+
+	//多个紧凑数据报合并成一个 [CoalesceMarker]{[变长长度][紧凑数据报]}...
+	enum { CoalesceMarker = 0xC5 };
+
+	//解码后最多比原数据多出多少字节
+	int32 GetMaxExpandSize();
+
+	bool IsCompact(const uint8* InData, int32 InLen);
+
+	//连接内序号生成的PackageID 编码时只写序号
+	FGuid MakeSequenceGuid(uint32 InSequence);
+
+	//bPackageHead 数据是否以FSimplePackageHead开头(滑动窗口模式)
+	//InMainChannelID 主通道 编码为索引0 对方解码成它自己的主通道
+	bool Encode(const uint8* InData, int32 InLen, bool bPackageHead, const FGuid& InMainChannelID, TArray<uint8>& OutData);
+
+	//OutData至少需要InLen + GetMaxExpandSize() 返回还原后的长度 失败返回INDEX_NONE
+	int32 Decode(const uint8* InData, int32 InLen, const FGuid& InMainChannelID, uint8* OutData, int32 OutCapacity);
+
+	bool IsCoalesced(const uint8* InData, int32 InLen);
+
+	//InCoalescedSize大小的合并包再追加一个InLen的紧凑数据报后的大小 为0时包括标记
+	int32 GetCoalescedSize(int32 InCoalescedSize, int32 InLen);
+
+	//追加一个紧凑数据报 OutData为空时先写标记
+	void AppendCoalesced(TArray<uint8>& OutData, const uint8* InData, int32 InLen);
+
+	//按顺序拆开 每个紧凑数据报调用一次InFunc 格式不对的部分直接丢弃并返回false
+	bool SplitCoalesced(uint8* InData, int32 InLen, TFunctionRef<void(uint8*, int32)> InFunc);
+}
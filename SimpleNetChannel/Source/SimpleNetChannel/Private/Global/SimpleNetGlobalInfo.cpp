@@ -4,6 +4,7 @@
 #include "Misc/FileHelper.h"
 #include "Log/SimpleNetChannelLog.h"
 #include "Stream/SimpleIOStream.h"
+#include "Core/EncryptionAndDecryption/SimpleStreamCipher.h"
 
 #if PLATFORM_MAC
 #include "Mac/MacPlatformProcess.h"
@@ -14,6 +15,7 @@
 enum EParamType
 {
 	Param_Int,
+	Param_Bool,
 	Param_Float,
 	Param_Int2,
 	Param_String,
@@ -30,6 +32,12 @@ void AutoInsertString(TMap<FString,FString> &InConfigInfo,void* InData,const TCH
 			*(int32*)InData = FCString::Atoi(**InValue);
 			break;
 		}
+		case EParamType::Param_Bool:
+		{
+			//bool只有一个字节 不能按int32写 否则会覆盖后面的字段
+			*(bool*)InData = FCString::Atoi(**InValue) != 0;
+			break;
+		}
 		case EParamType::Param_Float:
 		{
 			*(float*)InData = FCString::Atof(**InValue);
@@ -83,9 +91,18 @@ void FSimpleNetGlobalInfo::Destroy()
 	}
 }
 
+void FSimpleNetGlobalInfo::SetInfo(const FSimpleConfigInfo& InInfo)
+{
+	ConfigInfo = InInfo;
+
+	InitSecretKey();
+}
+
 void FSimpleNetGlobalInfo::SetSecretKey(const FString &InSecretKey)
 {
 	ConfigInfo.SecretKey = InSecretKey;
+
+	InitSecretKey();
 }
 
 void FSimpleNetGlobalInfo::Init(const FString& InPath)
@@ -139,14 +156,45 @@ void FSimpleNetGlobalInfo::Init(const FString& InPath)
 		AutoInsertString(InConfigInfo,&ConfigInfo.Port, INSERT_TEXT("Port"), EParamType::Param_Int);
 		AutoInsertString(InConfigInfo,&ConfigInfo.RecvDataNumber, INSERT_TEXT("RecvDataNumber"), EParamType::Param_Int);
 		AutoInsertString(InConfigInfo,&ConfigInfo.SendDataNumber, INSERT_TEXT("SendDataNumber"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.RecvBatchNumber, INSERT_TEXT("RecvBatchNumber"), EParamType::Param_Int);
 		AutoInsertString(InConfigInfo,&ConfigInfo.MaxConnections, INSERT_TEXT("MaxConnections"), EParamType::Param_Int);
 		AutoInsertString(InConfigInfo,&ConfigInfo.MaxChannels, INSERT_TEXT("MaxChannels"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.MsgQueueSize, INSERT_TEXT("MsgQueueSize"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.MsgQueueMaxSize, INSERT_TEXT("MsgQueueMaxSize"), EParamType::Param_Int);
 		AutoInsertString(InConfigInfo,&ConfigInfo.NumberThreads, INSERT_TEXT("NumberThreads"), EParamType::Param_Int);
-		AutoInsertString(InConfigInfo,&ConfigInfo.bPrintHeartBeat, INSERT_TEXT("bPrintHeartBeat"), EParamType::Param_Int);
-		AutoInsertString(InConfigInfo,&ConfigInfo.bSlidingWindow, INSERT_TEXT("bSlidingWindow"), EParamType::Param_Int);
-		AutoInsertString(InConfigInfo,&ConfigInfo.bRepackaging, INSERT_TEXT("bRepackaging"), EParamType::Param_Int);
-		AutoInsertString(InConfigInfo,&ConfigInfo.OutTimeLink, INSERT_TEXT("RepackagingTime"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.TaskQueueSize, INSERT_TEXT("TaskQueueSize"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.TaskBatchNumber, INSERT_TEXT("TaskBatchNumber"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ShardNumber, INSERT_TEXT("ShardNumber"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ShardPort, INSERT_TEXT("ShardPort"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.CompressionThreshold, INSERT_TEXT("CompressionThreshold"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.CoalesceMTU, INSERT_TEXT("CoalesceMTU"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.MaxPackageSize, INSERT_TEXT("MaxPackageSize"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.CacheArenaSize, INSERT_TEXT("CacheArenaSize"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentBandwidth, INSERT_TEXT("ImpairmentBandwidth"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentSeed, INSERT_TEXT("ImpairmentSeed"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bPrintHeartBeat, INSERT_TEXT("bPrintHeartBeat"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bSlidingWindow, INSERT_TEXT("bSlidingWindow"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.SlidingWindowSize, INSERT_TEXT("SlidingWindowSize"), EParamType::Param_Int);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bRepackaging, INSERT_TEXT("bRepackaging"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bCompactHeader, INSERT_TEXT("bCompactHeader"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bStreamCipher, INSERT_TEXT("bStreamCipher"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bCipherAuthentication, INSERT_TEXT("bCipherAuthentication"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bCompression, INSERT_TEXT("bCompression"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bCoalesce, INSERT_TEXT("bCoalesce"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bCongestionControl, INSERT_TEXT("bCongestionControl"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.bImpairment, INSERT_TEXT("bImpairment"), EParamType::Param_Bool);
+		AutoInsertString(InConfigInfo,&ConfigInfo.RepackagingTime, INSERT_TEXT("RepackagingTime"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.MinRepackagingTime, INSERT_TEXT("MinRepackagingTime"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.MaxRepackagingTime, INSERT_TEXT("MaxRepackagingTime"), EParamType::Param_Float);
 		AutoInsertString(InConfigInfo,&ConfigInfo.PingMaxOutTime, INSERT_TEXT("PingMaxOutTime"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.CoalesceLatency, INSERT_TEXT("CoalesceLatency"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.InterestCellSize, INSERT_TEXT("InterestCellSize"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.StatsDumpInterval, INSERT_TEXT("StatsDumpInterval"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentLoss, INSERT_TEXT("ImpairmentLoss"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentDuplicate, INSERT_TEXT("ImpairmentDuplicate"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentReorder, INSERT_TEXT("ImpairmentReorder"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentDelay, INSERT_TEXT("ImpairmentDelay"), EParamType::Param_Float);
+		AutoInsertString(InConfigInfo,&ConfigInfo.ImpairmentJitter, INSERT_TEXT("ImpairmentJitter"), EParamType::Param_Float);
 		AutoInsertString(InConfigInfo,&ConfigInfo.OutTimeLink, INSERT_TEXT("OutTimeLink"), EParamType::Param_Float);
 		AutoInsertString(InConfigInfo,&ConfigInfo.OutTimeSynchronizationTime, INSERT_TEXT("OutTimeSynchronizationTime"), EParamType::Param_Float);
 		AutoInsertString(InConfigInfo,&ConfigInfo.HeartBeatTimeTnterval, INSERT_TEXT("HeartBeatTimeTnterval"), EParamType::Param_Float);
@@ -160,15 +208,46 @@ void FSimpleNetGlobalInfo::Init(const FString& InPath)
 		Content.Add(FString::Printf(TEXT("Port=%i"),ConfigInfo.Port));
 		Content.Add(FString::Printf(TEXT("RecvDataNumber=%i"), ConfigInfo.RecvDataNumber));
 		Content.Add(FString::Printf(TEXT("SendDataNumber=%i"), ConfigInfo.SendDataNumber));
+		Content.Add(FString::Printf(TEXT("RecvBatchNumber=%i"), ConfigInfo.RecvBatchNumber));
 		Content.Add(FString::Printf(TEXT("MaxConnections=%i"), ConfigInfo.MaxConnections));
 		Content.Add(FString::Printf(TEXT("MaxChannels=%i"), ConfigInfo.MaxChannels));
+		Content.Add(FString::Printf(TEXT("MsgQueueSize=%i"), ConfigInfo.MsgQueueSize));
+		Content.Add(FString::Printf(TEXT("MsgQueueMaxSize=%i"), ConfigInfo.MsgQueueMaxSize));
 		Content.Add(FString::Printf(TEXT("NumberThreads=%i"), ConfigInfo.NumberThreads));
+		Content.Add(FString::Printf(TEXT("TaskQueueSize=%i"), ConfigInfo.TaskQueueSize));
+		Content.Add(FString::Printf(TEXT("TaskBatchNumber=%i"), ConfigInfo.TaskBatchNumber));
+		Content.Add(FString::Printf(TEXT("ShardNumber=%i"), ConfigInfo.ShardNumber));
+		Content.Add(FString::Printf(TEXT("ShardPort=%i"), ConfigInfo.ShardPort));
+		Content.Add(FString::Printf(TEXT("CompressionThreshold=%i"), ConfigInfo.CompressionThreshold));
+		Content.Add(FString::Printf(TEXT("CoalesceMTU=%i"), ConfigInfo.CoalesceMTU));
+		Content.Add(FString::Printf(TEXT("MaxPackageSize=%i"), ConfigInfo.MaxPackageSize));
+		Content.Add(FString::Printf(TEXT("CacheArenaSize=%i"), ConfigInfo.CacheArenaSize));
+		Content.Add(FString::Printf(TEXT("ImpairmentBandwidth=%i"), ConfigInfo.ImpairmentBandwidth));
+		Content.Add(FString::Printf(TEXT("ImpairmentSeed=%i"), ConfigInfo.ImpairmentSeed));
 		Content.Add(FString::Printf(TEXT("bPrintHeartBeat=%i"), ConfigInfo.bPrintHeartBeat));
 		Content.Add(FString::Printf(TEXT("bSlidingWindow=%i"), ConfigInfo.bSlidingWindow));
+		Content.Add(FString::Printf(TEXT("SlidingWindowSize=%i"), ConfigInfo.SlidingWindowSize));
 		Content.Add(FString::Printf(TEXT("bRepackaging=%i"), ConfigInfo.bRepackaging));
+		Content.Add(FString::Printf(TEXT("bCompactHeader=%i"), ConfigInfo.bCompactHeader));
+		Content.Add(FString::Printf(TEXT("bStreamCipher=%i"), ConfigInfo.bStreamCipher));
+		Content.Add(FString::Printf(TEXT("bCipherAuthentication=%i"), ConfigInfo.bCipherAuthentication));
+		Content.Add(FString::Printf(TEXT("bCompression=%i"), ConfigInfo.bCompression));
+		Content.Add(FString::Printf(TEXT("bCoalesce=%i"), ConfigInfo.bCoalesce));
+		Content.Add(FString::Printf(TEXT("bCongestionControl=%i"), ConfigInfo.bCongestionControl));
+		Content.Add(FString::Printf(TEXT("bImpairment=%i"), ConfigInfo.bImpairment));
 		Content.Add(FString::Printf(TEXT("OutTimeLink=%f"), ConfigInfo.OutTimeLink));
 		Content.Add(FString::Printf(TEXT("PingMaxOutTime=%f"), ConfigInfo.PingMaxOutTime));
+		Content.Add(FString::Printf(TEXT("CoalesceLatency=%f"), ConfigInfo.CoalesceLatency));
+		Content.Add(FString::Printf(TEXT("InterestCellSize=%f"), ConfigInfo.InterestCellSize));
+		Content.Add(FString::Printf(TEXT("StatsDumpInterval=%f"), ConfigInfo.StatsDumpInterval));
+		Content.Add(FString::Printf(TEXT("ImpairmentLoss=%f"), ConfigInfo.ImpairmentLoss));
+		Content.Add(FString::Printf(TEXT("ImpairmentDuplicate=%f"), ConfigInfo.ImpairmentDuplicate));
+		Content.Add(FString::Printf(TEXT("ImpairmentReorder=%f"), ConfigInfo.ImpairmentReorder));
+		Content.Add(FString::Printf(TEXT("ImpairmentDelay=%f"), ConfigInfo.ImpairmentDelay));
+		Content.Add(FString::Printf(TEXT("ImpairmentJitter=%f"), ConfigInfo.ImpairmentJitter));
 		Content.Add(FString::Printf(TEXT("RepackagingTime=%f"), ConfigInfo.RepackagingTime));
+		Content.Add(FString::Printf(TEXT("MinRepackagingTime=%f"), ConfigInfo.MinRepackagingTime));
+		Content.Add(FString::Printf(TEXT("MaxRepackagingTime=%f"), ConfigInfo.MaxRepackagingTime));
 		Content.Add(FString::Printf(TEXT("HeartBeatTimeTnterval=%f"), ConfigInfo.HeartBeatTimeTnterval));
 		Content.Add(FString::Printf(TEXT("PublicIP=%s"),*ConfigInfo.PublicIP));
 		Content.Add(FString::Printf(TEXT("SecretKey=%s"), *ConfigInfo.SecretKey));
@@ -183,10 +262,21 @@ void FSimpleNetGlobalInfo::Init(const FString& InPath)
 void FSimpleNetGlobalInfo::InitSecretKey()
 {
 	//Key registration
+	SecretKey.Reset();
+	FoldedSecretKey = 0;
+	FMemory::Memzero(StreamKey, sizeof(StreamKey));
+
 	if (!ConfigInfo.SecretKey.IsEmpty())
 	{
 		FSimpleIOStream SecretIOStream(SecretKey);
 		SecretIOStream << ConfigInfo.SecretKey;
+
+		for (auto& Tmp : SecretKey)
+		{
+			FoldedSecretKey ^= Tmp;
+		}
+
+		SimpleStreamCipher::DeriveKey(SecretKey.GetData(), SecretKey.Num(), StreamKey);
 	}
 }
 
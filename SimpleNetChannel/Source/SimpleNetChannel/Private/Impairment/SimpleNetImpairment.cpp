@@ -0,0 +1,190 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Impairment/SimpleNetImpairment.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "IPAddress.h"
+#include "Misc/ScopeLock.h"
+
+namespace SimpleNetImpairment
+{
+	//路由器缓冲 排队超过这么久的直接丢弃
+	const double MaxQueueTime = 1.0;
+
+	struct FPacketPredicate
+	{
+		bool operator()(const FSimpleNetImpairment::FPacket& A, const FSimpleNetImpairment::FPacket& B) const
+		{
+			return A.Time < B.Time || (A.Time == B.Time && A.Sequence < B.Sequence);
+		}
+	};
+}
+
+FSimpleNetImpairmentConfig::FSimpleNetImpairmentConfig()
+	:Loss(0.f)
+	, Delay(0.f)
+	, Jitter(0.f)
+	, Duplicate(0.f)
+	, Reorder(0.f)
+	, Bandwidth(0)
+	, Seed(0)
+{
+}
+
+FSimpleNetImpairmentConfig FSimpleNetImpairmentConfig::FromConfigInfo()
+{
+	FSimpleNetImpairmentConfig ImpairmentConfig;
+
+	const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+	if (ConfigInfo.bImpairment)
+	{
+		ImpairmentConfig.Loss = ConfigInfo.ImpairmentLoss;
+		ImpairmentConfig.Delay = ConfigInfo.ImpairmentDelay;
+		ImpairmentConfig.Jitter = ConfigInfo.ImpairmentJitter;
+		ImpairmentConfig.Duplicate = ConfigInfo.ImpairmentDuplicate;
+		ImpairmentConfig.Reorder = ConfigInfo.ImpairmentReorder;
+		ImpairmentConfig.Bandwidth = ConfigInfo.ImpairmentBandwidth;
+		ImpairmentConfig.Seed = ConfigInfo.ImpairmentSeed;
+	}
+
+	return ImpairmentConfig;
+}
+
+bool FSimpleNetImpairmentConfig::IsEnabled() const
+{
+	return Loss > 0.f || Delay > 0.f || Jitter > 0.f || Duplicate > 0.f || Reorder > 0.f || Bandwidth > 0;
+}
+
+FSimpleNetImpairment::FSimpleNetImpairment()
+	:bEnabled(false)
+	, Seed(0)
+	, Sequence(0)
+	, LinkFreeTime(0.0)
+{
+}
+
+void FSimpleNetImpairment::Init(const FSimpleNetImpairmentConfig& InConfig, int32 InSeed)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	Config = InConfig;
+	Config.Loss = FMath::Clamp(Config.Loss, 0.f, 1.f);
+	Config.Duplicate = FMath::Clamp(Config.Duplicate, 0.f, 1.f);
+	Config.Reorder = FMath::Clamp(Config.Reorder, 0.f, 1.f);
+	Config.Delay = FMath::Max(Config.Delay, 0.f);
+	Config.Jitter = FMath::Max(Config.Jitter, 0.f);
+	Config.Bandwidth = FMath::Max(Config.Bandwidth, 0);
+
+	Seed = (int32)HashCombine((uint32)Config.Seed, (uint32)InSeed);
+	Random.Initialize(Seed);
+
+	Packets.Reset();
+	Sequence = 0;
+	LinkFreeTime = 0.0;
+	Stats = FSimpleNetImpairmentStats();
+
+	bEnabled = Config.IsEnabled();
+}
+
+void FSimpleNetImpairment::Push(double InTime, const uint8* InData, int32 InLen, const TSharedPtr<FInternetAddr>& InAddr)
+{
+	FPacket Packet;
+	Packet.Time = InTime;
+	Packet.Sequence = Sequence++;
+	Packet.Data.Append(InData, InLen);
+	Packet.Addr = InAddr;
+
+	Packets.HeapPush(MoveTemp(Packet), SimpleNetImpairment::FPacketPredicate());
+	Stats.Queued++;
+}
+
+void FSimpleNetImpairment::Add(const uint8* InData, int32 InLen, const TSharedPtr<FInternetAddr>& InAddr, double InTime)
+{
+	if (!InData || InLen <= 0)
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Mutex);
+
+	//每个数据报取的随机数个数固定 结果只和种子以及数据报的顺序有关
+	float LossRoll = Random.GetFraction();
+	float DuplicateRoll = Random.GetFraction();
+	float ReorderRoll = Random.GetFraction();
+	float JitterRoll = Random.GetFraction();
+	float DuplicateJitterRoll = Random.GetFraction();
+
+	if (LossRoll < Config.Loss)
+	{
+		Stats.Dropped++;
+		return;
+	}
+
+	//带宽 按字节数占用链路 链路前面排队太久就丢弃
+	double SendTime = InTime;
+	if (Config.Bandwidth > 0)
+	{
+		double StartTime = FMath::Max(InTime, LinkFreeTime);
+		if (StartTime - InTime > SimpleNetImpairment::MaxQueueTime)
+		{
+			Stats.Overflowed++;
+			return;
+		}
+
+		LinkFreeTime = StartTime + (double)InLen / Config.Bandwidth;
+		SendTime = LinkFreeTime;
+	}
+
+	if (ReorderRoll < Config.Reorder && (Config.Delay > 0.f || Config.Jitter > 0.f))
+	{
+		Stats.Reordered++;
+		Push(SendTime, InData, InLen, InAddr);
+	}
+	else
+	{
+		Push(SendTime + Config.Delay + JitterRoll * Config.Jitter, InData, InLen, InAddr);
+	}
+
+	if (DuplicateRoll < Config.Duplicate)
+	{
+		Stats.Duplicated++;
+		Push(SendTime + Config.Delay + DuplicateJitterRoll * Config.Jitter, InData, InLen, InAddr);
+	}
+}
+
+void FSimpleNetImpairment::Release(double InTime, TFunctionRef<void(FPacket&)> InFunc)
+{
+	TArray<FPacket, TInlineAllocator<16>> DuePackets;
+	{
+		FScopeLock ScopeLock(&Mutex);
+
+		while (Packets.Num() > 0 && Packets.HeapTop().Time <= InTime)
+		{
+			FPacket& Packet = DuePackets.AddDefaulted_GetRef();
+			Packets.HeapPop(Packet, SimpleNetImpairment::FPacketPredicate(), false);
+		}
+	}
+
+	for (FPacket& Tmp : DuePackets)
+	{
+		InFunc(Tmp);
+	}
+}
+
+void FSimpleNetImpairment::Reset()
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	Packets.Reset();
+	Sequence = 0;
+	LinkFreeTime = 0.0;
+
+	//复用的链接重新开始同样的序列
+	Random.Initialize(Seed);
+}
+
+FSimpleNetImpairmentStats FSimpleNetImpairment::GetStats() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	return Stats;
+}
@@ -0,0 +1,191 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Interest/SimpleNetInterestGrid.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "Misc/ScopeRWLock.h"
+
+FSimpleNetInterestGrid::FSimpleNetInterestGrid()
+	:CellSize(2000.f)
+{
+	SetCellSize(FSimpleNetGlobalInfo::Get()->GetInfo().InterestCellSize);
+}
+
+void FSimpleNetInterestGrid::SetCellSize(float InCellSize)
+{
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	if (Entries.Num() == 0 && InCellSize > 0.f)
+	{
+		CellSize = InCellSize;
+	}
+}
+
+FIntPoint FSimpleNetInterestGrid::GetCell(const FVector& InPosition) const
+{
+	return FIntPoint(
+		FMath::FloorToInt(InPosition.X / CellSize),
+		FMath::FloorToInt(InPosition.Y / CellSize));
+}
+
+void FSimpleNetInterestGrid::Update(FSimpleChannel* InChannel, const FVector& InPosition)
+{
+	if (!InChannel)
+	{
+		return;
+	}
+
+	FIntPoint NewCell = GetCell(InPosition);
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	if (int32* Index = EntryIndex.Find(InChannel))
+	{
+		FEntry& Entry = Entries[*Index];
+		Entry.Position = InPosition;
+
+		//同一个格子里移动不用动索引
+		if (Entry.Cell == NewCell)
+		{
+			return;
+		}
+
+		int32 EntryID = *Index;
+		TArray<int32>& OldCell = Cells.FindChecked(Entry.Cell);
+		int32 LastEntryID = OldCell.Last();
+		OldCell.RemoveAtSwap(Entry.CellIndex, 1, false);
+		if (LastEntryID != EntryID)
+		{
+			Entries[LastEntryID].CellIndex = Entry.CellIndex;
+		}
+
+		if (OldCell.Num() == 0)
+		{
+			Cells.Remove(Entry.Cell);
+		}
+
+		TArray<int32>& Cell = Cells.FindOrAdd(NewCell);
+		Entry.Cell = NewCell;
+		Entry.CellIndex = Cell.Add(EntryID);
+	}
+	else
+	{
+		TArray<int32>& Cell = Cells.FindOrAdd(NewCell);
+
+		int32 EntryID = Entries.Add({ InChannel, InPosition, NewCell, INDEX_NONE });
+		Entries[EntryID].CellIndex = Cell.Add(EntryID);
+
+		EntryIndex.Add(InChannel, EntryID);
+	}
+}
+
+void FSimpleNetInterestGrid::Remove(FSimpleChannel* InChannel)
+{
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	int32 EntryID = INDEX_NONE;
+	if (!EntryIndex.RemoveAndCopyValue(InChannel, EntryID))
+	{
+		return;
+	}
+
+	FEntry& Entry = Entries[EntryID];
+
+	TArray<int32>& Cell = Cells.FindChecked(Entry.Cell);
+	int32 LastEntryID = Cell.Last();
+	Cell.RemoveAtSwap(Entry.CellIndex, 1, false);
+	if (LastEntryID != EntryID)
+	{
+		Entries[LastEntryID].CellIndex = Entry.CellIndex;
+	}
+
+	if (Cell.Num() == 0)
+	{
+		Cells.Remove(Entry.Cell);
+	}
+
+	Entries.RemoveAt(EntryID);
+}
+
+void FSimpleNetInterestGrid::Query(const FVector& InCenter, float InRadius, TArray<FSimpleChannel*>& OutChannels) const
+{
+	if (InRadius < 0.f)
+	{
+		return;
+	}
+
+	FIntPoint MinCell = GetCell(InCenter - FVector(InRadius, InRadius, 0.f));
+	FIntPoint MaxCell = GetCell(InCenter + FVector(InRadius, InRadius, 0.f));
+	float RadiusSquared = InRadius * InRadius;
+
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+
+	//半径远大于格子时 覆盖的格子可能比实际有人的格子还多
+	int64 CoverNum = (int64)(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+	if (CoverNum > Cells.Num())
+	{
+		for (auto& Tmp : Cells)
+		{
+			if (Tmp.Key.X >= MinCell.X && Tmp.Key.X <= MaxCell.X &&
+				Tmp.Key.Y >= MinCell.Y && Tmp.Key.Y <= MaxCell.Y)
+			{
+				for (int32 EntryID : Tmp.Value)
+				{
+					const FEntry& Entry = Entries[EntryID];
+					if (FVector::DistSquaredXY(Entry.Position, InCenter) <= RadiusSquared)
+					{
+						OutChannels.Add(Entry.Channel);
+					}
+				}
+			}
+		}
+
+		return;
+	}
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			if (const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y)))
+			{
+				for (int32 EntryID : *Cell)
+				{
+					const FEntry& Entry = Entries[EntryID];
+					if (FVector::DistSquaredXY(Entry.Position, InCenter) <= RadiusSquared)
+					{
+						OutChannels.Add(Entry.Channel);
+					}
+				}
+			}
+		}
+	}
+}
+
+bool FSimpleNetInterestGrid::Find(FSimpleChannel* InChannel, FVector& OutPosition) const
+{
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+
+	if (const int32* Index = EntryIndex.Find(InChannel))
+	{
+		OutPosition = Entries[*Index].Position;
+		return true;
+	}
+
+	return false;
+}
+
+int32 FSimpleNetInterestGrid::Num() const
+{
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+
+	return Entries.Num();
+}
+
+void FSimpleNetInterestGrid::Reset()
+{
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	Entries.Empty();
+	EntryIndex.Empty();
+	Cells.Empty();
+}
@@ -0,0 +1,604 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Load/SimpleNetLoadGenerator.h"
+#include "SimpleNetManage.h"
+#include "Protocols/SimpleNetProtocols.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "Log/SimpleNetChannelLog.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
+
+namespace SimpleNetLoadGenerator
+{
+	const uint32 CaptureMagic = 0x534E4350;//SNCP
+	const int32 CaptureVersion = 1;
+
+	//回放前等待客户端加入的最长时间
+	const double JoinTimeout = 10.0;
+}
+
+FSimpleNetTrafficCapture::FSimpleNetTrafficCapture()
+	:StartTime(0.0)
+{
+}
+
+void FSimpleNetTrafficCapture::Start()
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	Records.Reset();
+	StartTime = FPlatformTime::Seconds();
+}
+
+void FSimpleNetTrafficCapture::Add(int32 InClient, const TArray<uint8>& InData)
+{
+	double Time = FPlatformTime::Seconds();
+
+	FScopeLock ScopeLock(&Mutex);
+
+	FSimpleNetCaptureRecord& Record = Records.AddDefaulted_GetRef();
+	Record.Time = Time - StartTime;
+	Record.Client = InClient;
+	Record.Data = InData;
+}
+
+bool FSimpleNetTrafficCapture::Save(const FString& InFilename) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	{
+		FScopeLock ScopeLock(&Mutex);
+
+		uint32 Magic = SimpleNetLoadGenerator::CaptureMagic;
+		int32 Version = SimpleNetLoadGenerator::CaptureVersion;
+		int32 Num = Records.Num();
+		Writer << Magic << Version << Num;
+
+		for (const FSimpleNetCaptureRecord& Tmp : Records)
+		{
+			double Time = Tmp.Time;
+			int32 Client = Tmp.Client;
+			int32 Size = Tmp.Data.Num();
+			Writer << Time << Client << Size;
+			Writer.Serialize((void*)Tmp.Data.GetData(), Size);
+		}
+	}
+
+	return FFileHelper::SaveArrayToFile(Bytes, *InFilename);
+}
+
+bool FSimpleNetTrafficCapture::Load(const FString& InFilename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *InFilename))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 Num = 0;
+	Reader << Magic << Version << Num;
+	if (Magic != SimpleNetLoadGenerator::CaptureMagic || Version != SimpleNetLoadGenerator::CaptureVersion || Num < 0)
+	{
+		UE_LOG(LogSimpleNetChannel, Error, TEXT("[Capture] %s is not a capture file."), *InFilename);
+		return false;
+	}
+
+	TArray<FSimpleNetCaptureRecord> NewRecords;
+	for (int32 i = 0; i < Num && !Reader.IsError(); i++)
+	{
+		FSimpleNetCaptureRecord& Record = NewRecords.AddDefaulted_GetRef();
+
+		int32 Size = 0;
+		Reader << Record.Time << Record.Client << Size;
+		if (Size < (int32)sizeof(FSimpleBunchHead) || Size > Reader.TotalSize() - Reader.Tell())
+		{
+			Reader.SetError();
+			break;
+		}
+
+		Record.Data.SetNumUninitialized(Size);
+		Reader.Serialize(Record.Data.GetData(), Size);
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogSimpleNetChannel, Error, TEXT("[Capture] %s is truncated."), *InFilename);
+		return false;
+	}
+
+	//多个发送线程录制 写入顺序和时间不一定一致
+	NewRecords.StableSort([](const FSimpleNetCaptureRecord& A, const FSimpleNetCaptureRecord& B)
+	{
+		return A.Time < B.Time;
+	});
+
+	FScopeLock ScopeLock(&Mutex);
+	Records = MoveTemp(NewRecords);
+
+	return true;
+}
+
+void FSimpleNetTrafficCapture::Reset()
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	Records.Empty();
+	StartTime = 0.0;
+}
+
+FSimpleNetLoadConfig::FSimpleNetLoadConfig()
+	:GroupID(0x4C4F4144)
+	, Port(0)
+	, ClientNum(1)
+	, SocketType(ESimpleSocketType::SIMPLESOCKETTYPE_UDP)
+	, ObjectClass(nullptr)
+	, bAllowSynchronization(false)
+	, bHighConcurrency(false)
+	, Duration(0.f)
+	, SendRate(10.f)
+	, PingRate(1.f)
+	, Seed(0)
+{
+}
+
+FSimpleNetLoadReport::FSimpleNetLoadReport()
+	:Duration(0.0)
+	, ClientNum(0)
+	, JoinNum(0)
+	, SendNum(0)
+	, SkipNum(0)
+	, BytesIn(0)
+	, PacketsIn(0)
+	, BytesOut(0)
+	, PacketsOut(0)
+	, LatencyNum(0)
+	, LostNum(0)
+	, LatencyP50(0.f)
+	, LatencyP90(0.f)
+	, LatencyP99(0.f)
+	, LatencyMax(0.f)
+	, CPUAverage(0.f)
+	, CPUPeak(0.f)
+{
+}
+
+void FSimpleNetLoadReport::Dump() const
+{
+	double Seconds = FMath::Max(Duration, 0.001);
+
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("[Load] Duration=%.1fs Clients=%i/%i Send=%llu (%.0f/s) Skip=%llu"),
+		Duration, JoinNum, ClientNum, SendNum, SendNum / Seconds, SkipNum);
+
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("[Load] Out=%llu packets %.1fKB/s In=%llu packets %.1fKB/s"),
+		PacketsOut, BytesOut / Seconds / 1024.0,
+		PacketsIn, BytesIn / Seconds / 1024.0);
+
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("[Load] Latency=%i Lost=%i P50=%.1fms P90=%.1fms P99=%.1fms Max=%.1fms"),
+		LatencyNum, LostNum, LatencyP50, LatencyP90, LatencyP99, LatencyMax);
+
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("[Load] CPU Average=%.1f%% Peak=%.1f%%"),
+		CPUAverage, CPUPeak);
+}
+
+FSimpleNetLoadGenerator::FSimpleNetLoadGenerator()
+	:TotalWeight(0.f)
+	, Replay(nullptr)
+	, ReplayIndex(0)
+	, ReplayStartTime(-1.0)
+	, Capture(nullptr)
+	, Time(0.0)
+	, SendNum(0)
+	, SkipNum(0)
+	, LostNum(0)
+	, CPUTotal(0.0)
+	, CPUPeak(0.f)
+	, CPUSampleNum(0)
+	, bRunning(false)
+{
+}
+
+FSimpleNetLoadGenerator::~FSimpleNetLoadGenerator()
+{
+	if (bRunning)
+	{
+		Stop();
+	}
+}
+
+bool FSimpleNetLoadGenerator::Start(const FSimpleNetLoadConfig& InConfig)
+{
+	if (bRunning)
+	{
+		return false;
+	}
+
+	TotalWeight = 0.f;
+	for (const FSimpleNetLoadAction& Tmp : InConfig.Actions)
+	{
+		if (Tmp.Send && Tmp.Weight > 0.f)
+		{
+			TotalWeight += Tmp.Weight;
+		}
+	}
+
+	return CreateClients(InConfig);
+}
+
+bool FSimpleNetLoadGenerator::StartReplay(const FSimpleNetLoadConfig& InConfig, const FSimpleNetTrafficCapture* InCapture)
+{
+	if (bRunning || !InCapture)
+	{
+		return false;
+	}
+
+	//回放时只按录制发送
+	FSimpleNetLoadConfig ReplayConfig = InConfig;
+	ReplayConfig.Actions.Empty();
+	ReplayConfig.SendRate = 0.f;
+	ReplayConfig.Duration = 0.f;
+
+	TotalWeight = 0.f;
+	if (!CreateClients(ReplayConfig))
+	{
+		return false;
+	}
+
+	Replay = InCapture;
+	ReplayIndex = 0;
+
+	return true;
+}
+
+bool FSimpleNetLoadGenerator::CreateClients(const FSimpleNetLoadConfig& InConfig)
+{
+	Config = InConfig;
+
+	Clients.Reset();
+	Latencies.Reset();
+	Replay = nullptr;
+	ReplayIndex = 0;
+	ReplayStartTime = -1.0;
+	Time = 0.0;
+	SendNum = 0;
+	SkipNum = 0;
+	LostNum = 0;
+	CPUTotal = 0.0;
+	CPUPeak = 0.f;
+	CPUSampleNum = 0;
+
+	if (!FSimpleNetManage::CreateCients(Config.GroupID, Config.IP, Config.Port, Config.ClientNum, Config.ObjectClass, Config.bAllowSynchronization, Config.SocketType, Config.bHighConcurrency))
+	{
+		FSimpleNetManage::DestroyClients(Config.GroupID);
+		return false;
+	}
+
+	if (TArray<FSimpleNetManage*>* InClients = FSimpleNetManage::GetClients(Config.GroupID))
+	{
+		for (int32 i = 0; i < InClients->Num(); i++)
+		{
+			FClient& Client = Clients.AddDefaulted_GetRef();
+			Client.Manage = (*InClients)[i];
+
+			//每个客户端一个随机流 发送序列和加入的先后无关
+			Client.Random.Initialize(Config.Seed + i);
+		}
+	}
+
+	bRunning = Clients.Num() > 0;
+
+	return bRunning;
+}
+
+void FSimpleNetLoadGenerator::Record(FSimpleNetTrafficCapture* InCapture)
+{
+	Capture = InCapture;
+	if (Capture)
+	{
+		Capture->Start();
+	}
+
+	for (int32 i = 0; i < Clients.Num(); i++)
+	{
+		if (Capture)
+		{
+			Clients[i].Manage->SendCaptureDelegate.BindRaw(this, &FSimpleNetLoadGenerator::OnSendCapture, i);
+		}
+		else
+		{
+			Clients[i].Manage->SendCaptureDelegate.Unbind();
+		}
+	}
+}
+
+double FSimpleNetLoadGenerator::GetInterval(FRandomStream& InRandom, float InRate)
+{
+	//平均间隔是1/InRate 在[0.5,1.5)倍之间浮动
+	return (0.5 + InRandom.GetFraction()) / InRate;
+}
+
+bool FSimpleNetLoadGenerator::UpdateJoin(int32 InClient)
+{
+	FClient& Client = Clients[InClient];
+	if (Client.bJoin)
+	{
+		return true;
+	}
+
+	USimpleController* Controller = Client.Manage->GetController();
+	if (!Controller || !Controller->GetConnetion() ||
+		Controller->GetConnetion()->GetState() != ESimpleConnetionLinkType::LINK_JOIN)
+	{
+		return false;
+	}
+
+	Client.bJoin = true;
+	Controller->RecvDelegate.AddRaw(this, &FSimpleNetLoadGenerator::OnRecvProtocol, InClient);
+
+	if (Config.SendRate > 0.f)
+	{
+		Client.NextSendTime = Time + GetInterval(Client.Random, Config.SendRate);
+	}
+
+	if (Config.PingRate > 0.f)
+	{
+		Client.NextPingTime = Time + GetInterval(Client.Random, Config.PingRate);
+	}
+
+	return true;
+}
+
+bool FSimpleNetLoadGenerator::Tick(float DeltaSeconds)
+{
+	if (!bRunning)
+	{
+		return false;
+	}
+
+	Time += DeltaSeconds;
+
+	FSimpleNetManage::TickClients(DeltaSeconds);
+
+	int32 JoinNum = 0;
+	for (int32 i = 0; i < Clients.Num(); i++)
+	{
+		if (UpdateJoin(i))
+		{
+			JoinNum++;
+
+			SendActions(i);
+			SendPing(i);
+		}
+	}
+
+	FCPUTime CPUTime = FPlatformTime::GetCPUTime();
+	CPUTotal += CPUTime.CPUTimePct;
+	CPUPeak = FMath::Max(CPUPeak, CPUTime.CPUTimePct);
+	CPUSampleNum++;
+
+	if (Replay)
+	{
+		//全部加入后才开始计时 否则前面的消息都落在没有加入的客户端上
+		if (JoinNum == Clients.Num() || Time >= SimpleNetLoadGenerator::JoinTimeout)
+		{
+			SendReplay();
+		}
+
+		return ReplayIndex < Replay->GetRecords().Num();
+	}
+
+	return Config.Duration <= 0.f || Time < Config.Duration;
+}
+
+void FSimpleNetLoadGenerator::SendActions(int32 InClient)
+{
+	FClient& Client = Clients[InClient];
+	if (TotalWeight <= 0.f || Config.SendRate <= 0.f)
+	{
+		return;
+	}
+
+	FSimpleChannel* Channel = Client.Manage->GetChannel();
+	if (!Channel)
+	{
+		return;
+	}
+
+	while (Client.NextSendTime <= Time)
+	{
+		float Pick = Client.Random.GetFraction() * TotalWeight;
+		for (const FSimpleNetLoadAction& Tmp : Config.Actions)
+		{
+			if (!Tmp.Send || Tmp.Weight <= 0.f)
+			{
+				continue;
+			}
+
+			Pick -= Tmp.Weight;
+			if (Pick < 0.f)
+			{
+				Tmp.Send(Channel);
+				SendNum++;
+				break;
+			}
+		}
+
+		Client.NextSendTime += GetInterval(Client.Random, Config.SendRate);
+	}
+}
+
+void FSimpleNetLoadGenerator::SendPing(int32 InClient)
+{
+	FClient& Client = Clients[InClient];
+	if (Config.PingRate <= 0.f || Client.NextPingTime > Time)
+	{
+		return;
+	}
+
+	//上一个还没有回应就不发 超时由对象自己处理 会回调一个超时的SP_PingResponse
+	if (Client.PingTime == 0.0)
+	{
+		if (USimpleController* Controller = Client.Manage->GetController())
+		{
+			Client.PingTime = FPlatformTime::Seconds();
+			Controller->Ping();
+		}
+	}
+
+	Client.NextPingTime = Time + GetInterval(Client.Random, Config.PingRate);
+}
+
+void FSimpleNetLoadGenerator::SendReplay()
+{
+	const TArray<FSimpleNetCaptureRecord>& Records = Replay->GetRecords();
+
+	//录制的时间从第一条消息开始算
+	if (ReplayStartTime < 0.0)
+	{
+		ReplayStartTime = Time - (Records.Num() ? Records[0].Time : 0.0);
+	}
+
+	for (; ReplayIndex < Records.Num(); ReplayIndex++)
+	{
+		const FSimpleNetCaptureRecord& Record = Records[ReplayIndex];
+		if (ReplayStartTime + Record.Time > Time)
+		{
+			break;
+		}
+
+		FClient& Client = Clients[FMath::Abs(Record.Client) % Clients.Num()];
+		FSimpleChannel* Channel = Client.bJoin ? Client.Manage->GetChannel() : nullptr;
+
+		const FSimpleBunchHead* RecordHead = (const FSimpleBunchHead*)Record.Data.GetData();
+		if (!Channel || !RecordHead->bAsynchronous)
+		{
+			SkipNum++;
+			continue;
+		}
+
+		TArray<uint8> Data = Record.Data;
+
+		FSimpleBunchHead* Head = (FSimpleBunchHead*)Data.GetData();
+		Head->ChannelID = Channel->GetGuid();
+
+		Channel->Send(Data);
+		SendNum++;
+	}
+}
+
+void FSimpleNetLoadGenerator::OnRecvProtocol(uint32 InProtocol, FSimpleChannel* InChannel, int32 InClient)
+{
+	if (InProtocol != SP_PingResponse || !Clients.IsValidIndex(InClient))
+	{
+		return;
+	}
+
+	FClient& Client = Clients[InClient];
+	if (Client.PingTime == 0.0)
+	{
+		return;
+	}
+
+	double Latency = FPlatformTime::Seconds() - Client.PingTime;
+	Client.PingTime = 0.0;
+
+	//超时时对象会自己构造一个回应
+	if (Latency >= FSimpleNetGlobalInfo::Get()->GetInfo().PingMaxOutTime)
+	{
+		LostNum++;
+	}
+	else
+	{
+		Latencies.Add((float)(Latency * 1000.0));
+	}
+}
+
+void FSimpleNetLoadGenerator::OnSendCapture(FSimpleChannel* InChannel, const TArray<uint8>& InData, int32 InClient)
+{
+	if (Capture && InData.Num() >= (int32)sizeof(FSimpleBunchHead))
+	{
+		Capture->Add(InClient, InData);
+	}
+}
+
+FSimpleNetLoadReport FSimpleNetLoadGenerator::GetReport()
+{
+	FSimpleNetLoadReport Report;
+	Report.Duration = Time;
+	Report.ClientNum = Clients.Num();
+	Report.SendNum = SendNum;
+	Report.SkipNum = SkipNum;
+	Report.LostNum = LostNum;
+
+	for (FClient& Tmp : Clients)
+	{
+		if (Tmp.bJoin)
+		{
+			Report.JoinNum++;
+		}
+
+		FSimpleNetStatsSnapshot Snapshot;
+		Tmp.Manage->GetStats(Snapshot);
+
+		Report.BytesIn += Snapshot.Total.BytesIn;
+		Report.PacketsIn += Snapshot.Total.PacketsIn;
+		Report.BytesOut += Snapshot.Total.BytesOut;
+		Report.PacketsOut += Snapshot.Total.PacketsOut;
+	}
+
+	if (Latencies.Num() > 0)
+	{
+		TArray<float> Sorted = Latencies;
+		Sorted.Sort();
+
+		auto GetPercentile = [&](float InPercent)
+		{
+			return Sorted[FMath::Clamp(FMath::CeilToInt(InPercent * Sorted.Num()) - 1, 0, Sorted.Num() - 1)];
+		};
+
+		Report.LatencyNum = Sorted.Num();
+		Report.LatencyP50 = GetPercentile(0.5f);
+		Report.LatencyP90 = GetPercentile(0.9f);
+		Report.LatencyP99 = GetPercentile(0.99f);
+		Report.LatencyMax = Sorted.Last();
+	}
+
+	if (CPUSampleNum > 0)
+	{
+		Report.CPUAverage = (float)(CPUTotal / CPUSampleNum);
+		Report.CPUPeak = CPUPeak;
+	}
+
+	return Report;
+}
+
+FSimpleNetLoadReport FSimpleNetLoadGenerator::Stop()
+{
+	FSimpleNetLoadReport Report = GetReport();
+
+	for (FClient& Tmp : Clients)
+	{
+		Tmp.Manage->SendCaptureDelegate.Unbind();
+
+		if (USimpleController* Controller = Tmp.Manage->GetController())
+		{
+			Controller->RecvDelegate.RemoveAll(this);
+		}
+	}
+
+	//客户端由管理器释放
+	Clients.Reset();
+	FSimpleNetManage::DestroyClients(Config.GroupID);
+
+	Replay = nullptr;
+	Capture = nullptr;
+	bRunning = false;
+
+	return Report;
+}
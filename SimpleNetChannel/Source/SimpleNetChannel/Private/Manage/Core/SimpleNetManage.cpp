@@ -13,6 +13,7 @@
 #include "Thread/SimpleNetThreadManage.h"
 #include "SocketSubsystem.h"
 #include "Sockets.h"
+#include "Misc/ScopeRWLock.h"
 
 #if PLATFORM_WINDOWS
 #pragma optimize("",off) 
@@ -101,10 +102,13 @@ bool FSimpleNetManage::Init(uint32 InIP, uint32 InPort)
 
 				InNewConnetion->SetLinkState(LinkState);
 				InNewConnetion->SetManage(this);
+				InNewConnetion->SetSlotIndex(Net.RemoteConnetions.Num() - 1);
 
 			//	InNewConnetion->Init();
 			}
 
+			Net.InitIndex();
+
 			//Set up local direct join
 			Net.LocalConnetion->SetState(ESimpleConnetionLinkType::LINK_JOIN);
 			Net.LocalConnetion->GetMainChannel()->InitController();
@@ -128,7 +132,80 @@ bool FSimpleNetManage::Init(const FSimpleAddr& InAddr)
 
 void FSimpleNetManage::Tick(float DeltaTime)
 {
-	
+	TimerWheel.Advance(DeltaTime);
+
+	float StatsDumpInterval = FSimpleNetGlobalInfo::Get()->GetInfo().StatsDumpInterval;
+	if (StatsDumpInterval > 0.f)
+	{
+		StatsDumpTime += DeltaTime;
+		if (StatsDumpTime >= StatsDumpInterval)
+		{
+			StatsDumpTime = 0.f;
+			DumpStats();
+		}
+	}
+}
+
+void FSimpleNetManage::GetStats(FSimpleNetStatsSnapshot& OutSnapshot)
+{
+	OutSnapshot.Time = FPlatformTime::Seconds();
+
+	auto AddConnetion = [&](const TSharedPtr<FSimpleConnetion>& InConnetion)
+	{
+		if (InConnetion.IsValid() && InConnetion->GetState() != ESimpleConnetionLinkType::LINK_UNINITIALIZED)
+		{
+			FSimpleNetConnetionStats& Stats = OutSnapshot.Connetions.AddDefaulted_GetRef();
+			InConnetion->GetStats(Stats);
+
+			OutSnapshot.Total += Stats.Traffic;
+		}
+	};
+
+	AddConnetion(Net.LocalConnetion);
+	for (auto& Tmp : Net.RemoteConnetions)
+	{
+		AddConnetion(Tmp);
+	}
+
+	ProtocolTelemetry.GetStats(OutSnapshot.Protocols);
+}
+
+void FSimpleNetManage::DumpStats()
+{
+	FSimpleNetStatsSnapshot Snapshot;
+	GetStats(Snapshot);
+
+	Snapshot.Dump();
+}
+
+void FSimpleNetManage::FlushSend()
+{
+	//先清掉 发送期间新的请求留到下一次
+	bFlushRequested = false;
+
+	if (Net.LocalConnetion.IsValid())
+	{
+		Net.LocalConnetion->FlushSend();
+	}
+
+	for (auto& Tmp : Net.RemoteConnetions)
+	{
+		Tmp->FlushSend();
+	}
+}
+
+void FSimpleNetManage::UpdateImpairment()
+{
+	//没有开启的链接直接返回
+	if (Net.LocalConnetion.IsValid())
+	{
+		Net.LocalConnetion->UpdateImpairment();
+	}
+
+	for (auto& Tmp : Net.RemoteConnetions)
+	{
+		Tmp->UpdateImpairment();
+	}
 }
 
 void FSimpleNetManage::Close(const FSimpleAddrInfo& InCloseConnetion)
@@ -202,14 +279,14 @@ void FSimpleNetManage::Destroy(FSimpleNetManage* InNetInstance)
 	}
 }
 
-bool FSimpleNetManage::CreateCients(int32 InGroupID,const FString& InLinkIP, int32 InPort, int32 InClientNumber, UClass* InClass, bool bNewAllowSynchronization , ESimpleSocketType InType)
+bool FSimpleNetManage::CreateCients(int32 InGroupID,const FString& InLinkIP, int32 InPort, int32 InClientNumber, UClass* InClass, bool bNewAllowSynchronization , ESimpleSocketType InType, bool bNewHighConcurrency)
 {
 	Clients.Add(InGroupID, TArray<FSimpleNetManage*>());
 	TArray<FSimpleNetManage*> &InArray = Clients[InGroupID];
 
 	for (int32 i = 0; i < InClientNumber; i++)
 	{
-		if (FSimpleNetManage* InNewClientManage = CreateManage(ESimpleNetLinkState::LINKSTATE_CONNET, InType))
+		if (FSimpleNetManage* InNewClientManage = CreateManage(ESimpleNetLinkState::LINKSTATE_CONNET, InType, bNewHighConcurrency))
 		{
 			//绑定反射对象
 			if (InClass)
@@ -258,10 +335,16 @@ void FSimpleNetManage::DestroyClients(int32 InGroupID)
 {
 	if (InGroupID != INDEX_NONE)
 	{
-		for (auto &Tmp : Clients[InGroupID])
+		if (TArray<FSimpleNetManage*>* InClients = Clients.Find(InGroupID))
 		{
-			FSimpleNetManage::Destroy(Tmp);
+			for (auto& Tmp : *InClients)
+			{
+				FSimpleNetManage::Destroy(Tmp);
+			}
 		}
+
+		//已经释放了 不能再被TickClients访问
+		Clients.Remove(InGroupID);
 	}
 	else
 	{
@@ -272,6 +355,8 @@ void FSimpleNetManage::DestroyClients(int32 InGroupID)
 				FSimpleNetManage::Destroy(SubTmp);
 			}
 		}
+
+		Clients.Empty();
 	}
 }
 
@@ -323,6 +408,11 @@ void FSimpleNetManage::TickClients(float DeltaTime)
 	}
 }
 
+TArray<FSimpleNetManage*>* FSimpleNetManage::GetClients(int32 InGroupID)
+{
+	return Clients.Find(InGroupID);
+}
+
 TSharedPtr<FSimpleConnetion> FSimpleNetManage::FindConnetionFree(int32 InGroupID)
 {
 	float FreeOutTime = 10.f;
@@ -461,6 +551,11 @@ void FSimpleNetManage::Close()
 			Tmp->Close();
 		}
 	}
+
+	TimerWheel.Reset();
+	InterestGrid.Reset();
+	ProtocolTelemetry.Reset();
+	StatsDumpTime = 0.f;
 }
 
 void FSimpleNetManage::Close(const TSharedPtr<FInternetAddr>& InternetAddr)
@@ -478,20 +573,32 @@ FSimpleNetManage::FSimpleNetManage()
 	,bClientLink(false)
 {
 	bAllowSynchronization = false;
+	StatsDumpTime = 0.f;
 }
 
 int32 FSimpleNetManage::GetConnetionNum()
 {
-	int32 Num = 0;
-	for (auto &Tmp : Net.RemoteConnetions)
-	{
-		if (Tmp->GetState() == ESimpleConnetionLinkType::LINK_JOIN)
-		{
-			Num++;
-		}
-	}
+	return Net.GetJoinNum();
+}
+
+void FSimpleNetManage::OnConnetionAddrChanged(int32 InSlot, TSharedPtr<FInternetAddr> InNewAddr)
+{
+	Net.UpdateAddr(InSlot, InNewAddr.IsValid() ? GetSimpleAddr(InNewAddr) : FSimpleAddr());
+}
+
+void FSimpleNetManage::OnConnetionStateChanged(ESimpleConnetionLinkType InOldState, ESimpleConnetionLinkType InNewState)
+{
+	Net.UpdateState(InOldState, InNewState);
+}
 
-	return Num;
+void FSimpleNetManage::OnConnetionGroupChanged(int32 InSlot, int32 InOldGroupID, int32 InNewGroupID)
+{
+	Net.UpdateGroup(InSlot, InOldGroupID, InNewGroupID);
+}
+
+void FSimpleNetManage::OnConnetionUnLock(int32 InSlot)
+{
+	Net.ReleaseSlot(InSlot);
 }
 
 FSimpleAddr FSimpleNetManage::GetAddr()
@@ -516,73 +623,151 @@ void FSimpleNetManage::LinkTimeout(const FString& InTimeoutMsg)
 	Close();
 }
 
-void FSimpleNetManage::FNet::Clear(int32 InIndex)
+void FSimpleNetManage::FNet::InitIndex()
 {
-	if (InIndex >= 0 && InIndex < RemoteConnetions.Num())
+	FRWScopeLock ScopeLock(IndexLock, SLT_Write);
+
+	AddrIndex.Empty();
+	GroupIndex.Empty();
+	JoinNum.Reset();
+
+	SlotAddrs.Init(FSimpleAddr(), RemoteConnetions.Num());
+
+	//倒序放入 先取出的是小的槽位 和原来的遍历顺序一致
+	FreeSlots.Reset(RemoteConnetions.Num());
+	for (int32 i = RemoteConnetions.Num() - 1; i >= 0; i--)
 	{
-		RemoteConnetions[InIndex]->SetState(ESimpleConnetionLinkType::LINK_UNINITIALIZED);
+		FreeSlots.Add(i);
 	}
 }
 
-int32 FSimpleNetManage::FNet::Add(TSharedPtr<FInternetAddr> InternetAddr)
+void FSimpleNetManage::FNet::UpdateAddr(int32 InSlot, const FSimpleAddr& InNewAddr)
 {
-	for (int32 i = 0; i < RemoteConnetions.Num();i++)
-	{
-		if (RemoteConnetions[i]->GetState() == ESimpleConnetionLinkType::LINK_UNINITIALIZED)
-		{
-			RemoteConnetions[i]->Init();
+	FRWScopeLock ScopeLock(IndexLock, SLT_Write);
 
-			bool bBindAddr = false;
-			RemoteConnetions[i]->GetRemoteAddr()->SetIp(*InternetAddr->ToString(false), bBindAddr);
-			RemoteConnetions[i]->GetRemoteAddr()->SetPort(InternetAddr->GetPort());
+	if (!SlotAddrs.IsValidIndex(InSlot))
+	{
+		return;
+	}
 
-			RemoteConnetions[i]->SetState(ESimpleConnetionLinkType::LINK_LOGIN);
+	FSimpleAddr& SlotAddr = SlotAddrs[InSlot];
+	if (SlotAddr == InNewAddr)
+	{
+		return;
+	}
 
-			return i;
+	//0.0.0.0:0 是未使用的链接 不进索引
+	if (SlotAddr.IP != 0 || SlotAddr.Port != 0)
+	{
+		if (TArray<int32, TInlineAllocator<1>>* Slots = AddrIndex.Find(SlotAddr))
+		{
+			Slots->Remove(InSlot);
+			if (Slots->Num() == 0)
+			{
+				AddrIndex.Remove(SlotAddr);
+			}
 		}
 	}
 
-	return INDEX_NONE;
+	SlotAddr = InNewAddr;
+
+	if (SlotAddr.IP != 0 || SlotAddr.Port != 0)
+	{
+		AddrIndex.FindOrAdd(SlotAddr).AddUnique(InSlot);
+	}
 }
 
-bool FSimpleNetManage::FNet::IsAddr(TSharedPtr<FInternetAddr> InternetAddr)
+void FSimpleNetManage::FNet::UpdateState(ESimpleConnetionLinkType InOldState, ESimpleConnetionLinkType InNewState)
+{
+	if (InOldState != ESimpleConnetionLinkType::LINK_JOIN && InNewState == ESimpleConnetionLinkType::LINK_JOIN)
+	{
+		JoinNum.Increment();
+	}
+	else if (InOldState == ESimpleConnetionLinkType::LINK_JOIN && InNewState != ESimpleConnetionLinkType::LINK_JOIN)
+	{
+		JoinNum.Decrement();
+	}
+}
+
+void FSimpleNetManage::FNet::UpdateGroup(int32 InSlot, int32 InOldGroupID, int32 InNewGroupID)
 {
-	for (auto &Connetion : RemoteConnetions)
+	if (InOldGroupID == InNewGroupID)
+	{
+		return;
+	}
+
+	FRWScopeLock ScopeLock(IndexLock, SLT_Write);
+
+	if (InOldGroupID != INDEX_NONE)
 	{
-		if (*Connetion->GetRemoteAddr() == *InternetAddr)
+		if (TSet<int32>* Slots = GroupIndex.Find(InOldGroupID))
 		{
-			return true;
+			Slots->Remove(InSlot);
+			if (Slots->Num() == 0)
+			{
+				GroupIndex.Remove(InOldGroupID);
+			}
 		}
 	}
 
-	return false;
+	if (InNewGroupID != INDEX_NONE)
+	{
+		GroupIndex.FindOrAdd(InNewGroupID).Add(InSlot);
+	}
+}
+
+void FSimpleNetManage::FNet::ReleaseSlot(int32 InSlot)
+{
+	FRWScopeLock ScopeLock(IndexLock, SLT_Write);
+
+	if (RemoteConnetions.IsValidIndex(InSlot))
+	{
+		FreeSlots.Add(InSlot);
+	}
+}
+
+void FSimpleNetManage::FNet::Clear(int32 InIndex)
+{
+	if (InIndex >= 0 && InIndex < RemoteConnetions.Num())
+	{
+		RemoteConnetions[InIndex]->SetState(ESimpleConnetionLinkType::LINK_UNINITIALIZED);
+	}
+}
+
+int32 FSimpleNetManage::FNet::Add(TSharedPtr<FInternetAddr> InternetAddr)
+{
+	if (TSharedPtr<FSimpleConnetion> InConnetion = GetEmptyConnetion(InternetAddr))
+	{
+		InConnetion->SetState(ESimpleConnetionLinkType::LINK_LOGIN);
+
+		return InConnetion->GetSlotIndex();
+	}
+
+	return INDEX_NONE;
+}
+
+bool FSimpleNetManage::FNet::IsAddr(TSharedPtr<FInternetAddr> InternetAddr)
+{
+	return (*this)[InternetAddr].IsValid();
 }
 
 TSharedPtr<FSimpleConnetion> FSimpleNetManage::FNet::operator[](TSharedPtr<FInternetAddr> InternetAddr)
 {
-	for (auto& Connetion : RemoteConnetions)
+	if (!InternetAddr.IsValid())
 	{
-		if (*Connetion->GetRemoteAddr() == *InternetAddr)
-		{
-			return Connetion;
-		}
+		return NULL;
 	}
 
-	return NULL;
+	return (*this)[FSimpleNetManage::GetSimpleAddr(InternetAddr)];
 }
 
 TSharedPtr<FSimpleConnetion> FSimpleNetManage::FNet::operator[](const FSimpleAddr& InternetAddr)
 {
-	for (auto& Tmp : RemoteConnetions)
-	{
-		uint32 MyPort = Tmp->GetRemoteAddr()->GetPort();
-		uint32 MyIP = 0;
-		Tmp->GetRemoteAddr()->GetIp(MyIP);
+	FRWScopeLock ScopeLock(IndexLock, SLT_ReadOnly);
 
-		if (MyIP == InternetAddr.IP && MyPort == InternetAddr.Port)
-		{
-			return Tmp;
-		}
+	if (const TArray<int32, TInlineAllocator<1>>* Slots = AddrIndex.Find(InternetAddr))
+	{
+		return RemoteConnetions[(*Slots)[0]];
 	}
 
 	return NULL;
@@ -590,14 +775,30 @@ TSharedPtr<FSimpleConnetion> FSimpleNetManage::FNet::operator[](const FSimpleAdd
 
 TSharedPtr<FSimpleConnetion> FSimpleNetManage::FNet::operator[](const int32 InGroupID)
 {
-	for (auto& Connetion : RemoteConnetions)
+	if (InGroupID == INDEX_NONE)
 	{
-		if (Connetion->GetGroupID() == InGroupID)
+		//未分组的不进索引 保持原来的行为
+		for (auto& Connetion : RemoteConnetions)
 		{
-			if (true)//判定当前状态是否空闲
+			if (Connetion->GetGroupID() == InGroupID)
 			{
 				return Connetion;
-			}		
+			}
+		}
+
+		return nullptr;
+	}
+
+	FRWScopeLock ScopeLock(IndexLock, SLT_ReadOnly);
+
+	if (const TSet<int32>* Slots = GroupIndex.Find(InGroupID))
+	{
+		for (int32 Slot : *Slots)
+		{
+			if (true)//判定当前状态是否空闲
+			{
+				return RemoteConnetions[Slot];
+			}
 		}
 	}
 
@@ -606,27 +807,33 @@ TSharedPtr<FSimpleConnetion> FSimpleNetManage::FNet::operator[](const int32 InGr
 
 TSharedPtr<FSimpleConnetion> FSimpleNetManage::FNet::GetEmptyConnetion(TSharedPtr<FInternetAddr> InternetAddr)
 {
-	for (int32 i =0 ;i < RemoteConnetions.Num();i++)
+	TSharedPtr<FSimpleConnetion> InConnetion;
 	{
-		if (TSharedPtr<FSimpleConnetion> InConnetion = RemoteConnetions[i])
-		{	
-			if (InConnetion->GetState() == ESimpleConnetionLinkType::LINK_UNINITIALIZED)
-			{
-				if (!InConnetion->IsLock())
-				{				
-					InConnetion->SetRemoteAddr(InternetAddr);
+		FRWScopeLock ScopeLock(IndexLock, SLT_Write);
 
-					InConnetion->Lock();
-
-					InConnetion->Init();
+		//空闲表里可能有过期的槽位 取出时再确认一次
+		while (FreeSlots.Num() > 0)
+		{
+			TSharedPtr<FSimpleConnetion> Tmp = RemoteConnetions[FreeSlots.Pop(false)];
+			if (Tmp->GetState() == ESimpleConnetionLinkType::LINK_UNINITIALIZED && !Tmp->IsLock())
+			{
+				Tmp->Lock();
 
-					return InConnetion;
-				}
+				InConnetion = Tmp;
+				break;
 			}
 		}
 	}
 
-	return NULL;
+	//不能在索引锁内设置 设置地址会回调更新索引
+	if (InConnetion.IsValid())
+	{
+		InConnetion->SetRemoteAddr(InternetAddr);
+
+		InConnetion->Init();
+	}
+
+	return InConnetion;
 }
 
 FString FSimpleNetManage::GetAddrString(const FSimpleAddr& InAddr)
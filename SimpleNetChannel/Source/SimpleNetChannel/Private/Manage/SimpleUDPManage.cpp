@@ -10,6 +10,7 @@
 #include "Thread/SimpleNetThreadManage.h"
 #include "Protocols/SimpleNetProtocols.h"
 #include "Core/EncryptionAndDecryption/SimpleEncryptionAndDecryption.h"
+#include "Stream/SimpleIOStream.h"
 
 #if PLATFORM_WINDOWS
 #pragma optimize("",off) 
@@ -24,6 +25,9 @@ FSimpleUDPManage::FSimpleUDPManage(ESimpleNetLinkState InType,bool bNewHighConcu
 
 	bEndThread = false;
 
+	ShardPort = 0;
+	ShardTaskEvent = nullptr;
+
 	LinkState = InType;
 }
 
@@ -68,16 +72,8 @@ bool FSimpleUDPManage::Init(const FString& InIP, uint32 InPort)
 		uint32 UintIP;
 		NewAddrTmp->GetIp(UintIP);
 
-		if (Init(UintIP, InPort))
-		{
-			if (IsAllowSynchronization())
-			{
-				MainNetThread = MakeShareable(new FSimpleNetThread(FSimpleDelegate::CreateRaw(this, &FSimpleUDPManage::Run)));
-				MainNetThread->Trigger();
-			}
-
-			return true;
-		}
+		//Init(uint32,uint32) 内部已经启动了接收线程 这里不要重复创建 否则两个线程会同时读取同一个接收缓冲
+		return Init(UintIP, InPort);
 	}
 
 	return false;
@@ -85,8 +81,21 @@ bool FSimpleUDPManage::Init(const FString& InIP, uint32 InPort)
 
 bool FSimpleUDPManage::Init(uint32 InIP, uint32 InPort)
 {
+	RecvBuffer.Init(
+		FSimpleNetGlobalInfo::Get()->GetInfo().RecvBatchNumber,
+		FSimpleNetGlobalInfo::Get()->GetInfo().RecvDataNumber);
+
 	if (Super::Init(InIP, InPort))
 	{
+		if (IsHighConcurrency() && LinkState == ESimpleNetLinkState::LINKSTATE_LISTEN &&
+			FSimpleNetGlobalInfo::Get()->GetInfo().ShardNumber > 0)
+		{
+			if (!InitShards(InIP))
+			{
+				return false;
+			}
+		}
+
 		if (IsAllowSynchronization())
 		{
 			MainNetThread = MakeShareable(new FSimpleNetThread(FSimpleDelegate::CreateRaw(this, &FSimpleUDPManage::Run)));
@@ -133,7 +142,13 @@ void FSimpleUDPManage::Tick(float DeltaTime)//Both the client and the server lis
 				if (!IsAllowSynchronization())
 				{
 					Listen();
+
+					//没有新的数据报时 延迟到期的也要按时解析
+					UpdateImpairment();
 				}
+
+				//本帧产生的数据统一发送
+				FlushSend();
 			}
 		}
 	}
@@ -146,189 +161,236 @@ void FSimpleUDPManage::Listen()
 		return;
 	}
 
-	int32 RecvDataNumber = FSimpleNetGlobalInfo::Get()->GetInfo().RecvDataNumber;
-#if PLATFORM_WINDOWS || PLATFORM_MAC || PLATFORM_LINUX
-	uint8 Data[8196 * 1024] = { 0 };
-#elif /*PLATFORM_IOS || */PLATFORM_ANDROID
-	uint8 Data[8196 * 10] = { 0 };
-#else
-	uint8 Data[8196 * 100] = { 0 };
-#endif
-	int32 BytesRead = 0;
-	ISocketSubsystem* InSocketSubsystem = FSimpleConnetion::GetSocketSubsystem();
-	TSharedPtr<FInternetAddr> RemoteAddr = InSocketSubsystem->CreateInternetAddr();
-	bool bRecvFrom = Net.LocalConnetion->GetSocket()->RecvFrom(Data, RecvDataNumber, BytesRead, *RemoteAddr);
-	if (bRecvFrom)
+	//一次尽量多取 取出来的数据直接交给解析 不再拷贝
+	int32 RecvNum = RecvBuffer.Drain(Net.LocalConnetion->GetSocket());
+	for (int32 i = 0; i < RecvNum; i++)
 	{
-		if (IsHighConcurrency())//高并发为主
+		FSimpleNetRecvBuffer::FSlot& Slot = RecvBuffer[i];
+		HandleDatagram(Slot.Data, Slot.BytesRead, Slot.Addr);
+
+		//解析过程中可能已经关闭
+		if (!Net.LocalConnetion->GetSocket())
+		{
+			break;
+		}
+	}
+}
+
+void FSimpleUDPManage::HandleDatagram(uint8* Data, int32 BytesRead, TSharedPtr<FInternetAddr> RemoteAddr)
+{
+	if (IsHighConcurrency())//高并发为主
+	{
+		if (FSimpleChannel* Channel = Net.LocalConnetion->GetMainChannel())
 		{
-			if (FSimpleChannel* Channel = Net.LocalConnetion->GetMainChannel())
+			BytesRead = Net.LocalConnetion->DecryptPackage(Data, BytesRead);
+			if (BytesRead == INDEX_NONE)
 			{
-				SimpleEncryptionAndDecryption::Decryption(Data, BytesRead);
+				return;
+			}
 
-				FSimplePackageHead PackageHead = *(FSimplePackageHead*)Data;
-				FSimpleBunchHead InHead = *(FSimpleBunchHead*)&Data[sizeof(FSimplePackageHead)];
+			//合并的数据报也只会出现在握手之后
+			if (Net.LocalConnetion->IsCoalescedPackage(Data, BytesRead))
+			{
+				if (LinkState == ESimpleNetLinkState::LINKSTATE_CONNET)
+				{
+					Net.LocalConnetion->HandleCoalescedPackage(BytesRead, Data, RemoteAddr);
+				}
 
-				if (!bClientLink)
+				return;
+			}
+
+			//紧凑包头只会出现在握手之后 直接交给链接解析
+			if (Net.LocalConnetion->IsCompactPackage(Data, BytesRead))
+			{
+				if (LinkState == ESimpleNetLinkState::LINKSTATE_CONNET)
 				{
-					FGuid InNewGuid = FGuid::NewGuid();
-					Channel->SetMsgQueueGuid(InNewGuid);
+					Net.LocalConnetion->HandleMergePackage(BytesRead, Data, RemoteAddr);
+				}
 
-					if (InHead.ParamNum > 0)
-					{
-						TArray<uint8> InNewData(&Data[sizeof(FSimplePackageHead)], BytesRead - sizeof(FSimplePackageHead));
+				return;
+			}
 
-						Channel->AddMsg(InNewGuid, InNewData);
-					}
+			FSimplePackageHead PackageHead = *(FSimplePackageHead*)Data;
+			FSimpleBunchHead InHead = *(FSimpleBunchHead*)&Data[sizeof(FSimplePackageHead)];
+
+			if (!bClientLink)
+			{
+				TArray<uint8> InNewData;
+				if (InHead.ParamNum > 0)
+				{
+					InNewData.Append(&Data[sizeof(FSimplePackageHead)], BytesRead - sizeof(FSimplePackageHead));
 				}
 
-				switch (PackageHead.Protocol)
+				Channel->SetThreadMsg(InNewData);
+			}
+
+			switch (PackageHead.Protocol)
+			{
+				case SP_SocketAddressRequest://请求一个UDPSocket 地址 (服务器) Socket在异步线程
 				{
-					case SP_SocketAddressRequest://请求一个UDPSocket 地址 (服务器) Socket在异步线程
+					SIMPLE_PROTOCOLS_RECEIVE(SP_SocketAddressRequest);
+
+					if (TSharedPtr<FSimpleConnetion> NewConnetion = Net[RemoteAddr])//验证
+					{
+						UE_LOG(LogSimpleNetChannel,
+							Error,
+							TEXT("The address already exists and should not be connected. Client[IP:%s Port:%d]"),
+							*RemoteAddr->ToString(false),
+							RemoteAddr->GetPort());
+					}
+					else if (IsSharded())
 					{
-						SIMPLE_PROTOCOLS_RECEIVE(SP_SocketAddressRequest);
+						//共享端口 先占一个空链接 收到绑定请求时再记录客户端新的地址
+						if (Net.GetEmptyConnetion(RemoteAddr))
+						{
+							FString PublicIP = FSimpleNetGlobalInfo::Get()->GetInfo().PublicIP;
+							FSimpleAddr InSimpleAddr = FSimpleNetManage::GetSimpleAddr(*PublicIP, ShardPort);
+
+							FSimpleAddr InLastKey = FSimpleNetManage::GetSimpleAddr(RemoteAddr);
 
-						if (TSharedPtr<FSimpleConnetion> NewConnetion = Net[RemoteAddr])//验证
+							SIMPLE_PROTOCOLS_SEND_ADDR(SP_SocketAddressResponse, RemoteAddr, InSimpleAddr, InLastKey);
+						}
+						else
 						{
 							UE_LOG(LogSimpleNetChannel,
 								Error,
-								TEXT("The address already exists and should not be connected. Client[IP:%s Port:%d]"),
+								TEXT("The number of connections is full. Client[IP:%s Port:%d]"),
 								*RemoteAddr->ToString(false),
 								RemoteAddr->GetPort());
 						}
-						else if (TSharedPtr<FSimpleConnetion> TmpConnetion = Net.GetEmptyConnetion(RemoteAddr))//获取一个新的空链接
-						{
-							uint32 PortCount = GetAvailPort();
-							if (PortCount != 0)
-							{
-								//创建Socket
-								if (FSocket* UDPSocket = TmpConnetion->CreateSocket(0, PortCount, true))
-								{
-									OpenPort(PortCount);
-
-									FString PublicIP = FSimpleNetGlobalInfo::Get()->GetInfo().PublicIP;
-									FSimpleAddr InSimpleAddr = FSimpleNetManage::GetSimpleAddr(*PublicIP, PortCount);
-
-									FSimpleAddr InLastKey = FSimpleNetManage::GetSimpleAddr(RemoteAddr);
-
-									//启动监听线程
-									TmpConnetion->ActivateListen();
-
-									SIMPLE_PROTOCOLS_SEND_ADDR(SP_SocketAddressResponse, RemoteAddr, InSimpleAddr, InLastKey);
-
-									UE_LOG(LogSimpleNetChannel,
-										Display,
-										TEXT("Create a new Socket as a link. IP=%s,Port=%i"),
-										*PublicIP, PortCount);
-								}
-								else
-								{
-									UE_LOG(LogSimpleNetChannel,
-										Error,
-										TEXT("Failed to create Socket [%i]. Client[IP:%s Port:%d]"), PortCount,
-										*RemoteAddr->ToString(false),
-										RemoteAddr->GetPort());
-								}
-							}
-							else
-							{
-								UE_LOG(LogSimpleNetChannel,Error,TEXT("The available allocated ports are already full."));
-							}
-						}
-
-						break;
 					}
-					case SP_SocketAddressResponse://客户端 Socket在主线程
+					else if (TSharedPtr<FSimpleConnetion> TmpConnetion = Net.GetEmptyConnetion(RemoteAddr))//获取一个新的空链接
 					{
-						FSimpleAddr InLinkSimpleAddr;
-						FSimpleAddr InLastKey;//用于验证
-
-						SIMPLE_PROTOCOLS_RECEIVE(SP_SocketAddressResponse, InLinkSimpleAddr, InLastKey);
-						if (InLinkSimpleAddr.IP != 0, InLinkSimpleAddr.Port != 0)
+						uint32 PortCount = GetAvailPort();
+						if (PortCount != 0)
 						{
-							uint32 NewPort = 0;
-							if (FSocket* InNewUPDSocekt = Net.LocalConnetion->CreateSocket(
-								InLinkSimpleAddr.IP,
-								NewPort,
-								false))
+							//创建Socket
+							if (FSocket* UDPSocket = TmpConnetion->CreateSocket(0, PortCount, true))
 							{
-								SIMPLE_PROTOCOLS_SEND(SP_BindingAddressRequest, InLastKey);
+								OpenPort(PortCount);
+
+								FString PublicIP = FSimpleNetGlobalInfo::Get()->GetInfo().PublicIP;
+								FSimpleAddr InSimpleAddr = FSimpleNetManage::GetSimpleAddr(*PublicIP, PortCount);
+
+								FSimpleAddr InLastKey = FSimpleNetManage::GetSimpleAddr(RemoteAddr);
+
+								//启动监听线程
+								TmpConnetion->ActivateListen();
+
+								SIMPLE_PROTOCOLS_SEND_ADDR(SP_SocketAddressResponse, RemoteAddr, InSimpleAddr, InLastKey);
 
 								UE_LOG(LogSimpleNetChannel,
 									Display,
-									TEXT("Bind the current address to the server."));
+									TEXT("Create a new Socket as a link. IP=%s,Port=%i"),
+									*PublicIP, PortCount);
 							}
 							else
 							{
 								UE_LOG(LogSimpleNetChannel,
 									Error,
-									TEXT("Link server error."));
+									TEXT("Failed to create Socket [%i]. Client[IP:%s Port:%d]"), PortCount,
+									*RemoteAddr->ToString(false),
+									RemoteAddr->GetPort());
 							}
+						}
+						else
+						{
+							UE_LOG(LogSimpleNetChannel,Error,TEXT("The available allocated ports are already full."));
+						}
+					}
+
+					break;
+				}
+				case SP_SocketAddressResponse://客户端 Socket在主线程
+				{
+					FSimpleAddr InLinkSimpleAddr;
+					FSimpleAddr InLastKey;//用于验证
+
+					SIMPLE_PROTOCOLS_RECEIVE(SP_SocketAddressResponse, InLinkSimpleAddr, InLastKey);
+					if (InLinkSimpleAddr.IP != 0, InLinkSimpleAddr.Port != 0)
+					{
+						uint32 NewPort = 0;
+						if (FSocket* InNewUPDSocekt = Net.LocalConnetion->CreateSocket(
+							InLinkSimpleAddr.IP,
+							NewPort,
+							false))
+						{
+							SIMPLE_PROTOCOLS_SEND(SP_BindingAddressRequest, InLastKey);
 
-							InLinkSimpleAddr.Port = NewPort;
+							UE_LOG(LogSimpleNetChannel,
+								Display,
+								TEXT("Bind the current address to the server."));
 						}
 						else
 						{
 							UE_LOG(LogSimpleNetChannel,
 								Error,
-								TEXT("Error in obtaining server socket."));
+								TEXT("Link server error."));
 						}
 
-						break;
+						InLinkSimpleAddr.Port = NewPort;
 					}
-					case SP_BindingAddressResponse:
+					else
 					{
-						SIMPLE_PROTOCOLS_RECEIVE(SP_BindingAddressResponse);
+						UE_LOG(LogSimpleNetChannel,
+							Error,
+							TEXT("Error in obtaining server socket."));
+					}
 
-						//向服务器发送Hello
-						Net.LocalConnetion->ConnectVerification();
+					break;
+				}
+				case SP_BindingAddressResponse:
+				{
+					SIMPLE_PROTOCOLS_RECEIVE(SP_BindingAddressResponse);
 
-						bClientLink = true;
+					//向服务器发送Hello
+					Net.LocalConnetion->ConnectVerification();
 
-						break;
-					}
-					default://只针对客户端
-					{
-						if (LinkState == ESimpleNetLinkState::LINKSTATE_CONNET) //The client can parse the data directly
-						{
-							Net.LocalConnetion->HandleMergePackage(BytesRead, Data, RemoteAddr);
-						}
+					bClientLink = true;
 
-						break;
+					break;
+				}
+				default://只针对客户端
+				{
+					if (LinkState == ESimpleNetLinkState::LINKSTATE_CONNET) //The client can parse the data directly
+					{
+						Net.LocalConnetion->HandleMergePackage(BytesRead, Data, RemoteAddr);
 					}
-				};
-			}
+
+					break;
+				}
+			};
 		}
-		else
+	}
+	else
+	{
+		if (LinkState == ESimpleNetLinkState::LINKSTATE_LISTEN)
 		{
-			if (LinkState == ESimpleNetLinkState::LINKSTATE_LISTEN)
+			if (TSharedPtr<FSimpleConnetion> NewConnetion = Net[RemoteAddr])
+			{	
+				NewConnetion->RecvByRemote(BytesRead, Data, RemoteAddr);
+			}
+			else
 			{
-				if (TSharedPtr<FSimpleConnetion> NewConnetion = Net[RemoteAddr])
-				{	
-					NewConnetion->HandleMergePackage(BytesRead, Data, RemoteAddr);
+				if (TSharedPtr<FSimpleConnetion> TmpConnetion = Net.GetEmptyConnetion(RemoteAddr))
+				{
+					TmpConnetion->RecvByRemote(BytesRead, Data, RemoteAddr);
 				}
 				else
 				{
-					if (TSharedPtr<FSimpleConnetion> TmpConnetion = Net.GetEmptyConnetion(RemoteAddr))
-					{
-						TmpConnetion->HandleMergePackage(BytesRead, Data, RemoteAddr);
-					}
-					else
-					{
-						UE_LOG(LogSimpleNetChannel,
-							Error,
-							TEXT("The number of connections is full. Client[IP:%s Port:%d]"),
-							*RemoteAddr->ToString(false),
-							RemoteAddr->GetPort());
-					}
+					UE_LOG(LogSimpleNetChannel,
+						Error,
+						TEXT("The number of connections is full. Client[IP:%s Port:%d]"),
+						*RemoteAddr->ToString(false),
+						RemoteAddr->GetPort());
 				}
 			}
-			else if (LinkState == ESimpleNetLinkState::LINKSTATE_CONNET) //The client can parse the data directly
-			{
-				Net.LocalConnetion->HandleMergePackage(BytesRead, Data, RemoteAddr);
-			}
-		}	
-	}
+		}
+		else if (LinkState == ESimpleNetLinkState::LINKSTATE_CONNET) //The client can parse the data directly
+		{
+			Net.LocalConnetion->RecvByRemote(BytesRead, Data, RemoteAddr);
+		}
+	}	
 }
 
 //#include "SocketTypes.h"
@@ -339,6 +401,11 @@ void FSimpleUDPManage::Close()
 
 	Super::Close();
 
+	//链接已经解除了对共享Socket的引用
+	CloseShards();
+
+	FlushSend();
+
 	if (Net.LocalConnetion->GetSocket())
 	{
 		if (ISocketSubsystem* SocketSubsystem = FSimpleConnetion::GetSocketSubsystem())
@@ -366,12 +433,269 @@ void FSimpleUDPManage::ResetLocalConnetion()
 
 void FSimpleUDPManage::Run()
 {
+	const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+
+	//合并发送时最多等CoalesceLatency 保证生产者请求的发送不会等满30毫秒
+	FTimespan WaitTime = FTimespan::FromMilliseconds(30.0);
+	if (ConfigInfo.bCoalesce)
+	{
+		WaitTime = FMath::Min(WaitTime, FTimespan::FromSeconds(FMath::Max(ConfigInfo.CoalesceLatency, 0.001f)));
+	}
+
+	while (!bEndThread)
+	{
+		//阻塞等待可读 有数据立即唤醒 不再固定睡眠
+		//已经有链接请求发送 只看一眼有没有数据
+		if (RecvBuffer.WaitForRead(Net.LocalConnetion->GetSocket(), IsFlushRequested() ? FTimespan::Zero() : WaitTime))
+		{
+			Listen();
+		}
+		else if (!Net.LocalConnetion->GetSocket())
+		{
+			FPlatformProcess::Sleep(0.03f);
+		}
+
+		UpdateImpairment();
+
+		FlushSend();
+	}
+}
+
+bool FSimpleUDPManage::InitShards(uint32 InIP)
+{
+	ISocketSubsystem* SocketSubsystem = FSimpleConnetion::GetSocketSubsystem();
+	if (!SocketSubsystem)
+	{
+		return false;
+	}
+
+	const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+
+	int32 ShardNumber = ConfigInfo.ShardNumber;
+#if !PLATFORM_LINUX
+	//只有Linux内核会把同一端口的数据报分配到多个Socket 其他平台只有一个能收到
+	if (ShardNumber > 1)
+	{
+		UE_LOG(LogSimpleNetChannel, Warning, TEXT("Shared port load balancing is not supported on this platform, only one shard thread is used."));
+		ShardNumber = 1;
+	}
+#endif
+
+	ShardPort = ConfigInfo.ShardPort > 0 ? ConfigInfo.ShardPort : Net.LocalConnetion->GetAddr()->GetPort() + 1;
+
+	for (int32 i = 0; i < ShardNumber; i++)
+	{
+		TUniquePtr<FShard> Shard = MakeUnique<FShard>();
+
+		Shard->Addr = SocketSubsystem->CreateInternetAddr();
+		if (InIP == 0)
+		{
+			Shard->Addr->SetAnyAddress();
+		}
+		else
+		{
+			Shard->Addr->SetIp(InIP);
+		}
+		Shard->Addr->SetPort(ShardPort);
+
+		Shard->Socket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("RenZhai"));
+		if (!Shard->Socket ||
+			!Shard->Socket->SetReuseAddr(true) ||
+			!Shard->Socket->SetNonBlocking(true) ||
+			!Shard->Socket->Bind(*Shard->Addr))
+		{
+			FString ErrorInfo = FString::Printf(TEXT("Failed to bind shared port %i."), ShardPort);
+			ExecuteNetManageMsgDelegate(ESimpleNetErrorType::INIT_FAIL, ErrorInfo);
+			UE_LOG(LogSimpleNetChannel, Error, TEXT("%s"), *ErrorInfo);
+
+			if (Shard->Socket)
+			{
+				SocketSubsystem->DestroySocket(Shard->Socket);
+			}
+
+			CloseShards();
+			return false;
+		}
+
+		int32 RecvSize = 0;
+		Shard->Socket->SetReceiveBufferSize(ConfigInfo.RecvDataNumber * ConfigInfo.RecvBatchNumber, RecvSize);
+
+		Shard->RecvBuffer.Init(ConfigInfo.RecvBatchNumber, ConfigInfo.RecvDataNumber);
+		Shards.Add(MoveTemp(Shard));
+	}
+
+	//全部绑定成功后再启动线程
+	ShardTaskEvent = FPlatformProcess::GetSynchEventFromPool();
+
+	for (int32 i = 0; i < Shards.Num(); i++)
+	{
+		Shards[i]->Thread = MakeShareable(new FSimpleNetThread(FSimpleDelegate::CreateRaw(this, &FSimpleUDPManage::RunShard, i)));
+		Shards[i]->Thread->Trigger();
+	}
+
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("Shared port %i is served by %i shard threads."), ShardPort, Shards.Num());
+
+	return true;
+}
+
+void FSimpleUDPManage::CloseShards()
+{
+	if (Shards.Num() == 0)
+	{
+		return;
+	}
+
+	bEndThread = true;
+
+	//接收线程还引用着FShard和Socket 先等线程全部退出再释放
+	//RunShard最多阻塞一次等待时间 释放FSimpleNetThread会唤醒并等待线程结束
+	for (auto& Tmp : Shards)
+	{
+		Tmp->Thread.Reset();
+	}
+
+	//线程池里还没有解析完的数据报引用着管理器
+	if (ShardTaskEvent)
+	{
+		while (ShardTaskNum.GetValue() > 0)
+		{
+			ShardTaskEvent->Wait();
+		}
+
+		FPlatformProcess::ReturnSynchEventToPool(ShardTaskEvent);
+		ShardTaskEvent = nullptr;
+	}
+
+	if (ISocketSubsystem* SocketSubsystem = FSimpleConnetion::GetSocketSubsystem())
+	{
+		for (auto& Tmp : Shards)
+		{
+			if (Tmp->Socket)
+			{
+				SocketSubsystem->DestroySocket(Tmp->Socket);
+				Tmp->Socket = nullptr;
+			}
+		}
+	}
+
+	Shards.Empty();
+}
+
+void FSimpleUDPManage::RunShard(int32 InShardIndex)
+{
+	FShard& Shard = *Shards[InShardIndex];
+
 	while (!bEndThread)
 	{
-		Listen();
+		if (Shard.RecvBuffer.WaitForRead(Shard.Socket, FTimespan::FromMilliseconds(30.0)))
+		{
+			int32 RecvNum = Shard.RecvBuffer.Drain(Shard.Socket);
+			for (int32 i = 0; i < RecvNum && !bEndThread; i++)
+			{
+				FSimpleNetRecvBuffer::FSlot& Slot = Shard.RecvBuffer[i];
+				HandleShardDatagram(InShardIndex, Slot.Data, Slot.BytesRead, Slot.Addr);
+			}
+		}
+	}
+}
+
+void FSimpleUDPManage::HandleShardDatagram(int32 InShardIndex, uint8* Data, int32 BytesRead, TSharedPtr<FInternetAddr> RemoteAddr)
+{
+	//已经绑定 交给线程池解析 接收线程马上回去收下一批
+	//同一个客户端地址的数据报在同一条通道里按顺序解析 通道满了接收线程等待
+	if (TSharedPtr<FSimpleConnetion> Connetion = Net[RemoteAddr])
+	{
+		if (Connetion->IsSharedSocket())
+		{
+			//数据和地址都在接收缓冲里 会被下一批改写
+			TArray<uint8> Datagram(Data, BytesRead);
+			TSharedPtr<FInternetAddr> InAddr(RemoteAddr->Clone());
+			TWeakPtr<FSimpleConnetion> WeakConnetion = Connetion;
+
+			ShardTaskNum.Increment();
+			FSimpleNetThreadManage::Get()->AddTask(FSimpleDelegate::CreateLambda(
+			[this, WeakConnetion, Datagram, InAddr]() mutable
+			{
+				//排队期间链接可能已经关闭 或者复用给了别的客户端
+				TSharedPtr<FSimpleConnetion> InConnetion = WeakConnetion.Pin();
+				if (InConnetion.IsValid() && InConnetion->IsSharedSocket() &&
+					InConnetion->GetRemoteAddr().IsValid() && *InConnetion->GetRemoteAddr() == *InAddr)
+				{
+					InConnetion->RecvByRemote(Datagram.Num(), Datagram.GetData(), InAddr);
+				}
+
+				if (ShardTaskNum.Decrement() == 0)
+				{
+					ShardTaskEvent->Trigger();
+				}
+			}), InAddr->GetTypeHash());
+		}
+
+		return;
+	}
+
+	int32 PackageHeadSize = sizeof(FSimplePackageHead);
+	if (BytesRead < PackageHeadSize + (int32)sizeof(FSimpleBunchHead))
+	{
+		return;
+	}
+
+	//绑定前还没有协商 只会是旧的加密
+	SimpleEncryptionAndDecryption::Decryption(Data, BytesRead);
+
+	FSimplePackageHead PackageHead = *(FSimplePackageHead*)Data;
+	if (PackageHead.Protocol != SP_BindingAddressRequest)
+	{
+		UE_LOG(LogSimpleNetChannel,
+			Error,
+			TEXT("There is an illegal IP link. Client[IP:%s Port:%d]"),
+			*RemoteAddr->ToString(false),
+			RemoteAddr->GetPort());
+
+		return;
+	}
+
+	//这里还不知道是哪个链接 不能借用通道的消息队列 直接读取参数
+	TArray<uint8> InNewData(&Data[PackageHeadSize], BytesRead - PackageHeadSize);
+	FSimpleIOStream Stream(InNewData);
+	Stream.Seek(sizeof(FSimpleBunchHead));
+
+	FSimpleAddr InLastKey;//用于验证
+	Stream >> InLastKey;
+	if (Stream.IsError())
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&ShardBindMutex);
+
+	//只有请求过地址 还没有绑定的链接可以绑定
+	TSharedPtr<FSimpleConnetion> Connetion = Net[InLastKey];
+	if (!Connetion.IsValid() || Connetion->GetSocket())
+	{
+		UE_LOG(LogSimpleNetChannel,
+			Error,
+			TEXT("Failed to obtain new address without establishing a valid link."));
 
-		FPlatformProcess::Sleep(0.03f);
+		return;
 	}
+
+	FShard& Shard = *Shards[InShardIndex];
+
+	Connetion->SetLocalAddr(TSharedPtr<FInternetAddr>(Shard.Addr->Clone()));
+	Connetion->SetSharedSocket(Shard.Socket);
+
+	//重置远端地址到新的客户端
+	Connetion->SetRemoteAddr(RemoteAddr);
+
+	if (FSimpleChannel* Channel = Connetion->GetMainChannel())
+	{
+		SIMPLE_PROTOCOLS_SEND(SP_BindingAddressResponse);
+	}
+
+	UE_LOG(LogSimpleNetChannel,
+		Display,
+		TEXT("Address binding successful."));
 }
 
 TSharedPtr<FSimpleConnetion> FSimpleUDPManage::CreateConnetion() const
@@ -3,6 +3,7 @@
 
 #include "SimpleNetManage.h"
 #include "Thread/SimpleNetThread.h"
+#include "Core/RecvBuffer/SimpleNetRecvBuffer.h"
 
 class FSocket;
 class FSimpleNetThread;
@@ -28,17 +29,53 @@ public:
 	//Asynchronous
 	void Run();
 
+	//共享端口的接收线程
+	void RunShard(int32 InShardIndex);
+
 protected:
 	virtual TSharedPtr<FSimpleConnetion> CreateConnetion() const;
 
 protected:
 	void Listen();
+	void HandleDatagram(uint8* Data, int32 BytesRead, TSharedPtr<FInternetAddr> RemoteAddr);
 
 	virtual bool CloseSocket();
 
+	//共享端口 所有客户端绑定到同一个端口 按客户端地址分发到链接
+	bool IsSharded() const { return Shards.Num() > 0; }
+	bool InitShards(uint32 InIP);
+	void CloseShards();
+	void HandleShardDatagram(int32 InShardIndex, uint8* Data, int32 BytesRead, TSharedPtr<FInternetAddr> RemoteAddr);
+
+protected:
+	struct FShard
+	{
+		FShard()
+			:Socket(nullptr)
+		{}
+
+		FSocket* Socket;
+		TSharedPtr<FInternetAddr> Addr;
+		FSimpleNetRecvBuffer RecvBuffer;
+		TSharedPtr<FSimpleNetThread, ESPMode::ThreadSafe> Thread;
+	};
+
+	TArray<TUniquePtr<FShard>> Shards;
+	uint32 ShardPort;
+
+	//多个线程可能同时收到同一个链接的绑定请求
+	FCriticalSection ShardBindMutex;
+
+	//已经绑定的链接 数据报交给线程池按客户端地址有序解析 关闭时等待全部执行完
+	FThreadSafeCounter ShardTaskNum;
+	FEvent* ShardTaskEvent;
+
 protected:
 	TSharedPtr<FSimpleNetThread,ESPMode::ThreadSafe> MainNetThread;
 
+	//批量接收缓冲
+	FSimpleNetRecvBuffer RecvBuffer;
+
 protected:
 	bool bEndThread;
 
@@ -0,0 +1,536 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Replication/SimpleNetReplication.h"
+#include "Channel/SimpleChannel.h"
+#include "Protocols/SimpleNetProtocols.h"
+#include "Log/SimpleNetChannelLog.h"
+#include "UObject/UnrealType.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/StructuredArchive.h"
+#include "Misc/ScopeLock.h"
+
+namespace SimpleNetReplication
+{
+	//同一个对象没有确认的快照超过这么多 说明一直在丢包 改发全量
+	const int32 MaxPending = 32;
+
+	struct FField
+	{
+		FProperty* Property;
+		int32 ArrayIndex;
+	};
+
+	struct FStructInfo
+	{
+		UScriptStruct* Struct;
+		uint32 TypeID;
+		TArray<FField> Fields;//静态数组按元素展开 每个元素占掩码的一位
+	};
+
+	typedef TSharedPtr<const FStructInfo, ESPMode::ThreadSafe> FStructInfoPtr;
+
+	static TMap<uint32, FStructInfoPtr>& GetStructs()
+	{
+		static TMap<uint32, FStructInfoPtr> Structs;
+		return Structs;
+	}
+
+	static FCriticalSection& GetStructsMutex()
+	{
+		static FCriticalSection Mutex;
+		return Mutex;
+	}
+
+	static uint32 GetTypeID(const UScriptStruct* InStruct)
+	{
+		return FCrc::StrCrc32(*InStruct->GetPathName());
+	}
+
+	static FStructInfoPtr FindStruct(uint32 InTypeID)
+	{
+		FScopeLock ScopeLock(&GetStructsMutex());
+
+		return GetStructs().FindRef(InTypeID);
+	}
+
+	static void SerializeField(FArchive& Ar, const FField& InField, void* InData)
+	{
+		FStructuredArchiveFromArchive Adapter(Ar);
+		InField.Property->SerializeItem(Adapter.GetSlot(), InField.Property->ContainerPtrToValuePtr<void>(InData, InField.ArrayIndex));
+	}
+
+	//序号回绕后仍然可以比较
+	static bool IsNewer(uint32 A, uint32 B)
+	{
+		return (int32)(A - B) > 0;
+	}
+}
+
+FSimpleNetReplication::FSnapshot::FSnapshot(UScriptStruct* InStruct, const void* InData)
+	:Struct(InStruct)
+{
+	Data = (uint8*)FMemory::Malloc(FMath::Max(Struct->GetStructureSize(), 1), Struct->GetMinAlignment());
+	Struct->InitializeStruct(Data);
+
+	if (InData)
+	{
+		Struct->CopyScriptStruct(Data, InData);
+	}
+}
+
+FSimpleNetReplication::FSnapshot::~FSnapshot()
+{
+	Struct->DestroyStruct(Data);
+	FMemory::Free(Data);
+}
+
+FSimpleNetReplication::FSimpleNetReplication()
+	:Channel(nullptr)
+{
+
+}
+
+void FSimpleNetReplication::SetChannel(FSimpleChannel* InChannel)
+{
+	Channel = InChannel;
+}
+
+void FSimpleNetReplication::RegisterStruct(UScriptStruct* InStruct)
+{
+	using namespace SimpleNetReplication;
+
+	if (!InStruct)
+	{
+		return;
+	}
+
+	uint32 TypeID = GetTypeID(InStruct);
+
+	FScopeLock ScopeLock(&GetStructsMutex());
+
+	if (GetStructs().Contains(TypeID))
+	{
+		return;
+	}
+
+	TSharedPtr<FStructInfo, ESPMode::ThreadSafe> Info = MakeShared<FStructInfo, ESPMode::ThreadSafe>();
+	Info->Struct = InStruct;
+	Info->TypeID = TypeID;
+
+	for (TFieldIterator<FProperty> It(InStruct); It; ++It)
+	{
+		//对象引用在两端不是同一个地址 不能按值复制
+		if (CastField<FObjectPropertyBase>(*It))
+		{
+			UE_LOG(LogSimpleNetChannel, Warning, TEXT("[Replication] %s.%s is an object reference and will not be replicated."),
+				*InStruct->GetName(),
+				*It->GetName());
+
+			continue;
+		}
+
+		for (int32 i = 0; i < It->ArrayDim; i++)
+		{
+			Info->Fields.Add({ *It, i });
+		}
+	}
+
+	GetStructs().Add(TypeID, Info);
+}
+
+void FSimpleNetReplication::BuildPayload(FSendObject& InObject, uint32 InKey, const void* InData, TArray<uint8>& OutPayload)
+{
+	using namespace SimpleNetReplication;
+
+	uint32 TypeID = GetTypeID(InObject.Struct);
+	FStructInfoPtr Info = FindStruct(TypeID);
+	check(Info.IsValid());
+
+	const FSnapshot* Baseline = InObject.Baseline.Get();
+	uint32 BaseSequence = Baseline ? InObject.AckSequence : 0;
+
+	FMemoryWriter Writer(OutPayload);
+	Writer << TypeID;
+	Writer << InKey;
+	Writer << InObject.Sequence;
+	Writer << BaseSequence;
+
+	//掩码先占位 写完属性后回填
+	TArray<uint8> Mask;
+	Mask.SetNumZeroed((Info->Fields.Num() + 7) / 8);
+
+	int64 MaskOffset = Writer.Tell();
+	Writer.Serialize(Mask.GetData(), Mask.Num());
+
+	for (int32 i = 0; i < Info->Fields.Num(); i++)
+	{
+		const FField& Field = Info->Fields[i];
+		if (!Baseline || !Field.Property->Identical_InContainer(Baseline->Data, InData, Field.ArrayIndex))
+		{
+			Mask[i >> 3] |= (1 << (i & 7));
+			SerializeField(Writer, Field, const_cast<void*>(InData));
+		}
+	}
+
+	if (Mask.Num() > 0)
+	{
+		FMemory::Memcpy(&OutPayload[MaskOffset], Mask.GetData(), Mask.Num());
+	}
+
+	if (Baseline)
+	{
+		Stats.DeltaNum++;
+		Stats.FullBytes += FMath::Max(InObject.FullSize, OutPayload.Num());
+	}
+	else
+	{
+		Stats.FullNum++;
+		Stats.FullBytes += OutPayload.Num();
+		InObject.FullSize = OutPayload.Num();
+	}
+
+	Stats.SendBytes += OutPayload.Num();
+}
+
+bool FSimpleNetReplication::Replicate(uint32 InKey, UScriptStruct* InStruct, const void* InData)
+{
+	using namespace SimpleNetReplication;
+
+	if (!Channel || !InStruct || !InData)
+	{
+		return false;
+	}
+
+	//发送方忘了注册的话自动注册 接收方必须自己注册
+	RegisterStruct(InStruct);
+
+	TArray<uint8> Payload;
+	{
+		FScopeLock ScopeLock(&Mutex);
+
+		FSendObject& Object = SendObjects.FindOrAdd(InKey);
+		if (Object.Struct != InStruct)
+		{
+			Object = FSendObject();
+			Object.Struct = InStruct;
+		}
+
+		if (Object.Last.IsValid() && InStruct->CompareScriptStruct(Object.Last->Data, InData, PPF_None))
+		{
+			return false;
+		}
+
+		//太久没有确认 基准作废
+		if (Object.Pending.Num() >= MaxPending)
+		{
+			Object.Baseline.Reset();
+			Object.AckSequence = 0;
+			Object.Pending.Empty();
+		}
+
+		Object.Sequence++;
+		if (Object.Sequence == 0)
+		{
+			Object.Sequence = 1;
+		}
+
+		BuildPayload(Object, InKey, InData, Payload);
+
+		FSnapshotPtr Snapshot = MakeShared<FSnapshot, ESPMode::ThreadSafe>(InStruct, InData);
+		Object.Pending.Add(Object.Sequence, Snapshot);
+		Object.Last = Snapshot;
+	}
+
+	SendPayload(SP_Replicate, Payload);
+
+	return true;
+}
+
+bool FSimpleNetReplication::GetState(uint32 InKey, UScriptStruct* InStruct, void* OutData) const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	if (const FRecvObject* Object = RecvObjects.Find(InKey))
+	{
+		if (Object->Struct == InStruct && Object->Latest.IsValid())
+		{
+			InStruct->CopyScriptStruct(OutData, Object->Latest->Data);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FSimpleNetReplication::Remove(uint32 InKey)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	SendObjects.Remove(InKey);
+}
+
+void FSimpleNetReplication::Receive(uint32 InProtocolsNumber, const uint8* InData, int32 InLen)
+{
+	if (InProtocolsNumber == SP_Replicate)
+	{
+		ReceiveState(InData, InLen);
+	}
+	else if (InProtocolsNumber == SP_ReplicateAck)
+	{
+		ReceiveAck(InData, InLen);
+	}
+}
+
+void FSimpleNetReplication::ReceiveState(const uint8* InData, int32 InLen)
+{
+	using namespace SimpleNetReplication;
+
+	FMemoryReaderView Reader(MakeArrayView(InData, InLen));
+
+	uint32 TypeID = 0;
+	uint32 Key = 0;
+	uint32 Sequence = 0;
+	uint32 BaseSequence = 0;
+	Reader << TypeID;
+	Reader << Key;
+	Reader << Sequence;
+	Reader << BaseSequence;
+
+	if (Reader.IsError())
+	{
+		return;
+	}
+
+	FStructInfoPtr Info = FindStruct(TypeID);
+	if (!Info.IsValid())
+	{
+		UE_LOG(LogSimpleNetChannel, Warning, TEXT("[Replication] Unregistered struct type %u, call FSimpleNetReplication::RegisterStruct first."), TypeID);
+		return;
+	}
+
+	TArray<uint8> Mask;
+	Mask.SetNumUninitialized((Info->Fields.Num() + 7) / 8);
+	Reader.Serialize(Mask.GetData(), Mask.Num());
+
+	if (Reader.IsError())
+	{
+		return;
+	}
+
+	bool bNack = false;
+	{
+		FScopeLock ScopeLock(&Mutex);
+
+		FRecvObject& Object = RecvObjects.FindOrAdd(Key);
+		if (Object.Struct != Info->Struct)
+		{
+			Object = FRecvObject();
+			Object.Struct = Info->Struct;
+		}
+
+		//乱序到达的旧状态直接丢弃 对方没有收到确认也不会拿它做基准
+		if (Object.Latest.IsValid() && !IsNewer(Sequence, Object.Sequence))
+		{
+			return;
+		}
+
+		FSnapshotPtr Baseline;
+		if (BaseSequence != 0)
+		{
+			Baseline = Object.History.FindRef(BaseSequence);
+			bNack = !Baseline.IsValid();
+		}
+
+		if (!bNack)
+		{
+			FSnapshotPtr Snapshot = MakeShared<FSnapshot, ESPMode::ThreadSafe>(Info->Struct, Baseline.IsValid() ? Baseline->Data : nullptr);
+
+			for (int32 i = 0; i < Info->Fields.Num(); i++)
+			{
+				if (Mask[i >> 3] & (1 << (i & 7)))
+				{
+					SerializeField(Reader, Info->Fields[i], Snapshot->Data);
+				}
+			}
+
+			if (Reader.IsError())
+			{
+				UE_LOG(LogSimpleNetChannel, Error, TEXT("[Replication] Invalid state, key = %u sequence = %u"), Key, Sequence);
+				return;
+			}
+
+			//对方以后只会拿这次的基准或者更新的快照做基准
+			for (auto It = Object.History.CreateIterator(); It; ++It)
+			{
+				if ((BaseSequence != 0 && IsNewer(BaseSequence, It.Key())) ||
+					IsNewer(Sequence, It.Key() + MaxPending))
+				{
+					It.RemoveCurrent();
+				}
+			}
+
+			Object.History.Add(Sequence, Snapshot);
+			Object.Latest = Snapshot;
+			Object.Sequence = Sequence;
+		}
+	}
+
+	SendAck(TypeID, Key, Sequence, bNack);
+
+	if (!bNack)
+	{
+		Notify(Key);
+	}
+}
+
+void FSimpleNetReplication::ReceiveAck(const uint8* InData, int32 InLen)
+{
+	using namespace SimpleNetReplication;
+
+	FMemoryReaderView Reader(MakeArrayView(InData, InLen));
+
+	uint32 TypeID = 0;
+	uint32 Key = 0;
+	uint32 Sequence = 0;
+	uint8 bNack = 0;
+	Reader << TypeID;
+	Reader << Key;
+	Reader << Sequence;
+	Reader << bNack;
+
+	if (Reader.IsError())
+	{
+		return;
+	}
+
+	TArray<uint8> Payload;
+	{
+		FScopeLock ScopeLock(&Mutex);
+
+		FSendObject* Object = SendObjects.Find(Key);
+		if (!Object || !Object->Struct || GetTypeID(Object->Struct) != TypeID)
+		{
+			return;
+		}
+
+		if (bNack)
+		{
+			//对方丢了基准 立刻补发一次全量
+			Stats.NackNum++;
+
+			Object->Baseline.Reset();
+			Object->AckSequence = 0;
+			Object->Pending.Empty();
+
+			if (Object->Last.IsValid())
+			{
+				Object->Sequence++;
+				if (Object->Sequence == 0)
+				{
+					Object->Sequence = 1;
+				}
+
+				BuildPayload(*Object, Key, Object->Last->Data, Payload);
+				Object->Pending.Add(Object->Sequence, Object->Last);
+			}
+		}
+		else if (Object->AckSequence == 0 || IsNewer(Sequence, Object->AckSequence))
+		{
+			if (FSnapshotPtr Snapshot = Object->Pending.FindRef(Sequence))
+			{
+				Object->Baseline = Snapshot;
+				Object->AckSequence = Sequence;
+
+				for (auto It = Object->Pending.CreateIterator(); It; ++It)
+				{
+					if (!IsNewer(It.Key(), Sequence))
+					{
+						It.RemoveCurrent();
+					}
+				}
+			}
+		}
+	}
+
+	if (Payload.Num() > 0)
+	{
+		SendPayload(SP_Replicate, Payload);
+	}
+}
+
+void FSimpleNetReplication::SendPayload(uint32 InProtocolsNumber, TArray<uint8>& InPayload)
+{
+	if (!Channel)
+	{
+		return;
+	}
+
+	FSimpleBunchHead Head;
+	Head.ProtocolsNumber = InProtocolsNumber;
+	Head.ParamNum = 1;
+	Head.ChannelID = Channel->GetGuid();
+	Head.bAsynchronous = true;
+
+	TArray<uint8> Buffer;
+	Buffer.Reserve(sizeof(FSimpleBunchHead) + InPayload.Num());
+	Buffer.Append((uint8*)&Head, sizeof(FSimpleBunchHead));
+	Buffer.Append(InPayload);
+
+	Channel->Send(Buffer);
+}
+
+void FSimpleNetReplication::SendAck(uint32 InTypeID, uint32 InKey, uint32 InSequence, bool bNack)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter Writer(Payload);
+
+	uint8 NackValue = bNack ? 1 : 0;
+	Writer << InTypeID;
+	Writer << InKey;
+	Writer << InSequence;
+	Writer << NackValue;
+
+	SendPayload(SP_ReplicateAck, Payload);
+}
+
+void FSimpleNetReplication::Notify(uint32 InKey)
+{
+	if (!Channel)
+	{
+		return;
+	}
+
+	//和普通协议一样放进消息队列 对象里用SIMPLE_PROTOCOLS_RECEIVE(SP_Replicate, Key)取出
+	FSimpleBunchHead Head;
+	Head.ProtocolsNumber = SP_Replicate;
+	Head.ParamNum = 1;
+	Head.ChannelID = Channel->GetGuid();
+	Head.bAsynchronous = true;
+
+	TArray<uint8> Buffer;
+	FSimpleIOStream Stream(Buffer);
+	Stream << Head;
+	Stream << InKey;
+
+	if (uint64 MsgID = Channel->AddMsg(Buffer))
+	{
+		Channel->DispatchProtocol(SP_Replicate, MsgID, 0ll);
+	}
+}
+
+void FSimpleNetReplication::Reset()
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	SendObjects.Empty();
+	RecvObjects.Empty();
+	Stats = FSimpleNetReplicationStats();
+}
+
+FSimpleNetReplicationStats FSimpleNetReplication::GetStats() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	return Stats;
+}
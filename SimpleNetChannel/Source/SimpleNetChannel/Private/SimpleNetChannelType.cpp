@@ -11,16 +11,39 @@ FSimpleConfigInfo::FSimpleConfigInfo()
 	, Port(11223)
 	, RecvDataNumber(10240)
 	, SendDataNumber(1024)
+	, RecvBatchNumber(64)
 	, MaxConnections(2000)
 	, MaxChannels(5)
+	, MsgQueueSize(64)
+	, MsgQueueMaxSize(65536)
 	, RepackagingFrequency(2000)
+	, SlidingWindowSize(32)
 	, NumberThreads(100)
+	, TaskQueueSize(4096)
+	, TaskBatchNumber(16)
+	, ShardNumber(0)
+	, ShardPort(0)
+	, CompressionThreshold(512)
+	, CoalesceMTU(1200)
+	, MaxPackageSize(64 * 1024 * 1024)
+	, CacheArenaSize(4 * 1024 * 1024)
+	, ImpairmentBandwidth(0)
+	, ImpairmentSeed(0)
 	, bPrintHeartBeat(false)
 	, bSlidingWindow(true)
 	, bRepackaging(true)
+	, bCompactHeader(false)
+	, bStreamCipher(false)
+	, bCipherAuthentication(false)
+	, bCompression(false)
+	, bCoalesce(false)
+	, bCongestionControl(false)
+	, bImpairment(false)
 	, bShowCompletePackProtocolInfo(false)
 	, bShowSendDebug(false)
 	, RepackagingTime(3.f)
+	, MinRepackagingTime(0.2f)
+	, MaxRepackagingTime(10.f)
 	, OutTimeLink(360)
 	, HeartBeatTimeTnterval(30.f)
 	, PublicIP(TEXT("127.0.0.1"))
@@ -28,6 +51,14 @@ FSimpleConfigInfo::FSimpleConfigInfo()
 	OutTimeSynchronizationTime = 5.f;
 
 	PingMaxOutTime = 2.f;
+	CoalesceLatency = 0.005f;
+	InterestCellSize = 2000.f;
+	StatsDumpInterval = 0.f;
+	ImpairmentLoss = 0.f;
+	ImpairmentDuplicate = 0.f;
+	ImpairmentReorder = 0.f;
+	ImpairmentDelay = 0.f;
+	ImpairmentJitter = 0.f;
 	PortRange = FIntVector2(Port, ++Port);
 }
 
@@ -35,6 +66,7 @@ FSimplePackageHead::FSimplePackageHead()
 	:Protocol(0)
 	,PackageIndex(0)
 	,PackageSize(0)
+	,AckBits(0)
 	,bAck(false)
 	,bForceSend(false)
 	,PackageID(FGuid::NewGuid())
@@ -47,6 +79,7 @@ FSimpleBunchHead::FSimpleBunchHead()
 	:ProtocolsNumber(0)
 	,ParamNum(0)
 	,bAsynchronous(true)
+	,Flags(BUNCH_NONE)
 {
 	FGuid A = FGuid::NewGuid();
 	Tag = A.A + A.B - A.C + A.D;
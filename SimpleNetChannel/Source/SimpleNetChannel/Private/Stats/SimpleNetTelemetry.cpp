@@ -0,0 +1,232 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Stats/SimpleNetTelemetry.h"
+#include "Log/SimpleNetChannelLog.h"
+
+FSimpleNetTrafficStats& FSimpleNetTrafficStats::operator+=(const FSimpleNetTrafficStats& InStats)
+{
+	BytesIn += InStats.BytesIn;
+	PacketsIn += InStats.PacketsIn;
+	BytesOut += InStats.BytesOut;
+	PacketsOut += InStats.PacketsOut;
+
+	return *this;
+}
+
+FSimpleNetConnetionStats::FSimpleNetConnetionStats()
+	:SlotIndex(INDEX_NONE)
+	, RetransmitNum(0)
+	, SRTT(0.0)
+	, ReassemblyNum(0)
+	, ReassemblyTime(0.0)
+	, ReassemblyMaxTime(0.0)
+	, QueueDepth(0)
+{
+	FMemory::Memzero(RTTHistogram);
+}
+
+void FSimpleNetStatsSnapshot::Dump() const
+{
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("[Stats] Connetions=%i In=%llu/%lluB Out=%llu/%lluB"),
+		Connetions.Num(),
+		Total.PacketsIn, Total.BytesIn,
+		Total.PacketsOut, Total.BytesOut);
+
+	for (const FSimpleNetConnetionStats& Tmp : Connetions)
+	{
+		FString Histogram;
+		for (int32 i = 0; i < SimpleNetRTTBucketNum; i++)
+		{
+			Histogram += FString::Printf(i == 0 ? TEXT("%u") : TEXT(",%u"), Tmp.RTTHistogram[i]);
+		}
+
+		UE_LOG(LogSimpleNetChannel, Display, TEXT("[Stats] Slot=%i %s In=%llu/%lluB Out=%llu/%lluB Retransmit=%llu SRTT=%.1fms RTT=[%s] Reassembly=%llu Avg=%.1fms Max=%.1fms Queue=%lld"),
+			Tmp.SlotIndex,
+			*Tmp.Addr,
+			Tmp.Traffic.PacketsIn, Tmp.Traffic.BytesIn,
+			Tmp.Traffic.PacketsOut, Tmp.Traffic.BytesOut,
+			Tmp.RetransmitNum,
+			Tmp.SRTT * 1000.0,
+			*Histogram,
+			Tmp.ReassemblyNum,
+			Tmp.ReassemblyNum > 0 ? Tmp.ReassemblyTime * 1000.0 / Tmp.ReassemblyNum : 0.0,
+			Tmp.ReassemblyMaxTime * 1000.0,
+			Tmp.QueueDepth);
+	}
+
+	for (const FSimpleNetProtocolStats& Tmp : Protocols)
+	{
+		UE_LOG(LogSimpleNetChannel, Display, TEXT("[Stats] Protocol=%u In=%llu/%lluB Out=%llu/%lluB"),
+			Tmp.ProtocolsNumber,
+			Tmp.Traffic.PacketsIn, Tmp.Traffic.BytesIn,
+			Tmp.Traffic.PacketsOut, Tmp.Traffic.BytesOut);
+	}
+}
+
+void FSimpleNetTrafficCounter::GetStats(FSimpleNetTrafficStats& OutStats) const
+{
+	OutStats.BytesIn = BytesIn.GetValue();
+	OutStats.PacketsIn = PacketsIn.GetValue();
+	OutStats.BytesOut = BytesOut.GetValue();
+	OutStats.PacketsOut = PacketsOut.GetValue();
+}
+
+void FSimpleNetTrafficCounter::Reset()
+{
+	BytesIn.Reset();
+	PacketsIn.Reset();
+	BytesOut.Reset();
+	PacketsOut.Reset();
+}
+
+FSimpleNetConnetionTelemetry::FSimpleNetConnetionTelemetry()
+	:ReassemblyMaxTime(0)
+{
+}
+
+void FSimpleNetConnetionTelemetry::OnRTTSample(double InRTT)
+{
+	int32 Milliseconds = FMath::Max(FMath::FloorToInt(InRTT * 1000.0), 0);
+
+	int32 Bucket = Milliseconds == 0 ? 0 : (int32)FMath::FloorLog2((uint32)Milliseconds) + 1;
+	RTTHistogram[FMath::Min(Bucket, SimpleNetRTTBucketNum - 1)].Increment();
+}
+
+void FSimpleNetConnetionTelemetry::OnReassembly(double InSeconds)
+{
+	int64 Microseconds = FMath::Max((int64)(InSeconds * 1000000.0), (int64)0);
+
+	ReassemblyNum.Increment();
+	ReassemblyTime.Add(Microseconds);
+
+	//只有变大时才写 多数情况下只读一次
+	int64 MaxTime = FPlatformAtomics::AtomicRead(&ReassemblyMaxTime);
+	while (Microseconds > MaxTime)
+	{
+		int64 OldMaxTime = FPlatformAtomics::InterlockedCompareExchange(&ReassemblyMaxTime, Microseconds, MaxTime);
+		if (OldMaxTime == MaxTime)
+		{
+			break;
+		}
+
+		MaxTime = OldMaxTime;
+	}
+}
+
+void FSimpleNetConnetionTelemetry::GetStats(FSimpleNetConnetionStats& OutStats) const
+{
+	Traffic.GetStats(OutStats.Traffic);
+
+	for (int32 i = 0; i < SimpleNetRTTBucketNum; i++)
+	{
+		OutStats.RTTHistogram[i] = (uint32)RTTHistogram[i].GetValue();
+	}
+
+	OutStats.ReassemblyNum = ReassemblyNum.GetValue();
+	OutStats.ReassemblyTime = ReassemblyTime.GetValue() / 1000000.0;
+	OutStats.ReassemblyMaxTime = FPlatformAtomics::AtomicRead(&ReassemblyMaxTime) / 1000000.0;
+}
+
+void FSimpleNetConnetionTelemetry::Reset()
+{
+	Traffic.Reset();
+
+	for (FThreadSafeCounter& Tmp : RTTHistogram)
+	{
+		Tmp.Reset();
+	}
+
+	ReassemblyNum.Reset();
+	ReassemblyTime.Reset();
+	FPlatformAtomics::InterlockedExchange(&ReassemblyMaxTime, 0);
+}
+
+FSimpleNetProtocolTelemetry::FSimpleNetProtocolTelemetry()
+{
+	FMemory::Memzero((void*)Keys, sizeof(Keys));
+}
+
+FSimpleNetTrafficCounter& FSimpleNetProtocolTelemetry::FindOrAdd(uint32 InProtocolsNumber)
+{
+	int32 Key = (int32)(InProtocolsNumber + 1);
+	if (Key == 0)
+	{
+		return Overflow;
+	}
+
+	uint32 Hash = InProtocolsNumber * 0x9E3779B1u;
+	for (int32 i = 0; i < SlotNum; i++)
+	{
+		int32 Index = (Hash + i) & (SlotNum - 1);
+
+		int32 SlotKey = Keys[Index];
+		if (SlotKey == 0)
+		{
+			//别的线程可能同时占用这个槽 失败的话看看占用的是不是同一个协议
+			SlotKey = FPlatformAtomics::InterlockedCompareExchange(&Keys[Index], Key, 0);
+			if (SlotKey == 0)
+			{
+				return Counters[Index];
+			}
+		}
+
+		if (SlotKey == Key)
+		{
+			return Counters[Index];
+		}
+	}
+
+	return Overflow;
+}
+
+void FSimpleNetProtocolTelemetry::OnRecv(uint32 InProtocolsNumber, int32 InBytes)
+{
+	FindOrAdd(InProtocolsNumber).OnRecv(InBytes);
+}
+
+void FSimpleNetProtocolTelemetry::OnSend(uint32 InProtocolsNumber, int32 InBytes)
+{
+	FindOrAdd(InProtocolsNumber).OnSend(InBytes);
+}
+
+void FSimpleNetProtocolTelemetry::GetStats(TArray<FSimpleNetProtocolStats>& OutStats) const
+{
+	auto AddStats = [&](uint32 InProtocolsNumber, const FSimpleNetTrafficCounter& InCounter)
+	{
+		FSimpleNetTrafficStats Traffic;
+		InCounter.GetStats(Traffic);
+
+		if (Traffic.PacketsIn > 0 || Traffic.PacketsOut > 0)
+		{
+			FSimpleNetProtocolStats& Stats = OutStats.AddDefaulted_GetRef();
+			Stats.ProtocolsNumber = InProtocolsNumber;
+			Stats.Traffic = Traffic;
+		}
+	};
+
+	for (int32 i = 0; i < SlotNum; i++)
+	{
+		if (int32 Key = Keys[i])
+		{
+			AddStats((uint32)Key - 1, Counters[i]);
+		}
+	}
+
+	AddStats(MAX_uint32, Overflow);
+
+	OutStats.Sort([](const FSimpleNetProtocolStats& A, const FSimpleNetProtocolStats& B)
+	{
+		return A.ProtocolsNumber < B.ProtocolsNumber;
+	});
+}
+
+void FSimpleNetProtocolTelemetry::Reset()
+{
+	//只清计数 协议号留着 同一个管理器里协议号基本不变
+	for (FSimpleNetTrafficCounter& Tmp : Counters)
+	{
+		Tmp.Reset();
+	}
+
+	Overflow.Reset();
+}
@@ -10,23 +10,62 @@
 
 FSimpleIOStream::FSimpleIOStream(TArray<uint8>& InBuffer)
 :Buffer(InBuffer)
-, Ptr(InBuffer.GetData())
+, Pos(0)
+, bReadError(false)
 {}
 
-void FSimpleIOStream::Wirte(void* InData, int64 InLength)
+void FSimpleIOStream::Wirte(const void* InData, int64 InLength)
 {
-	int32 StartPos = Buffer.AddUninitialized(InLength);
-	FMemory::Memcpy(&Buffer[StartPos], InData, InLength);
+	Buffer.Append((const uint8*)InData, InLength);
 }
 
-void FSimpleIOStream::Seek(int32 InPos)
+bool FSimpleIOStream::CanRead(int64 InLength)
+{
+	if (bReadError)
+	{
+		return false;
+	}
+
+	if (InLength < 0 || Pos < 0 || InLength > (int64)Buffer.Num() - Pos)
+	{
+		bReadError = true;
+		PrintMsg(FString::Printf(TEXT("Read out of range. Pos = %i Length = %lld Num = %i"), Pos, InLength, Buffer.Num()));
+
+		return false;
+	}
+
+	return true;
+}
+
+bool FSimpleIOStream::CheckNum(int32 InNum, int64 InElementSize)
 {
-	if (!Ptr)
+	if (bReadError)
+	{
+		return false;
+	}
+
+	if (InNum < 0)
 	{
-		Ptr = Buffer.GetData();
+		bReadError = true;
+		PrintMsg(FString::Printf(TEXT("Invalid element num = %i"), InNum));
+
+		return false;
 	}
 
-	Ptr += InPos;
+	return InNum > 0 && CanRead(InElementSize * InNum);
+}
+
+void FSimpleIOStream::Seek(int32 InPos)
+{
+	Pos += InPos;
+}
+
+void FSimpleIOStream::Reserve(int32 InSize)
+{
+	if (InSize > 0)
+	{
+		Buffer.Reserve(Buffer.Num() + InSize);
+	}
 }
 
 FSimpleIOStream& FSimpleIOStream::operator<<(FString& InValue)
@@ -77,20 +116,19 @@ FSimpleIOStream& FSimpleIOStream::operator>>(FString& InValue)
 
 uint8* FSimpleIOStream::Begin()
 {
-	Ptr = Buffer.GetData();
-	return Ptr;
+	Pos = 0;
+	return Buffer.GetData();
 }
 
 uint8* FSimpleIOStream::End()
 {
-	Begin();
-	Ptr += Buffer.Num();
-	return Ptr;
+	Pos = Buffer.Num();
+	return Buffer.GetData() + Pos;
 }
 
 uint8* FSimpleIOStream::Tall()
 {
-	return Ptr;
+	return Buffer.GetData() + Pos;
 }
 
 void FSimpleIOStream::PrintMsg(const FString& InString)
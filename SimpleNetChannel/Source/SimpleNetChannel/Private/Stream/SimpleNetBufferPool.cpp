@@ -0,0 +1,96 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Stream/SimpleNetBufferPool.h"
+
+namespace SimpleNetBufferPool
+{
+	//容量分级 256B 1K 4K 16K 64K
+	const int32 SizeClass[] = { 256, 1024, 4096, 16384, 65536 };
+	const int32 SizeClassNum = UE_ARRAY_COUNT(SizeClass);
+
+	//每一级最多缓存多少个
+	const int32 MaxPooledPerClass = 16;
+
+	struct FThreadPool
+	{
+		TArray<TArray<uint8>> Buckets[SizeClassNum];
+	};
+
+	static FThreadPool& GetThreadPool()
+	{
+		static thread_local FThreadPool ThreadPool;
+		return ThreadPool;
+	}
+}
+
+TArray<uint8> FSimpleNetBufferPool::Acquire(int32 InSize)
+{
+	using namespace SimpleNetBufferPool;
+
+	//接收时缓冲会被收到的数据替换 不需要从池里取
+	if (InSize <= 0)
+	{
+		return TArray<uint8>();
+	}
+
+	for (int32 i = 0; i < SizeClassNum; i++)
+	{
+		if (InSize <= SizeClass[i])
+		{
+			TArray<TArray<uint8>>& Bucket = GetThreadPool().Buckets[i];
+			if (Bucket.Num() > 0)
+			{
+				return Bucket.Pop(false);
+			}
+
+			TArray<uint8> Buffer;
+			Buffer.Reserve(SizeClass[i]);
+			return Buffer;
+		}
+	}
+
+	//超过最大分级的不缓存
+	TArray<uint8> Buffer;
+	Buffer.Reserve(InSize);
+	return Buffer;
+}
+
+void FSimpleNetBufferPool::Release(TArray<uint8>& InBuffer)
+{
+	using namespace SimpleNetBufferPool;
+
+	//数据可能已经被移走了(例如直接作为发送数据) 也可能换成了收到的大包
+	int32 Capacity = InBuffer.Max();
+	if (Capacity < SizeClass[0] || Capacity > SizeClass[SizeClassNum - 1] * 2)
+	{
+		return;
+	}
+
+	for (int32 i = SizeClassNum - 1; i >= 0; i--)
+	{
+		if (Capacity >= SizeClass[i])
+		{
+			TArray<TArray<uint8>>& Bucket = GetThreadPool().Buckets[i];
+			if (Bucket.Num() < MaxPooledPerClass)
+			{
+				InBuffer.Reset();
+				Bucket.Add(MoveTemp(InBuffer));
+			}
+
+			return;
+		}
+	}
+}
+
+int32 FSimpleNetBufferPool::GetPooledNum()
+{
+	using namespace SimpleNetBufferPool;
+
+	int32 Num = 0;
+	for (int32 i = 0; i < SizeClassNum; i++)
+	{
+		Num += GetThreadPool().Buckets[i].Num();
+	}
+
+	return Num;
+}
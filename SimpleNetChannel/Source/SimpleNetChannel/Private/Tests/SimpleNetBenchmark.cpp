@@ -0,0 +1,255 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Tests/SimpleNetBenchmark.h"
+#include "Log/SimpleNetChannelLog.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "SimpleNetManage.h"
+#include "Async/TaskGraphInterfaces.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+double SimpleNetBenchmark::Measure(TFunctionRef<void()> InFunc, double InMinTime)
+{
+	//先执行一次 让缓存和池子准备好
+	InFunc();
+
+	//每轮次数翻倍 计时本身的开销可以忽略
+	int64 Num = 0;
+	double Elapsed = 0.0;
+	double StartTime = FPlatformTime::Seconds();
+	for (int64 BatchNum = 1; Elapsed < InMinTime; BatchNum *= 2)
+	{
+		for (int64 i = 0; i < BatchNum; i++)
+		{
+			InFunc();
+		}
+
+		Num += BatchNum;
+		Elapsed = FPlatformTime::Seconds() - StartTime;
+	}
+
+	return Elapsed / Num;
+}
+
+void SimpleNetBenchmark::Report(FAutomationTestBase& InTest, const FString& InLine)
+{
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("[Bench] %s"), *InLine);
+
+	InTest.AddInfo(InLine);
+}
+
+uint64 SimpleNetBenchmark::GetRecvNum(FSimpleNetManage* InManage, uint32 InProtocolsNumber)
+{
+	TArray<FSimpleNetProtocolStats> Protocols;
+	InManage->GetProtocolTelemetry().GetStats(Protocols);
+
+	for (const FSimpleNetProtocolStats& Tmp : Protocols)
+	{
+		if (Tmp.ProtocolsNumber == InProtocolsNumber)
+		{
+			return Tmp.Traffic.PacketsIn;
+		}
+	}
+
+	return 0;
+}
+
+SimpleNetBenchmark::FScopedConfig::FScopedConfig()
+	:Info(FSimpleNetGlobalInfo::Get()->GetInfo())
+	, Origin(FSimpleNetGlobalInfo::Get()->GetInfo())
+{
+}
+
+SimpleNetBenchmark::FScopedConfig::~FScopedConfig()
+{
+	FSimpleNetGlobalInfo::Get()->SetInfo(Origin);
+}
+
+void SimpleNetBenchmark::FScopedConfig::Apply()
+{
+	FSimpleNetGlobalInfo::Get()->SetInfo(Info);
+}
+
+SimpleNetBenchmark::FLoopback::FLoopback()
+	:Server(nullptr)
+	, LastTime(0.0)
+{
+}
+
+SimpleNetBenchmark::FLoopback::~FLoopback()
+{
+	Stop();
+}
+
+bool SimpleNetBenchmark::FLoopback::Start(const FSimpleNetLoadConfig& InConfig, bool bServerThread)
+{
+	return StartServer(InConfig, bServerThread) && Generator.Start(Config);
+}
+
+bool SimpleNetBenchmark::FLoopback::StartReplay(const FSimpleNetLoadConfig& InConfig, const FSimpleNetTrafficCapture* InCapture)
+{
+	return StartServer(InConfig, true) && Generator.StartReplay(Config, InCapture);
+}
+
+bool SimpleNetBenchmark::FLoopback::StartServer(const FSimpleNetLoadConfig& InConfig, bool bServerThread)
+{
+	check(InConfig.IP.IsEmpty());
+
+	Config = InConfig;
+	if (Config.Port == 0)
+	{
+		Config.Port = FSimpleNetGlobalInfo::Get()->GetInfo().Port;
+	}
+
+	Server = FSimpleNetManage::CreateManage(ESimpleNetLinkState::LINKSTATE_LISTEN, Config.SocketType, Config.bHighConcurrency);
+	if (!Server)
+	{
+		return false;
+	}
+
+	//服务器的接收放到网络线程 不受驱动客户端的帧率限制
+	Server->SetAllowSynchronization(bServerThread);
+
+	if (!Server->Init(Config.Port))
+	{
+		UE_LOG(LogSimpleNetChannel, Error, TEXT("[Bench] Unable to listen on port %i."), Config.Port);
+
+		FSimpleNetManage::Destroy(Server);
+		Server = nullptr;
+		return false;
+	}
+
+	LastTime = FPlatformTime::Seconds();
+
+	return true;
+}
+
+bool SimpleNetBenchmark::FLoopback::Tick()
+{
+	if (!Server)
+	{
+		return false;
+	}
+
+	double CurrentTime = FPlatformTime::Seconds();
+	float DeltaSeconds = (float)(CurrentTime - LastTime);
+	LastTime = CurrentTime;
+
+	//服务器网络线程收到的链接 对象要到主线程创建 测试一直占着主线程 每帧处理一次
+	if (IsInGameThread())
+	{
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+	}
+
+	Server->Tick(DeltaSeconds);
+	bool bRunning = Generator.Tick(DeltaSeconds);
+
+	//一帧大约1毫秒 客户端按速率补发 不会因为帧率丢消息
+	FPlatformProcess::Sleep(0.001f);
+
+	return bRunning;
+}
+
+bool SimpleNetBenchmark::FLoopback::WaitUntil(TFunctionRef<bool()> InFunc, double InTimeout)
+{
+	double EndTime = FPlatformTime::Seconds() + InTimeout;
+	while (!InFunc())
+	{
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			return false;
+		}
+
+		Tick();
+	}
+
+	return true;
+}
+
+bool SimpleNetBenchmark::FLoopback::WaitJoin(double InTimeout)
+{
+	return WaitUntil([&]()
+	{
+		for (int32 i = 0; i < Config.ClientNum; i++)
+		{
+			if (!GetClientChannel(i))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}, InTimeout);
+}
+
+FSimpleNetLoadReport SimpleNetBenchmark::FLoopback::Stop()
+{
+	FSimpleNetLoadReport Report;
+	if (Generator.IsRunning())
+	{
+		Report = Generator.Stop();
+	}
+
+	if (Server)
+	{
+		FSimpleNetManage::Destroy(Server);
+		Server = nullptr;
+	}
+
+	return Report;
+}
+
+FSimpleChannel* SimpleNetBenchmark::FLoopback::GetClientChannel(int32 InIndex) const
+{
+	TArray<FSimpleNetManage*>* Clients = FSimpleNetManage::GetClients(Config.GroupID);
+	if (!Clients || !Clients->IsValidIndex(InIndex))
+	{
+		return nullptr;
+	}
+
+	FSimpleNetManage* Client = (*Clients)[InIndex];
+
+	USimpleController* Controller = Client->GetController();
+	if (!Controller || !Controller->GetConnetion() ||
+		Controller->GetConnetion()->GetState() != ESimpleConnetionLinkType::LINK_JOIN)
+	{
+		return nullptr;
+	}
+
+	return Client->GetChannel();
+}
+
+FSimpleNetTrafficStats SimpleNetBenchmark::FLoopback::GetServerTraffic() const
+{
+	FSimpleNetStatsSnapshot Snapshot;
+	if (Server)
+	{
+		Server->GetStats(Snapshot);
+	}
+
+	return Snapshot.Total;
+}
+
+void SimpleNetBenchmark::FLoopback::GetServerAddrs(TArray<TSharedPtr<FInternetAddr>>& OutAddrs) const
+{
+	if (!Server)
+	{
+		return;
+	}
+
+	FSimpleNetStatsSnapshot Snapshot;
+	Server->GetStats(Snapshot);
+
+	//统计里的地址是IP:Port
+	for (const FSimpleNetConnetionStats& Tmp : Snapshot.Connetions)
+	{
+		FString IP;
+		FString Port;
+		if (Tmp.SlotIndex != INDEX_NONE && Tmp.Addr.Split(TEXT(":"), &IP, &Port, ESearchCase::IgnoreCase, ESearchDir::FromEnd))
+		{
+			OutAddrs.Add(FSimpleNetManage::GetInternetAddr(FSimpleNetManage::GetSimpleAddr(*IP, FCString::Atoi(*Port))));
+		}
+	}
+}
+
+#endif
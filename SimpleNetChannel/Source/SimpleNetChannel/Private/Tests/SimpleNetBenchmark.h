@@ -0,0 +1,99 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Load/SimpleNetLoadGenerator.h"
+#include "Protocols/SimpleNetProtocols.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//正确性测试 每次提交都可以跑
+#define SIMPLE_NET_TEST_FLAGS (EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+//基准测试 只在性能分类里运行 结果只打印不做判断
+#define SIMPLE_NET_BENCHMARK_FLAGS (EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+//基准测试的负载 服务器收到后只计数
+DEFINITION_SIMPLE_PROTOCOLS(BenchPayload, 1100)
+
+//基准测试共用
+namespace SimpleNetBenchmark
+{
+	//重复执行InFunc 至少InMinTime秒 返回每次的平均秒数
+	double Measure(TFunctionRef<void()> InFunc, double InMinTime = 0.2);
+
+	//打印一行结果 同时写到自动化测试的日志里
+	void Report(FAutomationTestBase& InTest, const FString& InLine);
+
+	//管理器按协议号收到的消息数
+	uint64 GetRecvNum(FSimpleNetManage* InManage, uint32 InProtocolsNumber);
+
+	//临时修改配置 析构时恢复原来的
+	//修改Info后调用Apply 只对之后创建的管理器生效
+	class FScopedConfig
+	{
+	public:
+		FScopedConfig();
+		~FScopedConfig();
+
+		void Apply();
+
+		FSimpleConfigInfo Info;
+
+	private:
+		FSimpleConfigInfo Origin;
+	};
+
+	//本机回环 在进程内开一个服务器 再用FSimpleNetLoadGenerator按配置连接本机
+	//客户端由调用的线程驱动 服务器可以选择用自己的网络线程接收
+	class FLoopback
+	{
+	public:
+		FLoopback();
+		~FLoopback();
+
+		//InConfig.Port为0时使用配置里的端口 IP必须为空
+		//InConfig.bHighConcurrency同时用于服务器和客户端
+		bool Start(const FSimpleNetLoadConfig& InConfig, bool bServerThread = true);
+
+		//回放录制的流量 InCapture在回放期间必须有效
+		bool StartReplay(const FSimpleNetLoadConfig& InConfig, const FSimpleNetTrafficCapture* InCapture);
+
+		//按真实经过的时间驱动一帧 到了Duration返回false
+		bool Tick();
+
+		//一直驱动到InFunc返回true 超时返回false
+		bool WaitUntil(TFunctionRef<bool()> InFunc, double InTimeout);
+
+		//等所有客户端加入
+		bool WaitJoin(double InTimeout = 10.0);
+
+		//断开客户端 关闭服务器 返回客户端的统计
+		FSimpleNetLoadReport Stop();
+
+		FSimpleNetManage* GetServer() const { return Server; }
+		FSimpleNetLoadGenerator& GetGenerator() { return Generator; }
+
+		//第InIndex个客户端的主通道 还没有加入返回空
+		FSimpleChannel* GetClientChannel(int32 InIndex) const;
+
+		//服务器本机链接和所有远端链接的统计
+		FSimpleNetTrafficStats GetServerTraffic() const;
+
+		//服务器这边看到的已加入客户端的地址
+		void GetServerAddrs(TArray<TSharedPtr<FInternetAddr>>& OutAddrs) const;
+
+	protected:
+		bool StartServer(const FSimpleNetLoadConfig& InConfig, bool bServerThread);
+
+	protected:
+		FSimpleNetManage* Server;
+		FSimpleNetLoadGenerator Generator;
+		FSimpleNetLoadConfig Config;
+		double LastTime;
+	};
+}
+
+#endif
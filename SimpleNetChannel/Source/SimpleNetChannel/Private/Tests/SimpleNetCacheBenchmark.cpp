@@ -0,0 +1,180 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Cache/SimpleNetCacheManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//大消息切成很多小分片 分片乱序到达
+//原来的写法是每来一片追加到数组后面 和现在按整包大小从缓冲池取 按位置直接写入对比
+//分配次数用数组容量的变化来数 缓冲池的用它自己的统计
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetCacheBenchmark, "SimpleNetChannel.Benchmark.Cache", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetCacheBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 ChunkSize = 1024;
+	const int32 MessageSizes[] = { 16 * 1024, 256 * 1024, 1024 * 1024 };
+
+	for (int32 MessageSize : MessageSizes)
+	{
+		FRandomStream Random(MessageSize);
+
+		TArray<uint8> Message;
+		Message.SetNumUninitialized(MessageSize);
+		for (auto& Tmp : Message)
+		{
+			Tmp = (uint8)Random.RandHelper(256);
+		}
+
+		const int32 ChunkNum = (MessageSize + ChunkSize - 1) / ChunkSize;
+
+		//乱序到达的顺序
+		TArray<int32> Order;
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			Order.Add(i);
+		}
+
+		for (int32 i = ChunkNum - 1; i > 0; i--)
+		{
+			Order.Swap(i, Random.RandRange(0, i));
+		}
+
+		//原来的写法 只能按顺序追加
+		int64 AppendAllocNum = 0;
+		int64 AppendNum = 0;
+		double AppendTime = SimpleNetBenchmark::Measure([&]()
+		{
+			TArray<uint8> Cache;
+			for (int32 i = 0; i < ChunkNum; i++)
+			{
+				int32 Max = Cache.Max();
+
+				int32 Offset = i * ChunkSize;
+				Cache.Append(&Message[Offset], FMath::Min(ChunkSize, MessageSize - Offset));
+
+				if (Cache.Max() != Max)
+				{
+					AppendAllocNum++;
+				}
+			}
+
+			AppendNum++;
+		});
+
+		FSimpleNetCacheManage CacheManage;
+		FGuid Guid = FGuid::NewGuid();
+
+		bool bComplete = true;
+		int64 PooledNum = 0;
+		double PooledTime = SimpleNetBenchmark::Measure([&]()
+		{
+			FSimpleNetCacheManage::FCache* Cache = CacheManage.Create(Guid, MessageSize, ChunkSize);
+			if (!Cache)
+			{
+				bComplete = false;
+				return;
+			}
+
+			for (int32 Index : Order)
+			{
+				int32 Offset = Index * ChunkSize;
+				Cache->Write(Index, &Message[Offset], FMath::Min(ChunkSize, MessageSize - Offset));
+			}
+
+			bComplete &= Cache->IsComplete();
+
+			CacheManage.Remove(Guid);
+			PooledNum++;
+		});
+
+		//最后一次的内容要和原包一样
+		{
+			FSimpleNetCacheManage::FCache* Cache = CacheManage.Create(Guid, MessageSize, ChunkSize);
+			for (int32 Index : Order)
+			{
+				int32 Offset = Index * ChunkSize;
+				Cache->Write(Index, &Message[Offset], FMath::Min(ChunkSize, MessageSize - Offset));
+			}
+
+			bComplete &= Cache->IsComplete() && FMemory::Memcmp(Cache->Cache.GetData(), Message.GetData(), MessageSize) == 0;
+			CacheManage.Remove(Guid);
+		}
+
+		if (!bComplete)
+		{
+			AddError(FString::Printf(TEXT("%iKB message was not reassembled."), MessageSize / 1024));
+			return false;
+		}
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Cache message=%iKB chunks=%i append=%.1fus (%.0fMB/s) allocs/message=%.2f pooled=%.1fus (%.0fMB/s) allocs/message=%.4f reuse=%llu"),
+			MessageSize / 1024, ChunkNum,
+			AppendTime * 1e6, MessageSize / AppendTime / (1024.0 * 1024.0),
+			AppendNum > 0 ? (double)AppendAllocNum / AppendNum : 0.0,
+			PooledTime * 1e6, MessageSize / PooledTime / (1024.0 * 1024.0),
+			PooledNum > 0 ? (double)CacheManage.GetAllocateNum() / PooledNum : 0.0,
+			CacheManage.GetReuseNum()));
+	}
+
+	//本机回环 分片模式下发大消息 看整条路径上合包的吞吐
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bRepackaging = true;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 1;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		FSimpleChannel* Channel = Loopback.GetClientChannel(0);
+		if (!Channel)
+		{
+			AddError(TEXT("Loopback client disconnected."));
+			return false;
+		}
+
+		const int32 MessageSize = 1024 * 1024;
+		const int32 MessageNum = 20;
+
+		TArray<uint8> Payload;
+		Payload.Init(7, MessageSize);
+
+		uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+		double StartTime = FPlatformTime::Seconds();
+
+		for (int32 i = 0; i < MessageNum; i++)
+		{
+			SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Payload);
+		}
+
+		bool bRecv = Loopback.WaitUntil([&]()
+		{
+			return SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) >= RecvNum + MessageNum;
+		}, 120.0);
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		if (!bRecv)
+		{
+			AddError(FString::Printf(TEXT("%i messages were not delivered within 120 seconds."), MessageNum));
+			return false;
+		}
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Cache loopback message=%iKB messages=%i time=%.2fs throughput=%.1fMB/s"),
+			MessageSize / 1024, MessageNum, Seconds,
+			(double)MessageSize * MessageNum / Seconds / (1024.0 * 1024.0)));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,127 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Channel/SimpleNetChannelTable.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//按通道ID找槽位 每收到一个协议都要找一次
+//原来的做法是逐个比较通道数组里的GUID 和现在的开放寻址表对比 找得到和找不到的都测
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetChannelTableBenchmark, "SimpleNetChannel.Benchmark.ChannelTable", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetChannelTableBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 LookupNum = 1000;
+	const int32 ChannelNums[] = { 8, 32, 128, 512 };
+
+	for (int32 ChannelNum : ChannelNums)
+	{
+		FRandomStream Random(ChannelNum);
+
+		TArray<FGuid> IDs;
+		FSimpleNetChannelTable Table;
+		Table.Reserve(ChannelNum);
+
+		for (int32 i = 0; i < ChannelNum; i++)
+		{
+			FGuid& ID = IDs.Add_GetRef(FGuid::NewGuid());
+			Table.Add(ID, i);
+		}
+
+		//中间关掉一半再打开 探测链上的元素要还能找到
+		for (int32 i = 0; i < ChannelNum; i += 2)
+		{
+			Table.Remove(IDs[i]);
+		}
+
+		for (int32 i = 0; i < ChannelNum; i += 2)
+		{
+			IDs[i] = FGuid::NewGuid();
+			Table.Add(IDs[i], i);
+		}
+
+		int32 WrongNum = 0;
+		for (int32 i = 0; i < ChannelNum; i++)
+		{
+			if (Table.Find(IDs[i]) != i)
+			{
+				WrongNum++;
+			}
+		}
+
+		TArray<FGuid> Hits;
+		TArray<FGuid> Misses;
+		for (int32 i = 0; i < LookupNum; i++)
+		{
+			Hits.Add(IDs[Random.RandHelper(ChannelNum)]);
+			Misses.Add(FGuid::NewGuid());
+		}
+
+		for (const FGuid& Tmp : Misses)
+		{
+			if (Table.Find(Tmp) != INDEX_NONE)
+			{
+				WrongNum++;
+			}
+		}
+
+		//结果累加起来 查找不会被优化掉
+		int32 FoundNum = 0;
+		auto FindLinear = [&](const FGuid& InID)
+		{
+			for (int32 i = 0; i < IDs.Num(); i++)
+			{
+				if (IDs[i] == InID)
+				{
+					return i;
+				}
+			}
+
+			return (int32)INDEX_NONE;
+		};
+
+		double LinearHitTime = SimpleNetBenchmark::Measure([&]()
+		{
+			for (const FGuid& Tmp : Hits)
+			{
+				FoundNum += FindLinear(Tmp) != INDEX_NONE;
+			}
+		});
+
+		double LinearMissTime = SimpleNetBenchmark::Measure([&]()
+		{
+			for (const FGuid& Tmp : Misses)
+			{
+				FoundNum += FindLinear(Tmp) != INDEX_NONE;
+			}
+		});
+
+		double TableHitTime = SimpleNetBenchmark::Measure([&]()
+		{
+			for (const FGuid& Tmp : Hits)
+			{
+				FoundNum += Table.Find(Tmp) != INDEX_NONE;
+			}
+		});
+
+		double TableMissTime = SimpleNetBenchmark::Measure([&]()
+		{
+			for (const FGuid& Tmp : Misses)
+			{
+				FoundNum += Table.Find(Tmp) != INDEX_NONE;
+			}
+		});
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("ChannelTable channels=%i linear hit=%.1fns miss=%.1fns table hit=%.1fns miss=%.1fns"),
+			ChannelNum,
+			LinearHitTime * 1e9 / LookupNum, LinearMissTime * 1e9 / LookupNum,
+			TableHitTime * 1e9 / LookupNum, TableMissTime * 1e9 / LookupNum));
+
+		TestEqual(TEXT("Wrong lookups"), WrongNum, 0);
+	}
+
+	return true;
+}
+
+#endif
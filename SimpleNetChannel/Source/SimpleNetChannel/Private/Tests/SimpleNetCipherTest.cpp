@@ -0,0 +1,219 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Core/EncryptionAndDecryption/SimpleStreamCipher.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetCipherTest
+{
+	//RFC 8439 2.4.2和2.8.2共用的明文 114字节
+	const char Sunscreen[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+	const int32 SunscreenLen = sizeof(Sunscreen) - 1;
+
+	static TArray<uint8> FromHex(const TCHAR* InHex)
+	{
+		TArray<uint8> Bytes;
+		Bytes.SetNumZeroed(FCString::Strlen(InHex) / 2);
+		Bytes.SetNum(HexToBytes(InHex, Bytes.GetData()));
+
+		return Bytes;
+	}
+
+	static TArray<uint8> GetSunscreen()
+	{
+		TArray<uint8> Bytes;
+		Bytes.Append((const uint8*)Sunscreen, SunscreenLen);
+
+		return Bytes;
+	}
+
+	//00 01 02 ... 1f
+	static TArray<uint8> GetSequenceKey(uint8 InStart)
+	{
+		TArray<uint8> Key;
+		for (int32 i = 0; i < SimpleStreamCipher::KeySize; i++)
+		{
+			Key.Add((uint8)(InStart + i));
+		}
+
+		return Key;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetChaCha20Test, "SimpleNetChannel.Cipher.ChaCha20", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetChaCha20Test::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetCipherTest;
+
+	TArray<uint8> Key = GetSequenceKey(0x00);
+
+	//2.3.2 块函数 计数1 明文全0时密文就是密钥流
+	{
+		TArray<uint8> Nonce = FromHex(TEXT("000000090000004a00000000"));
+		TArray<uint8> Expected = FromHex(
+			TEXT("10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e")
+			TEXT("d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e"));
+
+		TArray<uint8> Data;
+		Data.SetNumZeroed(64);
+		SimpleStreamCipher::Xor(Key.GetData(), Nonce.GetData(), 1, Data.GetData(), Data.Num());
+
+		TestTrue(TEXT("RFC 8439 2.3.2 block"), Data == Expected);
+	}
+
+	//2.4.2 加密 超过一个块 支持向量指令的平台会走4块并行
+	TArray<uint8> Nonce = FromHex(TEXT("000000000000004a00000000"));
+	TArray<uint8> Expected = FromHex(
+		TEXT("6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b")
+		TEXT("f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8")
+		TEXT("07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736")
+		TEXT("5af90bbf74a35be6b40b8eedf2785e42874d"));
+	{
+		TArray<uint8> Data = GetSunscreen();
+		SimpleStreamCipher::Xor(Key.GetData(), Nonce.GetData(), 1, Data.GetData(), Data.Num());
+
+		TestTrue(TEXT("RFC 8439 2.4.2 encryption"), Data == Expected);
+
+		SimpleStreamCipher::Xor(Key.GetData(), Nonce.GetData(), 1, Data.GetData(), Data.Num());
+		TestTrue(TEXT("Decryption restores the plaintext"), Data == GetSunscreen());
+	}
+
+	//按块拆开 每段都走标量 和一次加密的结果一样
+	{
+		TArray<uint8> Data = GetSunscreen();
+		SimpleStreamCipher::Xor(Key.GetData(), Nonce.GetData(), 1, Data.GetData(), 64);
+		SimpleStreamCipher::Xor(Key.GetData(), Nonce.GetData(), 2, Data.GetData() + 64, Data.Num() - 64);
+
+		TestTrue(TEXT("Split at the block boundary"), Data == Expected);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetPoly1305Test, "SimpleNetChannel.Cipher.Poly1305", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetPoly1305Test::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetCipherTest;
+
+	//2.5.2
+	TArray<uint8> Key = FromHex(TEXT("85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b"));
+	TArray<uint8> Expected = FromHex(TEXT("a8061dc1305136c6c22b8baf0c0127a9"));
+
+	const char Message[] = "Cryptographic Forum Research Group";
+
+	uint8 Tag[SimpleStreamCipher::TagSize];
+	SimpleStreamCipher::Poly1305(Key.GetData(), (const uint8*)Message, sizeof(Message) - 1, Tag);
+
+	TestTrue(TEXT("RFC 8439 2.5.2 tag"), FMemory::Memcmp(Tag, Expected.GetData(), SimpleStreamCipher::TagSize) == 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetAEADTest, "SimpleNetChannel.Cipher.AEAD", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetAEADTest::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetCipherTest;
+
+	//2.8.2
+	TArray<uint8> Key = GetSequenceKey(0x80);
+	TArray<uint8> Nonce = FromHex(TEXT("070000004041424344454647"));
+	TArray<uint8> AAD = FromHex(TEXT("50515253c0c1c2c3c4c5c6c7"));
+	TArray<uint8> ExpectedCipherText = FromHex(
+		TEXT("d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6")
+		TEXT("3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36")
+		TEXT("92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc")
+		TEXT("3ff4def08e4b7a9de576d26586cec64b6116"));
+	TArray<uint8> ExpectedTag = FromHex(TEXT("1ae10b594f09e26a7e902ecbd0600691"));
+
+	TArray<uint8> Data = GetSunscreen();
+	uint8 Tag[SimpleStreamCipher::TagSize];
+	SimpleStreamCipher::Seal(Key.GetData(), Nonce.GetData(), AAD.GetData(), AAD.Num(), Data.GetData(), Data.Num(), Tag);
+
+	TestTrue(TEXT("RFC 8439 2.8.2 ciphertext"), Data == ExpectedCipherText);
+	TestTrue(TEXT("RFC 8439 2.8.2 tag"), FMemory::Memcmp(Tag, ExpectedTag.GetData(), SimpleStreamCipher::TagSize) == 0);
+
+	//改动密文或者附加数据都不能通过 失败时不解密
+	{
+		TArray<uint8> Tampered = Data;
+		Tampered[10] ^= 0x01;
+		TestFalse(TEXT("Tampered ciphertext is rejected"), SimpleStreamCipher::Open(Key.GetData(), Nonce.GetData(), AAD.GetData(), AAD.Num(), Tampered.GetData(), Tampered.Num(), Tag));
+
+		Tampered[10] ^= 0x01;
+		TestTrue(TEXT("Rejected ciphertext is left untouched"), Tampered == Data);
+	}
+
+	{
+		TArray<uint8> TamperedAAD = AAD;
+		TamperedAAD[0] ^= 0x80;
+
+		TArray<uint8> Copy = Data;
+		TestFalse(TEXT("Tampered AAD is rejected"), SimpleStreamCipher::Open(Key.GetData(), Nonce.GetData(), TamperedAAD.GetData(), TamperedAAD.Num(), Copy.GetData(), Copy.Num(), Tag));
+	}
+
+	TestTrue(TEXT("Open"), SimpleStreamCipher::Open(Key.GetData(), Nonce.GetData(), AAD.GetData(), AAD.Num(), Data.GetData(), Data.Num(), Tag));
+	TestTrue(TEXT("Open restores the plaintext"), Data == GetSunscreen());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetCipherBenchmark, "SimpleNetChannel.Benchmark.Cipher", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetCipherBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetCipherTest;
+
+	TArray<uint8> Key = GetSequenceKey(0x00);
+	TArray<uint8> Nonce = FromHex(TEXT("000000000000004a00000000"));
+
+	//原来的加密 每个字节和密钥字符串序列化后的每个字节异或
+	TArray<uint8> SecretKey = GetSequenceKey(0x20);
+	SecretKey.SetNum(16);
+
+	const int32 Sizes[] = { 32, 256, 1400 };
+	for (int32 Size : Sizes)
+	{
+		TArray<uint8> Data;
+		Data.SetNumZeroed(Size);
+		uint8 Tag[SimpleStreamCipher::TagSize];
+
+		double Original = SimpleNetBenchmark::Measure([&]()
+		{
+			for (auto& Tmp : Data)
+			{
+				for (auto& TmpSecretKey : SecretKey)
+				{
+					Tmp ^= TmpSecretKey;
+				}
+			}
+		});
+
+		double Folded = SimpleNetBenchmark::Measure([&]()
+		{
+			SimpleStreamCipher::XorByte(Data.GetData(), Data.Num(), 0x5A);
+		});
+
+		double Stream = SimpleNetBenchmark::Measure([&]()
+		{
+			SimpleStreamCipher::Xor(Key.GetData(), Nonce.GetData(), 1, Data.GetData(), Data.Num());
+		});
+
+		double Authenticated = SimpleNetBenchmark::Measure([&]()
+		{
+			SimpleStreamCipher::Seal(Key.GetData(), Nonce.GetData(), Nonce.GetData(), Nonce.Num(), Data.GetData(), Data.Num(), Tag);
+		});
+
+		auto GetGBs = [Size](double InSeconds)
+		{
+			return Size / InSeconds / (1024.0 * 1024.0 * 1024.0);
+		};
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Cipher %4iB Original=%.2fGB/s Folded=%.2fGB/s ChaCha20=%.2fGB/s ChaCha20-Poly1305=%.2fGB/s"),
+			Size, GetGBs(Original), GetGBs(Folded), GetGBs(Stream), GetGBs(Authenticated)));
+	}
+
+	return true;
+}
+
+#endif
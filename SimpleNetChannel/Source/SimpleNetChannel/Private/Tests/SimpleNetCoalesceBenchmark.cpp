@@ -0,0 +1,78 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//本机回环 每个客户端每帧连着发20条小的状态更新 每秒30帧
+//对比每条消息一个数据报和合并成MTU大小的数据报 线上的包数和字节数都按服务器收到的算
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetCoalesceBenchmark, "SimpleNetChannel.Benchmark.Coalesce", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetCoalesceBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 UpdateNum = 20;
+
+	const bool bCoalesces[] = { false, true };
+	for (bool bCoalesce : bCoalesces)
+	{
+		//合并发送需要紧凑包头 紧凑包头需要滑动窗口
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bSlidingWindow = true;
+		ScopedConfig.Info.bCompactHeader = bCoalesce;
+		ScopedConfig.Info.bCoalesce = bCoalesce;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 16;
+		Config.SendRate = 30.f;
+		Config.PingRate = 0.f;
+		Config.Duration = 5.f;
+
+		FSimpleNetLoadAction& Action = Config.Actions.AddDefaulted_GetRef();
+		Action.Name = TEXT("Frame");
+		Action.Send = [UpdateNum](FSimpleChannel* Channel)
+		{
+			for (int32 i = 0; i < UpdateNum; i++)
+			{
+				int32 ID = i;
+				FVector Location(100.f * i, 200.f, 300.f);
+				SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, ID, Location);
+			}
+		};
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback clients failed to join."));
+			return false;
+		}
+
+		uint64 StartRecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+		FSimpleNetTrafficStats StartTraffic = Loopback.GetServerTraffic();
+		double StartTime = FPlatformTime::Seconds();
+
+		while (Loopback.Tick())
+		{
+		}
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) - StartRecvNum;
+		FSimpleNetTrafficStats EndTraffic = Loopback.GetServerTraffic();
+		FSimpleNetLoadReport Report = Loopback.Stop();
+
+		uint64 PacketsIn = EndTraffic.PacketsIn - StartTraffic.PacketsIn;
+		uint64 BytesIn = EndTraffic.BytesIn - StartTraffic.BytesIn;
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Coalesce coalesce=%i updates/frame=%i messages=%.0f/s packets=%.0f/s bytes=%.0f/s packets/message=%.3f bytes/message=%.1f CPU=%.1f%%"),
+			bCoalesce ? 1 : 0, UpdateNum,
+			RecvNum / Seconds, PacketsIn / Seconds, BytesIn / Seconds,
+			RecvNum > 0 ? (double)PacketsIn / RecvNum : 0.0,
+			RecvNum > 0 ? (double)BytesIn / RecvNum : 0.0,
+			Report.CPUAverage));
+	}
+
+	return true;
+}
+
+#endif
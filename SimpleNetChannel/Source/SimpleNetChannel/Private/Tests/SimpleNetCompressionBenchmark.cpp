@@ -0,0 +1,216 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Stream/SimpleIOStream.h"
+#include "Global/SimpleNetGlobalInfo.h"
+#include "Core/Compression/SimpleNetCompression.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetCompressionBenchmark
+{
+	struct FPayload
+	{
+		FString Name;
+		TArray<uint8> Data;
+	};
+
+	void AddText(TArray<FPayload>& OutPayloads, const TCHAR* InName, const FString& InText)
+	{
+		FTCHARToUTF8 UTF8(*InText);
+
+		FPayload& Payload = OutPayloads.AddDefaulted_GetRef();
+		Payload.Name = InName;
+		Payload.Data.Append((const uint8*)UTF8.Get(), UTF8.Length());
+	}
+
+	//和MMORPGCommon里的格式一样 插件不依赖它 这里按同样的字段拼出来
+	void BuildPayloads(TArray<FPayload>& OutPayloads)
+	{
+		FRandomStream Random(0);
+
+		//角色列表 CharacterAppearacnceToString的JSON 四个槽位
+		{
+			FString Text = TEXT("[");
+			for (int32 i = 0; i < 4; i++)
+			{
+				Text += FString::Printf(
+					TEXT("%s{\"Name\":\"Player_%04i\",\"Date\":\"2021-08-%02i 12:%02i:00\",\"Lv\":%i,\"SlotPosition\":%i,")
+					TEXT("\"LegSize\":%.6f,\"WaistSize\":%.6f,\"ArmSize\":%.6f,\"HeadSize\":%.6f,\"ChestSize\":%.6f}"),
+					i > 0 ? TEXT(",") : TEXT(""),
+					Random.RandRange(0, 9999), Random.RandRange(1, 28), Random.RandRange(0, 59),
+					Random.RandRange(1, 60), i,
+					Random.FRand(), Random.FRand(), Random.FRand(), Random.FRand(), Random.FRand());
+			}
+			Text += TEXT("]");
+
+			AddText(OutPayloads, TEXT("CharacterList"), Text);
+		}
+
+		//背包 200个格子 物品ID 数量 耐久
+		{
+			FString Text = TEXT("[");
+			for (int32 i = 0; i < 200; i++)
+			{
+				Text += FString::Printf(TEXT("%s{\"Slot\":%i,\"ItemID\":%i,\"Count\":%i,\"Durability\":%i}"),
+					i > 0 ? TEXT(",") : TEXT(""),
+					i, 10000 + Random.RandRange(0, 300), Random.RandRange(1, 99), Random.RandRange(0, 100));
+			}
+			Text += TEXT("]");
+
+			AddText(OutPayloads, TEXT("Inventory"), Text);
+		}
+
+		//聊天记录 最近100条
+		{
+			const TCHAR* Words[] = { TEXT("boss"), TEXT("team"), TEXT("anyone"), TEXT("need"), TEXT("heal"),
+				TEXT("dungeon"), TEXT("trade"), TEXT("sword"), TEXT("gold"), TEXT("ready"), TEXT("go") };
+
+			FString Text;
+			for (int32 i = 0; i < 100; i++)
+			{
+				Text += FString::Printf(TEXT("[12:%02i] Player_%04i: "), i % 60, Random.RandRange(0, 50));
+				for (int32 j = Random.RandRange(3, 10); j > 0; j--)
+				{
+					Text += Words[Random.RandRange(0, UE_ARRAY_COUNT(Words) - 1)];
+					Text += TEXT(" ");
+				}
+				Text += TEXT("\n");
+			}
+
+			AddText(OutPayloads, TEXT("ChatHistory"), Text);
+		}
+
+		//压不动的数据 检查不会变大
+		{
+			FPayload& Payload = OutPayloads.AddDefaulted_GetRef();
+			Payload.Name = TEXT("Random");
+			Payload.Data.SetNumUninitialized(4096);
+			for (auto& Tmp : Payload.Data)
+			{
+				Tmp = (uint8)Random.RandHelper(256);
+			}
+		}
+	}
+}
+
+//代表性的大消息 先单独测压缩和还原 再在本机回环上对比关闭和开启压缩时线上的字节数和收完的时间
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetCompressionBenchmark, "SimpleNetChannel.Benchmark.Compression", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetCompressionBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetCompressionBenchmark;
+
+	TArray<FPayload> Payloads;
+	BuildPayloads(Payloads);
+
+	const int32 Threshold = FSimpleNetGlobalInfo::Get()->GetInfo().CompressionThreshold;
+
+	for (FPayload& Payload : Payloads)
+	{
+		//和发送时一样 [FSimpleBunchHead][包体]
+		TArray<uint8> Bunch;
+		{
+			FSimpleIOStream Stream(Bunch);
+			FSimpleBunchHead Head;
+			Stream << Head;
+			Stream << Payload.Data;
+		}
+
+		TArray<uint8> Compressed = Bunch;
+		bool bCompressed = SimpleNetCompression::Compress(Compressed, Threshold);
+
+		TArray<uint8> Restored;
+		if (bCompressed)
+		{
+			int32 RestoredNum = SimpleNetCompression::Decompress(Compressed.GetData(), Compressed.Num(), Restored);
+			if (RestoredNum != Bunch.Num() || FMemory::Memcmp(Restored.GetData() + sizeof(FSimpleBunchHead), Bunch.GetData() + sizeof(FSimpleBunchHead), Bunch.Num() - sizeof(FSimpleBunchHead)) != 0)
+			{
+				AddError(FString::Printf(TEXT("%s did not round trip."), *Payload.Name));
+				return false;
+			}
+		}
+
+		TArray<uint8> Scratch;
+		double CompressTime = SimpleNetBenchmark::Measure([&]()
+		{
+			Scratch = Bunch;
+			SimpleNetCompression::Compress(Scratch, Threshold);
+		});
+
+		double DecompressTime = bCompressed ? SimpleNetBenchmark::Measure([&]()
+		{
+			SimpleNetCompression::Decompress(Compressed.GetData(), Compressed.Num(), Restored);
+		}) : 0.0;
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Compression %s bytes=%i compressed=%i ratio=%.2f compress=%.1fus decompress=%.1fus"),
+			*Payload.Name, Bunch.Num(), Compressed.Num(), (double)Compressed.Num() / Bunch.Num(),
+			CompressTime * 1e6, DecompressTime * 1e6));
+	}
+
+	//每种消息发50条 等服务器全部收到
+	const int32 SendNum = 50;
+
+	const bool bCompressions[] = { false, true };
+	for (bool bCompression : bCompressions)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bCompression = bCompression;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 1;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		for (FPayload& Payload : Payloads)
+		{
+			FSimpleChannel* Channel = Loopback.GetClientChannel(0);
+			if (!Channel)
+			{
+				AddError(TEXT("Loopback client disconnected."));
+				return false;
+			}
+
+			uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+			uint64 BytesIn = Loopback.GetServerTraffic().BytesIn;
+			double StartTime = FPlatformTime::Seconds();
+
+			for (int32 i = 0; i < SendNum; i++)
+			{
+				SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Payload.Data);
+			}
+
+			bool bRecv = Loopback.WaitUntil([&]()
+			{
+				return SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) >= RecvNum + SendNum;
+			}, 60.0);
+
+			double Seconds = FPlatformTime::Seconds() - StartTime;
+			if (!bRecv)
+			{
+				AddError(FString::Printf(TEXT("%s was not delivered within 60 seconds."), *Payload.Name));
+				return false;
+			}
+
+			uint64 WireBytes = Loopback.GetServerTraffic().BytesIn - BytesIn;
+
+			SimpleNetBenchmark::Report(*this, FString::Printf(
+				TEXT("Compression compression=%i %s payload=%iB wire bytes/message=%.0f time=%.1fms"),
+				bCompression ? 1 : 0, *Payload.Name, Payload.Data.Num(),
+				(double)WireBytes / SendNum, Seconds * 1000.0));
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,99 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "SimpleNetManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//本机回环 损伤层模拟一条有延迟 丢包和带宽上限的链路
+//客户端一次发出一批大消息 比较关闭和开启拥塞控制时的有效吞吐和重传比例
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetCongestionBenchmark, "SimpleNetChannel.Benchmark.Congestion", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetCongestionBenchmark::RunTest(const FString& Parameters)
+{
+	const float Delay = 0.03f;
+	const float Loss = 0.01f;
+	const int32 Bandwidth = 1024 * 1024;
+	const int32 MessageSize = 64 * 1024;
+	const int32 MessageNum = 32;
+
+	const bool bCongestionControls[] = { false, true };
+	for (bool bCongestionControl : bCongestionControls)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bCongestionControl = bCongestionControl;
+		ScopedConfig.Info.bSlidingWindow = true;
+		ScopedConfig.Info.bRepackaging = true;
+		ScopedConfig.Info.bImpairment = true;
+		ScopedConfig.Info.ImpairmentDelay = Delay;
+		ScopedConfig.Info.ImpairmentLoss = Loss;
+		ScopedConfig.Info.ImpairmentBandwidth = Bandwidth;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 1;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		FSimpleChannel* Channel = Loopback.GetClientChannel(0);
+		FSimpleNetManage* Client = (*FSimpleNetManage::GetClients(Config.GroupID))[0];
+
+		//随机内容 不会被压缩
+		FRandomStream Random(0);
+		TArray<uint8> Payload;
+		Payload.SetNumUninitialized(MessageSize);
+		for (auto& Tmp : Payload)
+		{
+			Tmp = (uint8)Random.RandHelper(256);
+		}
+
+		uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+		double StartTime = FPlatformTime::Seconds();
+
+		//一次全部交给发送路径 相当于切换场景时的突发
+		for (int32 i = 0; i < MessageNum; i++)
+		{
+			SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Payload);
+		}
+
+		bool bRecv = Loopback.WaitUntil([&]()
+		{
+			return SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) >= RecvNum + MessageNum;
+		}, 300.0);
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		if (!bRecv)
+		{
+			AddError(FString::Printf(TEXT("%i messages were not delivered within 300 seconds."), MessageNum));
+			return false;
+		}
+
+		FSimpleNetStatsSnapshot Snapshot;
+		Client->GetStats(Snapshot);
+
+		uint64 RetransmitNum = 0;
+		for (const FSimpleNetConnetionStats& Tmp : Snapshot.Connetions)
+		{
+			RetransmitNum += Tmp.RetransmitNum;
+		}
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Congestion control=%i RTT=%.0fms loss=%.1f%% bandwidth=%iKB/s data=%iKB time=%.2fs goodput=%.1fKB/s packets=%llu retransmit=%llu (%.1f%%)"),
+			bCongestionControl ? 1 : 0, Delay * 2000.f, Loss * 100.f, Bandwidth / 1024,
+			MessageSize * MessageNum / 1024, Seconds,
+			(double)MessageSize * MessageNum / Seconds / 1024.0,
+			Snapshot.Total.PacketsOut, RetransmitNum,
+			Snapshot.Total.PacketsOut > 0 ? RetransmitNum * 100.0 / Snapshot.Total.PacketsOut : 0.0));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,104 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "SimpleNetManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//按地址找链接的开销 MaxConnections从100到50000 索引查找应该基本不变
+//线性查找模拟原来的遍历 和同样数量的地址逐个比较
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetConnetionLookupBenchmark, "SimpleNetChannel.Benchmark.ConnetionLookup", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetConnetionLookupBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 MaxConnections[] = { 100, 1000, 5000, 50000 };
+	for (int32 MaxConnection : MaxConnections)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.MaxConnections = MaxConnection;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 4;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback clients failed to join."));
+			return false;
+		}
+
+		FSimpleNetManage* Server = Loopback.GetServer();
+
+		TArray<TSharedPtr<FInternetAddr>> Addrs;
+		Loopback.GetServerAddrs(Addrs);
+
+		if (Addrs.Num() != Config.ClientNum)
+		{
+			AddError(FString::Printf(TEXT("Expected %i joined connections, found %i."), Config.ClientNum, Addrs.Num()));
+			return false;
+		}
+
+		for (auto& Tmp : Addrs)
+		{
+			if (!Server->FindConnetion(Tmp).IsValid())
+			{
+				AddError(FString::Printf(TEXT("Connetion %s was not found."), *Tmp->ToString(true)));
+				return false;
+			}
+		}
+
+		//没有这个链接的地址 原来的遍历要走完整个数组
+		TSharedPtr<FInternetAddr> MissAddr = FSimpleNetManage::GetInternetAddr(FSimpleNetManage::GetSimpleAddr(TEXT("127.0.0.1"), 1));
+
+		int32 FoundNum = 0;
+		int32 Index = 0;
+		double HitTime = SimpleNetBenchmark::Measure([&]()
+		{
+			FoundNum += Server->FindConnetion(Addrs[Index++ % Addrs.Num()]).IsValid();
+		});
+
+		double MissTime = SimpleNetBenchmark::Measure([&]()
+		{
+			FoundNum += Server->FindConnetion(MissAddr).IsValid();
+		});
+
+		double NumTime = SimpleNetBenchmark::Measure([&]()
+		{
+			FoundNum += Server->GetConnetionNum();
+		});
+
+		Loopback.Stop();
+
+		//原来的做法 预分配的每个槽位都比较一次地址
+		TArray<TSharedPtr<FInternetAddr>> SlotAddrs;
+		SlotAddrs.Reserve(MaxConnection);
+		for (int32 i = 0; i < MaxConnection; i++)
+		{
+			SlotAddrs.Add(FSimpleNetManage::GetInternetAddr(FSimpleNetManage::GetSimpleAddr(TEXT("10.0.0.1"), 1024 + i)));
+		}
+
+		double ScanTime = SimpleNetBenchmark::Measure([&]()
+		{
+			for (auto& Tmp : SlotAddrs)
+			{
+				if (FSimpleNetManage::AddrEquation(Tmp, MissAddr))
+				{
+					FoundNum++;
+					break;
+				}
+			}
+		});
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("ConnetionLookup MaxConnections=%i hit=%.1fns miss=%.1fns GetConnetionNum=%.1fns linear scan=%.1fns"),
+			MaxConnection,
+			HitTime * 1e9, MissTime * 1e9, NumTime * 1e9, ScanTime * 1e9));
+	}
+
+	return true;
+}
+
+#endif
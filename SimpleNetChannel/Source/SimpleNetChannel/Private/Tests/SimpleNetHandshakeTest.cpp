@@ -0,0 +1,124 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetHandshakeTest
+{
+	//开着改变数据报格式的特性登录 再发一段消息确认服务器能解析
+	//丢包时挑战协议和它的确认会重发 切换前后新旧格式的数据报混在一起
+	bool RunJoin(FAutomationTestBase& InTest, const TCHAR* InName, bool bHighConcurrency, float InLoss)
+	{
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 4;
+		Config.SendRate = 20.f;
+		Config.PingRate = 0.f;
+		Config.Duration = 2.f;
+		Config.bHighConcurrency = bHighConcurrency;
+
+		FSimpleNetLoadAction& Action = Config.Actions.AddDefaulted_GetRef();
+		Action.Name = TEXT("Move");
+		Action.Send = [](FSimpleChannel* Channel)
+		{
+			FVector Location(100.f, 200.f, 300.f);
+			SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Location);
+		};
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin(20.0))
+		{
+			InTest.AddError(FString::Printf(TEXT("%s highconcurrency=%i loss=%.2f: clients failed to join."),
+				InName, bHighConcurrency ? 1 : 0, InLoss));
+			return false;
+		}
+
+		while (Loopback.Tick())
+		{
+		}
+
+		uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+		FSimpleNetLoadReport Report = Loopback.Stop();
+
+		SimpleNetBenchmark::Report(InTest, FString::Printf(
+			TEXT("Handshake %s highconcurrency=%i loss=%.2f joined=%i sent=%llu received=%llu"),
+			InName, bHighConcurrency ? 1 : 0, InLoss, Report.JoinNum, Report.SendNum, RecvNum));
+
+		return InTest.TestTrue(TEXT("Server received messages after the wire format switch"), RecvNum > 0);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetHandshakeCompactTest, "SimpleNetChannel.Handshake.CompactHeader", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetHandshakeCompactTest::RunTest(const FString& Parameters)
+{
+	const bool bHighConcurrencys[] = { false, true };
+	const float Losses[] = { 0.f, 0.2f };
+
+	bool bResult = true;
+	for (bool bHighConcurrency : bHighConcurrencys)
+	{
+		for (float Loss : Losses)
+		{
+			SimpleNetBenchmark::FScopedConfig ScopedConfig;
+			ScopedConfig.Info.bSlidingWindow = true;
+			ScopedConfig.Info.bCompactHeader = true;
+			ScopedConfig.Info.bCoalesce = true;
+			ScopedConfig.Info.bCompression = true;
+			ScopedConfig.Info.bRepackaging = true;
+			ScopedConfig.Info.RepackagingTime = 0.1f;
+			ScopedConfig.Info.bImpairment = Loss > 0.f;
+			ScopedConfig.Info.ImpairmentLoss = Loss;
+			ScopedConfig.Apply();
+
+			bResult &= SimpleNetHandshakeTest::RunJoin(*this, TEXT("compact"), bHighConcurrency, Loss);
+		}
+	}
+
+	return bResult;
+}
+
+//流加密加上紧凑包头 有没有认证码都要能登录
+//不用滑动窗口时没有紧凑包头 只靠通道头分辨没有认证码的包
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetHandshakeStreamCipherTest, "SimpleNetChannel.Handshake.StreamCipher", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetHandshakeStreamCipherTest::RunTest(const FString& Parameters)
+{
+	struct FCase
+	{
+		const TCHAR* Name;
+		bool bSlidingWindow;
+		bool bCipherAuthentication;
+		float Loss;
+	};
+
+	const FCase Cases[] =
+	{
+		{ TEXT("stream+auth+compact"), true, true, 0.2f },
+		{ TEXT("stream+compact"), true, false, 0.2f },
+		{ TEXT("stream+auth"), false, true, 0.f },
+		{ TEXT("stream"), false, false, 0.f },
+	};
+
+	bool bResult = true;
+	for (const FCase& Case : Cases)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.SecretKey = TEXT("SimpleNetHandshakeTest");
+		ScopedConfig.Info.bStreamCipher = true;
+		ScopedConfig.Info.bCipherAuthentication = Case.bCipherAuthentication;
+		ScopedConfig.Info.bSlidingWindow = Case.bSlidingWindow;
+		ScopedConfig.Info.bCompactHeader = Case.bSlidingWindow;
+		ScopedConfig.Info.bCoalesce = false;
+		ScopedConfig.Info.bRepackaging = true;
+		ScopedConfig.Info.RepackagingTime = 0.1f;
+		ScopedConfig.Info.bImpairment = Case.Loss > 0.f;
+		ScopedConfig.Info.ImpairmentLoss = Case.Loss;
+		ScopedConfig.Apply();
+
+		bResult &= SimpleNetHandshakeTest::RunJoin(*this, Case.Name, false, Case.Loss);
+	}
+
+	return bResult;
+}
+
+#endif
@@ -0,0 +1,142 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Interest/SimpleNetInterestGrid.h"
+#include "Algo/Sort.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//5000个玩家在400米见方的地图上随机走动 每帧500个范围事件
+//每帧先把所有玩家的新位置更新到网格 再对每个事件查询范围内的玩家
+//对照是MulticastByPredicate的做法 每个事件遍历所有玩家比较距离
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetInterestBenchmark, "SimpleNetChannel.Benchmark.Interest", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetInterestBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 PlayerNum = 5000;
+	const int32 EventNum = 500;
+	const int32 TickNum = 50;
+	const float FrameRate = 20.f;
+	const float WorldSize = 40000.f;
+	const float Speed = 600.f;
+	const float Radiuses[] = { 1000.f, 3000.f, 10000.f };
+
+	//网格只拿通道指针当键 不会解引用 用一段内存里不同的地址代替真实的通道
+	TArray<uint8> ChannelKeys;
+	ChannelKeys.SetNumZeroed(PlayerNum);
+
+	TArray<FSimpleChannel*> Channels;
+	for (int32 i = 0; i < PlayerNum; i++)
+	{
+		Channels.Add(reinterpret_cast<FSimpleChannel*>(&ChannelKeys[i]));
+	}
+
+	for (float Radius : Radiuses)
+	{
+		FRandomStream Random(0);
+
+		TArray<FVector> Positions;
+		TArray<FVector> Velocities;
+		for (int32 i = 0; i < PlayerNum; i++)
+		{
+			Positions.Add(FVector(Random.FRandRange(0.f, WorldSize), Random.FRandRange(0.f, WorldSize), 0.f));
+			Velocities.Add(FRotator(0.f, Random.FRandRange(0.f, 360.f), 0.f).Vector() * Speed);
+		}
+
+		FSimpleNetInterestGrid Grid;
+		for (int32 i = 0; i < PlayerNum; i++)
+		{
+			Grid.Update(Channels[i], Positions[i]);
+		}
+
+		double UpdateTime = 0.0;
+		double QueryTime = 0.0;
+		double ScanTime = 0.0;
+		uint64 RecipientNum = 0;
+		int32 MismatchNum = 0;
+
+		TArray<FSimpleChannel*> Recipients;
+		TArray<FSimpleChannel*> ScanRecipients;
+		TArray<FVector> Events;
+
+		for (int32 Tick = 0; Tick < TickNum; Tick++)
+		{
+			//到了边界掉头 偶尔换个方向
+			for (int32 i = 0; i < PlayerNum; i++)
+			{
+				if (Random.FRand() < 0.02f)
+				{
+					Velocities[i] = FRotator(0.f, Random.FRandRange(0.f, 360.f), 0.f).Vector() * Speed;
+				}
+
+				FVector NewPosition = Positions[i] + Velocities[i] / FrameRate;
+				if (NewPosition.X < 0.f || NewPosition.X > WorldSize || NewPosition.Y < 0.f || NewPosition.Y > WorldSize)
+				{
+					Velocities[i] = -Velocities[i];
+					NewPosition = Positions[i] + Velocities[i] / FrameRate;
+				}
+
+				Positions[i] = NewPosition;
+			}
+
+			//事件发生在随机玩家的位置上
+			Events.Reset();
+			for (int32 i = 0; i < EventNum; i++)
+			{
+				Events.Add(Positions[Random.RandHelper(PlayerNum)]);
+			}
+
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < PlayerNum; i++)
+			{
+				Grid.Update(Channels[i], Positions[i]);
+			}
+			UpdateTime += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			for (const FVector& Event : Events)
+			{
+				Recipients.Reset();
+				Grid.Query(Event, Radius, Recipients);
+				RecipientNum += Recipients.Num();
+			}
+			QueryTime += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			float RadiusSquared = Radius * Radius;
+			for (const FVector& Event : Events)
+			{
+				ScanRecipients.Reset();
+				for (int32 i = 0; i < PlayerNum; i++)
+				{
+					if (FVector::DistSquaredXY(Positions[i], Event) <= RadiusSquared)
+					{
+						ScanRecipients.Add(Channels[i]);
+					}
+				}
+			}
+			ScanTime += FPlatformTime::Seconds() - StartTime;
+
+			//最后一个事件两边的结果要一样 TArray::Sort会解引用指针 这里按地址排
+			Algo::Sort(Recipients);
+			Algo::Sort(ScanRecipients);
+			if (Recipients != ScanRecipients)
+			{
+				MismatchNum++;
+			}
+		}
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Interest players=%i events/tick=%i radius=%.0f recipients/event=%.1f update=%.3fms/tick query=%.3fms/tick scan=%.3fms/tick speedup=%.1fx"),
+			PlayerNum, EventNum, Radius,
+			(double)RecipientNum / ((double)TickNum * EventNum),
+			UpdateTime * 1000.0 / TickNum, QueryTime * 1000.0 / TickNum, ScanTime * 1000.0 / TickNum,
+			UpdateTime + QueryTime > 0.0 ? ScanTime / (UpdateTime + QueryTime) : 0.0));
+
+		TestEqual(TEXT("Ticks where the grid and the scan disagree"), MismatchNum, 0);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//登录潮 所有客户端同时连接 主线程每帧额外占用FrameTime 模拟很重的游戏帧
+//服务器用自己的网络线程接收 统计服务器每秒接受的链接数
+//已经加入的客户端一直Ping 服务器在网络线程直接回应 网络线程被主线程卡住时延迟会跟着帧时间涨
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetLoginStormBenchmark, "SimpleNetChannel.Benchmark.LoginStorm", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetLoginStormBenchmark::RunTest(const FString& Parameters)
+{
+	const float HoldTime = 3.f;
+	const int32 ClientNums[] = { 100, 500 };
+	const float FrameTimes[] = { 0.f, 0.033f };
+
+	for (int32 ClientNum : ClientNums)
+	{
+		for (float FrameTime : FrameTimes)
+		{
+			SimpleNetBenchmark::FScopedConfig ScopedConfig;
+			ScopedConfig.Info.MaxConnections = FMath::Max(ScopedConfig.Info.MaxConnections, ClientNum);
+			ScopedConfig.Apply();
+
+			FSimpleNetLoadConfig Config;
+			Config.ClientNum = ClientNum;
+			Config.SendRate = 0.f;
+			Config.PingRate = 5.f;
+			Config.bHighConcurrency = true;
+
+			SimpleNetBenchmark::FLoopback Loopback;
+
+			//每帧先做完游戏逻辑再驱动网络
+			auto TickFrame = [&]()
+			{
+				if (FrameTime > 0.f)
+				{
+					FPlatformProcess::Sleep(FrameTime);
+				}
+
+				Loopback.Tick();
+			};
+
+			double StartTime = FPlatformTime::Seconds();
+			if (!Loopback.Start(Config))
+			{
+				AddError(TEXT("Unable to start the loopback server."));
+				return false;
+			}
+
+			//服务器这边已经接受的链接
+			int32 AcceptNum = 0;
+			double AcceptTime = 0.0;
+			while (FPlatformTime::Seconds() < StartTime + 60.0)
+			{
+				TArray<TSharedPtr<FInternetAddr>> Addrs;
+				Loopback.GetServerAddrs(Addrs);
+
+				if (Addrs.Num() > AcceptNum)
+				{
+					AcceptNum = Addrs.Num();
+					AcceptTime = FPlatformTime::Seconds() - StartTime;
+				}
+
+				if (AcceptNum >= ClientNum)
+				{
+					break;
+				}
+
+				TickFrame();
+			}
+
+			//客户端这边全部加入
+			bool bJoin = false;
+			while (FPlatformTime::Seconds() < StartTime + 60.0)
+			{
+				if (Loopback.GetGenerator().GetReport().JoinNum >= ClientNum)
+				{
+					bJoin = true;
+					break;
+				}
+
+				TickFrame();
+			}
+
+			double JoinTime = FPlatformTime::Seconds() - StartTime;
+
+			double HoldEndTime = FPlatformTime::Seconds() + HoldTime;
+			while (FPlatformTime::Seconds() < HoldEndTime)
+			{
+				TickFrame();
+			}
+
+			FSimpleNetLoadReport Report = Loopback.Stop();
+
+			SimpleNetBenchmark::Report(*this, FString::Printf(
+				TEXT("LoginStorm clients=%i frame=%.0fms accepted=%i accept time=%.2fs accepts/s=%.0f all joined=%i join time=%.2fs ping p50=%.1fms p99=%.1fms max=%.1fms lost=%i"),
+				ClientNum, FrameTime * 1000.f,
+				AcceptNum, AcceptTime, AcceptTime > 0.0 ? AcceptNum / AcceptTime : 0.0,
+				bJoin ? 1 : 0, JoinTime,
+				Report.LatencyP50, Report.LatencyP99, Report.LatencyMax, Report.LostNum));
+		}
+	}
+
+	return true;
+}
+
+#endif
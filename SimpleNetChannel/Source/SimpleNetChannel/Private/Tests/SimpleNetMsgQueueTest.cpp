@@ -0,0 +1,171 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Cache/SimpleNetMsgBatchPackageManage.h"
+#include "Async/Async.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//一百万条小消息 每个通道两个生产者线程同时写入 测试线程按ID依次取出
+//每个生产者的消息必须按写入的顺序取到 一条都不能少
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetMsgQueueTest, "SimpleNetChannel.MsgQueue.Stress", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetMsgQueueTest::RunTest(const FString& Parameters)
+{
+	const int32 ChannelNum = 8;
+	const int32 ProducerNum = 2;
+	const int32 MsgNum = 1000000 / (ChannelNum * ProducerNum);
+
+	TArray<FSimpleNetMsgBatchPackageManage> Queues;
+	Queues.SetNum(ChannelNum);
+
+	double StartTime = FPlatformTime::Seconds();
+
+	//消息内容是生产者编号和它自己的序号
+	TArray<TFuture<void>> Producers;
+	for (int32 i = 0; i < ChannelNum; i++)
+	{
+		for (int32 j = 0; j < ProducerNum; j++)
+		{
+			FSimpleNetMsgBatchPackageManage* Queue = &Queues[i];
+			Producers.Add(Async(EAsyncExecution::Thread, [Queue, j, MsgNum]()
+			{
+				for (int32 Index = 0; Index < MsgNum; Index++)
+				{
+					TArray<uint8> Data;
+					Data.SetNumUninitialized(sizeof(int32) * 2);
+
+					int32* Values = (int32*)Data.GetData();
+					Values[0] = j;
+					Values[1] = Index;
+
+					//到了上限会拒收 等消费者取走一些再写
+					while (Queue->Add(Data) == 0)
+					{
+						FPlatformProcess::Yield();
+					}
+				}
+			}));
+		}
+	}
+
+	//消息ID就是在队列里的位置 从1开始
+	TArray<uint64> NextIDs;
+	NextIDs.Init(1, ChannelNum);
+
+	TArray<int32> NextIndexs;
+	NextIndexs.Init(0, ChannelNum * ProducerNum);
+
+	const int64 TotalNum = (int64)ChannelNum * ProducerNum * MsgNum;
+	int64 ReceivedNum = 0;
+	int64 OutOfOrderNum = 0;
+
+	double Timeout = StartTime + 60.0;
+	while (ReceivedNum < TotalNum && FPlatformTime::Seconds() < Timeout)
+	{
+		bool bIdle = true;
+		for (int32 i = 0; i < ChannelNum; i++)
+		{
+			TArray<uint8> Data;
+
+			Queues[i].SetMsgQueueID(NextIDs[i]);
+			while (Queues[i].Receive(Data))
+			{
+				bIdle = false;
+
+				ReceivedNum++;
+				Queues[i].SetMsgQueueID(++NextIDs[i]);
+
+				const int32* Values = (const int32*)Data.GetData();
+				if (Data.Num() != sizeof(int32) * 2 || Values[0] < 0 || Values[0] >= ProducerNum)
+				{
+					OutOfOrderNum++;
+					continue;
+				}
+
+				int32& NextIndex = NextIndexs[i * ProducerNum + Values[0]];
+				if (Values[1] != NextIndex)
+				{
+					OutOfOrderNum++;
+				}
+
+				NextIndex = Values[1] + 1;
+			}
+		}
+
+		if (bIdle)
+		{
+			FPlatformProcess::Yield();
+		}
+	}
+
+	for (auto& Tmp : Producers)
+	{
+		Tmp.Wait();
+	}
+
+	double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	TestEqual(TEXT("Received messages"), ReceivedNum, TotalNum);
+	TestEqual(TEXT("Out of order messages"), OutOfOrderNum, (int64)0);
+
+	int64 GrownNum = 0;
+	int64 HighWater = 0;
+	for (int32 i = 0; i < ChannelNum; i++)
+	{
+		FSimpleNetMsgQueueStats Stats = Queues[i].GetStats();
+		TestEqual(TEXT("Pushed messages"), Stats.Pushed, (int64)ProducerNum * MsgNum);
+		TestEqual(TEXT("Received messages per channel"), Stats.Received, (int64)ProducerNum * MsgNum);
+		TestEqual(TEXT("Discarded messages"), Stats.Discarded, (int64)0);
+
+		GrownNum += Stats.Grown;
+		HighWater = FMath::Max(HighWater, Stats.HighWater);
+	}
+
+	SimpleNetBenchmark::Report(*this, FString::Printf(
+		TEXT("MsgQueue channels=%i producers=%i messages=%lld time=%.2fs rate=%.0f/s grown=%lld high water=%lld"),
+		ChannelNum, ChannelNum * ProducerNum, ReceivedNum, Seconds, ReceivedNum / Seconds, GrownNum, HighWater));
+
+	return true;
+}
+
+//队列扩到MsgQueueMaxSize后拒收新消息并计数 取走以后又能写入
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetMsgQueueCapTest, "SimpleNetChannel.MsgQueue.Cap", SIMPLE_NET_TEST_FLAGS)
+bool FSimpleNetMsgQueueCapTest::RunTest(const FString& Parameters)
+{
+	SimpleNetBenchmark::FScopedConfig Config;
+	Config.Info.MsgQueueSize = 4;
+	Config.Info.MsgQueueMaxSize = 16;
+	Config.Apply();
+
+	FSimpleNetMsgBatchPackageManage Queue;
+
+	int32 AddedNum = 0;
+	for (int32 i = 0; i < 20; i++)
+	{
+		TArray<uint8> Data;
+		Data.Add((uint8)i);
+
+		if (Queue.Add(Data) != 0)
+		{
+			AddedNum++;
+		}
+	}
+
+	FSimpleNetMsgQueueStats Stats = Queue.GetStats();
+	TestEqual(TEXT("Added messages"), AddedNum, 16);
+	TestEqual(TEXT("Rejected messages"), Stats.Rejected, (int64)4);
+	TestEqual(TEXT("Capacity"), Stats.Capacity, (int64)16);
+
+	TArray<uint8> Data;
+	Queue.SetMsgQueueID(1);
+	TestTrue(TEXT("Receive head"), Queue.Receive(Data));
+
+	Data.Reset();
+	Data.Add(0);
+	TestEqual(TEXT("Add after receive"), (int64)Queue.Add(Data), (int64)17);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,92 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "SimpleNetManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//服务器广播一条世界事件 逐个接收者发送(原来的做法)和包体只序列化一次的MulticastByPredicate对比
+//客户端都在同一个进程里 只测到1000个接收者 更多的接收者需要用独立进程的压测
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetMulticastBenchmark, "SimpleNetChannel.Benchmark.Multicast", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetMulticastBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 RoundNum = 20;
+	const int32 ClientNums[] = { 10, 100, 1000 };
+	for (int32 ClientNum : ClientNums)
+	{
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = ClientNum;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin(60.0))
+		{
+			AddError(FString::Printf(TEXT("%i loopback clients failed to join."), ClientNum));
+			return false;
+		}
+
+		FSimpleNetManage* Server = Loopback.GetServer();
+
+		TArray<FSimpleChannel*> Channels;
+		{
+			TArray<TSharedPtr<FInternetAddr>> Addrs;
+			Loopback.GetServerAddrs(Addrs);
+
+			for (auto& Tmp : Addrs)
+			{
+				if (TSharedPtr<FSimpleConnetion> Connetion = Server->FindConnetion(Tmp))
+				{
+					Channels.Add(Connetion->GetMainChannel());
+				}
+			}
+		}
+
+		//事件名 位置 一段附加数据
+		FString EventName = TEXT("WorldBossSpawned");
+		FVector Location(1000.f, 2000.f, 300.f);
+		TArray<uint8> Extra;
+		Extra.Init(7, 256);
+
+		double SendTime = 0.0;
+		double MulticastTime = 0.0;
+		for (int32 i = 0; i < RoundNum; i++)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			for (FSimpleChannel* Channel : Channels)
+			{
+				SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, EventName, Location, Extra);
+			}
+			SendTime += FPlatformTime::Seconds() - StartTime;
+
+			//让网络线程把这一轮发完 客户端回确认
+			for (int32 j = 0; j < 10; j++)
+			{
+				Loopback.Tick();
+			}
+
+			StartTime = FPlatformTime::Seconds();
+			Server->MulticastByPredicate<SP_BenchPayload, USimpleNetworkObject>(
+				[](USimpleNetworkObject*) { return true; }, EventName, Location, Extra);
+			MulticastTime += FPlatformTime::Seconds() - StartTime;
+
+			for (int32 j = 0; j < 10; j++)
+			{
+				Loopback.Tick();
+			}
+		}
+
+		Loopback.Stop();
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Multicast recipients=%i per-recipient send=%.1fus (%.2fus each) multicast=%.1fus (%.2fus each)"),
+			Channels.Num(),
+			SendTime / RoundNum * 1e6, SendTime / RoundNum / FMath::Max(Channels.Num(), 1) * 1e6,
+			MulticastTime / RoundNum * 1e6, MulticastTime / RoundNum / FMath::Max(Channels.Num(), 1) * 1e6));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,212 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "SimpleNetManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//服务器原样回应 带着客户端发出的时间
+DEFINITION_SIMPLE_PROTOCOLS(BenchPing, 1102)
+
+namespace SimpleNetPriorityBenchmark
+{
+	enum class EMode
+	{
+		Idle,//没有大数据 延迟的下限
+		SamePriority,//两个通道都是NORMAL 和原来一样平分
+		Priority,//主通道HIGH 大数据通道BULK
+	};
+
+	const TCHAR* GetModeName(EMode InMode)
+	{
+		switch (InMode)
+		{
+		case EMode::Idle:
+			return TEXT("idle");
+		case EMode::SamePriority:
+			return TEXT("same priority");
+		default:
+			return TEXT("priority");
+		}
+	}
+}
+
+//本机回环 损伤层限制带宽 客户端在第二个通道上一直发大消息把链路占满
+//同时主通道上Ping 比较Ping的p99 优先级调度只在开启拥塞控制时生效
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetPriorityBenchmark, "SimpleNetChannel.Benchmark.Priority", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetPriorityBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetPriorityBenchmark;
+
+	const int32 Bandwidth = 512 * 1024;
+	const int32 MessageSize = 32 * 1024;
+	const int32 MaxPendingNum = 8;
+	const float BulkTime = 8.f;
+	const float PingInterval = 0.05f;
+
+	const EMode Modes[] = { EMode::Idle, EMode::SamePriority, EMode::Priority };
+	for (EMode Mode : Modes)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bCongestionControl = true;
+		ScopedConfig.Info.bSlidingWindow = true;
+		ScopedConfig.Info.bImpairment = true;
+		ScopedConfig.Info.ImpairmentDelay = 0.01f;
+		ScopedConfig.Info.ImpairmentBandwidth = Bandwidth;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 1;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		FSimpleChannel* MainChannel = Loopback.GetClientChannel(0);
+		if (!MainChannel)
+		{
+			AddError(TEXT("Loopback client disconnected."));
+			return false;
+		}
+
+		//服务器的对象在主线程创建 等它出来再挂回应
+		TSharedPtr<FSimpleConnetion> ServerConnetion;
+		USimpleNetworkObject* ServerObject = nullptr;
+		bool bServerObject = Loopback.WaitUntil([&]()
+		{
+			TArray<TSharedPtr<FInternetAddr>> Addrs;
+			Loopback.GetServerAddrs(Addrs);
+
+			if (Addrs.Num() > 0)
+			{
+				ServerConnetion = Loopback.GetServer()->FindConnetion(Addrs[0]);
+				if (ServerConnetion.IsValid())
+				{
+					ServerObject = ServerConnetion->GetMainChannel()->GetNetObject();
+				}
+			}
+
+			return ServerObject != nullptr;
+		}, 10.0);
+
+		if (!bServerObject)
+		{
+			AddError(TEXT("Server object was not spawned."));
+			return false;
+		}
+
+		//两边各加一个通道 用同一个ID 服务器才认得大数据通道的消息
+		TSharedPtr<FSimpleConnetion> ClientConnetion = MainChannel->GetConnetion();
+		FSimpleChannel* BulkChannel = ClientConnetion.IsValid() ? ClientConnetion->AddChannel() : nullptr;
+		FSimpleChannel* ServerBulkChannel = ServerConnetion.IsValid() ? ServerConnetion->AddChannel() : nullptr;
+		if (!BulkChannel || !ServerBulkChannel)
+		{
+			AddError(TEXT("Unable to add the bulk channel."));
+			return false;
+		}
+
+		ServerBulkChannel->SetGuid(BulkChannel->GetGuid());
+
+		if (Mode == EMode::Priority)
+		{
+			MainChannel->SetPriority(ESimpleNetChannelPriority::HIGH);
+			BulkChannel->SetPriority(ESimpleNetChannelPriority::BULK);
+		}
+
+		//随机内容 不会被压缩
+		FRandomStream Random(0);
+		TArray<uint8> Payload;
+		Payload.SetNumUninitialized(MessageSize);
+		for (auto& Tmp : Payload)
+		{
+			Tmp = (uint8)Random.RandHelper(256);
+		}
+
+		//服务器原样回应 客户端按发出的时间算往返
+		TArray<double> Latencies;
+		ServerObject->RecvDelegate.AddLambda([](uint32 InProtocol, FSimpleChannel* Channel)
+		{
+			if (InProtocol == SP_BenchPing)
+			{
+				double SendTime = 0.0;
+				SIMPLE_PROTOCOLS_RECEIVE(SP_BenchPing, SendTime);
+				SIMPLE_PROTOCOLS_SEND(SP_BenchPing, SendTime);
+			}
+		});
+
+		FDelegateHandle LatencyHandle = MainChannel->GetNetObject()->RecvDelegate.AddLambda([&Latencies](uint32 InProtocol, FSimpleChannel* Channel)
+		{
+			if (InProtocol == SP_BenchPing)
+			{
+				double SendTime = 0.0;
+				SIMPLE_PROTOCOLS_RECEIVE(SP_BenchPing, SendTime);
+				Latencies.Add((FPlatformTime::Seconds() - SendTime) * 1000.0);
+			}
+		});
+
+		uint64 StartRecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+		uint64 SendNum = 0;
+		int32 PingNum = 0;
+		double StartTime = FPlatformTime::Seconds();
+		double NextPingTime = StartTime;
+
+		//让大数据通道一直有积压 但不要无限堆在发送队列里
+		while (FPlatformTime::Seconds() < StartTime + BulkTime)
+		{
+			if (Mode != EMode::Idle)
+			{
+				uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) - StartRecvNum;
+				while (SendNum - RecvNum < MaxPendingNum)
+				{
+					FSimpleChannel* Channel = BulkChannel;
+					SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Payload);
+					SendNum++;
+				}
+			}
+
+			if (FPlatformTime::Seconds() >= NextPingTime)
+			{
+				FSimpleChannel* Channel = MainChannel;
+				double SendTime = FPlatformTime::Seconds();
+				SIMPLE_PROTOCOLS_SEND(SP_BenchPing, SendTime);
+
+				PingNum++;
+				NextPingTime += PingInterval;
+			}
+
+			Loopback.Tick();
+		}
+
+		//最后几个Ping的回应
+		Loopback.WaitUntil([&]() { return Latencies.Num() >= PingNum; }, 2.0);
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		uint64 BulkRecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) - StartRecvNum;
+
+		Latencies.Sort();
+		auto GetPercentile = [&](float InPercentile)
+		{
+			return Latencies.Num() > 0 ? Latencies[FMath::Clamp(FMath::CeilToInt(Latencies.Num() * InPercentile) - 1, 0, Latencies.Num() - 1)] : 0.0;
+		};
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Priority %s bandwidth=%iKB/s bulk=%.1fKB/s pings=%i/%i p50=%.1fms p99=%.1fms max=%.1fms"),
+			GetModeName(Mode), Bandwidth / 1024,
+			(double)BulkRecvNum * MessageSize / Seconds / 1024.0,
+			Latencies.Num(), PingNum,
+			GetPercentile(0.5f), GetPercentile(0.99f), Latencies.Num() > 0 ? Latencies.Last() : 0.0));
+
+		//Latencies出了这次循环就没了
+		MainChannel->GetNetObject()->RecvDelegate.Remove(LatencyHandle);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,63 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Protocols/SimpleNetProtocols.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//本机回环 服务器网络线程每次唤醒取一个数据报(原来的接收)和取一批的对比
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetRecvBenchmark, "SimpleNetChannel.Benchmark.Recv", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetRecvBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 BatchNumbers[] = { 1, 64 };
+	for (int32 BatchNumber : BatchNumbers)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.RecvBatchNumber = BatchNumber;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 32;
+		Config.SendRate = 2000.f;
+		Config.PingRate = 0.f;
+		Config.Duration = 3.f;
+
+		FSimpleNetLoadAction& Action = Config.Actions.AddDefaulted_GetRef();
+		Action.Name = TEXT("Payload");
+		Action.Send = [](FSimpleChannel* Channel)
+		{
+			int32 Value = 0;
+			SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Value);
+		};
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback clients failed to join."));
+			return false;
+		}
+
+		//只统计加入以后的
+		FSimpleNetTrafficStats StartTraffic = Loopback.GetServerTraffic();
+		double StartTime = FPlatformTime::Seconds();
+
+		while (Loopback.Tick())
+		{
+		}
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		FSimpleNetTrafficStats EndTraffic = Loopback.GetServerTraffic();
+		FSimpleNetLoadReport Report = Loopback.Stop();
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Recv batch=%2i clients=%i in=%.0f packets/s CPU=%.1f%% peak=%.1f%%"),
+			BatchNumber, Config.ClientNum,
+			(EndTraffic.PacketsIn - StartTraffic.PacketsIn) / Seconds,
+			Report.CPUAverage, Report.CPUPeak));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,213 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Tests/SimpleNetReplicationBenchmark.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "SimpleNetManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetReplicationBenchmark
+{
+	//按帧录好的所有玩家状态
+	struct FSession
+	{
+		int32 PlayerNum;
+		int32 FrameNum;
+		TArray<FSimpleNetBenchPlayerState> States;
+
+		const FSimpleNetBenchPlayerState& Get(int32 InFrame, int32 InPlayer) const
+		{
+			return States[InFrame * PlayerNum + InPlayer];
+		}
+	};
+
+	//没有真实的录制 按同样的种子生成一局 大约一半的玩家在跑动 偶尔掉血回蓝 很少升级 外观不变
+	void BuildSession(int32 InPlayerNum, int32 InFrameNum, float InFrameRate, FSession& OutSession)
+	{
+		FRandomStream Random(0);
+
+		OutSession.PlayerNum = InPlayerNum;
+		OutSession.FrameNum = InFrameNum;
+		OutSession.States.Reset(InPlayerNum * InFrameNum);
+
+		TArray<FSimpleNetBenchPlayerState> Players;
+		TArray<float> Headings;
+		for (int32 i = 0; i < InPlayerNum; i++)
+		{
+			FSimpleNetBenchPlayerState& Player = Players.AddDefaulted_GetRef();
+			Player.Name = FString::Printf(TEXT("Player_%04i"), i);
+			Player.Lv = Random.RandRange(1, 60);
+			Player.LegSize = Random.FRand();
+			Player.WaistSize = Random.FRand();
+			Player.ArmSize = Random.FRand();
+			Player.HeadSize = Random.FRand();
+			Player.ChestSize = Random.FRand();
+			Player.Location = FVector(Random.FRandRange(-10000.f, 10000.f), Random.FRandRange(-10000.f, 10000.f), 100.f);
+			Player.MoveState = Random.FRand() < 0.5f ? 1 : 0;
+
+			Headings.Add(Random.FRandRange(0.f, 360.f));
+		}
+
+		for (int32 Frame = 0; Frame < InFrameNum; Frame++)
+		{
+			for (int32 i = 0; i < InPlayerNum; i++)
+			{
+				FSimpleNetBenchPlayerState& Player = Players[i];
+
+				if (Random.FRand() < 0.05f)
+				{
+					Player.MoveState = Player.MoveState ? 0 : 1;
+				}
+
+				if (Player.MoveState)
+				{
+					if (Random.FRand() < 0.03f)
+					{
+						Headings[i] = Random.FRandRange(0.f, 360.f);
+					}
+
+					Player.Rotation.Yaw = Headings[i];
+					Player.Velocity = Player.Rotation.Vector() * 600.f;
+					Player.Location += Player.Velocity / InFrameRate;
+				}
+				else
+				{
+					Player.Velocity = FVector::ZeroVector;
+				}
+
+				if (Random.FRand() < 0.03f)
+				{
+					Player.Health = FMath::Clamp(Player.Health - Random.RandRange(-10, 20), 1, 100);
+				}
+
+				if (Random.FRand() < 0.01f)
+				{
+					Player.Mana = FMath::Clamp(Player.Mana - Random.RandRange(-10, 30), 0, 100);
+				}
+
+				if (Random.FRand() < 0.0005f)
+				{
+					Player.Lv++;
+				}
+
+				OutSession.States.Add(Player);
+			}
+		}
+	}
+}
+
+//本机回环 服务器在客户端的通道上回放100个玩家一局的状态 每帧每个玩家都调用一次Replicate
+//对比实际发出的状态字节和每次都发全量需要的字节 丢包时差量要退回全量
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetReplicationBenchmark, "SimpleNetChannel.Benchmark.Replication", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetReplicationBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetReplicationBenchmark;
+
+	const int32 PlayerNum = 100;
+	const float FrameRate = 20.f;
+	const int32 FrameNum = 200;
+
+	FSession Session;
+	BuildSession(PlayerNum, FrameNum, FrameRate, Session);
+
+	UScriptStruct* Struct = FSimpleNetBenchPlayerState::StaticStruct();
+	FSimpleNetReplication::RegisterStruct(Struct);
+
+	const float Losses[] = { 0.f, 0.05f };
+	for (float Loss : Losses)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bImpairment = Loss > 0.f;
+		ScopedConfig.Info.ImpairmentLoss = Loss;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 1;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		TSharedPtr<FSimpleConnetion> ServerConnetion;
+		bool bServerConnetion = Loopback.WaitUntil([&]()
+		{
+			TArray<TSharedPtr<FInternetAddr>> Addrs;
+			Loopback.GetServerAddrs(Addrs);
+
+			if (Addrs.Num() > 0)
+			{
+				ServerConnetion = Loopback.GetServer()->FindConnetion(Addrs[0]);
+			}
+
+			return ServerConnetion.IsValid();
+		}, 10.0);
+
+		if (!bServerConnetion)
+		{
+			AddError(TEXT("Server did not accept the loopback client."));
+			return false;
+		}
+
+		FSimpleNetReplication& Replication = ServerConnetion->GetMainChannel()->GetReplication();
+
+		//按录制的帧率回放
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < FrameNum; Frame++)
+		{
+			for (int32 i = 0; i < PlayerNum; i++)
+			{
+				Replication.Replicate((uint32)i, Session.Get(Frame, i));
+			}
+
+			double NextFrameTime = StartTime + (Frame + 1) / FrameRate;
+			Loopback.WaitUntil([&]() { return FPlatformTime::Seconds() >= NextFrameTime; }, 1.0);
+		}
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		//客户端最后看到的状态要和最后一帧一样
+		int32 MismatchNum = PlayerNum;
+		Loopback.WaitUntil([&]()
+		{
+			FSimpleChannel* Channel = Loopback.GetClientChannel(0);
+			if (!Channel)
+			{
+				return false;
+			}
+
+			MismatchNum = 0;
+			for (int32 i = 0; i < PlayerNum; i++)
+			{
+				FSimpleNetBenchPlayerState State;
+				if (!Channel->GetReplication().GetState((uint32)i, State) ||
+					!Struct->CompareScriptStruct(&State, &Session.Get(FrameNum - 1, i), PPF_None))
+				{
+					MismatchNum++;
+				}
+			}
+
+			return MismatchNum == 0;
+		}, 5.0);
+
+		FSimpleNetReplicationStats Stats = Replication.GetStats();
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Replication players=%i frames=%i loss=%.0f%% full state=%.1fKB/s replicated=%.1fKB/s ratio=%.3f full=%llu delta=%llu nack=%llu mismatched=%i"),
+			PlayerNum, FrameNum, Loss * 100.f,
+			Stats.FullBytes / Seconds / 1024.0,
+			Stats.SendBytes / Seconds / 1024.0,
+			Stats.FullBytes > 0 ? (double)Stats.SendBytes / Stats.FullBytes : 0.0,
+			Stats.FullNum, Stats.DeltaNum, Stats.NackNum, MismatchNum));
+
+		TestEqual(TEXT("Players whose replicated state differs from the last frame"), MismatchNum, 0);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleNetReplicationBenchmark.generated.h"
+
+//状态复制基准测试用的玩家状态 外观字段和FMMORPGCharacterAppearance一样 再加上位置和战斗属性
+//UHT不认WITH_DEV_AUTOMATION_TESTS 这个结构体一直会编译
+USTRUCT()
+struct FSimpleNetBenchPlayerState
+{
+	GENERATED_BODY()
+
+	FSimpleNetBenchPlayerState()
+		:Lv(1)
+		, LegSize(0.f)
+		, WaistSize(0.f)
+		, ArmSize(0.f)
+		, HeadSize(0.f)
+		, ChestSize(0.f)
+		, Location(ForceInit)
+		, Rotation(ForceInit)
+		, Velocity(ForceInit)
+		, Health(100)
+		, Mana(100)
+		, MoveState(0)
+	{}
+
+	UPROPERTY()
+	FString Name;
+
+	UPROPERTY()
+	int32 Lv;
+
+	UPROPERTY()
+	float LegSize;
+
+	UPROPERTY()
+	float WaistSize;
+
+	UPROPERTY()
+	float ArmSize;
+
+	UPROPERTY()
+	float HeadSize;
+
+	UPROPERTY()
+	float ChestSize;
+
+	UPROPERTY()
+	FVector Location;
+
+	UPROPERTY()
+	FRotator Rotation;
+
+	UPROPERTY()
+	FVector Velocity;
+
+	UPROPERTY()
+	int32 Health;
+
+	UPROPERTY()
+	int32 Mana;
+
+	UPROPERTY()
+	uint8 MoveState;
+};
@@ -0,0 +1,71 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//本机回环 客户端每条消息一次SendTo(原来的发送)和每个网络Tick合并发送的对比
+//客户端的PacketsOut就是SendTo的次数
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetSendBenchmark, "SimpleNetChannel.Benchmark.Send", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetSendBenchmark::RunTest(const FString& Parameters)
+{
+	const bool bCoalesces[] = { false, true };
+	for (bool bCoalesce : bCoalesces)
+	{
+		//合并发送需要紧凑包头 紧凑包头需要滑动窗口
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bSlidingWindow = true;
+		ScopedConfig.Info.bCompactHeader = bCoalesce;
+		ScopedConfig.Info.bCoalesce = bCoalesce;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 16;
+		Config.SendRate = 1000.f;
+		Config.PingRate = 0.f;
+		Config.Duration = 3.f;
+
+		//移动同步大小的小消息
+		FSimpleNetLoadAction& Action = Config.Actions.AddDefaulted_GetRef();
+		Action.Name = TEXT("Move");
+		Action.Send = [](FSimpleChannel* Channel)
+		{
+			FVector Location(100.f, 200.f, 300.f);
+			FRotator Rotation(0.f, 90.f, 0.f);
+			SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Location, Rotation);
+		};
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback clients failed to join."));
+			return false;
+		}
+
+		FSimpleNetLoadReport StartReport = Loopback.GetGenerator().GetReport();
+		double StartTime = FPlatformTime::Seconds();
+
+		while (Loopback.Tick())
+		{
+		}
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		FSimpleNetLoadReport Report = Loopback.Stop();
+
+		uint64 SendNum = Report.SendNum - StartReport.SendNum;
+		uint64 PacketsOut = Report.PacketsOut - StartReport.PacketsOut;
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("Send coalesce=%i messages=%.0f/s SendTo per message=%.3f bytes/s=%.0f CPU=%.1f%%"),
+			bCoalesce ? 1 : 0,
+			SendNum / Seconds,
+			SendNum > 0 ? (double)PacketsOut / SendNum : 0.0,
+			(Report.BytesOut - StartReport.BytesOut) / Seconds,
+			Report.CPUAverage));
+	}
+
+	return true;
+}
+
+#endif
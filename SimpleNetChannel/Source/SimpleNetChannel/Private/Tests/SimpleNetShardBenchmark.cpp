@@ -0,0 +1,66 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "HAL/PlatformMemory.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//高并发服务器 每个客户端一个端口(原来的做法)和多个线程共用一个端口的分片对比
+//全部加入的时间 加入后保持5秒的Ping 以及每个链接的内存
+//内存是整个进程的增量 包括同一个进程里的客户端 两种模式的客户端一样 差值就是服务器的
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetShardBenchmark, "SimpleNetChannel.Benchmark.Shard", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetShardBenchmark::RunTest(const FString& Parameters)
+{
+	const float HoldTime = 5.f;
+	const int32 ClientNums[] = { 100, 500, 1000 };
+	const int32 ShardNumbers[] = { 0, 4 };
+
+	for (int32 ClientNum : ClientNums)
+	{
+		for (int32 ShardNumber : ShardNumbers)
+		{
+			SimpleNetBenchmark::FScopedConfig ScopedConfig;
+			ScopedConfig.Info.ShardNumber = ShardNumber;
+			ScopedConfig.Info.MaxConnections = FMath::Max(ScopedConfig.Info.MaxConnections, ClientNum);
+			ScopedConfig.Apply();
+
+			FSimpleNetLoadConfig Config;
+			Config.ClientNum = ClientNum;
+			Config.SendRate = 0.f;
+			Config.PingRate = 1.f;
+			Config.bHighConcurrency = true;
+
+			uint64 StartMemory = FPlatformMemory::GetStats().UsedPhysical;
+			double StartTime = FPlatformTime::Seconds();
+
+			SimpleNetBenchmark::FLoopback Loopback;
+			if (!Loopback.Start(Config))
+			{
+				AddError(TEXT("Unable to start the loopback server."));
+				return false;
+			}
+
+			bool bJoin = Loopback.WaitJoin(120.0);
+			double JoinTime = FPlatformTime::Seconds() - StartTime;
+
+			int64 MemoryPerConnetion = ((int64)FPlatformMemory::GetStats().UsedPhysical - (int64)StartMemory) / ClientNum;
+
+			//加入以后保持一段时间 看链接能不能一直维持
+			double HoldEndTime = FPlatformTime::Seconds() + HoldTime;
+			Loopback.WaitUntil([&]() { return FPlatformTime::Seconds() >= HoldEndTime; }, HoldTime * 2.0);
+
+			FSimpleNetLoadReport Report = Loopback.Stop();
+
+			SimpleNetBenchmark::Report(*this, FString::Printf(
+				TEXT("Shard shards=%i clients=%i all joined=%i join time=%.2fs joined=%i ping p99=%.1fms lost=%i memory/connetion=%.1fKB"),
+				ShardNumber, ClientNum, bJoin ? 1 : 0, JoinTime,
+				Report.JoinNum, Report.LatencyP99, Report.LostNum,
+				MemoryPerConnetion / 1024.0));
+		}
+	}
+
+	return true;
+}
+
+#endif
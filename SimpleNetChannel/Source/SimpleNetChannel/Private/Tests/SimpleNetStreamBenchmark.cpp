@@ -0,0 +1,140 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Stream/SimpleIOStream.h"
+#include "Stream/SimpleNetBufferPool.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetStreamBenchmark
+{
+	//一条移动同步大小的协议消息
+	struct FMessage
+	{
+		FMessage()
+			:Location(100.f, 200.f, 300.f)
+			, Rotation(0.f, 90.f, 0.f)
+			, Name(TEXT("PlayerCharacter_C_12"))
+		{
+			Extra.Init(3, 64);
+		}
+
+		FSimpleBunchHead Head;
+		FVector Location;
+		FRotator Rotation;
+		FString Name;
+		TArray<uint8> Extra;
+	};
+}
+
+//序列化一条协议消息 每次新建缓冲逐个字段追加(原来的写法)和池里取预先算好大小的缓冲对比
+//分配次数用缓冲容量的变化来数 池里取到的缓冲不算分配
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetStreamBenchmark, "SimpleNetChannel.Benchmark.Stream", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetStreamBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetStreamBenchmark;
+
+	FMessage Message;
+	const int32 MessageNum = 100000;
+
+	double FreshTime = SimpleNetBenchmark::Measure([&]()
+	{
+		TArray<uint8> Buffer;
+		FSimpleIOStream Stream(Buffer);
+		Stream << Message.Head;
+		FRecursionMessageInfo::BuildSendParams(Stream, Message.Location, Message.Rotation, Message.Name, Message.Extra);
+	});
+
+	//和DEFINITION_PROTOCOLS发送时一样 先算大小再从池里取
+	int64 PooledAllocNum = 0;
+	int64 PooledNum = 0;
+	auto SerializePooled = [&]()
+	{
+		int32 Size = (int32)sizeof(FSimpleBunchHead) + FRecursionMessageInfo::GetSendParamsSize(
+			Message.Location, Message.Rotation, Message.Name, Message.Extra);
+
+		int32 PooledBefore = FSimpleNetBufferPool::GetPooledNum();
+
+		FSimpleNetPooledBuffer PooledBuffer(Size);
+		TArray<uint8>& Buffer = PooledBuffer.Get();
+
+		if (FSimpleNetBufferPool::GetPooledNum() == PooledBefore)
+		{
+			PooledAllocNum++;
+		}
+
+		int32 Max = Buffer.Max();
+
+		FSimpleIOStream Stream(Buffer);
+		Stream << Message.Head;
+		FRecursionMessageInfo::BuildSendParams(Stream, Message.Location, Message.Rotation, Message.Name, Message.Extra);
+
+		if (Buffer.Max() != Max)
+		{
+			PooledAllocNum++;
+		}
+
+		PooledNum++;
+	};
+
+	//第一条会从空池里分配 之后是稳定状态
+	SerializePooled();
+	PooledAllocNum = 0;
+	PooledNum = 0;
+
+	double PooledTime = SimpleNetBenchmark::Measure(SerializePooled);
+
+	//每个字段写完看一次容量 变了就是重新分配
+	int64 FreshAllocNum = 0;
+	for (int32 i = 0; i < MessageNum; i++)
+	{
+		TArray<uint8> Buffer;
+		FSimpleIOStream Stream(Buffer);
+
+		int32 Max = Buffer.Max();
+		Stream << Message.Head << Message.Location << Message.Rotation;
+		FreshAllocNum += Buffer.Max() != Max;
+		Max = Buffer.Max();
+		Stream << Message.Name;
+		FreshAllocNum += Buffer.Max() != Max;
+		Max = Buffer.Max();
+		Stream << Message.Extra;
+		FreshAllocNum += Buffer.Max() != Max;
+	}
+
+	SimpleNetBenchmark::Report(*this, FString::Printf(
+		TEXT("Stream fresh buffer=%.1fns allocs/message>=%.2f pooled=%.1fns allocs/message=%.4f"),
+		FreshTime * 1e9, (double)FreshAllocNum / MessageNum,
+		PooledTime * 1e9, PooledNum > 0 ? (double)PooledAllocNum / PooledNum : 0.0));
+
+	if (PooledAllocNum != 0)
+	{
+		AddWarning(FString::Printf(TEXT("Pooled serialization allocated %lld times in steady state."), PooledAllocNum));
+	}
+
+	//读一条截断的消息 越界前就要停下
+	{
+		TArray<uint8> Buffer;
+		FSimpleIOStream WriteStream(Buffer);
+		WriteStream << Message.Head;
+		FRecursionMessageInfo::BuildSendParams(WriteStream, Message.Location, Message.Rotation, Message.Name, Message.Extra);
+
+		Buffer.SetNum(Buffer.Num() - 16);
+
+		FMessage Received;
+		Received.Name.Empty();
+		Received.Extra.Empty();
+
+		FSimpleIOStream ReadStream(Buffer);
+		ReadStream.Seek(sizeof(FSimpleBunchHead));
+		FRecursionMessageInfo::BuildReceiveParams(ReadStream, Received.Location, Received.Rotation, Received.Name, Received.Extra);
+
+		TestTrue(TEXT("Truncated message is rejected"), ReadStream.IsError());
+		TestTrue(TEXT("Truncated message does not read past the end"), ReadStream.GetPos() <= Buffer.Num());
+	}
+
+	return true;
+}
+
+#endif
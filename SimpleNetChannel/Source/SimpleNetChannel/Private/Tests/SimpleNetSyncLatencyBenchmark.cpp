@@ -0,0 +1,157 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "SimpleNetManage.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//同步协议 服务器收到后原样回应 发送方在Send里等到回应才返回
+DEFINITION_SIMPLE_PROTOCOLS_SYNCHRONIZE(BenchSync, 1101)
+
+namespace SimpleNetSyncLatencyBenchmark
+{
+	float GetPercentile(const TArray<double>& InSorted, float InPercentile)
+	{
+		if (InSorted.Num() == 0)
+		{
+			return 0.f;
+		}
+
+		int32 Index = FMath::Clamp(FMath::CeilToInt(InSorted.Num() * InPercentile) - 1, 0, InSorted.Num() - 1);
+		return (float)InSorted[Index];
+	}
+}
+
+//本机回环 同步协议的往返时间
+//原来的发送每30毫秒检查一次回应 往返至少要等一个检查周期 现在由接收线程直接唤醒
+//同一个客户端再用异步的Ping测一次 作为没有等待开销的对照
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetSyncLatencyBenchmark, "SimpleNetChannel.Benchmark.SyncLatency", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetSyncLatencyBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetSyncLatencyBenchmark;
+
+	const int32 RoundTripNum = 2000;
+
+	FSimpleNetLoadConfig Config;
+	Config.ClientNum = 1;
+	Config.SendRate = 0.f;
+	Config.PingRate = 0.f;
+	Config.bAllowSynchronization = true;
+
+	SimpleNetBenchmark::FLoopback Loopback;
+	if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+	{
+		AddError(TEXT("Loopback client failed to join."));
+		return false;
+	}
+
+	//服务器的对象在主线程创建 等它出来再挂回应
+	USimpleNetworkObject* ServerObject = nullptr;
+	bool bServerObject = Loopback.WaitUntil([&]()
+	{
+		TArray<TSharedPtr<FInternetAddr>> Addrs;
+		Loopback.GetServerAddrs(Addrs);
+
+		if (Addrs.Num() > 0)
+		{
+			if (TSharedPtr<FSimpleConnetion> Connetion = Loopback.GetServer()->FindConnetion(Addrs[0]))
+			{
+				ServerObject = Connetion->GetMainChannel()->GetNetObject();
+			}
+		}
+
+		return ServerObject != nullptr;
+	}, 10.0);
+
+	if (!bServerObject)
+	{
+		AddError(TEXT("Server object was not spawned."));
+		return false;
+	}
+
+	//在服务器的网络线程回应 带着请求的Tag
+	ServerObject->RecvDelegate.AddLambda([](uint32 InProtocol, FSimpleChannel* Channel)
+	{
+		if (InProtocol == SP_BenchSync)
+		{
+			int32 Value = 0;
+			SIMPLE_PROTOCOLS_RECEIVE(SP_BenchSync, Value);
+			SIMPLE_PROTOCOLS_SEND(SP_BenchSync, Value);
+		}
+	});
+
+	TArray<double> Latencies;
+	Latencies.Reserve(RoundTripNum);
+
+	int32 MismatchNum = 0;
+	for (int32 i = 0; i < RoundTripNum; i++)
+	{
+		FSimpleChannel* Channel = Loopback.GetClientChannel(0);
+		if (!Channel)
+		{
+			AddError(TEXT("Loopback client disconnected."));
+			return false;
+		}
+
+		int32 Value = i;
+		double StartTime = FPlatformTime::Seconds();
+
+		SIMPLE_PROTOCOLS_SEND(SP_BenchSync, Value);
+
+		Latencies.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+		//回应留在这个线程上
+		int32 Echo = INDEX_NONE;
+		SIMPLE_PROTOCOLS_RECEIVE(SP_BenchSync, Echo);
+		if (Echo != i)
+		{
+			MismatchNum++;
+		}
+
+		//心跳和确认
+		if (i % 10 == 0)
+		{
+			Loopback.Tick();
+		}
+	}
+
+	Latencies.Sort();
+
+	SimpleNetBenchmark::Report(*this, FString::Printf(
+		TEXT("SyncLatency round trips=%i p50=%.3fms p99=%.3fms max=%.3fms missing responses=%i"),
+		Latencies.Num(),
+		GetPercentile(Latencies, 0.5f), GetPercentile(Latencies, 0.99f), Latencies.Last(),
+		MismatchNum));
+
+	TestEqual(TEXT("Missing or wrong responses"), MismatchNum, 0);
+
+	//异步的Ping 同样一个客户端和服务器的网络线程
+	{
+		Loopback.Stop();
+
+		Config.PingRate = 50.f;
+		Config.Duration = 5.f;
+
+		SimpleNetBenchmark::FLoopback PingLoopback;
+		if (!PingLoopback.Start(Config) || !PingLoopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		while (PingLoopback.Tick())
+		{
+		}
+
+		FSimpleNetLoadReport Report = PingLoopback.Stop();
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("SyncLatency async ping round trips=%i p50=%.3fms p99=%.3fms max=%.3fms"),
+			Report.LatencyNum, Report.LatencyP50, Report.LatencyP99, Report.LatencyMax));
+	}
+
+	return true;
+}
+
+#endif
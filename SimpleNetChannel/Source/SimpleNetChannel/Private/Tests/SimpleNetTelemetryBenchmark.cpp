@@ -0,0 +1,118 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Stats/SimpleNetTelemetry.h"
+#include "SimpleNetManage.h"
+#include "Async/Async.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//统计的开销 收到一个数据报记一次链接的计数 再按协议号记一次
+//先单独测每个包的开销 单线程和几个线程同时写同一组计数器 再换算成每秒10万个包占一个核的比例
+//然后本机回环按每秒10万个包发送 用实际收到的包数换算 同时测取一次快照的时间
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetTelemetryBenchmark, "SimpleNetChannel.Benchmark.Telemetry", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetTelemetryBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 PacketNum = 1000;
+	const int32 ProtocolNum = 16;
+	const double TargetRate = 100000.0;
+
+	FSimpleNetConnetionTelemetry ConnetionTelemetry;
+	FSimpleNetProtocolTelemetry ProtocolTelemetry;
+
+	auto RecordPackets = [&]()
+	{
+		for (int32 i = 0; i < PacketNum; i++)
+		{
+			ConnetionTelemetry.OnRecv(64);
+			ProtocolTelemetry.OnRecv(1000 + (i % ProtocolNum), 48);
+		}
+	};
+
+	double PacketTime = SimpleNetBenchmark::Measure(RecordPackets) / PacketNum;
+
+	//网络线程和几个发送线程同时记
+	const int32 ThreadNum = 4;
+	const int32 RoundNum = 200;
+
+	double StartTime = FPlatformTime::Seconds();
+	{
+		TArray<TFuture<void>> Futures;
+		for (int32 i = 0; i < ThreadNum; i++)
+		{
+			Futures.Add(Async(EAsyncExecution::Thread, [&]()
+			{
+				for (int32 j = 0; j < RoundNum; j++)
+				{
+					RecordPackets();
+				}
+			}));
+		}
+
+		for (auto& Tmp : Futures)
+		{
+			Tmp.Wait();
+		}
+	}
+
+	//每个线程自己的包 按线程平均
+	double ContendedTime = (FPlatformTime::Seconds() - StartTime) / ((double)RoundNum * PacketNum);
+
+	SimpleNetBenchmark::Report(*this, FString::Printf(
+		TEXT("Telemetry per packet=%.1fns (%.3f%% of a core at 100k packets/s) contended threads=%i per packet=%.1fns (%.3f%%)"),
+		PacketTime * 1e9, PacketTime * TargetRate * 100.0,
+		ThreadNum, ContendedTime * 1e9, ContendedTime * TargetRate * 100.0));
+
+	//50个客户端 每个每秒2000个
+	FSimpleNetLoadConfig Config;
+	Config.ClientNum = 50;
+	Config.SendRate = (float)(TargetRate / Config.ClientNum);
+	Config.PingRate = 0.f;
+	Config.Duration = 3.f;
+
+	FSimpleNetLoadAction& Action = Config.Actions.AddDefaulted_GetRef();
+	Action.Name = TEXT("Payload");
+	Action.Send = [](FSimpleChannel* Channel)
+	{
+		int32 Value = 0;
+		SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Value);
+	};
+
+	SimpleNetBenchmark::FLoopback Loopback;
+	if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+	{
+		AddError(TEXT("Loopback clients failed to join."));
+		return false;
+	}
+
+	FSimpleNetTrafficStats StartTraffic = Loopback.GetServerTraffic();
+	StartTime = FPlatformTime::Seconds();
+
+	while (Loopback.Tick())
+	{
+	}
+
+	double Seconds = FPlatformTime::Seconds() - StartTime;
+	FSimpleNetTrafficStats EndTraffic = Loopback.GetServerTraffic();
+
+	FSimpleNetStatsSnapshot Snapshot;
+	double SnapshotTime = SimpleNetBenchmark::Measure([&]()
+	{
+		Loopback.GetServer()->GetStats(Snapshot);
+	});
+
+	FSimpleNetLoadReport Report = Loopback.Stop();
+
+	double PacketRate = (EndTraffic.PacketsIn - StartTraffic.PacketsIn) / Seconds;
+
+	SimpleNetBenchmark::Report(*this, FString::Printf(
+		TEXT("Telemetry loopback clients=%i in=%.0f packets/s telemetry=%.3f%% of a core process CPU=%.1f%% snapshot=%.1fus connetions=%i protocols=%i"),
+		Config.ClientNum, PacketRate, PacketRate * PacketTime * 100.0,
+		Report.CPUAverage, SnapshotTime * 1e6,
+		Snapshot.Connetions.Num(), Snapshot.Protocols.Num()));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,149 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Thread/SimpleNetThreadManage.h"
+#include "Async/Async.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetThreadPoolBenchmark
+{
+	//一直等到InFunc返回true 超时返回false
+	bool WaitFor(TFunctionRef<bool()> InFunc, double InTimeout)
+	{
+		double EndTime = FPlatformTime::Seconds() + InTimeout;
+		while (!InFunc())
+		{
+			if (FPlatformTime::Seconds() >= EndTime)
+			{
+				return false;
+			}
+
+			FPlatformProcess::Sleep(0.001f);
+		}
+
+		return true;
+	}
+}
+
+//很小的任务 一个和四个生产者往线程池里加 每个生产者有自己的一组亲和键
+//每个任务检查同一个亲和键上的序号是不是连续的 统计每秒执行的任务数
+//对照是原来没有空闲线程时的做法 每个任务交给UE的AsyncTask
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetThreadPoolBenchmark, "SimpleNetChannel.Benchmark.ThreadPool", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetThreadPoolBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetThreadPoolBenchmark;
+
+	const int32 TaskNum = 1000000;
+	const int32 ThreadNum = 4;
+	const int32 QueueSize = 1024;
+	const int32 AffinityNum = 256;//每个生产者
+
+	const int32 ProducerNums[] = { 1, 4 };
+	const int32 BatchNumbers[] = { 1, 32 };
+
+	for (int32 ProducerNum : ProducerNums)
+	{
+		for (int32 BatchNumber : BatchNumbers)
+		{
+			//每个亲和键最后执行的序号 同一个键只会在一条通道上顺序执行
+			TArray<int32> LastSequences;
+			LastSequences.Init(INDEX_NONE, ProducerNum * AffinityNum);
+
+			FThreadSafeCounter OrderErrorNum;
+
+			const int32 TaskPerProducer = TaskNum / ProducerNum;
+
+			TUniquePtr<FSimpleNetThreadManage> ThreadManage = MakeUnique<FSimpleNetThreadManage>(ThreadNum, QueueSize, BatchNumber);
+
+			double StartTime = FPlatformTime::Seconds();
+			{
+				TArray<TFuture<void>> Futures;
+				for (int32 Producer = 0; Producer < ProducerNum; Producer++)
+				{
+					Futures.Add(Async(EAsyncExecution::Thread, [&, Producer]()
+					{
+						for (int32 i = 0; i < TaskPerProducer; i++)
+						{
+							uint32 Affinity = Producer * AffinityNum + i % AffinityNum;
+							int32 Sequence = i / AffinityNum;
+
+							ThreadManage->AddTask(FSimpleDelegate::CreateLambda([&LastSequences, &OrderErrorNum, Affinity, Sequence]()
+							{
+								if (LastSequences[Affinity] + 1 != Sequence)
+								{
+									OrderErrorNum.Increment();
+								}
+
+								LastSequences[Affinity] = Sequence;
+							}), Affinity);
+						}
+					}));
+				}
+
+				for (auto& Tmp : Futures)
+				{
+					Tmp.Wait();
+				}
+			}
+
+			double AddTime = FPlatformTime::Seconds() - StartTime;
+
+			bool bCompleted = WaitFor([&]() { return ThreadManage->GetCompletedNum() >= (int64)TaskPerProducer * ProducerNum; }, 60.0);
+			double Seconds = FPlatformTime::Seconds() - StartTime;
+
+			ThreadManage.Reset();
+
+			if (!bCompleted)
+			{
+				AddError(FString::Printf(TEXT("Thread pool did not finish %i tasks within 60 seconds."), TaskPerProducer * ProducerNum));
+				return false;
+			}
+
+			SimpleNetBenchmark::Report(*this, FString::Printf(
+				TEXT("ThreadPool threads=%i producers=%i batch=%2i tasks=%i add=%.0f tasks/s executed=%.0f tasks/s order errors=%i"),
+				ThreadNum, ProducerNum, BatchNumber, TaskPerProducer * ProducerNum,
+				TaskPerProducer * ProducerNum / AddTime, TaskPerProducer * ProducerNum / Seconds,
+				OrderErrorNum.GetValue()));
+
+			TestEqual(TEXT("Tasks executed out of order"), OrderErrorNum.GetValue(), 0);
+		}
+	}
+
+	//对照 UE的后台任务 不保证同一个键的顺序
+	{
+		FThreadSafeCounter CompletedNum;
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < TaskNum; i++)
+		{
+			AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [&CompletedNum]()
+			{
+				CompletedNum.Increment();
+			});
+		}
+
+		double AddTime = FPlatformTime::Seconds() - StartTime;
+
+		bool bCompleted = WaitFor([&]() { return CompletedNum.GetValue() >= TaskNum; }, 60.0);
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		if (!bCompleted)
+		{
+			//任务还引用着CompletedNum 等它们全部结束再返回
+			WaitFor([&]() { return CompletedNum.GetValue() >= TaskNum; }, 600.0);
+
+			AddError(FString::Printf(TEXT("AsyncTask did not finish %i tasks within 60 seconds."), TaskNum));
+			return false;
+		}
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("ThreadPool AsyncTask producers=1 tasks=%i add=%.0f tasks/s executed=%.0f tasks/s"),
+			TaskNum, TaskNum / AddTime, TaskNum / Seconds));
+	}
+
+	return true;
+}
+
+#endif
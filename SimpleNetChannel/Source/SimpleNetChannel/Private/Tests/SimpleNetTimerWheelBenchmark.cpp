@@ -0,0 +1,106 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+#include "Timer/SimpleNetTimerWheel.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SimpleNetTimerWheelBenchmark
+{
+	//原来的做法 每个链接记着下一次心跳和超时的时间 每帧全部检查一遍
+	struct FConnetionTimer
+	{
+		double HeartBeat;
+		double TimeOut;
+	};
+}
+
+//每个链接一个每秒一次的心跳和一个不会到期的超时 按60帧推进10秒
+//时间轮每帧只处理到期的心跳 遍历的做法和链接数成正比
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetTimerWheelBenchmark, "SimpleNetChannel.Benchmark.TimerWheel", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetTimerWheelBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace SimpleNetTimerWheelBenchmark;
+
+	const float DeltaSeconds = 1.f / 60.f;
+	const int32 FrameNum = 600;
+	const float HeartBeatInterval = 1.f;
+	const float TimeOut = 30.f;
+
+	const int32 ConnetionNums[] = { 100, 1000, 5000, 50000 };
+	for (int32 ConnetionNum : ConnetionNums)
+	{
+		FRandomStream Random(0);
+
+		int64 FiredNum = 0;
+		double WheelTime = 0.0;
+		{
+			FSimpleNetTimerWheel TimerWheel;
+
+			//心跳在回调里重新注册 和链接的做法一样
+			TFunction<void()> HeartBeat;
+			HeartBeat = [&]()
+			{
+				FiredNum++;
+				TimerWheel.Schedule(HeartBeatInterval, FSimpleDelegate::CreateLambda([&]() { HeartBeat(); }));
+			};
+
+			for (int32 i = 0; i < ConnetionNum; i++)
+			{
+				TimerWheel.Schedule(Random.FRandRange(0.f, HeartBeatInterval), FSimpleDelegate::CreateLambda([&]() { HeartBeat(); }));
+				TimerWheel.Schedule(TimeOut, FSimpleDelegate());
+			}
+
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < FrameNum; i++)
+			{
+				TimerWheel.Advance(DeltaSeconds);
+			}
+			WheelTime = (FPlatformTime::Seconds() - StartTime) / FrameNum;
+		}
+
+		int64 ScanFiredNum = 0;
+		double ScanTime = 0.0;
+		{
+			TArray<FConnetionTimer> Connetions;
+			Connetions.SetNum(ConnetionNum);
+			for (auto& Tmp : Connetions)
+			{
+				Tmp.HeartBeat = Random.FRandRange(0.f, HeartBeatInterval);
+				Tmp.TimeOut = TimeOut;
+			}
+
+			double Time = 0.0;
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < FrameNum; i++)
+			{
+				Time += DeltaSeconds;
+				for (auto& Tmp : Connetions)
+				{
+					if (Time >= Tmp.HeartBeat)
+					{
+						Tmp.HeartBeat += HeartBeatInterval;
+						ScanFiredNum++;
+					}
+
+					if (Time >= Tmp.TimeOut)
+					{
+						Tmp.TimeOut = Time + TimeOut;
+					}
+				}
+			}
+			ScanTime = (FPlatformTime::Seconds() - StartTime) / FrameNum;
+		}
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("TimerWheel connetions=%i timers=%i wheel=%.2fus/tick scan=%.2fus/tick fired=%lld/%lld"),
+			ConnetionNum, ConnetionNum * 2,
+			WheelTime * 1e6, ScanTime * 1e6,
+			FiredNum, ScanFiredNum));
+	}
+
+	return true;
+}
+
+#endif
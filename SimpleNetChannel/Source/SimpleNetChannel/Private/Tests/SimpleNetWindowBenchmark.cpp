@@ -0,0 +1,92 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//本机回环 损伤层注入延迟和丢包 一条大消息从发出到服务器收到的时间
+//停等(原来的分片发送)大约是分片数乘往返时间 滑动窗口接近一个往返加上传输时间
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetWindowBenchmark, "SimpleNetChannel.Benchmark.SlidingWindow", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetWindowBenchmark::RunTest(const FString& Parameters)
+{
+	const float Delay = 0.02f;
+	const float Loss = 0.005f;
+	const int32 Sizes[] = { 64 * 1024, 256 * 1024 };
+
+	const bool bSlidingWindows[] = { false, true };
+	for (bool bSlidingWindow : bSlidingWindows)
+	{
+		//两边都经过损伤层 往返时间是两倍的延迟
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bSlidingWindow = bSlidingWindow;
+		ScopedConfig.Info.bCompactHeader = false;
+		ScopedConfig.Info.bCoalesce = false;
+		ScopedConfig.Info.bRepackaging = true;
+		ScopedConfig.Info.RepackagingTime = 0.25f;
+		ScopedConfig.Info.bImpairment = true;
+		ScopedConfig.Info.ImpairmentDelay = Delay;
+		ScopedConfig.Info.ImpairmentLoss = Loss;
+		ScopedConfig.Apply();
+
+		FSimpleNetLoadConfig Config;
+		Config.ClientNum = 1;
+		Config.SendRate = 0.f;
+		Config.PingRate = 0.f;
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback client failed to join."));
+			return false;
+		}
+
+		FRandomStream Random(0);
+		for (int32 Size : Sizes)
+		{
+			FSimpleChannel* Channel = Loopback.GetClientChannel(0);
+			if (!Channel)
+			{
+				AddError(TEXT("Loopback client disconnected."));
+				return false;
+			}
+
+			//随机内容 不会被压缩
+			TArray<uint8> Payload;
+			Payload.SetNumUninitialized(Size);
+			for (auto& Tmp : Payload)
+			{
+				Tmp = (uint8)Random.RandHelper(256);
+			}
+
+			uint64 RecvNum = SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload);
+			double StartTime = FPlatformTime::Seconds();
+
+			SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Payload);
+
+			bool bRecv = Loopback.WaitUntil([&]()
+			{
+				return SimpleNetBenchmark::GetRecvNum(Loopback.GetServer(), SP_BenchPayload) > RecvNum;
+			}, 120.0);
+
+			double Seconds = FPlatformTime::Seconds() - StartTime;
+			if (!bRecv)
+			{
+				AddError(FString::Printf(TEXT("%i bytes were not delivered within 120 seconds."), Size));
+				return false;
+			}
+
+			int32 ChunkNum = FMath::DivideAndRoundUp(Size, ScopedConfig.Info.SendDataNumber);
+
+			SimpleNetBenchmark::Report(*this, FString::Printf(
+				TEXT("SlidingWindow=%i size=%iKB chunks=%i RTT=%.0fms loss=%.1f%% time=%.2fs goodput=%.1fKB/s"),
+				bSlidingWindow ? 1 : 0, Size / 1024, ChunkNum,
+				Delay * 2000.f, Loss * 100.f,
+				Seconds, Size / Seconds / 1024.0));
+		}
+	}
+
+	return true;
+}
+
+#endif
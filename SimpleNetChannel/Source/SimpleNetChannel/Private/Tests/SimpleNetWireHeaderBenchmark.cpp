@@ -0,0 +1,84 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Tests/SimpleNetBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//先录制一段移动同步的流量 再分别用原来的包头和紧凑包头回放 比较线上的字节数
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSimpleNetWireHeaderBenchmark, "SimpleNetChannel.Benchmark.WireHeader", SIMPLE_NET_BENCHMARK_FLAGS)
+bool FSimpleNetWireHeaderBenchmark::RunTest(const FString& Parameters)
+{
+	FSimpleNetLoadConfig Config;
+	Config.ClientNum = 8;
+	Config.SendRate = 20.f;
+	Config.PingRate = 0.f;
+	Config.Duration = 5.f;
+
+	//位置 朝向 速度
+	FSimpleNetLoadAction& Action = Config.Actions.AddDefaulted_GetRef();
+	Action.Name = TEXT("Move");
+	Action.Send = [](FSimpleChannel* Channel)
+	{
+		FVector Location(FMath::FRandRange(-1e4f, 1e4f), FMath::FRandRange(-1e4f, 1e4f), 100.f);
+		FRotator Rotation(0.f, FMath::FRandRange(-180.f, 180.f), 0.f);
+		float Speed = 600.f;
+		SIMPLE_PROTOCOLS_SEND(SP_BenchPayload, Location, Rotation, Speed);
+	};
+
+	FSimpleNetTrafficCapture Capture;
+	{
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.Start(Config) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback clients failed to join."));
+			return false;
+		}
+
+		Loopback.GetGenerator().Record(&Capture);
+		while (Loopback.Tick())
+		{
+		}
+	}
+
+	//紧凑包头需要滑动窗口 关掉合并发送 只比较包头
+	const bool bCompactHeaders[] = { false, true };
+	for (bool bCompactHeader : bCompactHeaders)
+	{
+		SimpleNetBenchmark::FScopedConfig ScopedConfig;
+		ScopedConfig.Info.bSlidingWindow = true;
+		ScopedConfig.Info.bCompactHeader = bCompactHeader;
+		ScopedConfig.Info.bCoalesce = false;
+		ScopedConfig.Apply();
+
+		SimpleNetBenchmark::FLoopback Loopback;
+		if (!Loopback.StartReplay(Config, &Capture) || !Loopback.WaitJoin())
+		{
+			AddError(TEXT("Loopback clients failed to join."));
+			return false;
+		}
+
+		FSimpleNetLoadReport StartReport = Loopback.GetGenerator().GetReport();
+		double StartTime = FPlatformTime::Seconds();
+
+		while (Loopback.Tick())
+		{
+		}
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		FSimpleNetLoadReport Report = Loopback.Stop();
+
+		uint64 SendNum = Report.SendNum - StartReport.SendNum;
+		uint64 BytesOut = Report.BytesOut - StartReport.BytesOut;
+
+		SimpleNetBenchmark::Report(*this, FString::Printf(
+			TEXT("WireHeader compact=%i messages=%llu bytes/message=%.1f bandwidth=%.1fKB/s"),
+			bCompactHeader ? 1 : 0, SendNum,
+			SendNum > 0 ? (double)BytesOut / SendNum : 0.0,
+			BytesOut / Seconds / 1024.0));
+	}
+
+	return true;
+}
+
+#endif
@@ -34,21 +34,25 @@ FSimpleNetThread::FSimpleNetThread(FSimpleDelegate InDelegate)
 
 FSimpleNetThread::~FSimpleNetThread()
 {
-	//用主线程把自己杀掉
-	FGraphEventRef Task = FFunctionGraphTask::CreateAndDispatchWhenReady([this]()
+	//不再切到主线程 唤醒后等它自己退出
+	bStopThread = true;
+
+	if (ThreadEvent)
 	{
-		//杀掉自己
-		Kill();
+		ThreadEvent->Trigger();
+	}
+
+	//杀掉自己
+	Kill();
 
-		// 事件使用完毕，返回到池中
+	// 事件使用完毕，返回到池中
+	if (ThreadEvent)
+	{
 		FPlatformProcess::ReturnSynchEventToPool(ThreadEvent);
 
 		// 确保不再使用这个指针
 		ThreadEvent = nullptr;
-
-	}, TStatId(), NULL, ENamedThreads::GameThread);
-
-	FTaskGraphInterface::Get().WaitUntilTaskCompletes(Task);
+	}
 }
 
 void FSimpleNetThread::Bind(FSimpleDelegate InDelegate)
@@ -76,22 +80,10 @@ uint32 FSimpleNetThread::Run()
 {
 	while (!bStopThread && ThreadEvent)
 	{
-		UE_LOG(LogSimpleNetChannel, Display, TEXT("The current thread is ready to suspend [%s]"),*RunnableName);
-		
 		ThreadEvent->Wait();
 
-		UE_LOG(LogSimpleNetChannel, Display, TEXT("[%s] Start executing new tasks."), *RunnableName);
-
-		FDateTime StartTime = FDateTime::Now();
-
 		Delegate.ExecuteIfBound();
 
-		FTimespan Duration = FDateTime::Now() - StartTime;
-
-		double TotalSeconds = Duration.GetTotalSeconds();
-
-		UE_LOG(LogSimpleNetChannel, Display, TEXT("[%s] Task completed.Spent %f s"), *RunnableName,TotalSeconds);
-
 		//解除绑定等待下一个任务来临
 		Delegate.Unbind();
 	}
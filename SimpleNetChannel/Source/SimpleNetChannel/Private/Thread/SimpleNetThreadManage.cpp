@@ -1,16 +1,103 @@
 #include "Thread/SimpleNetThreadManage.h"
-#include "Thread/SimpleNetThread.h"
 #include "Global/SimpleNetGlobalInfo.h"
 #include "Log/SimpleNetChannelLog.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/ScopeLock.h"
 #include "Async/Async.h"
 
+namespace SimpleNetThreadManage
+{
+	//当前线程是不是线程池的工作线程
+	thread_local bool bWorkerThread = false;
+}
+
+//常驻的工作线程 没有任务时挂在空闲列表上等待唤醒
+class FSimpleNetThreadManage::FWorker :public FRunnable
+{
+public:
+	FWorker(FSimpleNetThreadManage* InManage, int32 InIndex)
+		:Manage(InManage)
+		, Thread(nullptr)
+		, ThreadEvent(FPlatformProcess::GetSynchEventFromPool())
+		, bStopThread(false)
+	{
+		Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("SimpleNetWorker-%i"), InIndex), 0, TPri_Normal);
+	}
+
+	virtual ~FWorker()
+	{
+		if (Thread)
+		{
+			Thread->Kill(true);
+
+			delete Thread;
+			Thread = nullptr;
+		}
+
+		FPlatformProcess::ReturnSynchEventToPool(ThreadEvent);
+		ThreadEvent = nullptr;
+	}
+
+	virtual uint32 Run() override
+	{
+		SimpleNetThreadManage::bWorkerThread = true;
+
+		TArray<FSimpleDelegate> Tasks;
+		Tasks.Reserve(Manage->BatchNumber);
+
+		while (!bStopThread)
+		{
+			int32 Lane = INDEX_NONE;
+			if (!Manage->PopBatch(this, Tasks, Lane))
+			{
+				ThreadEvent->Wait();
+				continue;
+			}
+
+			for (auto& Tmp : Tasks)
+			{
+				Tmp.ExecuteIfBound();
+			}
+
+			Manage->FinishBatch(Lane, Tasks.Num());
+			Tasks.Reset();
+		}
+
+		return 0;
+	}
+
+	virtual void Stop() override
+	{
+		bStopThread = true;
+		ThreadEvent->Trigger();
+	}
+
+	void Wake()
+	{
+		ThreadEvent->Trigger();
+	}
+
+	//由管理器持有QueueMutex时设置
+	FSimpleDelegate LongTask;
+
+private:
+	FSimpleNetThreadManage* Manage;
+	FRunnableThread* Thread;
+	FEvent* ThreadEvent;
+	FThreadSafeBool bStopThread;
+};
+
 FSimpleNetThreadManage* FSimpleNetThreadManage::Instance = nullptr;
 
 FSimpleNetThreadManage* FSimpleNetThreadManage::Get()
 {
 	if (!Instance)
 	{
-		Instance = new FSimpleNetThreadManage(FSimpleNetGlobalInfo::Get()->GetInfo().NumberThreads);
+		const FSimpleConfigInfo& ConfigInfo = FSimpleNetGlobalInfo::Get()->GetInfo();
+
+		Instance = new FSimpleNetThreadManage(ConfigInfo.NumberThreads, ConfigInfo.TaskQueueSize, ConfigInfo.TaskBatchNumber);
 	}
 
 	return Instance;
@@ -21,46 +108,197 @@ void FSimpleNetThreadManage::Destroy()
 	if (Instance)
 	{
 		delete Instance;
+		Instance = nullptr;
 	}
 }
 
-FSimpleNetThreadManage::FSimpleNetThreadManage(int32 InNumThreads)
+FSimpleNetThreadManage::FSimpleNetThreadManage(int32 InNumThreads, int32 InQueueSize, int32 InBatchNumber)
+	:LongTaskNum(0)
+	, QueueSize(FMath::Max(InQueueSize, 1))
+	, BatchNumber(FMath::Max(InBatchNumber, 1))
 {
+	InNumThreads = FMath::Max(InNumThreads, 1);
+
+	//队列要先准备好 线程创建后马上会来取任务
+	Lanes.SetNum(InNumThreads);
+	for (auto& Tmp : Lanes)
+	{
+		Tmp.SpaceEvent = FPlatformProcess::GetSynchEventFromPool();
+	}
+
+	IdleWorkers.Reserve(InNumThreads);
+
 	for (int32 i = 0; i < InNumThreads; ++i)
 	{
-		TaskQueue.Add(MakeShareable(new FSimpleNetThread()));
+		Workers.Add(MakeUnique<FWorker>(this, i));
 	}
+
+	UE_LOG(LogSimpleNetChannel, Display, TEXT("Thread pool creation [%i] threads"), InNumThreads);
 }
 
 FSimpleNetThreadManage::~FSimpleNetThreadManage()
 {
-	TaskQueue.Empty();
+	//先全部通知退出 再逐个等待
+	for (auto& Tmp : Workers)
+	{
+		Tmp->Stop();
+	}
+
+	Workers.Empty();
+
+	for (auto& Tmp : Lanes)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(Tmp.SpaceEvent);
+		Tmp.SpaceEvent = nullptr;
+	}
 }
 
-void FSimpleNetThreadManage::AddTask(const FSimpleDelegate &InTask)
+void FSimpleNetThreadManage::AddTask(FSimpleDelegate InTask, uint32 InAffinity)
 {
-	//寻找不忙的线程
-	TSharedPtr<FSimpleNetThread,ESPMode::ThreadSafe> NotBusyThread;
-	for (auto &Tmp : TaskQueue)
+	int32 LaneIndex = InAffinity % (uint32)Lanes.Num();
+	FLane& Lane = Lanes[LaneIndex];
+
+	FWorker* Worker = nullptr;
+	for (;;)
 	{
-		if (!Tmp->IsBusy())
 		{
-			NotBusyThread = Tmp;
-			break;
+			FScopeLock ScopeLock(&QueueMutex);
+
+			if (Lane.Tasks.Num < QueueSize || SimpleNetThreadManage::bWorkerThread)
+			{
+				Lane.Tasks.Push(MoveTemp(InTask));
+
+				//正在执行的通道由执行它的线程接着取 不需要唤醒别人
+				if (!Lane.bClaimed && !Lane.bReady)
+				{
+					Lane.bReady = true;
+					ReadyLanes.Push(LaneIndex);
+
+					Worker = PopIdleWorker();
+				}
+
+				//还有空位 轮到下一个等待的生产者
+				if (Lane.WaitingNum > 0 && Lane.Tasks.Num < QueueSize)
+				{
+					Lane.SpaceEvent->Trigger();
+				}
+
+				break;
+			}
+
+			Lane.WaitingNum++;
 		}
+
+		//通道满了 等工作线程取走一批再试
+		Lane.SpaceEvent->Wait();
+
+		FScopeLock ScopeLock(&QueueMutex);
+		Lane.WaitingNum--;
 	}
 
-	if (NotBusyThread) //找到该线程
+	if (Worker)
 	{
-		NotBusyThread->Bind(InTask);
-		NotBusyThread->Trigger();//激活
+		Worker->Wake();
 	}
-	else //未找到 可能工作区已经满额 使用UE5本身的线程
+}
+
+void FSimpleNetThreadManage::AddLongTask(const FSimpleDelegate& InTask)
+{
+	FWorker* Worker = nullptr;
+	{
+		FScopeLock ScopeLock(&QueueMutex);
+
+		if (LongTaskNum < Workers.Num() - 1)
+		{
+			Worker = PopIdleWorker();
+			if (Worker)
+			{
+				Worker->LongTask = InTask;
+				LongTaskNum++;
+			}
+		}
+	}
+
+	if (Worker)
 	{
+		Worker->Wake();
+	}
+	else //没有空闲的线程 使用UE5本身的线程
+	{
+		OverflowNum.Increment();
+
 		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask,
 		[InTask]()
 		{
 			InTask.ExecuteIfBound();
 		});
 	}
-}
\ No newline at end of file
+}
+
+bool FSimpleNetThreadManage::PopBatch(FWorker* InWorker, TArray<FSimpleDelegate>& OutTasks, int32& OutLane)
+{
+	FScopeLock ScopeLock(&QueueMutex);
+
+	if (InWorker->LongTask.IsBound())
+	{
+		OutTasks.Add(MoveTemp(InWorker->LongTask));
+		InWorker->LongTask.Unbind();
+
+		OutLane = LongTaskLane;
+		return true;
+	}
+
+	//有序的通道优先 一次只有一个线程执行同一条通道
+	if (ReadyLanes.Num > 0)
+	{
+		OutLane = ReadyLanes.Pop();
+
+		FLane& Lane = Lanes[OutLane];
+		Lane.bReady = false;
+		Lane.bClaimed = true;
+
+		while (Lane.Tasks.Num > 0 && OutTasks.Num() < BatchNumber)
+		{
+			OutTasks.Add(Lane.Tasks.Pop());
+		}
+
+		//腾出了空位 唤醒等待的生产者
+		if (Lane.WaitingNum > 0)
+		{
+			Lane.SpaceEvent->Trigger();
+		}
+
+		return true;
+	}
+
+	IdleWorkers.Add(InWorker);
+	return false;
+}
+
+void FSimpleNetThreadManage::FinishBatch(int32 InLane, int32 InNum)
+{
+	if (InLane == LongTaskLane)
+	{
+		FScopeLock ScopeLock(&QueueMutex);
+		LongTaskNum--;
+		return;
+	}
+
+	CompletedNum.Add(InNum);
+
+	FScopeLock ScopeLock(&QueueMutex);
+
+	//执行期间又加入的任务 重新排队 和其他通道轮流执行
+	FLane& Lane = Lanes[InLane];
+	Lane.bClaimed = false;
+	if (Lane.Tasks.Num > 0)
+	{
+		Lane.bReady = true;
+		ReadyLanes.Push(InLane);
+	}
+}
+
+FSimpleNetThreadManage::FWorker* FSimpleNetThreadManage::PopIdleWorker()
+{
+	return IdleWorkers.Num() > 0 ? IdleWorkers.Pop(false) : nullptr;
+}
@@ -3,9 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
 
-class FSimpleNetThread;
-
+//线程池 任务放进有界队列 工作线程一直从队列里成批取出执行 不再每个任务唤醒一次
+//同一个亲和键的任务放在同一条通道里按顺序执行 不同的通道可以并行
+//例如共享端口收到的数据报按客户端地址放进通道 接收线程只负责收 解析交给这里
 class SIMPLENETCHANNEL_API FSimpleNetThreadManage
 {
 public:
@@ -13,15 +15,114 @@ public:
 	static void Destroy();
 
 public:
-	FSimpleNetThreadManage(int32 InNumThreads);
+	FSimpleNetThreadManage(int32 InNumThreads, int32 InQueueSize, int32 InBatchNumber);
 
 	~FSimpleNetThreadManage();
 
-	void AddTask(const FSimpleDelegate& InTask);
+	//InAffinity相同的任务按加入的顺序执行 例如用客户端地址保证一个链接的任务有序
+	//通道满了外部线程挂起等待工作线程取走 工作线程自己加入的不等 避免等待自己
+	void AddTask(FSimpleDelegate InTask, uint32 InAffinity);
+
+	//一直运行的任务(例如独立端口的监听循环) 独占一个空闲的工作线程直到返回
+	//至少留一个线程处理队列 没有空闲的使用UE5本身的线程
+	void AddLongTask(const FSimpleDelegate& InTask);
+
+	int32 GetNumThreads() const { return Workers.Num(); }
+
+	//执行完的短任务数 和因为没有空闲线程交给UE5线程的长任务数
+	int64 GetCompletedNum() const { return CompletedNum.GetValue(); }
+	int64 GetOverflowNum() const { return OverflowNum.GetValue(); }
+
+protected:
+	class FWorker;
+	friend class FWorker;
+
+	//环形队列 满了扩容 是否有界由调用方判断
+	template<typename T>
+	struct TRing
+	{
+		TRing()
+			:Head(0)
+			, Num(0)
+		{}
+
+		void Push(T InValue)
+		{
+			if (Num == Data.Num())
+			{
+				TArray<T> NewData;
+				NewData.SetNum(FMath::Max(Num * 2, 16));
+				for (int32 i = 0; i < Num; i++)
+				{
+					NewData[i] = MoveTemp(Data[(Head + i) % Data.Num()]);
+				}
+
+				Data = MoveTemp(NewData);
+				Head = 0;
+			}
+
+			Data[(Head + Num) % Data.Num()] = MoveTemp(InValue);
+			Num++;
+		}
+
+		T Pop()
+		{
+			T Value = MoveTemp(Data[Head]);
+			Data[Head] = T();//释放委托持有的负载
+
+			Head = (Head + 1) % Data.Num();
+			Num--;
+
+			return Value;
+		}
+
+		TArray<T> Data;
+		int32 Head;
+		int32 Num;
+	};
+
+	struct FLane
+	{
+		FLane()
+			:bClaimed(false)
+			, bReady(false)
+			, WaitingNum(0)
+			, SpaceEvent(nullptr)
+		{}
+
+		TRing<FSimpleDelegate> Tasks;
+		bool bClaimed;//有工作线程正在执行这条通道的任务
+		bool bReady;//已经在ReadyLanes里
+
+		//通道满了 等待空位的生产者
+		int32 WaitingNum;
+		FEvent* SpaceEvent;
+	};
+
+	//取一批任务 没有任务时把自己挂到空闲列表并返回false
+	//OutLane为通道 长任务为LongTaskLane
+	bool PopBatch(FWorker* InWorker, TArray<FSimpleDelegate>& OutTasks, int32& OutLane);
+	void FinishBatch(int32 InLane, int32 InNum);
+
+	//持有QueueMutex时调用
+	FWorker* PopIdleWorker();
+
+	static const int32 LongTaskLane = -2;
 
 protected:
 	static FSimpleNetThreadManage *Instance;
 
-	// 应该有一个线程安全的任务队列
-    TArray<TSharedPtr<FSimpleNetThread,ESPMode::ThreadSafe>> TaskQueue;
-};
\ No newline at end of file
+	TArray<TUniquePtr<FWorker>> Workers;
+	TArray<FLane> Lanes;
+
+	FCriticalSection QueueMutex;//保护下面的队列和空闲列表
+	TRing<int32> ReadyLanes;
+	TArray<FWorker*> IdleWorkers;
+	int32 LongTaskNum;
+
+	int32 QueueSize;
+	int32 BatchNumber;
+
+	FThreadSafeCounter64 CompletedNum;
+	FThreadSafeCounter64 OverflowNum;
+};
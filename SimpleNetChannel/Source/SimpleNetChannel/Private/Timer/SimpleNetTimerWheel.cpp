@@ -0,0 +1,199 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#include "Timer/SimpleNetTimerWheel.h"
+#include "Misc/ScopeLock.h"
+
+FSimpleNetTimerWheel::FSimpleNetTimerWheel(float InTickInterval)
+	:TickInterval(FMath::Max(InTickInterval, 0.001f))
+	, Time(0.0)
+	, PendingTime(0.0)
+	, CurrentTick(0)
+	, ActiveNum(0)
+{
+}
+
+FSimpleNetTimerWheel::FHandle FSimpleNetTimerWheel::Schedule(float InDelay, const FSimpleDelegate& InDelegate)
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	uint32 Index = 0;
+	if (FreeTimers.Num() > 0)
+	{
+		Index = FreeTimers.Pop(false);
+	}
+	else
+	{
+		Index = Timers.AddDefaulted();
+	}
+
+	//至少等到下一格 不会在本次Advance内执行
+	uint64 DelayTick = FMath::Max<uint64>((uint64)FMath::CeilToDouble(FMath::Max(InDelay, 0.f) / TickInterval), 1);
+
+	FTimer& Timer = Timers[Index];
+	Timer.Generation++;
+	Timer.Expire = CurrentTick + DelayTick;
+	Timer.bActive = true;
+	Timer.Delegate = InDelegate;
+
+	Insert(Index);
+	ActiveNum++;
+
+	return ((uint64)Timer.Generation << 32) | ((uint64)Index + 1);
+}
+
+bool FSimpleNetTimerWheel::Cancel(FHandle InHandle)
+{
+	if (InHandle == 0)
+	{
+		return false;
+	}
+
+	FScopeLock ScopeLock(&Mutex);
+
+	uint32 Index = (uint32)(InHandle & MAX_uint32) - 1;
+	uint32 Generation = (uint32)(InHandle >> 32);
+	if (Timers.IsValidIndex(Index))
+	{
+		FTimer& Timer = Timers[Index];
+		if (Timer.bActive && Timer.Generation == Generation)
+		{
+			//格子里的记录等到轮到它时再清理
+			Timer.bActive = false;
+			Timer.Delegate.Unbind();
+			FreeTimers.Add(Index);
+			ActiveNum--;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FSimpleNetTimerWheel::Insert(uint32 InIndex)
+{
+	const FTimer& Timer = Timers[InIndex];
+
+	FEntry Entry;
+	Entry.Index = InIndex;
+	Entry.Generation = Timer.Generation;
+
+	uint64 Delta = Timer.Expire > CurrentTick ? Timer.Expire - CurrentTick : 0;
+	for (int32 Level = 0; Level < LevelNum; Level++)
+	{
+		//最高层放不下的先放在最远的格子 转下来时重新计算
+		if (Delta < ((uint64)SlotNum << (Level * SlotBits)) || Level == LevelNum - 1)
+		{
+			uint64 Expire = FMath::Min(Timer.Expire, CurrentTick + ((uint64)SlotNum << (Level * SlotBits)) - 1);
+			Wheels[Level][(Expire >> (Level * SlotBits)) & (SlotNum - 1)].Add(Entry);
+			break;
+		}
+	}
+}
+
+bool FSimpleNetTimerWheel::IsValidEntry(const FEntry& InEntry) const
+{
+	const FTimer& Timer = Timers[InEntry.Index];
+	return Timer.bActive && Timer.Generation == InEntry.Generation;
+}
+
+void FSimpleNetTimerWheel::Cascade(int32 InLevel)
+{
+	TArray<FEntry> Entries = MoveTemp(Wheels[InLevel][(CurrentTick >> (InLevel * SlotBits)) & (SlotNum - 1)]);
+	for (const FEntry& Entry : Entries)
+	{
+		if (IsValidEntry(Entry))
+		{
+			Insert(Entry.Index);
+		}
+	}
+}
+
+void FSimpleNetTimerWheel::Advance(float DeltaSeconds)
+{
+	TArray<FSimpleDelegate> Expired;
+
+	{
+		FScopeLock ScopeLock(&Mutex);
+
+		Time += DeltaSeconds;
+		PendingTime += DeltaSeconds;
+
+		while (PendingTime >= TickInterval)
+		{
+			PendingTime -= TickInterval;
+			CurrentTick++;
+
+			//低层转完一圈 把上一层对应格子里的定时器分散下来
+			for (int32 Level = 1; Level < LevelNum; Level++)
+			{
+				if ((CurrentTick & (((uint64)1 << (Level * SlotBits)) - 1)) != 0)
+				{
+					break;
+				}
+
+				Cascade(Level);
+			}
+
+			TArray<FEntry>& Slot = Wheels[0][CurrentTick & (SlotNum - 1)];
+			for (const FEntry& Entry : Slot)
+			{
+				if (IsValidEntry(Entry))
+				{
+					FTimer& Timer = Timers[Entry.Index];
+					if (Timer.Expire <= CurrentTick)
+					{
+						Expired.Add(MoveTemp(Timer.Delegate));
+
+						Timer.bActive = false;
+						FreeTimers.Add(Entry.Index);
+						ActiveNum--;
+					}
+					else
+					{
+						Insert(Entry.Index);
+					}
+				}
+			}
+
+			Slot.Reset();
+		}
+	}
+
+	//回调里可能会重新注册 放在锁外面执行
+	for (FSimpleDelegate& Delegate : Expired)
+	{
+		Delegate.ExecuteIfBound();
+	}
+}
+
+void FSimpleNetTimerWheel::Reset()
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	for (int32 Level = 0; Level < LevelNum; Level++)
+	{
+		for (int32 i = 0; i < SlotNum; i++)
+		{
+			Wheels[Level][i].Empty();
+		}
+	}
+
+	//保留Generation 旧的句柄依然无效
+	FreeTimers.Reset();
+	for (int32 i = 0; i < Timers.Num(); i++)
+	{
+		Timers[i].bActive = false;
+		Timers[i].Delegate.Unbind();
+		FreeTimers.Add(i);
+	}
+
+	ActiveNum = 0;
+}
+
+int32 FSimpleNetTimerWheel::GetActiveNum() const
+{
+	FScopeLock ScopeLock(&Mutex);
+
+	return ActiveNum;
+}
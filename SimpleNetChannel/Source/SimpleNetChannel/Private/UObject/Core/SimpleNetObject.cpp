@@ -8,7 +8,7 @@
 USimpleNetworkObject::USimpleNetworkObject()
 {
 	bPing = false;
-	PingTime = 0.f;
+	PingTimer = 0;
 }
 
 void USimpleNetworkObject::Init()
@@ -18,6 +18,13 @@ void USimpleNetworkObject::Init()
 
 void USimpleNetworkObject::Tick(float DeltaTime)
 {
+	
+}
+
+void USimpleNetworkObject::OnPingTimeout()
+{
+	PingTimer = 0;
+
 	//检测ping是否超时
 	if (bPing)
 	{
@@ -25,16 +32,10 @@ void USimpleNetworkObject::Tick(float DeltaTime)
 		{
 			if (GetConnetion()->GetState() == ESimpleConnetionLinkType::LINK_JOIN)
 			{
-				PingTime += DeltaTime;
-				if (PingTime >= FSimpleNetGlobalInfo::Get()->GetInfo().PingMaxOutTime)
-				{
-					//超时
-					PingTime = 0.f;
+				//超时
+				bPing = false;
 
-					bPing = false;
-
-					BuildUnlinked(ESimpleNetManagePingType::OUTTIME);
-				}
+				BuildUnlinked(ESimpleNetManagePingType::OUTTIME);
 			}
 		}	
 	}
@@ -75,6 +76,14 @@ void USimpleNetworkObject::Ping()
 		SIMPLE_PROTOCOLS_SEND(SP_PingRequest);
 
 		bPing = true;
+
+		if (FSimpleNetTimerWheel* TimerWheel = GetConnetion()->GetTimerWheel())
+		{
+			TimerWheel->Cancel(PingTimer);
+			PingTimer = TimerWheel->Schedule(
+				FSimpleNetGlobalInfo::Get()->GetInfo().PingMaxOutTime,
+				FSimpleDelegate::CreateUObject(this, &USimpleNetworkObject::OnPingTimeout));
+		}
 	}
 	else
 	{
@@ -122,10 +131,16 @@ void USimpleNetworkObject::RecvProtocol(uint32 InProtocol)
 	{
 		case SP_PingResponse:
 		{
-			//超时
-			PingTime = 0.f;
-			
 			bPing = false;
+
+			if (TSharedPtr<FSimpleConnetion> Connetion = GetConnetion())
+			{
+				if (FSimpleNetTimerWheel* TimerWheel = Connetion->GetTimerWheel())
+				{
+					TimerWheel->Cancel(PingTimer);
+				}
+			}
+			PingTimer = 0;
 			break;
 		}
 	}
@@ -2,6 +2,8 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include "SimpleNetChannelType.h"
+#include "Timer/SimpleNetTimerWheel.h"
 
 //主要针对发送的散包，比如大型文章，无法一口气发送好几兆的数据，我们需要把数据切成一段段的，batch就是这一段
 //这个类是用来管理这些
@@ -15,47 +17,80 @@ public:
 	{
 		FBatch()
 			:bAck(false)
+			, AckBase(0)
+			, NextSend(0)
+			, DupAckCount(0)
+			, HandshakeRepeatCount(0)
+			, HandshakeTime(0.0)
+			, RepackagingTimer(0)
 		{}
 		struct FElement
 		{
 			FElement()
 				:bStartUpRepackaging(false)
 				, bAck(false)
+				, bFastRetransmitted(false)
 				, RepeatCount(0)
-				, CurrentTime(0.f)
+				, SendTime(0.0)
 			{}
 
 			bool bStartUpRepackaging;//
 			bool bAck;
+			bool bFastRetransmitted;//快速重传只做一次 之后交给超时重传
 			uint8 RepeatCount;//
-			float CurrentTime;
+			double SendTime;//最后一次发送的时间 时间轮的时间
 
 			TArray<uint8> Package;
+			FSimpleSharedSlice Body;//广播时包体共享 Package里只有包头
 		};
 
 		bool bAck;
 		TMap<int32, FElement> Sequence;
+
+		//滑动窗口
+		int32 AckBase;//对方连续收到的分片数 之前的都已确认
+		int32 NextSend;//下一个要首次发送的分片
+		uint8 DupAckCount;//重复确认次数 达到3次快速重传
+
+		//握手包 对方回应之前需要重发
+		TArray<uint8> Handshake;
+		int32 HandshakeRepeatCount;
+		double HandshakeTime;
+
+		//重传定时器 删除批次时取消
+		FSimpleNetTimerWheel::FHandle RepackagingTimer;
 	};
 
 public:
 	FSimpleNetBatchManage();
 	virtual ~FSimpleNetBatchManage();
 
-public:
-	FSimpleNetBatchManage::FBatch& operator[](const FGuid& InGuid)
-	{
-		return Batchs[InGuid];
-	}
-
 public:
 	void SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionPtr);
-	virtual void Tick(float DeltaSeconds);
 
-	void Add(const FGuid& InGuid, const FSimpleNetBatchManage::FBatch& InCache);
-	FSimpleNetBatchManage::FBatch* Find(const FGuid& InGuid);
+	//当前时间 和重传定时器使用同一个时钟
+	double GetTime() const;
+
+	//批次在外面填好再加入 加入后只能通过WithBatch访问
+	void Add(const FGuid& InGuid, FSimpleNetBatchManage::FBatch&& InCache);
+
+	//在锁里访问批次 找不到返回false
+	//不要把批次或者分片的引用带出回调 重传定时器随时可能删除批次
+	bool WithBatch(const FGuid& InGuid, TFunctionRef<void(FSimpleNetBatchManage::FBatch&)> InFunc);
 	void Remove(const FGuid& InGuid);
 	void Reset();
 
+protected:
+	FSimpleNetTimerWheel* GetTimerWheel() const;
+
+	//每个批次一个重传定时器 到期时检查需要补发的分片 再按最早的到期时间重新注册
+	//持有BatchsReadWrite时调用
+	void ScheduleRepackaging(FSimpleNetBatchManage::FBatch& InBatch, const FGuid& InGuid, float InDelay);
+	void Repackaging(FGuid InGuid);
+
+	//持有BatchsReadWrite时调用 取消重传定时器 没确认的分片还给拥塞控制
+	void Discard(FSimpleNetBatchManage::FBatch& InBatch);
+
 protected:
 	TWeakPtr<FSimpleConnetion> ConnetionPtr;
 	TMap<FGuid, FBatch> Batchs;
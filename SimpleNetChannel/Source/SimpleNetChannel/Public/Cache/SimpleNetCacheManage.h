@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 
 //主要针对缓存，比如服务器客户端发过来的一段段散包，当数量达到要求，会合成一个整包，这个函数是散包缓存
+//整包的内存在握手时一次分配好 从连接自己的缓冲池里取 交付以后还回去给下一个包用
 class SIMPLENETCHANNEL_API FSimpleNetCacheManage
 {
 public:
@@ -18,7 +19,27 @@ public:
 		uint32 TotalSize;
 		TArray<uint8> Cache;
 
+		//按分片接收 乱序到达直接写到对应位置
+		uint32 ChunkSize;
+		uint32 RecvSize;
+		int32 AckBase;//连续收到的分片数
+		TBitArray<> Received;
+
+		double StartTime;//创建的时间 统计合包耗时
+
 		void Reset();
+
+		//ChunkSize为0表示不分片
+		void Init(uint32 InTotalSize, uint32 InChunkSize);
+
+		//写入分片 长度不对或越界返回false 重复分片直接忽略
+		bool Write(int32 InIndex, const uint8* InData, int32 InLen);
+
+		//第i位代表AckBase+1+i号分片已经收到
+		uint32 GetAckBits() const;
+
+		FORCEINLINE int32 GetChunkNum() const { return Received.Num(); }
+		FORCEINLINE bool IsComplete() const { return Received.Num() > 0 && AckBase >= Received.Num(); }
 	};
 
 public:
@@ -28,12 +49,39 @@ public:
 	}
 
 public:
-	void Add(const FGuid &InGuid,const FSimpleNetCacheManage::FCache &InCache);
+	//按整包大小分配好缓存 ChunkSize为0表示不分片 大小非法返回空
+	FSimpleNetCacheManage::FCache* Create(const FGuid& InGuid, uint32 InTotalSize, uint32 InChunkSize);
 	FSimpleNetCacheManage::FCache* Find(const FGuid& InGuid);
+
+	//缓存的内存还回缓冲池
 	void Remove(const FGuid& InGuid);
+
+	//链接关闭 缓冲池一起释放
 	void Reset();
 
+	//向系统申请内存的次数和复用的次数
+	FORCEINLINE uint64 GetAllocateNum() const { return AllocateNum; }
+	FORCEINLINE uint64 GetReuseNum() const { return ReuseNum; }
+
+protected:
+	TArray<uint8> AcquireBuffer(uint32 InSize);
+	void ReleaseBuffer(TArray<uint8>& InBuffer);
+
 protected:
 	TMap<FGuid, FCache> Caches;
 	FCriticalSection CachesReadWrite;//针对缓存锁 
+
+	//按2的幂分级的空闲缓冲 最小1KB 最大1MB 更大的包用完直接释放
+	enum
+	{
+		MinBufferBits = 10,
+		MaxBufferBits = 20,
+		BufferClassNum = MaxBufferBits - MinBufferBits + 1,
+	};
+
+	TArray<TArray<uint8>> FreeBuffers[BufferClassNum];
+	uint32 FreeBufferSize;//池里缓存的总字节数 不超过CacheArenaSize
+
+	uint64 AllocateNum;
+	uint64 ReuseNum;
 };
\ No newline at end of file
@@ -2,24 +2,46 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include <atomic>
 
 //主要针对将包传递过来后存储在本地，方便逻辑那边取出里面的数据
 //这个类是用来管理这些
+//每个通道一个多生产者单消费者环形队列 网络线程写入 分发协议的线程读取
+//消息ID就是在环里的位置 不需要生成GUID 写入和读取只用原子操作
+//满了以后扩容 扩容时才需要独占 扩到MsgQueueMaxSize后拒收新消息
 
-class FSimpleConnetion;
+//队列统计 扩容次数和最大积压可以用来判断消费者是否跟得上
+struct SIMPLENETCHANNEL_API FSimpleNetMsgQueueStats
+{
+	FSimpleNetMsgQueueStats()
+		:Pushed(0)
+		, Received(0)
+		, Discarded(0)
+		, Grown(0)
+		, Rejected(0)
+		, Capacity(0)
+		, HighWater(0)
+	{}
+
+	int64 Pushed;//成功写入
+	int64 Received;//被协议取走
+	int64 Discarded;//没有被取走就过期
+	int64 Grown;//队列满了扩容的次数
+	int64 Rejected;//到了容量上限被拒收
+	int64 Capacity;//当前容量
+	int64 HighWater;//最大积压
+};
 
 class SIMPLENETCHANNEL_API FSimpleNetMsgBatchPackageManage
 {
 public:
-	struct FMsgBatchPackage
+	struct FSlot
 	{
-		FMsgBatchPackage();
-
-		void Tick(float DeltaSeconds);
-
-		float CurrentTime;
-		bool bOutTime;
+		FSlot()
+			:Sequence(0)
+		{}
 
+		std::atomic<uint64> Sequence;
 		TArray<uint8> Data;
 	};
 
@@ -27,25 +49,54 @@ public:
 	FSimpleNetMsgBatchPackageManage();
 	virtual ~FSimpleNetMsgBatchPackageManage();
 
-public:
-	FSimpleNetMsgBatchPackageManage::FMsgBatchPackage& operator[](const FGuid& InGuid)
-	{
-		return MsgQueue[InGuid];
-	}
+	//队列里的消息属于当前通道 拷贝出来的是一个空队列
+	FSimpleNetMsgBatchPackageManage(const FSimpleNetMsgBatchPackageManage& InOther);
+	FSimpleNetMsgBatchPackageManage& operator=(const FSimpleNetMsgBatchPackageManage& InOther);
 
 public:
-	void SetMsgQueueGuid(const FGuid& InNewGuid);
-	void SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionPtr);
-	virtual void Tick(float DeltaSeconds);
+	//消费者 设置当前正在分发的消息 比它旧的消息已经没人会取了 直接丢弃
+	void SetMsgQueueID(uint64 InID);
+	uint64 GetMsgQueueID() const { return MsgQueueID; }
+
+	//生产者 返回消息ID 从1开始 队列满了扩容后再写入
+	//已经扩到上限还是满的话返回0 消息不会写入
+	uint64 Add(TArray<uint8>& InData);
 
-	void Add(const FGuid& InGuid, TArray<uint8>& InData);
+	//消费者 取出当前消息
 	bool Receive(TArray<uint8>& InData);
 
 	void Reset();
 
+	FSimpleNetMsgQueueStats GetStats() const;
+
 protected:
-	TWeakPtr<FSimpleConnetion> ConnetionPtr;
-	FGuid MsgQueueGuid;
-	TMap<FGuid, FSimpleNetMsgBatchPackageManage::FMsgBatchPackage> MsgQueue;
-	FCriticalSection ThreadCritical;//对资源上锁 防止读取和写入 导致数据错乱
-};
\ No newline at end of file
+	//持有SlotsLock的读锁 队列没有分配或者满了返回false
+	bool TryAdd(TArray<uint8>& InData, uint64& OutID);
+
+	//持有SlotsLock的写锁 第一次写入时分配 满了容量翻倍
+	//已经到了上限返回false
+	bool Grow();
+
+	//消费者 队头准备好了返回true 生产者已经占位但还没写完的话等待
+	bool WaitForHead(FSlot*& OutSlot);
+	void PopHead(FSlot& InSlot);
+
+protected:
+	//第一次写入时分配 大部分通道不会收到消息
+	//读写都持有读锁 只有扩容持有写锁
+	FRWLock SlotsLock;
+	FSlot* Slots;
+	uint64 Capacity;
+	uint64 MaxCapacity;
+
+	std::atomic<uint64> EnqueuePos;
+	uint64 DequeuePos;
+	uint64 MsgQueueID;
+
+	FThreadSafeCounter64 Pushed;
+	int64 Received;
+	int64 Discarded;
+	int64 HighWater;
+	int64 Grown;
+	FThreadSafeCounter64 Rejected;
+};
@@ -6,12 +6,14 @@
 #include "Misc/ScopeLock.h"
 #include "Cache/SimpleNetBatchManage.h"
 #include "Cache/SimpleNetMsgBatchPackageManage.h"
+#include "Replication/SimpleNetReplication.h"
 
 DECLARE_DELEGATE_RetVal(UClass*, FSimpleReturnDelegate);
 
 class USimpleNetworkObject;
 class FSimpleConnetion;
 class FInternetAddr;
+class FEvent;
 
 class SIMPLENETCHANNEL_API FSimpleChannel
 {
@@ -30,11 +32,27 @@ public:
 
 	virtual void RecvProtocol(uint32 InProtocolsNumber);
 
+	//网络线程收到协议 控制器还在主线程创建的话先缓存 创建好以后按顺序交付
+	void DispatchProtocol(uint32 InProtocolsNumber, uint64 InMsgID, uint64 InTag);
+
 	void Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNewAddr,bool bForceSend = false);
 	void Send(TArray<uint8>& InData,bool bForceSend = false);
 
+	//广播用 包体已经序列化 这里只生成这个接收者的包头 只支持异步协议
+	void SendShared(const FSimpleBunchHead& InHead, const FSimpleSharedBody& InBody, TSharedPtr<FInternetAddr> InNewAddr, bool bForceSend = false);
+
+	//转成共享包体 所有接收者引用同一份
+	static FSimpleSharedBody MakeSharedBody(TArray<uint8>& InBody);
+
+	//先取当前线程的直接消息 再取消息队列里正在分发的消息
 	bool Receive(TArray<uint8>& InData);
 
+	//网络线程直接处理的协议(例如握手) 不经过消息队列 只有当前线程接下来的Receive能取到
+	void SetThreadMsg(TArray<uint8>& InData);
+
+	//同步协议的回应 不经过消息队列 交给等待的发送线程
+	void AcceptSynchronize(uint64 InTag, TArray<uint8>& InData);
+
 	TSharedPtr<FInternetAddr> GetLocalAddr() const;
 	TSharedPtr<FInternetAddr> GetRemoteAddr() const;
 
@@ -42,7 +60,12 @@ public:
 
 	TSharedPtr<FSimpleConnetion >GetConnetion();
 
-	void AddMsg(const FGuid &InGuid,TArray<uint8> &InData);
+	//返回消息ID 从1开始 队列满了扩容
+	uint64 AddMsg(TArray<uint8> &InData);
+	FSimpleNetMsgQueueStats GetMsgQueueStats() const;
+
+	//结构体状态的差量同步
+	FSimpleNetReplication& GetReplication() { return Replication; }
 
 	void InitController();
 	void SpawnController();
@@ -62,35 +85,104 @@ public:
 	void AcceptSuccess(const FGuid &InDataID,uint32 InIndex,bool bAck,bool bAllSuccessful = false);
 	void SendBatch(const FGuid& InDataID, uint32 InIndex,uint32 InProtocol);
 
+	//滑动窗口 把窗口内还没有发送过的分片发出去
+	//拥塞控制打开时窗口不超过拥塞窗口 交给连接的发送调度按优先级发送
+	void SendWindow(const FGuid& InDataID);
+
+	//窗口内下一个要发送的分片大小 窗口满了或者发完了返回INDEX_NONE
+	int32 GetWindowElementSize(const FGuid& InDataID);
+
+	//发送窗口内的下一个分片
+	void SendWindowElement(const FGuid& InDataID);
+
+	//对方回应了握手 准备好接收分片
+	void AcceptReady(const FGuid& InDataID);
+
+	//选择确认 InAckBase之前的分片全部收到 InAckBits第i位代表InAckBase+1+i号分片收到
+	void AcceptSelective(const FGuid& InDataID, uint32 InAckBase, uint32 InAckBits);
+
 	void BuildBytes(TArray<uint8> &InBytes,TArray<uint8>& OutBytes,bool bForce);
 
+	//收到对方回应 唤醒等待这个Tag的发送方
 	bool RemoveSynchronizeTag(uint64 InNewTags);
 
+	//通道关闭时唤醒所有还在等待的同步发送
+	void CancelSynchronize();
+
 protected:
+	void SendElement(FSimpleNetBatchManage::FBatch::FElement& InElement, uint32 InProtocol);
+
+	//没有重传过的分片才能采样往返时间
+	void SampleRTT(const FSimpleNetBatchManage::FBatch::FElement& InElement);
+
 	USimpleNetworkObject* SpawnObject(UClass *InClass);
 	void RegisterObject(FSimpleReturnDelegate InDelegate,UClass *InObjectClass);
 	void RegisterObject(UClass *InClass, UClass* InObjectClass);
 
+	//不在主线程时投递给主线程创建 不等待 期间收到的协议先缓存
+	void SpawnOnGameThread(TFunction<void()> InSpawn);
+
+	//对象交给主线程销毁 不等待
+	void ReleaseObject();
+
 public:
 	bool IsValid()const;
 	const FGuid &GetGuid() const;
 	void SetGuid(const FGuid &NewGuid);
-	void SetMsgQueueGuid(const FGuid& InNewGuid);
+
+	//在链接通道数组中的位置
+	void SetIndex(int32 InIndex) { Index = InIndex; }
+	int32 GetIndex() const { return Index; }
 	void ResetTagBackups(uint64 InNewValue) { TagBackups = InNewValue; }
 
+	//InWeight 同一优先级的通道按权重分配带宽
+	void SetPriority(ESimpleNetChannelPriority InPriority, int32 InWeight = 1);
+	ESimpleNetChannelPriority GetPriority() const { return Priority; }
+	int32 GetWeight() const { return Weight; }
+
 	//不要直接调用该方法 
 	void DestroySelf();
 
+protected:
+	//持有ObjectMutex时调用 只由DispatchProtocol切换正在分发的消息
+	void SetMsgQueueID(uint64 InID);
+	void ResetThreadMsg();
+
 protected:
 	FSimpleNetBatchManage BatchManage;
 	FSimpleNetMsgBatchPackageManage BatchPackageManage;
+	FSimpleNetReplication Replication;
 
 protected:
 	TWeakPtr<FSimpleConnetion> ConnetionPtr;
 	TStrongObjectPtr<USimpleNetworkObject> Object;
 	FGuid ID;
-	TArray<uint64> SynchronizeTag;//为同步考虑
+	TMap<uint64, FEvent*> SynchronizeTag;//为同步考虑 回应到达时直接触发事件
+	TMap<uint64, TArray<uint8>> SynchronizeMsgs;//回应的数据 等待的线程醒来后取走
+	FCriticalSection SynchronizeMutex;
+
+	TMap<uint32, TArray<uint8>> ThreadMsgs;//按线程ID
+	FCriticalSection ThreadMsgMutex;
 
 	//由服务器备份
 	uint64 TagBackups;
+
+	ESimpleNetChannelPriority Priority;
+	int32 Weight;
+
+	struct FPendingProtocol
+	{
+		uint32 ProtocolsNumber;
+		uint64 MsgID;
+		uint64 Tag;
+	};
+
+	//控制器创建完成前收到的协议
+	TArray<FPendingProtocol> PendingProtocols;
+	uint8 bObjectPending : 1;
+	uint8 bInitPending : 1;
+	uint32 ObjectSerial;//关闭或者重新创建时加一 过期的主线程任务直接放弃
+	FCriticalSection ObjectMutex;
+
+	int32 Index;
 };
\ No newline at end of file
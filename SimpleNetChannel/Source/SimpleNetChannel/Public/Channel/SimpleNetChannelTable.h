@@ -0,0 +1,44 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//通道ID到槽位的索引 每个链接一份
+//线性探测的开放寻址 桶是连续的数组 删除时把后面的元素往前移 不留墓碑
+//每收到一个协议都要按ID找通道 通道多的时候比逐个比较GUID快
+class SIMPLENETCHANNEL_API FSimpleNetChannelTable
+{
+public:
+	FSimpleNetChannelTable();
+
+	//预计的通道数 桶的数量至少是它的两倍
+	void Reserve(int32 InNum);
+
+	void Add(const FGuid& InID, int32 InSlot);
+	void Remove(const FGuid& InID);
+
+	//找不到返回INDEX_NONE
+	int32 Find(const FGuid& InID) const;
+
+	int32 Num() const;
+	void Reset();
+
+protected:
+	struct FBucket
+	{
+		FGuid ID;
+		int32 Slot;//INDEX_NONE代表空桶
+	};
+
+	static uint32 GetHash(const FGuid& InID);
+
+	void Rehash(int32 InBucketNum);
+	void Insert(const FGuid& InID, int32 InSlot);
+
+protected:
+	TArray<FBucket> Buckets;
+	int32 Count;
+
+	mutable FRWLock Lock;
+};
@@ -0,0 +1,95 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSimpleNetCongestionStats
+{
+	FSimpleNetCongestionStats()
+		:SRTT(0.0)
+		, RTO(0.0)
+		, Window(0.f)
+		, InFlight(0)
+		, SendNum(0)
+		, RetransmitNum(0)
+	{}
+
+	double SRTT;//平滑往返时间 还没有采样时为0
+	double RTO;//重传超时
+	float Window;//拥塞窗口 单位是分片
+	int32 InFlight;//发出去还没有确认的分片数
+	uint64 SendNum;//首次发送的分片数
+	uint64 RetransmitNum;//重传的分片数
+};
+
+//拥塞控制 每个连接一份 这个连接的所有通道共用
+//往返时间按RFC 6298估算 重传超时跟着往返时间走 不再固定RepackagingTime
+//拥塞窗口AIMD 慢启动后每个往返加一 快速重传减半 超时回到1
+//窗口限制的是整个连接在途的分片数 所有通道所有批次加起来 不是每个批次各算一份
+//令牌桶平滑发送 速率为 窗口 * 分片大小 / 往返时间 避免一次把整个窗口砸到对方的链路上
+class SIMPLENETCHANNEL_API FSimpleNetCongestion
+{
+public:
+	FSimpleNetCongestion();
+
+	void Reset();
+
+	//Karn算法 只用没有重传过的分片采样
+	void OnRTTSample(double InRTT);
+
+	//新确认了InAckNum个分片
+	void OnAck(int32 InAckNum);
+
+	//批次没等到确认就删除了 里面在途的分片不再计算
+	void OnDiscard(int32 InNum);
+
+	//重复确认触发的快速重传 窗口减半
+	void OnFastRetransmit();
+
+	//超时重传 窗口回到1 重传超时翻倍
+	void OnTimeout();
+
+	//首次发送计入在途 重传的分片已经在途里了
+	void OnSend(bool bRetransmit);
+
+	double GetRTO() const;
+	int32 GetWindow() const;
+
+	//在途的分片数小于窗口才能发新的分片
+	bool CanSend() const;
+
+	//令牌够的话扣除并返回true InTime为时间轮的时间
+	bool ConsumeTokens(int32 InBytes, double InTime);
+
+	//重传不等令牌 但是要扣除 之后的新分片会等一等
+	void ForceConsumeTokens(int32 InBytes, double InTime);
+
+	//还要等多少秒令牌才够
+	double GetTokenWaitTime(int32 InBytes, double InTime) const;
+
+	FSimpleNetCongestionStats GetStats() const;
+
+protected:
+	//每秒多少字节 还没有往返时间采样时返回0 代表不限速
+	double GetPacingRate() const;
+	double GetBurstSize(double InPacingRate) const;
+	void RefillTokens(double InTime);
+
+protected:
+	double SRTT;
+	double RTTVar;
+	double RTO;
+
+	float Window;
+	float SlowStartThreshold;
+	int32 InFlight;
+
+	double Tokens;
+	double LastRefillTime;
+
+	uint64 SendNum;
+	uint64 RetransmitNum;
+
+	mutable FCriticalSection Mutex;
+};
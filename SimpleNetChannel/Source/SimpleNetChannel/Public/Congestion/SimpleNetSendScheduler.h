@@ -0,0 +1,51 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleNetChannelType.h"
+#include "Timer/SimpleNetTimerWheel.h"
+
+class FSimpleConnetion;
+
+//发送调度 每个连接一份
+//拥塞控制限速时 各个通道窗口里的分片在这里排队等令牌
+//不同优先级之间严格按优先级发送 同一优先级内按通道权重做差额轮询(DRR)
+//大文件和邮件同步放在低优先级的通道上 就不会挡住移动和战斗的消息
+class SIMPLENETCHANNEL_API FSimpleNetSendScheduler
+{
+public:
+	FSimpleNetSendScheduler();
+
+	void SetConnetion(TWeakPtr<FSimpleConnetion> InConnetionPtr);
+
+	//批次的窗口里还有分片要发 挂到所属通道的队列上
+	void Add(const FGuid& InChannelID, const FGuid& InBatchID);
+
+	//按优先级和权重发送 令牌不够时注册定时器 补充后继续
+	void Run();
+
+	void Reset();
+
+protected:
+	void OnTimer();
+
+protected:
+	struct FFlow
+	{
+		FFlow()
+			:Deficit(0)
+		{}
+
+		FGuid ChannelID;
+		TArray<FGuid> Batchs;//按加入的顺序发送
+		int32 Deficit;//本轮还可以发送的字节数
+	};
+
+	TArray<FFlow> Flows[(int32)ESimpleNetChannelPriority::MAX];
+	int32 Cursor[(int32)ESimpleNetChannelPriority::MAX];
+
+	TWeakPtr<FSimpleConnetion> ConnetionPtr;
+	FSimpleNetTimerWheel::FHandle Timer;
+	FCriticalSection Mutex;
+};
@@ -2,8 +2,16 @@
 #pragma once
 
 #include "SimpleNetChannelType.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Timer/SimpleNetTimerWheel.h"
+#include "Congestion/SimpleNetCongestion.h"
+#include "Congestion/SimpleNetSendScheduler.h"
 #include "Cache/SimpleNetCacheManage.h"
 #include "Channel/SimpleChannel.h"
+#include "Channel/SimpleNetChannelTable.h"
+#include "Stats/SimpleNetTelemetry.h"
+#include "Impairment/SimpleNetImpairment.h"
 
 class FSocket;
 class FInternetAddr;
@@ -37,6 +45,18 @@ public:
 
 	virtual void Send(TArray<uint8>& InData);
 	virtual void Send(TArray<uint8>& InData, TSharedPtr<FInternetAddr> InNewAddr);
+
+	//包体是多个接收者共享的数据 发送时和包头拼接后再加密
+	virtual void Send(TArray<uint8>& InHead, const FSimpleSharedSlice& InBody, TSharedPtr<FInternetAddr> InNewAddr);
+	void Send(TArray<uint8>& InHead, const FSimpleSharedSlice& InBody);
+
+	virtual void FlushSend(){}
+
+	//把损伤层里到期的发送数据报发出去 InTime之前的全部发出
+	virtual void FlushImpairment(double InTime){}
+
+	//把损伤层里到期的接收数据报交给解析 由接收线程和管理器的网络Tick调用
+	void UpdateImpairment();
 	//virtual void Receive(const FGuid &InChannelID,TArray<uint8> &InData);
 
 	virtual void Analysis(uint8* InData, int32 BytesNumber);
@@ -45,24 +65,58 @@ public:
 
 	void CheckTimeOut();
 
+	//距离最后一次心跳超过了OutTimeLink
+	bool IsTimeOut();
+
 	virtual void RequestSocketAddressRequest();
 	virtual void ConnectVerification();
 	void SetSocket(FSocket* InSocket);
 
+	//共享端口模式 Socket属于管理器 关闭链接时只解除引用
+	void SetSharedSocket(FSocket* InSocket);
+	bool IsSharedSocket() const { return bSharedSocket; }
+
 	void ResetHeartBeat();
 
+	//所属管理器的时间轮 没有管理器时为空
+	FSimpleNetTimerWheel* GetTimerWheel();
+
+	//这个连接所有通道共用的拥塞控制
+	FSimpleNetCongestion& GetCongestion() { return Congestion; }
+	FSimpleNetSendScheduler& GetSendScheduler() { return SendScheduler; }
+
+	FSimpleNetConnetionTelemetry& GetTelemetry() { return Telemetry; }
+
+	//汇总计数器 拥塞控制和各个通道的队列
+	void GetStats(FSimpleNetConnetionStats& OutStats);
+
+	//单独给这个链接设置损伤 Init时会按全局配置重新设置
+	void SetImpairment(const FSimpleNetImpairmentConfig& InConfig);
+	const FSimpleNetImpairment& GetSendImpairment() const { return SendImpairment; }
+	const FSimpleNetImpairment& GetRecvImpairment() const { return RecvImpairment; }
+
 	FSimpleChannel* GetMainChannel();
 	FSimpleChannel* GetChannel(const FGuid &InChannelGuid);
 
+	//取一个没有使用的通道并分配ID 槽位第一次用到时才创建通道 满了返回空
+	FSimpleChannel* AddChannel();
+
+	//通道ID变化时维护索引 由通道调用
+	void OnChannelGuidChanged(int32 InIndex, const FGuid& InOldGuid, const FGuid& InNewGuid);
+
 	void SetLinkState(ESimpleNetLinkState NewLinkState);
 	void SetConnetionType(ESimpleConnetionType InType);
 	void SetManage(FSimpleNetManage *InManage);
 
 	void GetChannelActiveID(TArray<FGuid>& InIDs);
 
-	void SetGroupID(int32 InNewGroupID) { GroupID = InNewGroupID; }
+	void SetGroupID(int32 InNewGroupID);
 	int32 GetGroupID() { return GroupID; }
 
+	//在管理器远端链接中的位置 本地链接为INDEX_NONE
+	void SetSlotIndex(int32 InSlotIndex) { SlotIndex = InSlotIndex; }
+	int32 GetSlotIndex() const { return SlotIndex; }
+
 	FSocket* GetSocket()const { return Socket; }
 
 	//socket
@@ -81,10 +135,70 @@ public:
 		int32& OutLen);
 
 	void HandleMergePackage(int32 InRecvNum,uint8* InData, TSharedPtr<FInternetAddr> InAddr);
+
+	//合并发送的数据报 拆开后逐个交给HandleMergePackage
+	void HandleCoalescedPackage(int32 InRecvNum, uint8* InData, TSharedPtr<FInternetAddr> InAddr);
 	void VerificatioConnetionInfo(uint8* InData, int32 InByteNumber, TSharedPtr<FInternetAddr> InAddr);
 
-	//接受 并且 处理 远端
-	void RecvByRemote(int32 InBytesSize,uint8 *InData);
+	//接受 并且 处理 远端 先解密 InAddr为空时使用自己的远端地址
+	void RecvByRemote(int32 InBytesSize,uint8 *InData, TSharedPtr<FInternetAddr> InAddr = nullptr);
+
+protected:
+	//解密后按合并或者普通数据报处理
+	void HandleDatagram(int32 InBytesSize, uint8* InData, TSharedPtr<FInternetAddr> InAddr);
+
+	//线路格式
+public:
+	//本地配置支持的特性
+	static ESimpleNetWireFeature GetLocalWireFeatures();
+
+	//协商结果 改变数据报格式的特性要等对方也切换以后才生效
+	//bSendNow 发送方向马上切换(客户端) 否则等收到对方第一个新格式的数据报一起切换(服务器)
+	//接收方向在这之前新旧格式都接受
+	void SetPendingWireFeatures(ESimpleNetWireFeature InFeatures, bool bSendNow);
+
+	bool HasSendWireFeature(ESimpleNetWireFeature InFeature) const { return EnumHasAnyFlags(SendWireFeatures, InFeature); }
+
+	//协商了紧凑包头后 PackageID使用连接内的序号
+	FGuid MakeSequencePackageID();
+
+	//按入队时的特性编码 不需要编码返回false
+	bool EncodeWireHeader(const TArray<uint8>& InData, ESimpleNetWireFeature InFeatures, TArray<uint8>& OutData);
+	bool IsCompactPackage(const uint8* InData, int32 InLen) const;
+	bool IsCoalescedPackage(const uint8* InData, int32 InLen) const;
+
+	//InFeatures 入队时的发送特性 流加密需要在包前面预留GetCipherHeadSize
+	static int32 GetCipherHeadSize(ESimpleNetWireFeature InFeatures);
+	void EncryptPackage(TArray<uint8>& InOutPackage, ESimpleNetWireFeature InFeatures);
+
+	//解密后InOutData指向明文 返回明文长度 认证失败返回INDEX_NONE
+	int32 DecryptPackage(uint8*& InOutData, int32 InLen);
+
+protected:
+	//链接复用时换一组Nonce 保证同一个密钥下Nonce不重复
+	void ResetCipher();
+
+	void ApplyPendingWireFeatures();
+
+	//解密后的数据报是不是对方按协商结果发来的新格式
+	bool IsPendingWireFormat(const uint8* InData, int32 InLen);
+	bool IsValidCompactPackage(const uint8* InData, int32 InLen);
+
+	//收到的原始数据报能不能按协商的流加密解开 不修改InData
+	bool IsPendingStreamPackage(const uint8* InData, int32 InLen);
+
+	//滑动窗口模式下的包头 或者通道头是否合理 用来分辨新旧格式
+	static bool IsValidPackageHead(const uint8* InData, int32 InLen);
+	static bool IsValidBunchHead(const uint8* InData, int32 InLen);
+
+	//心跳和超时检测由时间轮驱动 不在每帧检查
+protected:
+	void ScheduleHeartBeat();
+	void OnHeartBeatTimer();
+
+	//收到心跳时如果没有定时器就注册一个 到期时按最后一次心跳的时间决定是否断开
+	void ScheduleTimeOut(float InDelay);
+	void OnTimeOutTimer();
 
 public:
 	void Lock();
@@ -96,10 +210,11 @@ public:
 	FORCEINLINE ESimpleNetLinkState GetLinkState()const { return LinkState; }
 	FORCEINLINE ESimpleConnetionType GetConnetionType()const { return ConnetionType; }
 	FORCEINLINE ESimpleConnetionLinkType GetState() { return State; }
-	FORCEINLINE	TArray<FSimpleChannel>& GetChannels() { return Channels; }
+	FORCEINLINE	TArray<TUniquePtr<FSimpleChannel>>& GetChannels() { return Channels; }
 
 protected:
-	TArray<FSimpleChannel> Channels;//
+	TArray<TUniquePtr<FSimpleChannel>> Channels;//槽位一开始就分好 没用过的槽位为空
+	FSimpleNetChannelTable ChannelTable;//ID到槽位
 	ESimpleConnetionLinkType State;//初始化阶段
 	ESimpleNetLinkState LinkState;//Connet的状态
 	ESimpleConnetionType ConnetionType;
@@ -111,20 +226,49 @@ protected:
 	uint8 bLock : 1;
 	uint8 bHeartBeat : 1;
 	uint8 bStopListen : 1;
-	double HeartTime;
+	uint8 bSharedSocket : 1;
 	double LastTime;
 
+	FSimpleNetTimerWheel::FHandle HeartBeatTimer;
+	FSimpleNetTimerWheel::FHandle TimeOutTimer;
+	FThreadSafeBool bTimeOutTimer;
+
 	double RequiredReconnectionTime;
 	double TimeoutLink;
 
 	int32 GroupID;//方便验证组ID
+	int32 SlotIndex;
 
 	//缓存管理
 	FSimpleNetCacheManage CacheManage;
 
+	FSimpleNetCongestion Congestion;
+	FSimpleNetSendScheduler SendScheduler;
+	FSimpleNetConnetionTelemetry Telemetry;
+
+	//本地测试用的丢包 延迟 乱序 没有开启时不经过
+	FSimpleNetImpairment SendImpairment;
+	FSimpleNetImpairment RecvImpairment;
+
+	//两个方向当前使用的格式
+	ESimpleNetWireFeature SendWireFeatures;
+	ESimpleNetWireFeature RecvWireFeatures;
+
+	//协商好但对方可能还没切换 收到第一个新格式的数据报或者加入后生效
+	ESimpleNetWireFeature PendingWireFeatures;
+	bool bPendingWireFeatures;
+
+	FThreadSafeCounter PackageSequence;
+
+	//流加密的Nonce = CipherSalt + CipherSequence
+	uint32 CipherSalt;
+	FThreadSafeCounter64 CipherSequence;
+
 protected: 
 	FSimpleNetManage* Manage;
 	FCriticalSection SocketMutex;//主要针对主线程和内部其他线程争夺
+	FCriticalSection LifecycleMutex;//初始化和关闭 不再切到主线程执行
+	FCriticalSection ImpairmentMutex;//延迟到期的接收数据报 多个线程取出时保证按顺序解析
 
 	FRWLock HeartBeatReadWrite;//针对心跳读写
 	bool bIntoOutTime;
@@ -12,10 +12,20 @@ public:
 
 	void Init(const FString &InPath = FPaths::ProjectDir() / TEXT("SimpleNetConfig.ini"));
 	const FSimpleConfigInfo& GetInfo() const;
+
+	//不读配置文件直接替换 例如基准测试对比不同的配置
+	//只在没有网络线程运行的时候调用 之后创建的链接才会使用
+	void SetInfo(const FSimpleConfigInfo& InInfo);
 	
 	void SetSecretKey(const FString &InSecretKey);
 	const TArray<uint8> &GetSecretKey() const;
 
+	//旧加密使用 所有密钥字节异或到一起
+	uint8 GetFoldedSecretKey() const { return FoldedSecretKey; }
+
+	//流加密使用 由密钥派生的32字节
+	const uint8* GetStreamKey() const { return StreamKey; }
+
 private:
 	void InitSecretKey();
 
@@ -24,4 +34,6 @@ private:
 	FSimpleConfigInfo ConfigInfo;
 
 	TArray<uint8> SecretKey;
+	uint8 FoldedSecretKey = 0;
+	uint8 StreamKey[32] = { 0 };
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FInternetAddr;
+
+//模拟差网络的参数 全部为0时不做任何处理
+struct SIMPLENETCHANNEL_API FSimpleNetImpairmentConfig
+{
+	FSimpleNetImpairmentConfig();
+
+	//从FSimpleConfigInfo读取 没有开启bImpairment时返回全0
+	static FSimpleNetImpairmentConfig FromConfigInfo();
+
+	bool IsEnabled() const;
+
+	float Loss;//丢包率 0-1
+	float Delay;//固定延迟 秒
+	float Jitter;//在Delay上随机增加[0,Jitter)秒
+	float Duplicate;//重复发送的概率
+	float Reorder;//不等待延迟直接发出的概率 会越过前面还在延迟的数据报
+	int32 Bandwidth;//字节每秒 0为不限制 超出的排队 排队超过一秒的丢弃
+	int32 Seed;
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetImpairmentStats
+{
+	FSimpleNetImpairmentStats()
+		:Queued(0)
+		, Dropped(0)
+		, Duplicated(0)
+		, Reordered(0)
+		, Overflowed(0)
+	{}
+
+	uint64 Queued;
+	uint64 Dropped;//按丢包率丢弃
+	uint64 Duplicated;
+	uint64 Reordered;
+	uint64 Overflowed;//超过带宽排队丢弃
+};
+
+//数据报的损伤层 夹在链接和Socket之间 每个链接每个方向一份
+//数据报先进入按时间排序的队列 到期后由网络线程取出 交给真正的发送或者解析
+//同样的种子和同样的数据报序列 丢弃 重复 乱序的结果一样
+class SIMPLENETCHANNEL_API FSimpleNetImpairment
+{
+public:
+	struct FPacket
+	{
+		double Time;
+		uint64 Sequence;//同一时间的按进入的顺序
+		TArray<uint8> Data;
+		TSharedPtr<FInternetAddr> Addr;
+	};
+
+	FSimpleNetImpairment();
+
+	//InSeed和配置里的种子混合 区分链接和方向
+	void Init(const FSimpleNetImpairmentConfig& InConfig, int32 InSeed);
+
+	FORCEINLINE bool IsEnabled() const { return bEnabled; }
+
+	//InAddr需要调用方保证入队以后不会被改写
+	void Add(const uint8* InData, int32 InLen, const TSharedPtr<FInternetAddr>& InAddr, double InTime);
+
+	//取出所有到期的 在锁外面调用InFunc
+	void Release(double InTime, TFunctionRef<void(FPacket&)> InFunc);
+
+	//丢弃队列 保留配置
+	void Reset();
+
+	FSimpleNetImpairmentStats GetStats() const;
+
+protected:
+	void Push(double InTime, const uint8* InData, int32 InLen, const TSharedPtr<FInternetAddr>& InAddr);
+
+protected:
+	FSimpleNetImpairmentConfig Config;
+	bool bEnabled;
+
+	FRandomStream Random;
+	int32 Seed;
+
+	TArray<FPacket> Packets;//小顶堆
+	uint64 Sequence;
+	double LinkFreeTime;//带宽限制下 链路空闲的时间
+
+	FSimpleNetImpairmentStats Stats;
+
+	mutable FCriticalSection Mutex;
+};
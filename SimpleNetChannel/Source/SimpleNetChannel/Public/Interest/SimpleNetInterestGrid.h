@@ -0,0 +1,52 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSimpleChannel;
+
+//视野管理 按XY平面划分的均匀网格 每个管理器一份
+//位置更新时把通道放到对应的格子 查询时只看半径覆盖的格子
+//格子大小和常用的广播半径差不多时 查询的开销和结果数量成正比 不再遍历所有链接
+class SIMPLENETCHANNEL_API FSimpleNetInterestGrid
+{
+public:
+	FSimpleNetInterestGrid();
+
+	//只有网格为空时才能修改
+	void SetCellSize(float InCellSize);
+	float GetCellSize() const { return CellSize; }
+
+	//加入或者移动 只在换格子时修改格子
+	void Update(FSimpleChannel* InChannel, const FVector& InPosition);
+	void Remove(FSimpleChannel* InChannel);
+
+	//以InCenter为圆心InRadius为半径的所有通道 不包含Z
+	void Query(const FVector& InCenter, float InRadius, TArray<FSimpleChannel*>& OutChannels) const;
+
+	bool Find(FSimpleChannel* InChannel, FVector& OutPosition) const;
+
+	int32 Num() const;
+	void Reset();
+
+protected:
+	FIntPoint GetCell(const FVector& InPosition) const;
+
+protected:
+	struct FEntry
+	{
+		FSimpleChannel* Channel;
+		FVector Position;
+		FIntPoint Cell;
+		int32 CellIndex;//在格子数组里的位置 删除时和最后一个交换
+	};
+
+	TSparseArray<FEntry> Entries;
+	TMap<FSimpleChannel*, int32> EntryIndex;
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	float CellSize;
+
+	mutable FRWLock Lock;
+};
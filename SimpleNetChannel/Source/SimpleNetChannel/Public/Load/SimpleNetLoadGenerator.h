@@ -0,0 +1,192 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleNetChannelType.h"
+
+class FSimpleChannel;
+class FSimpleNetManage;
+
+//录制的一条消息 Data是包含FSimpleBunchHead的完整消息
+struct SIMPLENETCHANNEL_API FSimpleNetCaptureRecord
+{
+	FSimpleNetCaptureRecord()
+		:Time(0.0)
+		, Client(0)
+	{}
+
+	double Time;//相对录制开始的秒数
+	int32 Client;
+	TArray<uint8> Data;
+};
+
+//按原来的时间录制和回放客户端发出的消息
+//回放时把消息头里的通道ID换成回放客户端的通道 同步协议会阻塞发送线程 不回放
+class SIMPLENETCHANNEL_API FSimpleNetTrafficCapture
+{
+public:
+	FSimpleNetTrafficCapture();
+
+	void Start();
+	void Add(int32 InClient, const TArray<uint8>& InData);
+
+	bool Save(const FString& InFilename) const;
+	bool Load(const FString& InFilename);
+
+	const TArray<FSimpleNetCaptureRecord>& GetRecords() const { return Records; }
+	void Reset();
+
+protected:
+	TArray<FSimpleNetCaptureRecord> Records;
+	double StartTime;
+	mutable FCriticalSection Mutex;//每个客户端的发送线程都会写
+};
+
+//一个协议组合里的一项 按权重随机选中 Channel是客户端的主通道
+//例如 [](FSimpleChannel* Channel){ SIMPLE_PROTOCOLS_SEND(SP_Move, Location); }
+struct SIMPLENETCHANNEL_API FSimpleNetLoadAction
+{
+	FSimpleNetLoadAction()
+		:Weight(1.f)
+	{}
+
+	FName Name;
+	float Weight;
+	TFunction<void(FSimpleChannel*)> Send;
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetLoadConfig
+{
+	FSimpleNetLoadConfig();
+
+	int32 GroupID;//CreateCients的组 不要和业务的客户端组重复
+	FString IP;//为空时用Port初始化 连接本机
+	int32 Port;
+	int32 ClientNum;
+	ESimpleSocketType SocketType;
+	UClass* ObjectClass;
+	bool bAllowSynchronization;//客户端用自己的网络线程接收 发送同步协议时需要 否则等不到回应
+	bool bHighConcurrency;//服务器是高并发模式时 客户端也要走高并发的握手
+
+	float Duration;//秒 0为一直运行 回放时以录制的长度为准
+	float SendRate;//每个客户端每秒发送的消息数
+	float PingRate;//每个客户端每秒Ping的次数 用来统计延迟
+	int32 Seed;//同样的种子 同样的组合 每个客户端发出的消息序列一样
+
+	TArray<FSimpleNetLoadAction> Actions;
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetLoadReport
+{
+	FSimpleNetLoadReport();
+
+	double Duration;
+	int32 ClientNum;
+	int32 JoinNum;
+
+	uint64 SendNum;//发出的消息
+	uint64 SkipNum;//回放时跳过的同步消息
+
+	//所有客户端链接的数据报
+	uint64 BytesIn;
+	uint64 PacketsIn;
+	uint64 BytesOut;
+	uint64 PacketsOut;
+
+	//Ping的往返时间 毫秒
+	int32 LatencyNum;
+	int32 LostNum;//超时没有回应
+	float LatencyP50;
+	float LatencyP90;
+	float LatencyP99;
+	float LatencyMax;
+
+	//进程的CPU占用 服务器在同一个进程时就是服务器加上客户端的占用
+	float CPUAverage;
+	float CPUPeak;
+
+	void Dump() const;
+};
+
+//无界面的压力测试 在进程内用CreateCients创建一组客户端连接服务器(本机或者远端)
+//按配置的协议组合和速率发送 或者回放录制的流量 结束时统计吞吐 延迟 CPU
+//所有接口都在主线程调用 Tick里会驱动TickClients
+class SIMPLENETCHANNEL_API FSimpleNetLoadGenerator
+{
+public:
+	FSimpleNetLoadGenerator();
+	~FSimpleNetLoadGenerator();
+
+	bool Start(const FSimpleNetLoadConfig& InConfig);
+
+	//InCapture在回放期间必须有效
+	bool StartReplay(const FSimpleNetLoadConfig& InConfig, const FSimpleNetTrafficCapture* InCapture);
+
+	//开始录制客户端发出的消息 在Start之后调用
+	void Record(FSimpleNetTrafficCapture* InCapture);
+
+	//到了Duration返回false
+	bool Tick(float DeltaSeconds);
+
+	//断开所有客户端 返回最后的统计
+	FSimpleNetLoadReport Stop();
+
+	FSimpleNetLoadReport GetReport();
+	bool IsRunning() const { return bRunning; }
+
+protected:
+	struct FClient
+	{
+		FClient()
+			:Manage(nullptr)
+			, NextSendTime(0.0)
+			, NextPingTime(0.0)
+			, PingTime(0.0)
+			, bJoin(false)
+		{}
+
+		FSimpleNetManage* Manage;
+		FRandomStream Random;
+		double NextSendTime;
+		double NextPingTime;
+		double PingTime;//正在等待回应的Ping 0代表没有
+		bool bJoin;
+	};
+
+	bool CreateClients(const FSimpleNetLoadConfig& InConfig);
+	bool UpdateJoin(int32 InClient);
+
+	void SendActions(int32 InClient);
+	void SendPing(int32 InClient);
+	void SendReplay();
+
+	void OnRecvProtocol(uint32 InProtocol, FSimpleChannel* InChannel, int32 InClient);
+	void OnSendCapture(FSimpleChannel* InChannel, const TArray<uint8>& InData, int32 InClient);
+
+	//平均间隔1/InRate 带随机偏移 避免所有客户端同一帧发送
+	static double GetInterval(FRandomStream& InRandom, float InRate);
+
+protected:
+	FSimpleNetLoadConfig Config;
+	TArray<FClient> Clients;
+	float TotalWeight;
+
+	const FSimpleNetTrafficCapture* Replay;
+	int32 ReplayIndex;
+	double ReplayStartTime;//小于0代表还没有开始
+	FSimpleNetTrafficCapture* Capture;
+
+	double Time;
+	uint64 SendNum;
+	uint64 SkipNum;
+
+	TArray<float> Latencies;
+	int32 LostNum;
+
+	double CPUTotal;
+	float CPUPeak;
+	int32 CPUSampleNum;
+
+	bool bRunning;
+};
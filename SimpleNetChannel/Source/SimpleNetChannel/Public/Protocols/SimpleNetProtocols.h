@@ -31,3 +31,7 @@ DEFINITION_SIMPLE_PROTOCOLS(RecvComplete, 1042)
 //Verify if online
 DEFINITION_SIMPLE_PROTOCOLS_FORCE(PingRequest, 1043)
 DEFINITION_SIMPLE_PROTOCOLS_FORCE(PingResponse, 1044)
+
+//State replication
+DEFINITION_SIMPLE_PROTOCOLS(Replicate, 1045)
+DEFINITION_SIMPLE_PROTOCOLS(ReplicateAck, 1046)
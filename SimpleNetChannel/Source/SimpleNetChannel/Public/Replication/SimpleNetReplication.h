@@ -0,0 +1,134 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSimpleChannel;
+class UScriptStruct;
+
+struct SIMPLENETCHANNEL_API FSimpleNetReplicationStats
+{
+	FSimpleNetReplicationStats()
+		:FullNum(0)
+		, DeltaNum(0)
+		, SendBytes(0)
+		, FullBytes(0)
+		, NackNum(0)
+	{}
+
+	uint64 FullNum;//发送的全量状态
+	uint64 DeltaNum;//发送的差量状态
+	uint64 SendBytes;//实际发送的状态字节数
+	uint64 FullBytes;//如果每次都发全量需要的字节数
+	uint64 NackNum;//对方找不到基准 要求重发全量
+};
+
+//状态复制 每个通道一份
+//按UStruct的反射逐个属性比较 只发送和对方最后确认的快照不同的属性 用位掩码标记哪些属性变了
+//确认之前发出的快照都保留 丢包后仍以最后确认的快照为基准 对方找不到基准或者长时间没有确认时发全量
+//接收方收到后通道的对象会收到SP_Replicate 参数是对象的Key 再用GetState取出最新状态
+class SIMPLENETCHANNEL_API FSimpleNetReplication
+{
+public:
+	FSimpleNetReplication();
+
+	void SetChannel(FSimpleChannel* InChannel);
+
+	//两端都要注册 类型ID是结构体路径名的CRC
+	static void RegisterStruct(UScriptStruct* InStruct);
+
+	//发送方 InKey区分同一个通道上的多个对象 比如角色ID 状态没有变化返回false
+	bool Replicate(uint32 InKey, UScriptStruct* InStruct, const void* InData);
+
+	template<class T>
+	bool Replicate(uint32 InKey, const T& InData)
+	{
+		return Replicate(InKey, T::StaticStruct(), &InData);
+	}
+
+	//接收方 最新的状态 还没有收到过返回false
+	bool GetState(uint32 InKey, UScriptStruct* InStruct, void* OutData) const;
+
+	template<class T>
+	bool GetState(uint32 InKey, T& OutData) const
+	{
+		return GetState(InKey, T::StaticStruct(), &OutData);
+	}
+
+	//发送方不再同步这个对象 比如离开视野
+	void Remove(uint32 InKey);
+
+	//网络线程 SP_Replicate 或者 SP_ReplicateAck
+	void Receive(uint32 InProtocolsNumber, const uint8* InData, int32 InLen);
+
+	void Reset();
+
+	FSimpleNetReplicationStats GetStats() const;
+
+protected:
+	struct FSnapshot
+	{
+		FSnapshot(UScriptStruct* InStruct, const void* InData);
+		~FSnapshot();
+
+		UScriptStruct* Struct;
+		uint8* Data;
+	};
+
+	typedef TSharedPtr<FSnapshot, ESPMode::ThreadSafe> FSnapshotPtr;
+
+	struct FSendObject
+	{
+		FSendObject()
+			:Struct(nullptr)
+			, Sequence(0)
+			, AckSequence(0)
+			, FullSize(0)
+		{}
+
+		UScriptStruct* Struct;
+		uint32 Sequence;//最后发送的序号 0代表没有
+		uint32 AckSequence;//对方最后确认的序号
+		int32 FullSize;//最后一次全量的大小 统计用
+		FSnapshotPtr Baseline;//对方确认过的快照
+		FSnapshotPtr Last;//最后发送的快照 没有变化不再发送
+		TMap<uint32, FSnapshotPtr> Pending;//已经发送还没有确认
+	};
+
+	struct FRecvObject
+	{
+		FRecvObject()
+			:Struct(nullptr)
+			, Sequence(0)
+		{}
+
+		UScriptStruct* Struct;
+		uint32 Sequence;//最新的序号
+		FSnapshotPtr Latest;
+		TMap<uint32, FSnapshotPtr> History;//对方可能拿来做基准的快照
+	};
+
+protected:
+	//InData和对方确认的快照比较 没有基准时写全量
+	void BuildPayload(FSendObject& InObject, uint32 InKey, const void* InData, TArray<uint8>& OutPayload);
+
+	void ReceiveState(const uint8* InData, int32 InLen);
+	void ReceiveAck(const uint8* InData, int32 InLen);
+
+	//包体是协议头后面的原始字节
+	void SendPayload(uint32 InProtocolsNumber, TArray<uint8>& InPayload);
+	void SendAck(uint32 InTypeID, uint32 InKey, uint32 InSequence, bool bNack);
+
+	//让通道的对象收到SP_Replicate
+	void Notify(uint32 InKey);
+
+protected:
+	FSimpleChannel* Channel;
+
+	TMap<uint32, FSendObject> SendObjects;
+	TMap<uint32, FRecvObject> RecvObjects;
+	FSimpleNetReplicationStats Stats;
+
+	mutable FCriticalSection Mutex;
+};
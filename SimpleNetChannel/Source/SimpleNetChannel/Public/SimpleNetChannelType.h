@@ -52,13 +52,36 @@ enum class ESimpleConnetionLinkType :uint8
 	LINK_JOIN, //
 };
 
+//线路特性 握手时协商 双方都支持才会启用
+enum class ESimpleNetWireFeature :uint32
+{
+	NONE				= 0,
+	COMPACT_HEADER		= 1 << 0,//紧凑包头
+	STREAM_CIPHER		= 1 << 1,//ChaCha20流加密
+	CIPHER_AUTH			= 1 << 2,//流加密附带Poly1305认证码
+	COMPRESSION			= 1 << 3,//大消息LZ4压缩
+	COALESCE			= 1 << 4,//多个小数据报合并发送
+};
+ENUM_CLASS_FLAGS(ESimpleNetWireFeature)
+
+//通道优先级 拥塞控制限速时高优先级通道的分片先发
+enum class ESimpleNetChannelPriority :uint8
+{
+	HIGH,//移动 战斗
+	NORMAL,
+	BULK,//资源 邮件同步这类大数据
+
+	MAX,
+};
+
 struct SIMPLENETCHANNEL_API FSimplePackageHead
 {
 	FSimplePackageHead();
 
 	uint32 Protocol;//
-	uint32 PackageIndex;
+	uint32 PackageIndex;//握手阶段携带分片大小 确认阶段表示连续收到的分片数
 	uint32 PackageSize;
+	uint32 AckBits;//选择确认 第i位代表PackageIndex+1+i号分片已经收到
 	bool bAck;
 	bool bForceSend;
 	uint64 Tag;//针对同步
@@ -66,6 +89,14 @@ struct SIMPLENETCHANNEL_API FSimplePackageHead
 	FGuid ChannelID;
 };
 
+//通道头标志
+enum ESimpleBunchFlag :uint8
+{
+	BUNCH_NONE			= 0,
+	BUNCH_COMPRESSED	= 1 << 0,//包体被压缩 格式为[uint32 原长度][LZ4数据]
+	BUNCH_ALL			= BUNCH_COMPRESSED,
+};
+
 struct SIMPLENETCHANNEL_API FSimpleBunchHead
 {
 	FSimpleBunchHead();
@@ -75,6 +106,42 @@ struct SIMPLENETCHANNEL_API FSimpleBunchHead
 	uint32 ProtocolsNumber;//协议号
 	uint8 ParamNum;
 	bool bAsynchronous;//异步
+	uint8 Flags;//ESimpleBunchFlag 占用原来的对齐空间 大小不变
+};
+
+//广播时所有接收者共享的数据 最后一次发送完成后释放
+typedef TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> FSimpleSharedBytes;
+
+//共享包体的一段 分片发送时每个分片引用其中一段
+struct SIMPLENETCHANNEL_API FSimpleSharedSlice
+{
+	FSimpleSharedSlice()
+		:Offset(0)
+		, Size(0)
+	{}
+
+	FSimpleSharedSlice(const FSimpleSharedBytes& InBytes, int32 InOffset, int32 InSize)
+		:Bytes(InBytes)
+		, Offset(InOffset)
+		, Size(InSize)
+	{}
+
+	FORCEINLINE bool IsValid() const { return Bytes.IsValid() && Size > 0; }
+	FORCEINLINE const uint8* GetData() const { return Bytes->GetData() + Offset; }
+
+	FSimpleSharedBytes Bytes;
+	int32 Offset;
+	int32 Size;
+};
+
+//广播的包体 只序列化和压缩一次 每个接收者按协商结果选用其中一份
+//每个包的Nonce不同 加密仍然在各自链接发送时进行
+struct SIMPLENETCHANNEL_API FSimpleSharedBody
+{
+	FORCEINLINE bool IsValid() const { return Raw.IsValid(); }
+
+	FSimpleSharedBytes Raw;
+	FSimpleSharedBytes Compressed;//没有达到压缩阈值或者压缩后没有变小时为空
 };
 
 USTRUCT(BlueprintType, Meta = (Proto))
@@ -148,19 +215,77 @@ struct SIMPLENETCHANNEL_API FSimpleConfigInfo
 	UPROPERTY(Config)
 	int32 SendDataNumber;
 
+	//一次唤醒最多批量接收多少个数据报
+	UPROPERTY(Config)
+	int32 RecvBatchNumber;
+
 	UPROPERTY(Config)
 	int32 MaxConnections;
 
 	UPROPERTY(Config)
 	int32 MaxChannels;
 
+	//每个通道缓存的待分发消息数 会取整到2的幂 满了以后容量翻倍
+	UPROPERTY(Config)
+	int32 MsgQueueSize;
+
+	//每个通道消息队列扩容的上限 到了上限新消息会被拒收并计数
+	UPROPERTY(Config)
+	int32 MsgQueueMaxSize;
+
 	UPROPERTY(Config)
 	int32 RepackagingFrequency;
 
+	//滑动窗口 同时在途的最大分片数
+	UPROPERTY(Config)
+	int32 SlidingWindowSize;
+
 	//指定线程池应该有多少线程
 	UPROPERTY(Config)
 	int32 NumberThreads;
 
+	//线程池每条有序通道的容量 满了以后生产者等待
+	UPROPERTY(Config)
+	int32 TaskQueueSize;
+
+	//工作线程一次从队列取出的任务数
+	UPROPERTY(Config)
+	int32 TaskBatchNumber;
+
+	//高并发服务器 大于0时所有客户端共享一个端口 由这么多个线程分担接收
+	//Linux下由内核(SO_REUSEPORT)按客户端地址分配到各个线程 其他平台只使用一个线程
+	//0表示每个客户端一个端口和一个监听线程
+	UPROPERTY(Config)
+	int32 ShardNumber;
+
+	//共享端口 0表示Port + 1
+	UPROPERTY(Config)
+	int32 ShardPort;
+
+	//包体达到这么多字节才尝试压缩
+	UPROPERTY(Config)
+	int32 CompressionThreshold;
+
+	//合并后的数据报最大字节数
+	UPROPERTY(Config)
+	int32 CoalesceMTU;
+
+	//对方握手声明的整包超过这个字节数直接拒绝 不分配缓存
+	UPROPERTY(Config)
+	int32 MaxPackageSize;
+
+	//每个连接的组包缓冲池最多留多少字节 超出的缓存用完直接释放
+	UPROPERTY(Config)
+	int32 CacheArenaSize;
+
+	//损伤层的带宽限制 字节每秒 0为不限制
+	UPROPERTY(Config)
+	int32 ImpairmentBandwidth;
+
+	//损伤层的随机种子 同样的种子每次测试丢包和乱序的位置一样
+	UPROPERTY(Config)
+	int32 ImpairmentSeed;
+
 	UPROPERTY(Config)
 	bool bPrintHeartBeat;
 
@@ -170,6 +295,34 @@ struct SIMPLENETCHANNEL_API FSimpleConfigInfo
 	UPROPERTY(Config)
 	bool bRepackaging;
 
+	//紧凑包头 需要滑动窗口 对方也支持的情况下才会使用
+	UPROPERTY(Config)
+	bool bCompactHeader;
+
+	//流加密 需要配置SecretKey 对方也支持的情况下才会使用 否则使用旧的加密
+	UPROPERTY(Config)
+	bool bStreamCipher;
+
+	//流加密的包附带认证码 被篡改的包直接丢弃
+	UPROPERTY(Config)
+	bool bCipherAuthentication;
+
+	//大消息压缩 对方也支持的情况下才会使用 压缩后没有变小的按原样发送
+	UPROPERTY(Config)
+	bool bCompression;
+
+	//同一帧发给同一个地址的小数据报合并成一个 需要紧凑包头
+	UPROPERTY(Config)
+	bool bCoalesce;
+
+	//拥塞控制 按往返时间估算重传超时 限制在途分片数并平滑发送
+	UPROPERTY(Config)
+	bool bCongestionControl;
+
+	//本地测试用 在链接和Socket之间模拟丢包 延迟 抖动 重复 乱序 不要在正式环境打开
+	UPROPERTY(Config)
+	bool bImpairment;
+
 	UPROPERTY(Config)
 	bool bShowCompletePackProtocolInfo;
 
@@ -179,6 +332,13 @@ struct SIMPLENETCHANNEL_API FSimpleConfigInfo
 	UPROPERTY(Config)
 	float RepackagingTime;
 
+	//拥塞控制打开时 重传超时的范围 RepackagingTime作为没有往返时间采样前的初始值
+	UPROPERTY(Config)
+	float MinRepackagingTime;
+
+	UPROPERTY(Config)
+	float MaxRepackagingTime;
+
 	UPROPERTY(Config)
 	float OutTimeLink;
 
@@ -191,6 +351,35 @@ struct SIMPLENETCHANNEL_API FSimpleConfigInfo
 	UPROPERTY(Config)
 	float PingMaxOutTime;
 
+	//合并发送最多等待多少秒 超过了不等网络Tick直接发出
+	UPROPERTY(Config)
+	float CoalesceLatency;
+
+	//视野网格的格子大小 和常用的广播半径差不多最合适
+	UPROPERTY(Config)
+	float InterestCellSize;
+
+	//每隔多少秒把统计输出到日志 0为不输出
+	UPROPERTY(Config)
+	float StatsDumpInterval;
+
+	//损伤层的丢包率 重复率 乱序率 0-1
+	UPROPERTY(Config)
+	float ImpairmentLoss;
+
+	UPROPERTY(Config)
+	float ImpairmentDuplicate;
+
+	UPROPERTY(Config)
+	float ImpairmentReorder;
+
+	//损伤层单向的固定延迟和随机抖动 秒
+	UPROPERTY(Config)
+	float ImpairmentDelay;
+
+	UPROPERTY(Config)
+	float ImpairmentJitter;
+
 	UPROPERTY(Config)
 	FString PublicIP;
 	 
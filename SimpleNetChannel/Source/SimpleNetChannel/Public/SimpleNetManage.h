@@ -9,6 +9,10 @@
 #include "UObject/SimpleController.h"
 #include "Channel/SimpleChannel.h"
 #include "Runtime/Launch/Resources/Version.h"
+#include "Timer/SimpleNetTimerWheel.h"
+#include "Interest/SimpleNetInterestGrid.h"
+#include "Stats/SimpleNetTelemetry.h"
+#include "HAL/ThreadSafeBool.h"
 
 #define TEST_SNC false
 
@@ -20,6 +24,9 @@ class USimpleNetworkObject;
 
 DECLARE_DELEGATE_TwoParams(FSimpleNetManageMsgDelegate, ESimpleNetErrorType, const FString&);
 
+//通道发出的每条消息 压缩和分片之前 包含FSimpleBunchHead
+DECLARE_DELEGATE_TwoParams(FSimpleNetSendCaptureDelegate, FSimpleChannel*, const TArray<uint8>&);
+
 class FSimpleConnetion;
 class FInternetAddr;
 
@@ -31,6 +38,9 @@ class SIMPLENETCHANNEL_API FSimpleNetManage
 public:
 	FSimpleNetManageMsgDelegate NetManageMsgDelegate;
 
+	//录制流量用 在发送线程调用
+	FSimpleNetSendCaptureDelegate SendCaptureDelegate;
+
 	UClass* NetworkObjectClass;
 	UClass* SimplePlayerClass;
 
@@ -53,7 +63,8 @@ public:
 	//InClientNumber 创建多少个客户端
 	//InClass 重写的类型
 	//InType TCP 还是UDP
-	static bool CreateCients(int32 InGroupID,const FString& InLinkIP,int32 InPort,int32 InClientNumber,UClass* InClass,bool bNewAllowSynchronization = false, ESimpleSocketType InType = ESimpleSocketType::SIMPLESOCKETTYPE_UDP);
+	//bNewHighConcurrency 服务器是高并发的话 客户端也要是高并发
+	static bool CreateCients(int32 InGroupID,const FString& InLinkIP,int32 InPort,int32 InClientNumber,UClass* InClass,bool bNewAllowSynchronization = false, ESimpleSocketType InType = ESimpleSocketType::SIMPLESOCKETTYPE_UDP,bool bNewHighConcurrency = false);
 	static void DestroyClients(int32 InGroupID = INDEX_NONE);
 
 	//如果找不到，都在使用中，那么就等待 等待一定时间 还为获取，就放弃
@@ -61,6 +72,9 @@ public:
 
 	static void TickClients(float DeltaTime);
 
+	//CreateCients创建的一组客户端 没有返回空
+	static TArray<FSimpleNetManage*>* GetClients(int32 InGroupID);
+
 public:
 	//处理服务器
 	TSharedPtr<FSimpleConnetion> FindConnetionFree(int32 InGroupID);
@@ -77,6 +91,16 @@ public:
 
 	virtual void Tick(float DeltaTime);
 	virtual void Close();
+
+	//把所有链接队列中待发送的数据发出去
+	void FlushSend();
+
+	//生产者线程攒够了一个MTU或者等待太久 通知网络线程尽快FlushSend
+	void RequestFlush() { bFlushRequested = true; }
+	bool IsFlushRequested() const { return bFlushRequested; }
+
+	//把所有链接损伤层里到期的接收数据报交给解析 和Listen在同一个线程
+	void UpdateImpairment();
 	virtual void Close(const FSimpleAddrInfo& InCloseConnetion);
 	virtual void Close(const TSharedPtr<FInternetAddr>& InternetAddr);
 
@@ -104,6 +128,23 @@ public:
 	template<uint32 InProtocols, class T, typename ...ParamTypes>
 	void MulticastByPredicate(TFunction<bool(T*)> InImplement, ParamTypes &...Param);
 
+	//按范围广播 只遍历视野网格里InRadius范围内的通道 InImplement可以为空
+	//通道的位置由业务在移动时通过GetInterestGrid().Update更新
+	template<uint32 InProtocols, class T, typename ...ParamTypes>
+	void MulticastByRadius(const FVector& InCenter, float InRadius, TFunction<bool(T*)> InImplement, ParamTypes &...Param);
+
+	//重传 心跳 超时都注册在这里 随Tick推进
+	FSimpleNetTimerWheel& GetTimerWheel() { return TimerWheel; }
+
+	FSimpleNetInterestGrid& GetInterestGrid() { return InterestGrid; }
+
+	//按协议号统计的收发 所有链接共用
+	FSimpleNetProtocolTelemetry& GetProtocolTelemetry() { return ProtocolTelemetry; }
+
+	//本地链接和所有已经加入的远端链接
+	void GetStats(FSimpleNetStatsSnapshot& OutSnapshot);
+	void DumpStats();
+
 	//是否开启了高并发
 	bool IsHighConcurrency() const { return bHighConcurrency || TEST_SNC; }
 
@@ -128,6 +169,13 @@ public:
 public:
 	FORCEINLINE ESimpleNetLinkState GetLinkState() { return LinkState; }
 
+	//链接变化时维护查找索引 InSlot是链接在RemoteConnetions中的位置
+public:
+	void OnConnetionAddrChanged(int32 InSlot, TSharedPtr<FInternetAddr> InNewAddr);
+	void OnConnetionStateChanged(ESimpleConnetionLinkType InOldState, ESimpleConnetionLinkType InNewState);
+	void OnConnetionGroupChanged(int32 InSlot, int32 InOldGroupID, int32 InNewGroupID);
+	void OnConnetionUnLock(int32 InSlot);
+
 protected:
 	virtual TStatId GetStatId()const;
 
@@ -149,11 +197,44 @@ protected:
 		TSharedPtr<FSimpleConnetion> operator[](const FSimpleAddr& InternetAddr);
 		TSharedPtr<FSimpleConnetion> operator[](const int32 InGroupID);//获取组内空闲的链接
 
+	public:
+		//预分配完链接后建立索引
+		void InitIndex();
+
+		//由链接在地址 状态 组 锁变化时通知 保证索引和链接一致
+		void UpdateAddr(int32 InSlot, const FSimpleAddr& InNewAddr);
+		void UpdateState(ESimpleConnetionLinkType InOldState, ESimpleConnetionLinkType InNewState);
+		void UpdateGroup(int32 InSlot, int32 InOldGroupID, int32 InNewGroupID);
+		void ReleaseSlot(int32 InSlot);
+
+		int32 GetJoinNum() const { return JoinNum.GetValue(); }
+
 	public:
 		TSharedPtr<FSimpleConnetion> LocalConnetion;
 		TArray<TSharedPtr<FSimpleConnetion>> RemoteConnetions;
+
+	protected:
+		//地址->槽位 同一地址极少出现多个槽位
+		TMap<FSimpleAddr, TArray<int32, TInlineAllocator<1>>> AddrIndex;
+		TArray<FSimpleAddr> SlotAddrs;
+
+		//组->槽位 未分组(INDEX_NONE)的不进索引
+		TMap<int32, TSet<int32>> GroupIndex;
+
+		//空闲槽位 取出时再校验状态
+		TArray<int32> FreeSlots;
+
+		FThreadSafeCounter JoinNum;
+		mutable FRWLock IndexLock;
 	}Net;
 
+	FSimpleNetTimerWheel TimerWheel;
+	FSimpleNetInterestGrid InterestGrid;
+	FSimpleNetProtocolTelemetry ProtocolTelemetry;
+	float StatsDumpTime;
+
+	FThreadSafeBool bFlushRequested;
+
 	bool bHighConcurrency;
 	bool bInit;
 	bool bClientLink;//只针对客户端 链接服务器
@@ -179,9 +260,9 @@ void FSimpleNetManage::FindRemoteNetworkObjectByLambda(TFunction<ESimpleNetManag
 		ESimpleNetManageCallType SimpleNetManageCallType = ESimpleNetManageCallType::INPROGRESS;
 		for (auto& TmpChannel : Tmp->GetChannels())
 		{
-			if (TmpChannel.IsValid())
+			if (TmpChannel && TmpChannel->IsValid())
 			{
-				SimpleNetManageCallType = InImplement(TmpChannel.GetNetObject<T>());
+				SimpleNetManageCallType = InImplement(TmpChannel->GetNetObject<T>());
 				if (SimpleNetManageCallType == ESimpleNetManageCallType::PROGRESS_COMPLETE)
 				{
 					break;
@@ -200,23 +281,84 @@ void FSimpleNetManage::FindRemoteNetworkObjectByLambda(TFunction<ESimpleNetManag
 template<uint32 InProtocols, class T, typename ...ParamTypes>
 void FSimpleNetManage::MulticastByPredicate(TFunction<bool(T*)> InImplement, ParamTypes &...Param)
 {
+	//异步协议 包体只序列化和压缩一次 每个接收者只生成自己的包头 加密还是各自进行
+	if (FSimpleProtocols<InProtocols>::IsAsynchronous())
+	{
+		FSimpleSharedBody Body;
+		uint8 ParamNum = (uint8)FRecursionMessageInfo::GetBuildParams(Param...);
+		for (auto& Tmp : Net.RemoteConnetions)
+		{
+			for (auto& TmpChannel : Tmp->GetChannels())
+			{
+				FSimpleChannel* Channel = TmpChannel.Get();
+				if (Channel && Channel->IsValid() && InImplement(Channel->GetNetObject<T>()))
+				{
+					//没有满足条件的接收者就不用序列化
+					if (!Body.IsValid())
+					{
+						Body = FSimpleProtocols<InProtocols>::BuildSharedBody(Param...);
+					}
+
+					FSimpleProtocols<InProtocols>::SendShared(Channel, Channel->GetRemoteAddr(), Body, ParamNum);
+				}
+			}
+		}
+
+		return;
+	}
+
+	//同步协议每个接收者都要等待自己的Tag 只能逐个发送
 	for (auto& Tmp : Net.RemoteConnetions)
 	{
 		ESimpleNetManageCallType SimpleNetManageCallType = ESimpleNetManageCallType::INPROGRESS;
-		for (auto& Channel : Tmp->GetChannels())
+		for (auto& TmpChannel : Tmp->GetChannels())
 		{
-			if (Channel.IsValid())
+			FSimpleChannel* Channel = TmpChannel.Get();
+			if (Channel && Channel->IsValid())
 			{
 				//是否满足可以广播的条件
-				if (InImplement(Channel.GetNetObject<T>()))
+				if (InImplement(Channel->GetNetObject<T>()))
 				{
 #if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 3
 					SIMPLE_PROTOCOLS_SEND(InProtocols, Param...);
 #else
-					FSimpleProtocols<InProtocols>::Send(&Channel, Channel.GetRemoteAddr(), Param...);
+					FSimpleProtocols<InProtocols>::Send(Channel, Channel->GetRemoteAddr(), Param...);
 #endif 
 				}
 			}
 		}
 	}
 }
+
+//按范围广播 和MulticastByPredicate一样 只是接收者来自视野网格
+template<uint32 InProtocols, class T, typename ...ParamTypes>
+void FSimpleNetManage::MulticastByRadius(const FVector& InCenter, float InRadius, TFunction<bool(T*)> InImplement, ParamTypes &...Param)
+{
+	TArray<FSimpleChannel*> Channels;
+	InterestGrid.Query(InCenter, InRadius, Channels);
+
+	FSimpleSharedBody Body;
+	uint8 ParamNum = (uint8)FRecursionMessageInfo::GetBuildParams(Param...);
+	for (FSimpleChannel* Channel : Channels)
+	{
+		//查询之后通道可能已经关闭
+		if (!Channel->IsValid() || (InImplement && !InImplement(Channel->GetNetObject<T>())))
+		{
+			continue;
+		}
+
+		if (FSimpleProtocols<InProtocols>::IsAsynchronous())
+		{
+			if (!Body.IsValid())
+			{
+				Body = FSimpleProtocols<InProtocols>::BuildSharedBody(Param...);
+			}
+
+			FSimpleProtocols<InProtocols>::SendShared(Channel, Channel->GetRemoteAddr(), Body, ParamNum);
+		}
+		else
+		{
+			FSimpleProtocols<InProtocols>::Send(Channel, Channel->GetRemoteAddr(), Param...);
+		}
+	}
+}
@@ -4,6 +4,7 @@
 #include "CoreMinimal.h"
 #include "Channel/SimpleChannel.h"
 #include "Stream/SimpleIOStream.h"
+#include "Stream/SimpleNetBufferPool.h"
 #include "SimpleNetChannelType.h"
 #include "SimpleNetManage.h"
 
@@ -12,10 +13,16 @@ class FSimpleProtocols{};
 
 #define SNC_TIMESCOPE(ContentString) SimpleNetChannel::FTimeCount __TimeCount(ContentString);
 
-#define DEFINITION_SIMPLE_BUFFER  \
-TArray<uint8> Buffer; \
+//缓冲从当前线程的池里借用 InSize是预计的序列化大小
+#define DEFINITION_SIMPLE_BUFFER_SIZE(InSize)  \
+FSimpleNetPooledBuffer PooledBuffer(InSize); \
+TArray<uint8>& Buffer = PooledBuffer.Get(); \
 FSimpleIOStream Stream(Buffer);
 
+#define DEFINITION_SIMPLE_BUFFER DEFINITION_SIMPLE_BUFFER_SIZE(0)
+
+#define DEFINITION_SIMPLE_SEND_SIZE (int32)sizeof(FSimpleBunchHead) + FRecursionMessageInfo::GetSendParamsSize(Params...)
+
 #define DEFINITION_SIMPLE_HEARD(ProtocolsName,InbValue) \
 FSimpleBunchHead Head; \
 Head.ProtocolsNumber = (uint32)SP_##ProtocolsName;\
@@ -44,6 +51,19 @@ public:
 		BuildSendParams(InStream, Param...);
 	}
 
+	template<typename ...ParamTypes>
+	static int32 GetSendParamsSize(ParamTypes &...Param)
+	{
+		return 0;
+	}
+
+	//参数序列化后的总大小 发送前一次性分配
+	template<class T, typename ...ParamTypes>
+	static int32 GetSendParamsSize(T& FirstParam, ParamTypes &...Param)
+	{
+		return FSimpleIOStream::GetSerializeSize(FirstParam) + GetSendParamsSize(Param...);
+	}
+
 	template<typename ...ParamTypes>
 	static void BuildReceiveParams(FSimpleIOStream& InStream, ParamTypes &...Param) {}
 
@@ -63,7 +83,7 @@ public: \
 	template<typename ...ParamTypes> \
 	static void Send(FSimpleChannel* InChannel,TSharedPtr<FInternetAddr> InAddr,ParamTypes &...Params) \
 	{ \
-		DEFINITION_SIMPLE_BUFFER \
+		DEFINITION_SIMPLE_BUFFER_SIZE(DEFINITION_SIMPLE_SEND_SIZE) \
 		DEFINITION_SIMPLE_HEARD(ProtocolsName,bAsynchronous) \
 		FRecursionMessageInfo::BuildSendParams(Stream, Params...); \
 		InChannel->Send(Buffer,InAddr,bForceSend);\
@@ -81,11 +101,29 @@ public: \
 	template<typename ...ParamTypes> \
 	static void BuildBytes(FSimpleChannel* InChannel,TArray<uint8> &OutBuffer,ParamTypes &...Params) \
 	{ \
-		DEFINITION_SIMPLE_BUFFER(Buffer); \
+		DEFINITION_SIMPLE_BUFFER_SIZE(DEFINITION_SIMPLE_SEND_SIZE) \
 		DEFINITION_SIMPLE_HEARD(ProtocolsName,bAsynchronous) \
 		FRecursionMessageInfo::BuildSendParams(Stream,Params...); \
 		InChannel->BuildBytes(Buffer,OutBuffer,bForceSend);\
 	} \
+	static constexpr bool IsForceSend() { return bForceSend; } \
+	static constexpr bool IsAsynchronous() { return bAsynchronous; } \
+	template<typename ...ParamTypes> \
+	static FSimpleSharedBody BuildSharedBody(ParamTypes &...Params) \
+	{ \
+		DEFINITION_SIMPLE_BUFFER_SIZE(FRecursionMessageInfo::GetSendParamsSize(Params...)) \
+		FRecursionMessageInfo::BuildSendParams(Stream,Params...); \
+		return FSimpleChannel::MakeSharedBody(Buffer); \
+	} \
+	static void SendShared(FSimpleChannel* InChannel,TSharedPtr<FInternetAddr> InAddr,const FSimpleSharedBody& InBody,uint8 InParamNum) \
+	{ \
+		FSimpleBunchHead Head; \
+		Head.ProtocolsNumber = (uint32)SP_##ProtocolsName;\
+		Head.ParamNum = InParamNum; \
+		Head.ChannelID = InChannel->GetGuid(); \
+		Head.bAsynchronous = bAsynchronous; \
+		InChannel->SendShared(Head,InBody,InAddr,bForceSend);\
+	} \
 };
 
 //针对异步
@@ -0,0 +1,168 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+//网络统计 计数器都是原子变量 收发路径上不加锁也不分配内存
+//需要看的时候取快照 或者按StatsDumpInterval定期输出到日志
+
+//往返时间直方图 按毫秒2的幂分桶 第0个桶是1ms以内 最后一个桶放所有更大的
+enum
+{
+	SimpleNetRTTBucketNum = 12,
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetTrafficStats
+{
+	FSimpleNetTrafficStats()
+		:BytesIn(0)
+		, PacketsIn(0)
+		, BytesOut(0)
+		, PacketsOut(0)
+	{}
+
+	FSimpleNetTrafficStats& operator+=(const FSimpleNetTrafficStats& InStats);
+
+	uint64 BytesIn;
+	uint64 PacketsIn;
+	uint64 BytesOut;
+	uint64 PacketsOut;
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetConnetionStats
+{
+	FSimpleNetConnetionStats();
+
+	int32 SlotIndex;//本地链接为INDEX_NONE
+	FString Addr;
+
+	//数据报 包括包头和加密的开销
+	FSimpleNetTrafficStats Traffic;
+
+	uint64 RetransmitNum;
+	double SRTT;
+	uint32 RTTHistogram[SimpleNetRTTBucketNum];
+
+	//分片合成整包
+	uint64 ReassemblyNum;
+	double ReassemblyTime;//累计 秒
+	double ReassemblyMaxTime;
+
+	//所有通道消息队列里还没被协议取走的
+	int64 QueueDepth;
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetProtocolStats
+{
+	FSimpleNetProtocolStats()
+		:ProtocolsNumber(0)
+	{}
+
+	uint32 ProtocolsNumber;
+
+	//消息 压缩后分片前的大小
+	FSimpleNetTrafficStats Traffic;
+};
+
+struct SIMPLENETCHANNEL_API FSimpleNetStatsSnapshot
+{
+	FSimpleNetStatsSnapshot()
+		:Time(0.0)
+	{}
+
+	double Time;
+
+	FSimpleNetTrafficStats Total;
+	TArray<FSimpleNetConnetionStats> Connetions;
+	TArray<FSimpleNetProtocolStats> Protocols;
+
+	//一行总计 每个链接一行 每个协议一行
+	void Dump() const;
+};
+
+//收发计数 一组四个
+class SIMPLENETCHANNEL_API FSimpleNetTrafficCounter
+{
+public:
+	FORCEINLINE void OnRecv(int32 InBytes)
+	{
+		BytesIn.Add(InBytes);
+		PacketsIn.Increment();
+	}
+
+	FORCEINLINE void OnSend(int32 InBytes)
+	{
+		BytesOut.Add(InBytes);
+		PacketsOut.Increment();
+	}
+
+	void GetStats(FSimpleNetTrafficStats& OutStats) const;
+	void Reset();
+
+protected:
+	FThreadSafeCounter64 BytesIn;
+	FThreadSafeCounter64 PacketsIn;
+	FThreadSafeCounter64 BytesOut;
+	FThreadSafeCounter64 PacketsOut;
+};
+
+//每个链接一份 重传和平滑往返时间取快照时从拥塞控制里读
+class SIMPLENETCHANNEL_API FSimpleNetConnetionTelemetry
+{
+public:
+	FSimpleNetConnetionTelemetry();
+
+	FORCEINLINE void OnRecv(int32 InBytes) { Traffic.OnRecv(InBytes); }
+	FORCEINLINE void OnSend(int32 InBytes) { Traffic.OnSend(InBytes); }
+
+	void OnRTTSample(double InRTT);
+	void OnReassembly(double InSeconds);
+
+	//只填这里记录的部分
+	void GetStats(FSimpleNetConnetionStats& OutStats) const;
+
+	//链接被复用时清零
+	void Reset();
+
+protected:
+	FSimpleNetTrafficCounter Traffic;
+
+	FThreadSafeCounter RTTHistogram[SimpleNetRTTBucketNum];
+
+	FThreadSafeCounter64 ReassemblyNum;
+	FThreadSafeCounter64 ReassemblyTime;//单位微秒
+	volatile int64 ReassemblyMaxTime;
+};
+
+//按协议号统计 每个管理器一份
+//固定大小的开放寻址表 第一次见到的协议号用CAS占一个槽 之后只做原子加
+//槽用完以后新的协议号都记在溢出槽里 快照里协议号为MAX_uint32
+class SIMPLENETCHANNEL_API FSimpleNetProtocolTelemetry
+{
+public:
+	enum
+	{
+		SlotNum = 256,
+	};
+
+	FSimpleNetProtocolTelemetry();
+
+	void OnRecv(uint32 InProtocolsNumber, int32 InBytes);
+	void OnSend(uint32 InProtocolsNumber, int32 InBytes);
+
+	//没有流量的协议不输出
+	void GetStats(TArray<FSimpleNetProtocolStats>& OutStats) const;
+	void Reset();
+
+protected:
+	FSimpleNetTrafficCounter& FindOrAdd(uint32 InProtocolsNumber);
+
+protected:
+	//协议号加一 0代表空槽
+	volatile int32 Keys[SlotNum];
+	FSimpleNetTrafficCounter Counters[SlotNum];
+	FSimpleNetTrafficCounter Overflow;
+};
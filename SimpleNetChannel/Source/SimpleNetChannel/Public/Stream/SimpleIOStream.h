@@ -106,21 +106,19 @@ public:
 		int32 Num = 0;
 		Stream >> Num; 
 
-		if (Num >= 1753880896)
+		if (!CheckNum(Num, sizeof(T)))
 		{
-			PrintMsg(TEXT("Value = 1753880896"));
+			return *this;
 		}
-		else if (Num > 0)
+
+		if (Num > 0)
 		{
 			int32 InLength = sizeof(T) * Num;
-			if (InLength > 0)
-			{
-				InValue.AddUninitialized(Num);
+			InValue.SetNumUninitialized(Num);
 
-				FMemory::Memcpy(InValue.GetData(), Ptr, InLength);
+			FMemory::Memcpy(InValue.GetData(), Tall(), InLength);
 
-				Seek(InLength);
-			}
+			Seek(InLength);
 		}
 
 		return *this;
@@ -133,13 +131,10 @@ public:
 		int32 Num = 0;
 		Stream >> Num; 
 
-		if (Num >= 1753880896)
+		//每个元素至少有一个int32的长度
+		if (CheckNum(Num, sizeof(int32)))
 		{
-			PrintMsg(TEXT("Value = 1753880896"));
-		}
-		else if (Num > 0)
-		{
-			for (int32 i = 0 ;i < Num ;i++)
+			for (int32 i = 0 ;i < Num && !bReadError ;i++)
 			{
 				TArray<T> &InValueArray = InValue.AddDefaulted_GetRef();
 				Stream >> InValueArray;
@@ -156,9 +151,9 @@ public:
 		int32 Num = 0;
 		Stream >> Num;
 
-		if (Num > 0)
+		if (CheckNum(Num, 1))
 		{
-			for (int32 i = 0; i < Num; i++)
+			for (int32 i = 0; i < Num && !bReadError; i++)
 			{
 				Key InKey;
 				Stream >> InKey;
@@ -178,13 +173,9 @@ public:
 		int32 Num = 0;
 		Stream >> Num;
 
-		if (Num >= 1753880896)
+		if (CheckNum(Num, sizeof(int32)))
 		{
-			PrintMsg(TEXT("Value = 1753880896"));
-		}
-		else if (Num > 0)
-		{
-			for (int32 i = 0; i < Num; i++)
+			for (int32 i = 0; i < Num && !bReadError; i++)
 			{
 				InValue.Add(FString());
 				FString& MyString = InValue.Last();
@@ -198,30 +189,103 @@ public:
 
 	FSimpleIOStream& operator>>(FString& InValue);
 
+	//序列化后的字节数 和operator<<一一对应 用来提前分配缓冲
+public:
+	template<class T>
+	static int32 GetSerializeSize(const T& InValue)
+	{
+		return sizeof(T);
+	}
+
+	template<class T>
+	static int32 GetSerializeSize(const TArray<T>& InValue)
+	{
+		return sizeof(int32) + sizeof(T) * InValue.Num();
+	}
+
+	template<class Key, class Value>
+	static int32 GetSerializeSize(const TMap<Key, Value>& InValue)
+	{
+		int32 Size = sizeof(int32);
+		for (auto& Tmp : InValue)
+		{
+			Size += GetSerializeSize(Tmp.Key);
+			Size += GetSerializeSize(Tmp.Value);
+		}
+
+		return Size;
+	}
+
+	template<class T>
+	static int32 GetSerializeSize(const TArray<TArray<T>>& InValue)
+	{
+		int32 Size = sizeof(int32);
+		for (auto& Tmp : InValue)
+		{
+			Size += GetSerializeSize(Tmp);
+		}
+
+		return Size;
+	}
+
+	static int32 GetSerializeSize(const TArray<FString>& InValue)
+	{
+		int32 Size = sizeof(int32);
+		for (auto& Tmp : InValue)
+		{
+			Size += GetSerializeSize(Tmp);
+		}
+
+		return Size;
+	}
+
+	static int32 GetSerializeSize(const FString& InValue)
+	{
+		return GetSerializeSize(InValue.GetCharArray());
+	}
+
 private:
-	void Wirte(void* InData, int64 InLength);
+	void Wirte(const void* InData, int64 InLength);
 
 	template<class T>
 	void Read(T &InValue)
 	{
-		Seek(0);//
-
-		InValue = *(T*)Ptr;
-		Seek(sizeof(T));
+		if (CanRead(sizeof(T)))
+		{
+			FMemory::Memcpy(&InValue, Tall(), sizeof(T));
+			Seek(sizeof(T));
+		}
 	}
 
+	//剩余字节不够的话标记错误 之后的读取全部跳过
+	bool CanRead(int64 InLength);
+
+	//InNum个元素 每个至少InElementSize字节 不能超过剩余字节
+	bool CheckNum(int32 InNum, int64 InElementSize);
+
 public:
 	void Seek(int32 InPos = 1);
 
+	//为接下来的写入预留空间
+	void Reserve(int32 InSize);
+
 	uint8* Begin();
 	uint8* End();
 	uint8* Tall();
 
+	int32 GetPos() const { return Pos; }
+	int32 GetRemaining() const { return Buffer.Num() - Pos; }
+
+	//读取越界或者长度非法
+	bool IsError() const { return bReadError; }
+
 private:
 	void PrintMsg(const FString& InString);
 
 private:
-	uint8* Ptr;
+	//使用偏移而不是指针 写入时缓冲重新分配不会导致读取位置失效
+	int32 Pos;
+	bool bReadError;
 };
 
 #if PLATFORM_WINDOWS
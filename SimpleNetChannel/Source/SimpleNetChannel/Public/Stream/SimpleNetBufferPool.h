@@ -0,0 +1,42 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//协议缓冲池 每个线程一份 不需要加锁
+//按容量分级回收 稳定运行后收发协议不再申请内存
+class SIMPLENETCHANNEL_API FSimpleNetBufferPool
+{
+public:
+	//取出一个空缓冲 容量至少是InSize InSize为0时返回不带内存的空缓冲
+	static TArray<uint8> Acquire(int32 InSize);
+
+	//还回当前线程的池里 容量太小或者太大的直接释放
+	static void Release(TArray<uint8>& InBuffer);
+
+	//当前线程池里缓存的数量
+	static int32 GetPooledNum();
+};
+
+//作用域内借用一个缓冲 析构时自动归还
+class SIMPLENETCHANNEL_API FSimpleNetPooledBuffer
+{
+public:
+	explicit FSimpleNetPooledBuffer(int32 InSize = 0)
+		:Buffer(FSimpleNetBufferPool::Acquire(InSize))
+	{}
+
+	~FSimpleNetPooledBuffer()
+	{
+		FSimpleNetBufferPool::Release(Buffer);
+	}
+
+	FSimpleNetPooledBuffer(const FSimpleNetPooledBuffer&) = delete;
+	FSimpleNetPooledBuffer& operator=(const FSimpleNetPooledBuffer&) = delete;
+
+	FORCEINLINE TArray<uint8>& Get() { return Buffer; }
+
+private:
+	TArray<uint8> Buffer;
+};
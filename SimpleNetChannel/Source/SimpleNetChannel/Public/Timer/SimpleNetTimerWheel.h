@@ -0,0 +1,77 @@
+// Copyright (C) RenZhai.2021.All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//分层时间轮 重传 心跳 超时检测都挂在这里
+//每帧只处理到期的定时器 不需要遍历所有链接和通道
+//4层 每层64格 精度TickInterval秒
+class SIMPLENETCHANNEL_API FSimpleNetTimerWheel
+{
+public:
+	enum
+	{
+		LevelNum = 4,
+		SlotBits = 6,
+		SlotNum = 1 << SlotBits,
+	};
+
+	//0代表无效的定时器
+	typedef uint64 FHandle;
+
+public:
+	FSimpleNetTimerWheel(float InTickInterval = 0.01f);
+
+	//InDelay秒后在Advance的线程执行 执行一次 需要重复的话在回调里重新注册
+	FHandle Schedule(float InDelay, const FSimpleDelegate& InDelegate);
+
+	//已经执行或者取消过的返回false
+	bool Cancel(FHandle InHandle);
+
+	void Advance(float DeltaSeconds);
+	void Reset();
+
+	//时间轮自己的时间 只随Advance前进
+	double GetTime() const { return Time; }
+	int32 GetActiveNum() const;
+
+protected:
+	struct FTimer
+	{
+		FTimer()
+			:Generation(0)
+			, Expire(0)
+			, bActive(false)
+		{}
+
+		uint32 Generation;//复用后旧的句柄失效
+		uint64 Expire;
+		bool bActive;
+		FSimpleDelegate Delegate;
+	};
+
+	struct FEntry
+	{
+		uint32 Index;
+		uint32 Generation;
+	};
+
+	void Insert(uint32 InIndex);
+	void Cascade(int32 InLevel);
+	bool IsValidEntry(const FEntry& InEntry) const;
+
+protected:
+	float TickInterval;
+	double Time;
+	double PendingTime;
+	uint64 CurrentTick;
+
+	TArray<FEntry> Wheels[LevelNum][SlotNum];
+	TArray<FTimer> Timers;
+	TArray<uint32> FreeTimers;
+	int32 ActiveNum;
+
+	//发送线程和网络线程也会注册定时器
+	mutable FCriticalSection Mutex;
+};
@@ -75,10 +75,14 @@ protected:
 
 	virtual void RecvProtocol(uint32 InProtocol);
 
+private:
+	//Ping回应超时 由时间轮触发
+	void OnPingTimeout();
+
 protected:
 	FSimpleChannel* Channel;
 
 private:
 	bool bPing;
-	float PingTime;
+	uint64 PingTimer;
 };